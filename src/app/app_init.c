@@ -2,20 +2,42 @@
 
 #include "bsp_usart2_debug.h"
 #include "estop.h"
+#include "home.h"
+#include "inputs.h"
+#include "isr_prof.h"
 #include "limits.h"
+#include "motion.h"
 #include "motion_units.h"
 #include "stepgen_pwm_tim3.h"
 #include "stm32f4xx.h"
 #include "system_clock.h"
 
+// Host link rate: 115200 for terminals; 1000000 / 1500000 are exact on a 45 MHz APB1 and
+// carry dense binary (hostlink) or G-code streams ~9-13x faster
+#ifndef DBG_UART_BAUD
+#define DBG_UART_BAUD 115200U
+#endif
+
+static volatile uint32_t s_millis;
+
+uint32_t app_millis(void) {
+    return s_millis;
+}
 
 static inline void debounce_tick_1k(void) {
+    inputs_tick(); // every switch in one debounce pass
     limits_poll_tick();
     estop_poll_tick();
 }
 
 void SysTick_Handler(void) {
+    ISR_PROF_ENTER();
+    s_millis++;
     debounce_tick_1k();
+    home_tick(); // homing state machines, on fresh switch readings
+    motion_service(); // hand planned blocks to the step engine
+    stepgen_prep(); // top up acceleration ramps (lower priority than the step ISR)
+    ISR_PROF_EXIT(ISR_PROF_SYSTICK);
 }
 
 // Keep device headers out of app layer on purpose.
@@ -23,13 +45,22 @@ void SysTick_Handler(void) {
 
 void app_init(void) {
     system_clock_init(); // SoC clocks
+    dwt_enable(); // cycle stamps (e-stop latency, parse timing)
     SysTick_Config(SystemCoreClock / 1000U);
     const uint32_t pclk1 = 45000000UL; // APB1 after clock setup
-    dbg_uart_init(pclk1, 115200); // early logging
+    dbg_uart_init(pclk1, DBG_UART_BAUD); // early logging
 
     // Board GPIO is inited lazily by each driver/bsp module as needed.
+    inputs_init(); // shared debouncer for the switches below
     estop_init(); // emergency braking system
     limits_init_min(); // limit switch
     stepgen_init_all(); // timer + pins for stepper STEP
+    estop_on_trip(stepgen_trip_all); // first edge stops the steps, debounce only validates
+    limits_on_trip(stepgen_trip_min);
     motion_init_defaults(); // steps/mm config
+    for (int i = 0; i < 3; ++i) {
+        const axis_t a = (axis_t)i;
+        stepgen_set_accel(a, accel_to_hz_s(a, accel_mm_s2(a))); // ramps for single-axis moves
+    }
+    motion_init(); // look-ahead planner for queued lines
 }
@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 void app_init(void);   // clocks, UART debug, drivers, motion units
+uint32_t app_millis(void); // SysTick milliseconds since app_init()
 
 #ifdef __cplusplus
 }
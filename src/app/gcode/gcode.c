@@ -0,0 +1,482 @@
+#include "gcode.h"
+
+#include <math.h>
+#include <string.h>
+
+#define MM_PER_INCH 25.4f
+#define MAX_INT_DIGITS 9U // keeps the mantissa inside uint32_t
+
+static const float POW10_NEG[] = {
+        1.0f, 1e-1f, 1e-2f, 1e-3f, 1e-4f, 1e-5f, 1e-6f, 1e-7f, 1e-8f, 1e-9f};
+
+/*------------ Line assembler ---------------*/
+
+bool gcode_line_feed(gcode_line_t* l, char c) {
+    if (c == '\n' || c == '\r') {
+        if (l->done || !l->seen) {
+            return false; // blank line or the second half of CR LF
+        }
+        l->buf[l->len] = '\0';
+        l->done = 1;
+        return true;
+    }
+
+    if (l->done) {
+        // The completed line stays readable until the next line's first byte
+        l->len = 0;
+        l->comment = 0;
+        l->overflow = 0;
+        l->seen = 0;
+        l->done = 0;
+    }
+    l->seen = 1;
+    if (l->comment) {
+        if (c == ')' && l->comment == '(') {
+            l->comment = 0;
+        }
+        return false;
+    }
+    if (c == '(' || c == ';') {
+        l->comment = (uint8_t)c;
+        return false;
+    }
+    if (c <= ' ' || c > '~') {
+        return false; // spaces, tabs, control bytes
+    }
+    if (c >= 'a' && c <= 'z') {
+        c = (char)(c - 'a' + 'A');
+    }
+    if (l->len >= GCODE_LINE_MAX) {
+        l->overflow = 1;
+        return false;
+    }
+    l->buf[l->len++] = c;
+    return false; // keep collecting
+}
+
+/*------------ Parser ---------------*/
+
+/* [+-]digits[.digits] -> float, without strtod. Extra fraction digits are dropped. */
+static bool read_number(const char** p, const char* end, float* out) {
+    const char* s = *p;
+    bool neg = false;
+    if (s < end && (*s == '-' || *s == '+')) {
+        neg = (*s == '-');
+        s++;
+    }
+
+    uint32_t mant = 0;
+    uint32_t digits = 0; // significant digits in mant
+    uint32_t frac = 0; // of which after the point
+    bool any = false;
+    while (s < end && *s >= '0' && *s <= '9') {
+        if (mant != 0 || *s != '0') {
+            if (digits >= MAX_INT_DIGITS) {
+                return false; // too large for a coordinate
+            }
+            digits++;
+        }
+        mant = mant * 10U + (uint32_t)(*s - '0');
+        any = true;
+        s++;
+    }
+    if (s < end && *s == '.') {
+        s++;
+        while (s < end && *s >= '0' && *s <= '9') {
+            if (digits < MAX_INT_DIGITS && frac < 9U) {
+                mant = mant * 10U + (uint32_t)(*s - '0');
+                if (mant != 0) {
+                    digits++;
+                }
+                frac++;
+            }
+            any = true;
+            s++;
+        }
+    }
+    if (!any) {
+        return false;
+    }
+
+    const float v = (float)mant * POW10_NEG[frac];
+    *out = neg ? -v : v;
+    *p = s;
+    return true;
+}
+
+/* G/M code number: an integer, or G-codes like 38.2 which we reject */
+static bool code_number(float v, uint8_t* code) {
+    if (v < 0.0f || v > 254.0f) {
+        return false;
+    }
+    const uint8_t n = (uint8_t)v;
+    if ((float)n != v) {
+        return false;
+    }
+    *code = n;
+    return true;
+}
+
+static gc_status_t set_group(uint8_t* slot, uint8_t code) {
+    if (*slot != GC_NONE) {
+        return GC_ERR_MODAL_CONFLICT;
+    }
+    *slot = code;
+    return GC_OK;
+}
+
+static gc_status_t parse_g(gcode_block_t* b, uint8_t g) {
+    switch (g) {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+        return set_group(&b->motion, g);
+    case 4:
+    case 10:
+    case 28:
+    case 92:
+        return set_group(&b->non_modal, g);
+    case 17:
+    case 18:
+    case 19:
+        return set_group(&b->plane, g);
+    case 20:
+    case 21:
+        return set_group(&b->units, g);
+    case 54:
+    case 55:
+    case 56:
+    case 57:
+    case 58:
+    case 59:
+        return set_group(&b->coord, g);
+    case 90:
+    case 91:
+        return set_group(&b->distance, g);
+    default:
+        return GC_ERR_UNSUPPORTED_G;
+    }
+}
+
+static gc_status_t parse_m(gcode_block_t* b, uint8_t m) {
+    switch (m) {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+    case 4:
+    case 5:
+    case 17:
+    case 18:
+    case 30:
+    case 84:
+        return set_group(&b->mcode, m);
+    default:
+        return GC_ERR_UNSUPPORTED_M;
+    }
+}
+
+static float* word_slot(gcode_block_t* b, char letter, uint16_t* bit) {
+    switch (letter) {
+    case 'X':
+        *bit = GC_WORD_X;
+        return &b->xyz[0];
+    case 'Y':
+        *bit = GC_WORD_Y;
+        return &b->xyz[1];
+    case 'Z':
+        *bit = GC_WORD_Z;
+        return &b->xyz[2];
+    case 'I':
+        *bit = GC_WORD_I;
+        return &b->ijk[0];
+    case 'J':
+        *bit = GC_WORD_J;
+        return &b->ijk[1];
+    case 'K':
+        *bit = GC_WORD_K;
+        return &b->ijk[2];
+    case 'R':
+        *bit = GC_WORD_R;
+        return &b->r;
+    case 'F':
+        *bit = GC_WORD_F;
+        return &b->f;
+    case 'P':
+        *bit = GC_WORD_P;
+        return &b->p;
+    case 'S':
+        *bit = GC_WORD_S;
+        return &b->s;
+    case 'L':
+        *bit = GC_WORD_L;
+        return &b->l;
+    default:
+        return NULL;
+    }
+}
+
+gc_status_t gcode_parse(const char* line, uint16_t len, gcode_block_t* b) {
+    memset(b, 0, sizeof *b);
+    b->motion = b->non_modal = b->plane = b->units = b->distance = b->coord = b->mcode =
+            GC_NONE;
+
+    const char* p = line;
+    const char* end = line + len;
+    if (p == end) {
+        return GC_ERR_EMPTY;
+    }
+
+    while (p < end) {
+        const char letter = *p++;
+        float v;
+        if (letter < 'A' || letter > 'Z') {
+            return GC_ERR_BAD_WORD;
+        }
+        if (!read_number(&p, end, &v)) {
+            return GC_ERR_BAD_NUMBER;
+        }
+
+        gc_status_t st = GC_OK;
+        uint8_t code;
+        uint16_t bit;
+        float* slot;
+        switch (letter) {
+        case 'G':
+            st = code_number(v, &code) ? parse_g(b, code) : GC_ERR_UNSUPPORTED_G;
+            break;
+        case 'M':
+            st = code_number(v, &code) ? parse_m(b, code) : GC_ERR_UNSUPPORTED_M;
+            break;
+        case 'N':
+            break; // line number: ignored
+        default:
+            slot = word_slot(b, letter, &bit);
+            if (slot == NULL) {
+                st = GC_ERR_BAD_WORD;
+            } else if (b->words & bit) {
+                st = GC_ERR_REPEATED_WORD;
+            } else {
+                b->words |= bit;
+                *slot = v;
+            }
+            break;
+        }
+        if (st != GC_OK) {
+            return st;
+        }
+    }
+    return GC_OK;
+}
+
+/*------------ Interpreter ---------------*/
+
+void gcode_init(gcode_state_t* st) {
+    memset(st, 0, sizeof *st);
+    st->motion = 0;
+    st->plane = 17;
+}
+
+/* In-plane axes of the arc, ordered so G2 is clockwise seen from the plane normal */
+void gcode_plane_axes(uint8_t plane, int* a0, int* a1) {
+    if (plane == 18) {
+        *a0 = 2; // ZX
+        *a1 = 0;
+    } else if (plane == 19) {
+        *a0 = 1; // YZ
+        *a1 = 2;
+    } else {
+        *a0 = 0; // XY
+        *a1 = 1;
+    }
+}
+
+/*
+G10 L2 Pn (origin in machine coordinates) / L20 Pn (the current point becomes the given work
+coordinate of system n). P0 is the active system. Only the named axes change.
+*/
+static gc_status_t set_wcs(gcode_state_t* s, const gcode_block_t* b, float unit) {
+    if (!(b->words & GC_WORD_L) || !(b->words & GC_WORD_P)) {
+        return GC_ERR_MISSING_WORDS;
+    }
+    uint8_t l, p;
+    if (!code_number(b->l, &l) || (l != 2U && l != 20U)) {
+        return GC_ERR_UNSUPPORTED;
+    }
+    if (!code_number(b->p, &p) || p > GCODE_WCS_COUNT) {
+        return GC_ERR_BAD_VALUE;
+    }
+    float* origin = s->wcs[p == 0U ? s->coord : p - 1U];
+    for (int i = 0; i < 3; ++i) {
+        if (b->words & (GC_WORD_X << i)) {
+            const float v = b->xyz[i] * unit;
+            origin[i] = (l == 2U) ? v : s->pos[i] - s->offset[i] - v;
+        }
+    }
+    return GC_OK;
+}
+
+/*
+Arc center from the radius form: the center sits on the perpendicular bisector of the chord,
+h away from its midpoint. G2 with R > 0 takes the short (< 180 deg) arc; a negative R asks
+for the long one.
+*/
+static gc_status_t center_from_radius(const float start[3],
+                                      const float target[3],
+                                      float r,
+                                      bool ccw,
+                                      int a0,
+                                      int a1,
+                                      float center[3]) {
+    const float x = target[a0] - start[a0];
+    const float y = target[a1] - start[a1];
+    const float d2 = x * x + y * y;
+    if (d2 == 0.0f) {
+        return GC_ERR_MISSING_WORDS; // full circle needs I/J/K
+    }
+    float h2 = 4.0f * r * r - d2;
+    if (h2 < 0.0f) {
+        if (h2 < -1e-3f * d2) {
+            return GC_ERR_MISSING_WORDS; // radius shorter than half the chord
+        }
+        h2 = 0.0f;
+    }
+    float h = -sqrtf(h2 / d2);
+    if (ccw) {
+        h = -h;
+    }
+    if (r < 0.0f) {
+        h = -h;
+    }
+    memcpy(center, start, 3 * sizeof(float));
+    center[a0] = start[a0] + 0.5f * (x - y * h);
+    center[a1] = start[a1] + 0.5f * (y + x * h);
+    return GC_OK;
+}
+
+gc_status_t gcode_execute(gcode_state_t* st, const gcode_block_t* b, gc_cmd_t* cmds, uint8_t* n) {
+    gcode_state_t s = *st; // committed only on success
+    *n = 0;
+
+    if (b->plane != GC_NONE) {
+        s.plane = b->plane;
+    }
+    if (b->units != GC_NONE) {
+        s.inches = (b->units == 20);
+    }
+    if (b->distance != GC_NONE) {
+        s.relative = (b->distance == 91);
+    }
+    if (b->coord != GC_NONE) {
+        s.coord = (uint8_t)(b->coord - 54U);
+    }
+    const float unit = s.inches ? MM_PER_INCH : 1.0f;
+    if (b->words & GC_WORD_F) {
+        s.feed_mm_min = b->f * unit;
+    }
+
+    // Program point of this line (machine mm) from the axis words
+    float target[3];
+    for (int i = 0; i < 3; ++i) {
+        target[i] = s.pos[i];
+        if (b->words & (GC_WORD_X << i)) {
+            const float v = b->xyz[i] * unit;
+            target[i] = s.relative ? s.pos[i] + v : v + s.wcs[s.coord][i] + s.offset[i];
+        }
+    }
+    const bool axes = (b->words & GC_WORD_AXES) != 0;
+
+    switch (b->non_modal) {
+    case 4:
+        if (!(b->words & GC_WORD_P) || b->p < 0.0f) {
+            return GC_ERR_MISSING_WORDS;
+        }
+        cmds[(*n)++] = (gc_cmd_t){.type = GC_CMD_DWELL, .seconds = b->p};
+        break;
+    case 10: {
+        const gc_status_t e = set_wcs(&s, b, unit);
+        if (e != GC_OK) {
+            return e;
+        }
+        break;
+    }
+    case 92:
+        if (!axes) {
+            return GC_ERR_MISSING_WORDS;
+        }
+        // The current point becomes the given work coordinate: nothing moves
+        for (int i = 0; i < 3; ++i) {
+            if (b->words & (GC_WORD_X << i)) {
+                s.offset[i] = s.pos[i] - s.wcs[s.coord][i] - b->xyz[i] * unit;
+            }
+        }
+        break;
+    case 28:
+        // Rapid through the optional intermediate point, then to machine zero on those axes
+        // (all axes when none are given)
+        if (axes) {
+            cmds[(*n)++] = (gc_cmd_t){.type = GC_CMD_RAPID,
+                                      .target = {target[0], target[1], target[2]}};
+        }
+        for (int i = 0; i < 3; ++i) {
+            if (!axes || (b->words & (GC_WORD_X << i))) {
+                target[i] = 0.0f;
+            }
+        }
+        cmds[(*n)++] = (gc_cmd_t){.type = GC_CMD_RAPID,
+                                  .target = {target[0], target[1], target[2]}};
+        memcpy(s.pos, target, sizeof target);
+        break;
+    default:
+        break;
+    }
+
+    if (b->motion != GC_NONE) {
+        s.motion = b->motion;
+    }
+    if (axes && b->non_modal == GC_NONE) {
+        gc_cmd_t c = {.target = {target[0], target[1], target[2]}};
+        if (s.motion == 0) {
+            c.type = GC_CMD_RAPID;
+        } else {
+            if (s.feed_mm_min <= 0.0f) {
+                return GC_ERR_NO_FEED;
+            }
+            c.feed_mm_min = s.feed_mm_min;
+            c.type = (s.motion == 1) ? GC_CMD_LINE : GC_CMD_ARC;
+        }
+
+        if (c.type == GC_CMD_ARC) {
+            int a0, a1;
+            gcode_plane_axes(s.plane, &a0, &a1);
+            c.plane = s.plane;
+            c.ccw = (s.motion == 3);
+            if (b->words & GC_WORD_R) {
+                const gc_status_t e =
+                        center_from_radius(s.pos, target, b->r * unit, c.ccw, a0, a1, c.center);
+                if (e != GC_OK) {
+                    return e;
+                }
+            } else {
+                const uint16_t ij = (uint16_t)((GC_WORD_I << a0) | (GC_WORD_I << a1));
+                if (!(b->words & ij)) {
+                    return GC_ERR_MISSING_WORDS;
+                }
+                memcpy(c.center, s.pos, sizeof c.center);
+                c.center[a0] += b->ijk[a0] * unit; // offsets are always incremental
+                c.center[a1] += b->ijk[a1] * unit;
+            }
+        }
+        cmds[(*n)++] = c;
+        memcpy(s.pos, target, sizeof target);
+    } else if ((b->motion == 2 || b->motion == 3) && !axes) {
+        return GC_ERR_MISSING_WORDS;
+    }
+
+    if (b->mcode != GC_NONE) {
+        cmds[(*n)++] = (gc_cmd_t){.type = GC_CMD_MCODE, .mcode = b->mcode};
+    }
+    *st = s;
+    return GC_OK;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * G-code front end (hardware independent, no heap, no strtod).
+ *
+ *  - gcode_line_feed(): byte-at-a-time line assembler. Drops spaces and comments, upper-cases
+ *    letters, and leaves one clean line in its own buffer.
+ *  - gcode_parse(): reads that buffer in place into a compact gcode_block_t (words + G/M codes).
+ *  - gcode_execute(): applies the modal state (G17-19, G20/21, G54-59, G90/91, G92, feed)
+ *    and emits a few commands in machine millimetres for the motion queue.
+ *  - gcode_arc.h: cuts a G2/G3 command into chords for the motion queue.
+ *
+ * Coordinates: machine = work + wcs[active] (G54..G59, set by G10) + offset (G92). Machine zero
+ * is where homing left the step counters.
+ *
+ * Supported: G0 G1 G2 G3 G4 G10 L2/L20 G17 G18 G19 G20 G21 G28 G54-G59 G90 G91 G92, M0 M1 M2
+ * M3 M4 M5 M17 M18 M30 M84.
+ */
+
+#define GCODE_LINE_MAX 96U // characters kept per line after stripping
+
+typedef enum {
+    GC_OK = 0,
+    GC_ERR_EMPTY, // nothing but comments / whitespace (not an error to the sender)
+    GC_ERR_LINE_OVERFLOW, // longer than GCODE_LINE_MAX after stripping
+    GC_ERR_BAD_NUMBER, // letter without a valid number
+    GC_ERR_BAD_WORD, // unknown letter
+    GC_ERR_REPEATED_WORD, // the same axis/parameter word twice
+    GC_ERR_MODAL_CONFLICT, // two codes from the same modal group
+    GC_ERR_UNSUPPORTED_G,
+    GC_ERR_UNSUPPORTED_M,
+    GC_ERR_NO_FEED, // G1/G2/G3 with no feed rate set
+    GC_ERR_MISSING_WORDS, // e.g. G4 without P, arc without I/J/K or R
+    GC_ERR_UNSUPPORTED, // valid G-code this controller cannot run (yet)
+    GC_ERR_BAD_VALUE, // word out of range, e.g. G10 P7
+    GC_ERR_SOFT_LIMIT, // target outside the travel envelope (refused by the planner)
+} gc_status_t;
+
+/* Line assembler: feed every received byte; true when `buf` holds a complete line */
+typedef struct {
+    char buf[GCODE_LINE_MAX + 1U]; // NUL-terminated once complete
+    uint16_t len;
+    uint8_t comment; // inside (...) or after ';'
+    uint8_t seen; // any byte on this line (a comment-only line still gets an answer)
+    uint8_t overflow; // line was cut: report GC_ERR_LINE_OVERFLOW
+    uint8_t done; // line complete: the next non-EOL byte starts a new one
+} gcode_line_t;
+
+bool gcode_line_feed(gcode_line_t* l, char c);
+
+/* Word bits in gcode_block_t.words */
+enum {
+    GC_WORD_X = 1U << 0,
+    GC_WORD_Y = 1U << 1,
+    GC_WORD_Z = 1U << 2,
+    GC_WORD_I = 1U << 3,
+    GC_WORD_J = 1U << 4,
+    GC_WORD_K = 1U << 5,
+    GC_WORD_R = 1U << 6,
+    GC_WORD_F = 1U << 7,
+    GC_WORD_P = 1U << 8,
+    GC_WORD_S = 1U << 9,
+    GC_WORD_L = 1U << 10,
+};
+#define GC_WORD_AXES (GC_WORD_X | GC_WORD_Y | GC_WORD_Z)
+#define GC_WORD_IJK (GC_WORD_I | GC_WORD_J | GC_WORD_K)
+
+#define GC_NONE 0xFFU
+
+/* One parsed line; G/M codes are kept as their integer number, GC_NONE if absent */
+typedef struct {
+    uint16_t words; // GC_WORD_* present on the line
+    uint8_t motion; // 0..3 (G0..G3)
+    uint8_t non_modal; // 4, 10, 28, 92
+    uint8_t plane; // 17..19
+    uint8_t units; // 20, 21
+    uint8_t distance; // 90, 91
+    uint8_t coord; // 54..59
+    uint8_t mcode; // M number
+    float xyz[3];
+    float ijk[3];
+    float r, f, p, s, l;
+} gcode_block_t;
+
+gc_status_t gcode_parse(const char* line, uint16_t len, gcode_block_t* b);
+
+#define GCODE_WCS_COUNT 6U // G54..G59
+
+typedef struct {
+    uint8_t motion; // modal motion mode (0..3)
+    uint8_t plane; // 17, 18, 19
+    bool inches; // G20
+    bool relative; // G91
+    float feed_mm_min; // 0 until the first F
+    float pos[3]; // machine position of the program point (mm)
+    uint8_t coord; // active work system, 0..5 = G54..G59
+    float wcs[GCODE_WCS_COUNT][3]; // G10: origin of each work system in machine mm
+    float offset[3]; // G92, on top of the active system: work = machine - wcs - offset
+} gcode_state_t;
+
+typedef enum {
+    GC_CMD_LINE, // feed move to target
+    GC_CMD_RAPID, // G0 to target
+    GC_CMD_ARC, // G2/G3 to target around center in `plane`
+    GC_CMD_DWELL, // wait for motion, then `seconds`
+    GC_CMD_MCODE, // program control / spindle / drivers (`mcode`), in order with motion
+} gc_cmd_type_t;
+
+typedef struct {
+    gc_cmd_type_t type;
+    float target[3]; // machine mm
+    float feed_mm_min;
+    float center[3]; // arcs: machine mm
+    uint8_t plane; // arcs: 17, 18, 19
+    bool ccw; // arcs: G3
+    float seconds; // dwell
+    uint8_t mcode;
+} gc_cmd_t;
+
+// The two in-plane axes of G17 / G18 / G19 (XY, ZX, YZ), in the order that makes G3 CCW
+void gcode_plane_axes(uint8_t plane, int* a0, int* a1);
+
+#define GCODE_MAX_CMDS 3U // G28 via an intermediate point + an M-code on the same line
+
+void gcode_init(gcode_state_t* st); // power-up modal state: G0 G17 G21 G54 G90, no offsets
+
+/**
+ * Apply one parsed block. Writes up to GCODE_MAX_CMDS commands in execution order and
+ * returns how many via *n. The state only changes when GC_OK is returned.
+ */
+gc_status_t gcode_execute(gcode_state_t* st, const gcode_block_t* b, gc_cmd_t* cmds, uint8_t* n);
@@ -0,0 +1,78 @@
+#include "gcode_arc.h"
+
+#include <math.h>
+#include <string.h>
+
+#define TWO_PI 6.28318530718f
+#define FULL_CIRCLE_EPS 5e-7f // rad: start and target this close make a full circle
+
+void gc_arc_init(gc_arc_t* a, const float start[3], const gc_cmd_t* c, float tol_mm) {
+    gcode_plane_axes(c->plane, &a->a0, &a->a1);
+    a->a2 = 3 - a->a0 - a->a1;
+    memcpy(a->target, c->target, sizeof a->target);
+    a->center[0] = c->center[a->a0];
+    a->center[1] = c->center[a->a1];
+    a->r0[0] = start[a->a0] - a->center[0];
+    a->r0[1] = start[a->a1] - a->center[1];
+    a->r[0] = a->r0[0];
+    a->r[1] = a->r0[1];
+    a->lin0 = start[a->a2];
+    a->done = 0;
+
+    // Signed travel from start to target; G2 runs negative, G3 positive, equal ends go round
+    const float tx = c->target[a->a0] - a->center[0];
+    const float ty = c->target[a->a1] - a->center[1];
+    float angle = atan2f(a->r0[0] * ty - a->r0[1] * tx, a->r0[0] * tx + a->r0[1] * ty);
+    if (c->ccw) {
+        if (angle <= FULL_CIRCLE_EPS) {
+            angle += TWO_PI;
+        }
+    } else if (angle >= -FULL_CIRCLE_EPS) {
+        angle -= TWO_PI;
+    }
+
+    const float radius = sqrtf(a->r0[0] * a->r0[0] + a->r0[1] * a->r0[1]);
+    uint32_t n = 1;
+    if (tol_mm > 0.0f && 2.0f * radius > tol_mm) {
+        const float chord = 2.0f * sqrtf(tol_mm * (2.0f * radius - tol_mm));
+        n = (uint32_t)ceilf(fabsf(angle) * radius / chord);
+        n = n ? n : 1U;
+    }
+    a->segments = n;
+    a->theta = angle / (float)n;
+    const float half = sinf(0.5f * a->theta);
+    a->vers_t = 2.0f * half * half; // 1 - cos(theta) without rounding cos() near 1
+    a->sin_t = sinf(a->theta);
+    a->lin_step = (c->target[a->a2] - a->lin0) / (float)n;
+}
+
+bool gc_arc_next(gc_arc_t* a, float out[3]) {
+    if (a->done >= a->segments) {
+        return false;
+    }
+    a->done++;
+    if (a->done == a->segments) {
+        memcpy(out, a->target, sizeof a->target); // exactly where the program says
+        return true;
+    }
+
+    float x, y;
+    if (a->done % GC_ARC_CORRECTION == 0U) {
+        const float t = a->theta * (float)a->done;
+        const float c = cosf(t), s = sinf(t);
+        x = a->r0[0] * c - a->r0[1] * s;
+        y = a->r0[0] * s + a->r0[1] * c;
+    } else {
+        // x cos - y sin as x - (x vers + y sin): the small terms keep their precision
+        const float v = a->vers_t, s = a->sin_t;
+        x = a->r[0] - (a->r[0] * v + a->r[1] * s);
+        y = a->r[1] + (a->r[0] * s - a->r[1] * v);
+    }
+    a->r[0] = x;
+    a->r[1] = y;
+
+    out[a->a0] = a->center[0] + x;
+    out[a->a1] = a->center[1] + y;
+    out[a->a2] = a->lin0 + a->lin_step * (float)a->done;
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "gcode.h"
+
+/**
+ * G2/G3 arcs as short lines for the motion queue (hardware independent, no heap).
+ *
+ * The arc is cut into equal angular steps whose chords stay within `tol_mm` of it. A chord of
+ * length l on radius r sags r - sqrt(r^2 - l^2 / 4), so l may be 2 sqrt(tol (2r - tol)).
+ * Each point is the previous radius vector turned by one fixed rotation: two sinf per arc,
+ * four multiplies per point. The rotation is kept as sin(theta) and 1 - cos(theta), since
+ * cosf() of a small step rounds to a value near 1 that lengthens or shortens the vector. The
+ * rounding left still adds up step by step, so every GC_ARC_CORRECTION points the vector is
+ * recomputed exactly from the start one. The last point is the programmed target itself. On a
+ * helix the third axis moves linearly with the angle.
+ *
+ * Float limit: points stay within about 2 ulp of the radius from the circle (0.07 um at
+ * r = 500 mm, under a 0.1 um tolerance). Along the arc they sit within a few ulp of the
+ * angle times r (0.25 um on a full 500 mm circle), which moves them on the circle, not off it.
+ */
+
+#define GC_ARC_CORRECTION 4U // points between exact sin/cos corrections
+
+typedef struct {
+    float center[2]; // in the plane (axes a0, a1)
+    float r0[2]; // start - center
+    float r[2]; // last point - center
+    float vers_t; // one step's rotation: 1 - cos(theta)
+    float sin_t; // and sin(theta)
+    float theta; // angle per step (rad, + = CCW)
+    float lin0; // third axis at the start
+    float lin_step; // and per step
+    float target[3];
+    int a0, a1, a2;
+    uint32_t segments; // points in all; the last one is `target`
+    uint32_t done; // points handed out
+} gc_arc_t;
+
+/* Plan the GC_CMD_ARC `c` from `start` (machine mm) with chords within tol_mm (> 0) */
+void gc_arc_init(gc_arc_t* a, const float start[3], const gc_cmd_t* c, float tol_mm);
+
+/* Next line end point into `out`; false once the target has been handed out */
+bool gc_arc_next(gc_arc_t* a, float out[3]);
@@ -0,0 +1,452 @@
+#include "gcode_stream.h"
+
+#include <math.h>
+#include <stdbool.h>
+
+#include "app_init.h"
+#include "bsp_usart2_debug.h"
+#include "estop.h"
+#include "gcode.h"
+#include "gcode_arc.h"
+#include "hostlink.h"
+#include "isr_prof.h"
+#include "motion.h"
+#include "planner.h"
+#include "stepgen_pwm_tim3.h"
+#include "system_clock.h"
+
+#define RAPID_MM_MIN 3000.0f // G0 feed along the path
+#define ARC_TOLERANCE_MM 0.002f // G2/G3 chords stay this close to the arc
+
+static gcode_line_t s_line;
+static gcode_state_t s_gc;
+static gc_cmd_t s_cmds[GCODE_MAX_CMDS];
+static uint8_t s_n; // commands of the current line
+static uint8_t s_next; // first one not yet queued
+static bool s_dwelling;
+static uint32_t s_dwell_until_ms;
+static gcode_stream_stats_t s_stats;
+static hl_decoder_t s_hl;
+static hl_modal_t s_hl_modal; // origin for HL_T_DELTA frames
+static hl_rt_t s_rt; // realtime bytes, scanned in the RX interrupt
+static gc_arc_t s_arc; // G2/G3 being cut into lines
+static bool s_arc_on;
+static bool s_arc_have; // s_arc_pt is taken from the arc but not yet queued
+static float s_arc_pt[3];
+
+static void put_u32(uint32_t v) {
+    char buf[11];
+    int i = 10;
+    buf[i] = '\0';
+    do {
+        buf[--i] = (char)('0' + v % 10U);
+        v /= 10U;
+    } while (v != 0U);
+    dbg_write(&buf[i]);
+}
+
+static void put_i32(int32_t v) {
+    if (v < 0) {
+        dbg_write("-");
+    }
+    put_u32(v < 0 ? 0U - (uint32_t)v : (uint32_t)v);
+}
+
+static void reply_error(uint32_t code) {
+    dbg_write("error:");
+    put_u32(code);
+    dbg_write("\r\n");
+}
+
+static void reply(gc_status_t st) {
+    if (st == GC_OK || st == GC_ERR_EMPTY) {
+        char ack[HL_ACK_MAX];
+        hl_format_ack(ack, motion_free(), dbg_rx_free()); // "ok Bf:<blocks>,<bytes>"
+        dbg_write(ack);
+        return;
+    }
+    reply_error((uint32_t)st);
+}
+
+static void set_drivers(bool on) {
+    for (int i = 0; i < 3; ++i) {
+        stepgen_enable((axis_t)i, on);
+    }
+}
+
+/* Queued, or refused (sets *err); false = not yet, try again on the next service call */
+static bool queue_line(const float target[3],
+                       float feed_mm_min,
+                       bool rapid,
+                       gc_status_t* err) {
+    switch (motion_line_to(target, feed_mm_min, rapid)) {
+    case MOTION_FULL:
+        return false;
+    case MOTION_SOFT_LIMIT:
+        *err = GC_ERR_SOFT_LIMIT;
+        return true;
+    case MOTION_OK:
+    default:
+        return true;
+    }
+}
+
+/* One chord after another from where the queue ends; false = planner full, carry on later */
+static bool run_arc(const gc_cmd_t* c, gc_status_t* err) {
+    if (!s_arc_on) {
+        float start[3];
+        motion_position(start);
+        gc_arc_init(&s_arc, start, c, ARC_TOLERANCE_MM);
+        s_arc_on = true;
+        s_arc_have = false;
+    }
+    for (;;) {
+        if (!s_arc_have) {
+            if (!gc_arc_next(&s_arc, s_arc_pt)) {
+                break;
+            }
+            s_arc_have = true;
+        }
+        if (!queue_line(s_arc_pt, c->feed_mm_min, false, err)) {
+            return false;
+        }
+        s_arc_have = false;
+        if (*err != GC_OK) {
+            break; // soft limit: the rest of the arc is dropped with the line
+        }
+    }
+    s_arc_on = false;
+    return true;
+}
+
+/* Queue (or run) one command; false = not yet, try again on the next service call */
+static bool run_cmd(const gc_cmd_t* c, gc_status_t* err) {
+    switch (c->type) {
+    case GC_CMD_LINE:
+        return queue_line(c->target, c->feed_mm_min, false, err);
+    case GC_CMD_RAPID:
+        return queue_line(c->target, RAPID_MM_MIN, true, err);
+    case GC_CMD_DWELL:
+        if (!s_dwelling) {
+            if (motion_busy()) {
+                return false; // G4 starts once the queued moves have finished
+            }
+            s_dwell_until_ms = app_millis() + (uint32_t)(c->seconds * 1000.0f + 0.5f);
+            s_dwelling = true;
+        }
+        if ((int32_t)(app_millis() - s_dwell_until_ms) < 0) {
+            return false;
+        }
+        s_dwelling = false;
+        return true;
+    case GC_CMD_MCODE:
+        switch (c->mcode) {
+        case 17:
+            set_drivers(true);
+            return true;
+        case 18:
+        case 84:
+            if (motion_busy()) {
+                return false;
+            }
+            set_drivers(false);
+            return true;
+        case 0:
+        case 1:
+        case 2:
+        case 30:
+            return !motion_busy(); // stop / end: the program point is reached
+        default:
+            return true; // M3/M4/M5: no spindle output on this board
+        }
+    case GC_CMD_ARC:
+        return run_arc(c, err);
+    default:
+        return true;
+    }
+}
+
+static void report_cycles(void) {
+    dbg_write("[CYC:");
+    put_u32(s_stats.last);
+    dbg_write(",");
+    put_u32(s_stats.max);
+    dbg_write(",");
+    put_u32(s_stats.lines ? (uint32_t)(s_stats.total / s_stats.lines) : 0U);
+    dbg_write("]\r\n");
+}
+
+/* Capacities for a character-counting sender: [BUF:<rx bytes>,<planner blocks>] */
+static void report_buffers(void) {
+    dbg_write("[BUF:");
+    put_u32(dbg_rx_size());
+    dbg_write(",");
+    put_u32(PLANNER_BUF_LEN - 1U);
+    dbg_write("]\r\n");
+}
+
+/* Last e-stop trip: [LAT:<edge->halt>,<edge->debounced>,<trips>] in DWT cycles */
+static void report_latency(void) {
+    estop_latency_t l;
+    estop_latency(&l);
+    dbg_write("[LAT:");
+    put_u32(l.edge_to_halt);
+    dbg_write(",");
+    put_u32(l.edge_to_debounced);
+    dbg_write(",");
+    put_u32(l.trips);
+    dbg_write("]\r\n");
+}
+
+/* Live position in um: [POS:<machine X,Y,Z>,<work X,Y,Z in the active G54..G59 + G92>] */
+static void report_position(void) {
+    float m[3];
+    motion_machine_position(m);
+    dbg_write("[POS:");
+    for (int i = 0; i < 3; ++i) {
+        put_i32((int32_t)lroundf(m[i] * 1000.0f));
+        dbg_write(",");
+    }
+    for (int i = 0; i < 3; ++i) {
+        const float w = m[i] - s_gc.wcs[s_gc.coord][i] - s_gc.offset[i];
+        put_i32((int32_t)lroundf(w * 1000.0f));
+        dbg_write(i < 2 ? "," : "]\r\n");
+    }
+}
+
+/* Handler cycles, one line each: [ISR:<name>,<calls>,<min>,<mean>,<max>], or [ISR:off] */
+static void report_isr(void) {
+    isr_prof_stats_t s;
+    if (!isr_prof_get(ISR_PROF_STEP, &s)) {
+        dbg_write("[ISR:off]\r\n"); // built without ISR_PROF
+        return;
+    }
+    for (int i = 0; i < ISR_PROF_COUNT; ++i) {
+        isr_prof_get((isr_prof_id_t)i, &s);
+        dbg_write("[ISR:");
+        dbg_write(isr_prof_name((isr_prof_id_t)i));
+        dbg_write(",");
+        put_u32(s.calls);
+        dbg_write(",");
+        put_u32(s.min);
+        dbg_write(",");
+        put_u32(s.calls ? (uint32_t)(s.total / s.calls) : 0U);
+        dbg_write(",");
+        put_u32(s.max);
+        dbg_write("]\r\n");
+    }
+}
+
+/* Step jitter per axis: [JIT:<axis>,<intervals>,<min>,<max>,<bin cycles>,<bin>:<count>,...]
+   with the bins as signed offsets from on-time (ends open) and only the non-empty ones, or
+   [JIT:off]. Each line waits for the one before to leave: a wide spread outgrows the TX ring. */
+static void report_jitter(void) {
+    static const char NAME[3][2] = {"x", "y", "z"};
+    stepgen_jitter_t j;
+    if (!stepgen_jitter_get(AXIS_X, &j)) {
+        dbg_write("[JIT:off]\r\n"); // built without STEP_JITTER
+        return;
+    }
+    for (int a = 0; a < 3; ++a) {
+        stepgen_jitter_get((axis_t)a, &j);
+        dbg_flush();
+        dbg_write("[JIT:");
+        dbg_write(NAME[a]);
+        dbg_write(",");
+        put_u32(j.count);
+        dbg_write(",");
+        put_i32(j.min);
+        dbg_write(",");
+        put_i32(j.max);
+        dbg_write(",");
+        put_u32(STEPGEN_JITTER_BIN_CYCLES);
+        for (uint32_t b = 0; b < STEPGEN_JITTER_BINS; ++b) {
+            if (j.bins[b] != 0U) {
+                dbg_write(",");
+                put_i32((int32_t)b - (int32_t)STEPGEN_JITTER_MID);
+                dbg_write(":");
+                put_u32(j.bins[b]);
+            }
+        }
+        dbg_write("]\r\n");
+    }
+}
+
+/* Overrides and hold: [OVR:<feed %>,<rapid %>,<held>] */
+static void report_overrides(void) {
+    dbg_write("[OVR:");
+    put_u32(s_rt.pct[0]);
+    dbg_write(",");
+    put_u32(s_rt.pct[1]);
+    dbg_write(motion_held() ? ",1]\r\n" : ",0]\r\n");
+}
+
+static void handle_line(void) {
+    if (s_line.overflow) {
+        reply(GC_ERR_LINE_OVERFLOW);
+        return;
+    }
+    if (s_line.len == 2 && s_line.buf[0] == '$' && s_line.buf[1] == 'C') {
+        report_cycles();
+        reply(GC_OK);
+        return;
+    }
+    if (s_line.len == 2 && s_line.buf[0] == '$' && s_line.buf[1] == 'B') {
+        report_buffers();
+        reply(GC_OK);
+        return;
+    }
+    if (s_line.len == 2 && s_line.buf[0] == '$' && s_line.buf[1] == 'L') {
+        report_latency();
+        reply(GC_OK);
+        return;
+    }
+    if (s_line.len == 2 && s_line.buf[0] == '$' && s_line.buf[1] == 'P') {
+        report_position();
+        reply(GC_OK);
+        return;
+    }
+    if (s_line.len == 2 && s_line.buf[0] == '$' && s_line.buf[1] == 'O') {
+        report_overrides();
+        reply(GC_OK);
+        return;
+    }
+    if (s_line.len == 2 && s_line.buf[0] == '$' && s_line.buf[1] == 'I') {
+        report_isr();
+        reply(GC_OK);
+        return;
+    }
+    if (s_line.len == 2 && s_line.buf[0] == '$' && s_line.buf[1] == 'J') {
+        report_jitter();
+        reply(GC_OK);
+        return;
+    }
+    if (s_line.len == 3 && s_line.buf[0] == '$' && s_line.buf[1] == 'J' && s_line.buf[2] == '0') {
+        stepgen_jitter_clear(); // a fresh capture from the next rise of each axis
+        reply(GC_OK);
+        return;
+    }
+
+    const uint32_t t0 = dwt_cycles();
+    gcode_block_t b;
+    gcode_state_t next = s_gc;
+    uint8_t n = 0;
+    gc_status_t st = gcode_parse(s_line.buf, s_line.len, &b);
+    if (st == GC_OK) {
+        st = gcode_execute(&next, &b, s_cmds, &n);
+    }
+    const uint32_t dt = dwt_cycles() - t0;
+    s_stats.lines++;
+    s_stats.last = dt;
+    s_stats.max = dt > s_stats.max ? dt : s_stats.max;
+    s_stats.total += dt;
+
+    if (st != GC_OK) {
+        reply(st);
+        return;
+    }
+    s_gc = next;
+    s_hl_modal.valid = false; // the program point may have moved: next frame must be a LINE
+    s_n = n;
+    s_next = 0;
+    if (n == 0) {
+        reply(GC_OK);
+    }
+}
+
+/* A binary frame becomes one queued command, answered like a G-code line */
+static void handle_frame(hl_status_t st) {
+    hl_move_t mv;
+    if (st == HL_FRAME) {
+        st = hl_frame_to_move(&s_hl_modal, &s_hl.frame, &mv);
+    }
+    if (st != HL_FRAME) {
+        reply_error((uint32_t)st);
+        return;
+    }
+    if (!mv.rapid && mv.feed_um_min == 0U) {
+        s_hl_modal.valid = false;
+        reply(GC_ERR_NO_FEED);
+        return;
+    }
+    gc_cmd_t* c = &s_cmds[0];
+    c->type = mv.rapid ? GC_CMD_RAPID : GC_CMD_LINE;
+    c->feed_mm_min = (float)mv.feed_um_min * 0.001f;
+    for (int i = 0; i < 3; ++i) {
+        c->target[i] = (float)mv.target_um[i] * 0.001f;
+        s_gc.pos[i] = c->target[i]; // text G-code carries on from here
+    }
+    s_stats.frames++;
+    s_n = 1;
+    s_next = 0;
+}
+
+/* RX interrupt, per byte as it arrives: realtime commands act before any queued line */
+static void on_rx_byte(uint8_t c) {
+    const uint8_t cmd = hl_rt_scan(&s_rt, c);
+    if (cmd == HL_RT_FEED_HOLD) {
+        motion_feed_hold();
+    } else if (cmd == HL_RT_CYCLE_START) {
+        motion_cycle_start();
+    } else if (cmd != 0U && hl_rt_override(&s_rt, cmd)) {
+        motion_override(s_rt.pct[0], s_rt.pct[1]);
+    }
+}
+
+void gcode_stream_init(void) {
+    gcode_init(&s_gc);
+    motion_position(s_gc.pos);
+    s_n = 0;
+    s_next = 0;
+    s_dwelling = false;
+    s_arc_on = false;
+    hl_decoder_init(&s_hl);
+    s_hl_modal.valid = false;
+    hl_rt_init(&s_rt);
+    dbg_rx_hook(on_rx_byte);
+}
+
+void gcode_stream_service(void) {
+    // Finish queueing the current line before reading on: a full planner holds the sender
+    if (s_next < s_n) {
+        gc_status_t err = GC_OK;
+        while (s_next < s_n && err == GC_OK) {
+            if (!run_cmd(&s_cmds[s_next], &err)) {
+                return;
+            }
+            s_next++;
+        }
+        if (err != GC_OK) {
+            // The rest of the line is dropped; carry on from what was really queued
+            motion_position(s_gc.pos);
+            s_hl_modal.valid = false;
+        }
+        s_n = 0;
+        s_next = 0;
+        reply(err);
+    }
+
+    int c;
+    while ((c = dbg_getc_nonblock()) >= 0) {
+        // A binary frame may start wherever a new G-code line could
+        if (!hl_decoder_idle(&s_hl) || (c == HL_SYNC && (s_line.done || !s_line.seen))) {
+            const hl_status_t st = hl_decode_byte(&s_hl, (uint8_t)c);
+            if (st != HL_NONE) {
+                handle_frame(st);
+                return;
+            }
+            continue;
+        }
+        if (hl_rt_is_cmd((uint8_t)c)) {
+            continue; // already acted on in the RX interrupt
+        }
+        if (gcode_line_feed(&s_line, (char)c)) {
+            handle_line();
+            return;
+        }
+    }
+}
+
+const gcode_stream_stats_t* gcode_stream_stats(void) {
+    return &s_stats;
+}
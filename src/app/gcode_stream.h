@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * G-code over USART2: assembles lines from dbg_getc_nonblock(), parses them and queues the
+ * moves with motion_line_to(). Non-blocking: call gcode_stream_service() from the superloop.
+ * Every line gets "ok Bf:<planner blocks free>,<RX bytes free>" or "error:<gc_status_t>" once
+ * its commands are queued, so a send-and-wait sender is throttled by the planner and a
+ * character-counting one (at most "$B" RX bytes unacknowledged) never overruns the RX ring.
+ * "$C" reports parse cycles per line, "$L" the last e-stop trip latency, "$O" the overrides,
+ * "$I" the cycles of every interrupt handler (isr_prof.h, ISR_PROF builds), "$J" the step
+ * jitter histograms and "$J0" clears them (stepgen_jitter.h, STEP_JITTER builds).
+ * Binary hostlink frames (hostlink.h) are accepted between lines and answered the same way.
+ * Realtime bytes ('!' hold, '~' resume, 0x90..0x97 overrides) act from the RX interrupt and
+ * never reach the line reader.
+ */
+
+void gcode_stream_init(void); // after app_init() (DWT counter) and motion_init()
+void gcode_stream_service(void);
+
+typedef struct {
+    uint32_t lines; // lines parsed
+    uint32_t frames; // binary moves accepted
+    uint32_t last; // DWT cycles for parse + execute of the last line
+    uint32_t max;
+    uint64_t total;
+} gcode_stream_stats_t;
+
+const gcode_stream_stats_t* gcode_stream_stats(void);
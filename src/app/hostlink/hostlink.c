@@ -0,0 +1,296 @@
+#include "hostlink.h"
+
+enum {
+    ST_SYNC = 0,
+    ST_LEN,
+    ST_TYPE,
+    ST_PAYLOAD,
+    ST_CRC_LO,
+    ST_CRC_HI,
+};
+
+uint16_t hl_crc16(uint16_t crc, const uint8_t* p, uint32_t n) {
+    while (n--) {
+        crc ^= (uint16_t)(*p++ << 8);
+        for (int i = 0; i < 8; ++i) {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+void hl_decoder_init(hl_decoder_t* d) {
+    d->state = ST_SYNC;
+    d->idx = 0;
+    d->crc = 0xFFFFU;
+    d->rx_crc = 0;
+}
+
+hl_status_t hl_decode_byte(hl_decoder_t* d, uint8_t b) {
+    switch (d->state) {
+    case ST_SYNC:
+        if (b == HL_SYNC) {
+            d->crc = 0xFFFFU;
+            d->state = ST_LEN;
+        }
+        return HL_NONE;
+    case ST_LEN:
+        if (b > HL_MAX_PAYLOAD) {
+            d->state = ST_SYNC;
+            return HL_ERR_LEN;
+        }
+        d->frame.len = b;
+        d->crc = hl_crc16(d->crc, &b, 1);
+        d->state = ST_TYPE;
+        return HL_NONE;
+    case ST_TYPE:
+        d->frame.type = b;
+        d->crc = hl_crc16(d->crc, &b, 1);
+        d->idx = 0;
+        d->state = d->frame.len ? ST_PAYLOAD : ST_CRC_LO;
+        return HL_NONE;
+    case ST_PAYLOAD:
+        d->frame.payload[d->idx++] = b;
+        if (d->idx == d->frame.len) {
+            d->crc = hl_crc16(d->crc, d->frame.payload, d->frame.len);
+            d->state = ST_CRC_LO;
+        }
+        return HL_NONE;
+    case ST_CRC_LO:
+        d->rx_crc = b;
+        d->state = ST_CRC_HI;
+        return HL_NONE;
+    case ST_CRC_HI:
+    default:
+        d->rx_crc |= (uint16_t)(b << 8);
+        d->state = ST_SYNC; // hunt again: a bad frame resyncs on the next SYNC
+        return d->rx_crc == d->crc ? HL_FRAME : HL_ERR_CRC;
+    }
+}
+
+enum { RT_TEXT = 0, RT_LEN, RT_FRAME };
+
+void hl_rt_init(hl_rt_t* s) {
+    s->line_start = 1;
+    s->state = RT_TEXT;
+    s->skip = 0;
+    s->pct[0] = 100U;
+    s->pct[1] = 100U;
+}
+
+/* Same framing rule as the stream: a SYNC opens a frame only where a new line could start */
+uint8_t hl_rt_scan(hl_rt_t* s, uint8_t b) {
+    switch (s->state) {
+    case RT_LEN:
+        if (b > HL_MAX_PAYLOAD) {
+            s->state = RT_TEXT; // the decoder drops it here too
+        } else {
+            s->skip = (uint8_t)(b + 3U);
+            s->state = RT_FRAME;
+        }
+        return 0;
+    case RT_FRAME:
+        if (--s->skip == 0U) {
+            s->state = RT_TEXT;
+        }
+        return 0;
+    case RT_TEXT:
+    default:
+        if (hl_rt_is_cmd(b)) {
+            return b; // not part of any line: line_start stays as it was
+        }
+        if (b == HL_SYNC && s->line_start) {
+            s->state = RT_LEN;
+            return 0;
+        }
+        s->line_start = (b == '\r' || b == '\n') ? 1U : 0U;
+        return 0;
+    }
+}
+
+bool hl_rt_override(hl_rt_t* s, uint8_t cmd) {
+    uint8_t* p = &s->pct[cmd >= HL_RT_RAPID_100 ? 1 : 0];
+    int v = *p;
+    switch (cmd) {
+    case HL_RT_FEED_100:
+    case HL_RT_RAPID_100:
+        v = 100;
+        break;
+    case HL_RT_FEED_PLUS_10:
+    case HL_RT_RAPID_PLUS_10:
+        v += 10;
+        break;
+    case HL_RT_FEED_MINUS_10:
+    case HL_RT_RAPID_MINUS_10:
+        v -= 10;
+        break;
+    case HL_RT_FEED_PLUS_1:
+        v += 1;
+        break;
+    case HL_RT_FEED_MINUS_1:
+        v -= 1;
+        break;
+    default:
+        return false;
+    }
+    v = v < HL_RT_PCT_MIN ? HL_RT_PCT_MIN : (v > HL_RT_PCT_MAX ? HL_RT_PCT_MAX : v);
+    if (v == *p) {
+        return false;
+    }
+    *p = (uint8_t)v;
+    return true;
+}
+
+static int32_t get_i32(const uint8_t* p) {
+    return (int32_t)((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16
+                     | (uint32_t)p[3] << 24);
+}
+
+static int16_t get_i16(const uint8_t* p) {
+    return (int16_t)((uint16_t)p[0] | (uint16_t)(p[1] << 8));
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+hl_status_t hl_frame_to_move(hl_modal_t* m, const hl_frame_t* f, hl_move_t* out) {
+    switch (f->type) {
+    case HL_T_LINE:
+        if (f->len != HL_LINE_LEN) {
+            return HL_ERR_LEN;
+        }
+        out->rapid = f->payload[0] & HL_FLAG_RAPID;
+        for (int i = 0; i < 3; ++i) {
+            out->target_um[i] = get_i32(&f->payload[1 + 4 * i]);
+        }
+        out->feed_um_min = (uint32_t)get_i32(&f->payload[13]);
+        break;
+    case HL_T_DELTA:
+        if (f->len != HL_DELTA_LEN) {
+            return HL_ERR_LEN;
+        }
+        if (!m->valid) {
+            return HL_ERR_NO_ORIGIN;
+        }
+        *out = m->last;
+        for (int i = 0; i < 3; ++i) {
+            out->target_um[i] += get_i16(&f->payload[2 * i]);
+        }
+        break;
+    default:
+        return HL_ERR_TYPE;
+    }
+    m->last = *out;
+    m->valid = true;
+    return HL_FRAME;
+}
+
+uint32_t hl_encode(uint8_t* out, uint8_t type, const uint8_t* payload, uint8_t len) {
+    out[0] = HL_SYNC;
+    out[1] = len;
+    out[2] = type;
+    for (uint8_t i = 0; i < len; ++i) {
+        out[3 + i] = payload[i];
+    }
+    const uint16_t crc = hl_crc16(0xFFFFU, &out[1], 2U + len);
+    out[3 + len] = (uint8_t)crc;
+    out[4 + len] = (uint8_t)(crc >> 8);
+    return 5U + len;
+}
+
+uint32_t hl_encode_move(hl_modal_t* m, uint8_t* out, const hl_move_t* mv) {
+    uint8_t p[HL_LINE_LEN];
+    bool delta = m->valid && (mv->rapid != 0U) == (m->last.rapid != 0U)
+                 && (mv->rapid || mv->feed_um_min == m->last.feed_um_min);
+    int64_t d[3];
+    for (int i = 0; i < 3; ++i) {
+        d[i] = (int64_t)mv->target_um[i] - m->last.target_um[i];
+        delta = delta && d[i] >= INT16_MIN && d[i] <= INT16_MAX;
+    }
+
+    uint32_t n;
+    if (delta) {
+        for (int i = 0; i < 3; ++i) {
+            p[2 * i] = (uint8_t)d[i];
+            p[2 * i + 1] = (uint8_t)((uint64_t)d[i] >> 8);
+        }
+        n = hl_encode(out, HL_T_DELTA, p, HL_DELTA_LEN);
+        m->last.target_um[0] = mv->target_um[0];
+        m->last.target_um[1] = mv->target_um[1];
+        m->last.target_um[2] = mv->target_um[2];
+        return n;
+    }
+    p[0] = mv->rapid ? HL_FLAG_RAPID : 0U;
+    for (int i = 0; i < 3; ++i) {
+        put_u32(&p[1 + 4 * i], (uint32_t)mv->target_um[i]);
+    }
+    put_u32(&p[13], mv->feed_um_min);
+    n = hl_encode(out, HL_T_LINE, p, HL_LINE_LEN);
+    m->last = *mv;
+    m->last.rapid = mv->rapid ? 1U : 0U;
+    m->valid = true;
+    return n;
+}
+
+static char* put_dec(char* p, uint32_t v) {
+    char tmp[10];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10U);
+        v /= 10U;
+    } while (v != 0U);
+    while (n > 0) {
+        *p++ = tmp[--n];
+    }
+    return p;
+}
+
+uint32_t hl_format_ack(char* out, uint32_t planner_free, uint32_t rx_free) {
+    static const char head[] = "ok Bf:";
+    char* p = out;
+    for (const char* h = head; *h; ++h) {
+        *p++ = *h;
+    }
+    p = put_dec(p, planner_free > 9999U ? 9999U : planner_free);
+    *p++ = ',';
+    p = put_dec(p, rx_free > 99999U ? 99999U : rx_free);
+    *p++ = '\r';
+    *p++ = '\n';
+    *p = '\0';
+    return (uint32_t)(p - out);
+}
+
+static const char* get_dec(const char* s, uint32_t* v) {
+    if (*s < '0' || *s > '9') {
+        return 0;
+    }
+    uint32_t x = 0;
+    while (*s >= '0' && *s <= '9') {
+        x = x * 10U + (uint32_t)(*s++ - '0');
+    }
+    *v = x;
+    return s;
+}
+
+bool hl_parse_ack(const char* s, uint32_t* planner_free, uint32_t* rx_free) {
+    if (s[0] != 'o' || s[1] != 'k') {
+        return false;
+    }
+    if (s[2] != '\0' && s[2] != ' ' && s[2] != '\r' && s[2] != '\n') {
+        return false;
+    }
+    s += 2;
+    if (s[0] == ' ' && s[1] == 'B' && s[2] == 'f' && s[3] == ':') {
+        uint32_t pf, rf;
+        s = get_dec(s + 4, &pf);
+        if (s != 0 && *s == ',' && get_dec(s + 1, &rf) != 0) {
+            *planner_free = pf;
+            *rx_free = rf;
+        }
+    }
+    return true;
+}
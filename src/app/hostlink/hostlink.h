@@ -0,0 +1,134 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Binary host link: compact, CRC-checked frames carrying pre-parsed moves, accepted on the
+ * same USART2 stream as text G-code (hardware independent; the same sources build into
+ * host-side senders).
+ *
+ *     SYNC(0xA5) | LEN | TYPE | payload[LEN] | CRC16 (LE)
+ *
+ * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over LEN, TYPE and the payload. SYNC is not
+ * printable ASCII, so a frame can only start where a G-code line could.
+ *
+ * Payloads (little endian, machine coordinates in micrometres):
+ *  - HL_T_LINE  flags(bit0 rapid) x y z (int32) feed (uint32, um/min)   17 -> 22 byte frame
+ *  - HL_T_DELTA dx dy dz (int16) from the last move, same feed / rapid   6 -> 11 byte frame
+ *
+ * Acknowledgements (text, for frames and G-code lines alike) carry the receive-side room:
+ *     ok Bf:<planner blocks free>,<RX bytes free>
+ * so a sender can keep the RX buffer full (character counting) instead of waiting per line.
+ */
+
+#define HL_SYNC 0xA5U
+#define HL_MAX_PAYLOAD 32U
+#define HL_MAX_FRAME (HL_MAX_PAYLOAD + 5U)
+
+enum {
+    HL_T_LINE = 0x01,
+    HL_T_DELTA = 0x02,
+};
+
+#define HL_LINE_LEN 17U
+#define HL_DELTA_LEN 6U
+#define HL_FLAG_RAPID 0x01U
+
+/* Results and error numbers (replied as "error:<n>", above the gc_status_t range) */
+typedef enum {
+    HL_NONE = 0, // decoder: frame not complete yet
+    HL_FRAME = 1, // decoder: `frame` holds a checked frame
+    HL_ERR_CRC = 20,
+    HL_ERR_LEN = 21, // LEN above HL_MAX_PAYLOAD, or wrong for the type
+    HL_ERR_TYPE = 22, // unknown frame type
+    HL_ERR_NO_ORIGIN = 23, // HL_T_DELTA without a binary move before it
+} hl_status_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t len;
+    uint8_t payload[HL_MAX_PAYLOAD];
+} hl_frame_t;
+
+/* Byte-at-a-time frame decoder */
+typedef struct {
+    uint8_t state; // 0 = hunting for SYNC
+    uint8_t idx; // payload bytes received
+    uint16_t crc; // running CRC
+    uint16_t rx_crc;
+    hl_frame_t frame;
+} hl_decoder_t;
+
+void hl_decoder_init(hl_decoder_t* d);
+hl_status_t hl_decode_byte(hl_decoder_t* d, uint8_t b);
+
+static inline bool hl_decoder_idle(const hl_decoder_t* d) {
+    return d->state == 0U;
+}
+
+/**
+ * Realtime commands: single bytes acted on as soon as the RX interrupt publishes them, ahead of
+ * any queued line, and skipped by the line / frame reader. '!' and '~' are grbl's; the
+ * override bytes are grbl's feed set (0x90..0x94), the rapid ones step by 10 % (0x95..0x97).
+ */
+enum {
+    HL_RT_FEED_HOLD = '!',
+    HL_RT_CYCLE_START = '~',
+    HL_RT_FEED_100 = 0x90,
+    HL_RT_FEED_PLUS_10 = 0x91,
+    HL_RT_FEED_MINUS_10 = 0x92,
+    HL_RT_FEED_PLUS_1 = 0x93,
+    HL_RT_FEED_MINUS_1 = 0x94,
+    HL_RT_RAPID_100 = 0x95,
+    HL_RT_RAPID_PLUS_10 = 0x96,
+    HL_RT_RAPID_MINUS_10 = 0x97,
+};
+
+#define HL_RT_PCT_MIN 10
+#define HL_RT_PCT_MAX 200
+
+static inline bool hl_rt_is_cmd(uint8_t b) {
+    return b == HL_RT_FEED_HOLD || b == HL_RT_CYCLE_START
+           || (b >= HL_RT_FEED_100 && b <= HL_RT_RAPID_MINUS_10);
+}
+
+/* Picks realtime bytes out of the raw RX stream, stepping over frames like the receiver does */
+typedef struct {
+    uint8_t line_start; // nothing of a G-code line yet: a SYNC here opens a frame
+    uint8_t state; // 0 = text, 1 = frame LEN next, 2 = inside a frame
+    uint8_t skip; // frame bytes left (TYPE, payload, CRC)
+    uint8_t pct[2]; // feed, rapid override in percent
+} hl_rt_t;
+
+void hl_rt_init(hl_rt_t* s); // at a line start, overrides 100 %
+uint8_t hl_rt_scan(hl_rt_t* s, uint8_t b); // the realtime command `b` is, or 0
+bool hl_rt_override(hl_rt_t* s, uint8_t cmd); // apply an override byte; true if pct[] changed
+
+/* One move, as both ends see it */
+typedef struct {
+    int32_t target_um[3]; // absolute machine position
+    uint32_t feed_um_min; // along the path (ignored for rapids)
+    uint8_t rapid;
+} hl_move_t;
+
+/* Modal state for HL_T_DELTA: the last move's end point, feed and rapid flag */
+typedef struct {
+    hl_move_t last;
+    bool valid; // false until a HL_T_LINE: deltas need an origin
+} hl_modal_t;
+
+/* Receiver: turn a checked frame into a move (HL_FRAME on success) */
+hl_status_t hl_frame_to_move(hl_modal_t* m, const hl_frame_t* f, hl_move_t* out);
+
+/* Sender: frames into `out` (at least HL_MAX_FRAME bytes), returns the frame length */
+uint16_t hl_crc16(uint16_t crc, const uint8_t* p, uint32_t n);
+uint32_t hl_encode(uint8_t* out, uint8_t type, const uint8_t* payload, uint8_t len);
+// HL_T_DELTA when the step from the last move fits int16 with the same feed, else HL_T_LINE
+uint32_t hl_encode_move(hl_modal_t* m, uint8_t* out, const hl_move_t* mv);
+
+/* Flow-control acknowledgement, NUL-terminated with CR LF; returns its length */
+#define HL_ACK_MAX 24U
+uint32_t hl_format_ack(char* out, uint32_t planner_free, uint32_t rx_free);
+// Sender side: true for any "ok" line; the Bf fields are filled in when present
+bool hl_parse_ack(const char* s, uint32_t* planner_free, uint32_t* rx_free);
@@ -1,16 +1,16 @@
+#include <math.h>
+
 #include "app_init.h"
+#include "gcode_stream.h"
 #include "home.h"
+#include "motion.h"
 #include "motion_units.h"
 #include "stepgen_pwm_tim3.h"
 
-static bool home_one(axis_t a, float fast, float slow, float backoff, float span, float offset) {
-    stepgen_enable(a, true); // ensure driver enabled
-    const home_params_t p = {.fast_feed_mm_min = fast,
-                             .slow_feed_mm_min = slow,
-                             .backoff_mm = backoff,
-                             .seek_span_mm = span,
-                             .home_offset_mm = offset};
-    return home_axis_blocking(a, &p);
+/* Queue a straight line (mm, feed in mm/min along the path), waiting while the planner is full */
+static void line_mm(float dx, float dy, float dz, float feed_mm_min) {
+    while (motion_line(dx, dy, dz, feed_mm_min) == MOTION_FULL) {
+    }
 }
 
 static void test_moves_after_home(void) {
@@ -18,22 +18,24 @@ static void test_moves_after_home(void) {
     const float test_mm = 20.0f;
     const float feed = 1200.0f;
 
-    // X +20
-    stepgen_dir(AXIS_X, /*CW=*/false); // if CW is your + direction for X
-    stepgen_move_n(AXIS_X, mm_to_steps(AXIS_X, test_mm), feed_to_hz(AXIS_X, feed));
-    while (stepgen_busy(AXIS_X)) {
-    }
+    // X+20 / Y+20 together: one coordinated diagonal instead of two serial moves
+    line_mm(test_mm, test_mm, 0.0f, feed);
+
+    // (Z optional—see safety note below)
+    line_mm(0.0f, 0.0f, test_mm, feed);
 
-    // Y +20
-    stepgen_dir(AXIS_Y, /*CW=*/false);
-    stepgen_move_n(AXIS_Y, mm_to_steps(AXIS_Y, test_mm), feed_to_hz(AXIS_Y, feed));
-    while (stepgen_busy(AXIS_Y)) {
+    // Short chords of a quarter circle: the planner carries speed through the corners
+    const float r = 10.0f;
+    float px = r, py = 0.0f;
+    for (int k = 1; k <= 32; ++k) {
+        const float t = 1.5707964f * (float)k / 32.0f;
+        const float x = r * cosf(t), y = r * sinf(t);
+        line_mm(x - px, y - py, 0.0f, feed);
+        px = x;
+        py = y;
     }
 
-    // (Z optional—see safety note below)
-    stepgen_dir(AXIS_Z, /*CW=*/true);
-    stepgen_move_n(AXIS_Z, mm_to_steps(AXIS_Z, test_mm), feed_to_hz(AXIS_Z, feed));
-    while (stepgen_busy(AXIS_Z)) {
+    while (motion_busy()) {
     }
 }
 
@@ -49,18 +51,31 @@ int main(void) {
     const float SPAN = 220.0f; // long enough to *guarantee* you reach MIN
     const float OFFS = 1.0f; // sit 1 mm off the switch at the end
 
-    bool okX = home_one(AXIS_X, FAST, SLOW, BACK, SPAN, OFFS);
-    bool okY = home_one(AXIS_Y, FAST, SLOW, BACK, SPAN, OFFS);
-    bool okZ = home_one(AXIS_Z, FAST, SLOW, BACK, SPAN, OFFS);
+    const home_params_t hp = {.fast_feed_mm_min = FAST,
+                              .slow_feed_mm_min = SLOW,
+                              .backoff_mm = BACK,
+                              .seek_span_mm = SPAN,
+                              .home_offset_mm = OFFS,
+                              .single_pass = true}; // EXTI edge capture, no slow latch
+    const home_params_t params[3] = {hp, hp, hp};
+
+    // Z clears the work first, then X and Y home together
+    const uint8_t order[] = {HOME_BIT(AXIS_Z), HOME_BIT(AXIS_X) | HOME_BIT(AXIS_Y)};
+    home_start(params, order, 2);
+    while (home_busy()) {
+        // free for other start-up work; home_phase(axis) reports progress
+    }
 
     // Simple success check (replace with LEDs/UART if you have them):
-    volatile bool all_ok = okX && okY && okZ;
+    volatile bool all_ok = home_ok();
 
     // Try some gentle + moves away from MIN to verify directions/clearance
     if (all_ok) {
         test_moves_after_home();
     }
 
+    gcode_stream_init(); // jobs from a sender over USART2
     for (;;) { /* superloop */
+        gcode_stream_service();
     }
 }
@@ -3,9 +3,14 @@
 #include "axis.h"
 #include "delay.h"
 #include "limits.h"
+#include "motion.h"
 #include "motion_units.h"
 #include "stepgen_pwm_tim3.h"
 
+static home_seq_t s_seq;
+static volatile bool s_running; // s_seq belongs to home_tick() while set
+static uint8_t s_capturing; // axes whose seek has the switch-edge capture armed
+
 static inline void poll_1ms(void) {
     limits_poll_tick();
     delay(1);
@@ -17,71 +22,120 @@ static inline void set_dir_toward(axis_t a, bool toward_negative) {
     stepgen_dir(a, cw);
 }
 
-/**
- * Move a distance in mm at feed (mm/min) in the given direction
- * BLocks until the motion completes or is stopped early by the MIN switch
- * (ISR already handles the early stop)
- */
-static void move_mm_blocking(axis_t a, float mm, float feed_mm_min, bool toward_negative) {
-    set_dir_toward(a, toward_negative);
-    stepgen_move_n(a, mm_to_steps(a, mm), feed_to_hz(a, feed_mm_min));
-    while (stepgen_busy(a)) {
-        poll_1ms(); // keep the debouncer fresh during motion
-    }
-}
-
 void home_init(void) {
-    limits_init_min(); // seed debouncers from current pin level
-    // Give the debouncer a few ms to settle
+    // The MIN inputs are set up by app_init() (limits_init_min()); give the debouncer a few
+    // ms to settle
     for (int i = 0; i < 10; ++i) {
         poll_1ms();
     }
 }
 
-/* Back-off until MIN is released (safety), then do fast-seek, release, slow-seek,
-   and final clearance to home_offset_mm. Leaves you un-pressed and homed. */
-bool home_axis_blocking(axis_t a, const home_params_t* p) {
-    // Ensure driver is enabled (TMC2209: low-active enable)
-    stepgen_enable(a, true);
+bool home_start(const home_params_t p[3], const uint8_t* groups, uint8_t n_groups) {
+    if (s_running || motion_busy()) {
+        return false;
+    }
+    home_seq_start(&s_seq, p, groups, n_groups);
+    s_capturing = 0;
+    for (int i = 0; i < 3; ++i) {
+        stepgen_enable((axis_t)i, true); // TMC2209: low-active enable
+    }
+    s_running = true; // hand over to SysTick last
+    return true;
+}
 
-    // 0) If we start on the switch, back off first.
-    if (limits_min_pressed(a)) {
-        move_mm_blocking(a, p->backoff_mm, p->slow_feed_mm_min, /*toward_negative=*/false);
-        // Wait until debounced release (should be immediate after backoff)
-        for (int i = 0; i < 20 && limits_min_pressed(a); ++i)
-            poll_1ms();
-        if (limits_min_pressed(a))
-            return false; // still stuck -> wiring/mechanics issue
+/* A captured seek has stopped: tell its state machine how far it ran past the edge */
+static void collect_capture(int i) {
+    const axis_t a = (axis_t)i;
+    uint32_t at;
+    if (limits_capture_get(a, &at)) {
+        const uint32_t past = stepgen_steps_issued(a) - at;
+        home_seq_trigger(&s_seq, (uint8_t)i, (float)past * mm_per_step(a));
     }
+    limits_capture_disarm(a);
+    s_capturing &= (uint8_t)~HOME_BIT(i);
+}
 
-    // 1) FAST SEEK toward MIN; ISR will stop early on hit.
-    move_mm_blocking(a, p->seek_span_mm, p->fast_feed_mm_min, /*toward_negative=*/true);
-    if (!limits_min_pressed(a)) {
-        // Never hit the switch within the span -> not found
-        return false;
+/* Feeds the switches and busy flags in, starts whatever moves the state machines ask for.
+   The step engine stops a move toward MIN on its own when the switch trips. */
+void home_tick(void) {
+    if (!s_running) {
+        return;
+    }
+    uint8_t pressed = 0, busy = 0;
+    for (int i = 0; i < 3; ++i) {
+        pressed |= limits_min_pressed((axis_t)i) ? (uint8_t)HOME_BIT(i) : 0U;
+        busy |= stepgen_busy((axis_t)i) ? (uint8_t)HOME_BIT(i) : 0U;
+        if ((s_capturing & HOME_BIT(i)) && !(busy & HOME_BIT(i))) {
+            collect_capture(i);
+        }
     }
+    home_move_t mv[HOME_AXES];
+    const uint8_t start = home_seq_tick(&s_seq, pressed, busy, mv);
+    for (int i = 0; i < 3; ++i) {
+        const axis_t a = (axis_t)i;
+        if (start & HOME_BIT(i)) {
+            set_dir_toward(a, mv[i].toward_negative);
+            if (mv[i].capture) {
+                limits_capture_arm(a, stepgen_steps_issued); // before the first step
+                s_capturing |= (uint8_t)HOME_BIT(i);
+            }
+            stepgen_move_n(a, mm_to_steps(a, mv[i].mm), feed_to_hz(a, mv[i].feed_mm_min));
+        }
+    }
+    if (!home_seq_active(&s_seq)) {
+        if (s_seq.failed) {
+            for (int i = 0; i < 3; ++i) {
+                stepgen_set_hz((axis_t)i, 0); // abort what the group still had running
+                limits_capture_disarm((axis_t)i);
+            }
+        }
+        uint8_t homed = 0;
+        for (int i = 0; i < 3; ++i) {
+            if (s_seq.axis[i].phase == HOME_DONE) {
+                stepgen_position_set((axis_t)i, 0); // machine zero: where the clearance ended
+                homed |= (uint8_t)HOME_BIT(i);
+            }
+        }
+        motion_sync(); // the homing moves bypassed the planner
+        motion_soft_limits(homed); // an axis that did not home is not checked
+        s_running = false;
+    }
+}
 
-    // 2) BACK OFF to clear the switch
-    move_mm_blocking(a, p->backoff_mm, p->slow_feed_mm_min, /*toward_negative=*/false);
-    for (int i = 0; i < 50 && limits_min_pressed(a); ++i)
-        poll_1ms();
-    if (limits_min_pressed(a))
-        return false;
+bool home_busy(void) {
+    return s_running;
+}
 
-    // 3) SLOW SEEK to re-latch precisely
-    move_mm_blocking(a, p->backoff_mm * 2.0f, p->slow_feed_mm_min, /*toward_negative=*/true);
-    if (!limits_min_pressed(a))
+bool home_ok(void) {
+    if (s_running || s_seq.failed || s_seq.n_groups == 0) {
         return false;
-
-    // 4) Final clearance to home_offset (leave switch released)
-    if (p->home_offset_mm >= 0.0f) {
-        move_mm_blocking(a, p->home_offset_mm, p->slow_feed_mm_min, /*toward_negative=*/false);
-        for (int i = 0; i < 50 && limits_min_pressed(a); ++i)
-            poll_1ms();
-        if (limits_min_pressed(a))
-            return false;
     }
-
-    // (Future step will set machine position = 0 here; for now we just report success.)
+    for (uint8_t g = 0; g < s_seq.n_groups; ++g) {
+        for (int i = 0; i < 3; ++i) {
+            if ((s_seq.groups[g] & HOME_BIT(i)) && s_seq.axis[i].phase != HOME_DONE) {
+                return false;
+            }
+        }
+    }
     return true;
-}
\ No newline at end of file
+}
+
+home_phase_t home_phase(axis_t a) {
+    return s_seq.axis[(int)a].phase;
+}
+
+home_err_t home_error(axis_t a) {
+    return s_seq.axis[(int)a].err;
+}
+
+/* One axis through the same state machine, waiting for it (needs SysTick running) */
+bool home_axis_blocking(axis_t a, const home_params_t* p) {
+    home_params_t all[3] = {*p, *p, *p};
+    const uint8_t group = (uint8_t)HOME_BIT((int)a);
+    if (!home_start(all, &group, 1)) {
+        return false;
+    }
+    while (home_busy()) {
+    }
+    return home_ok();
+}
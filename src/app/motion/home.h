@@ -1,17 +1,25 @@
 #pragma once
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "axis.h"
-
-typedef struct {
-    float fast_feed_mm_min; // fast seek speed
-    float slow_feed_mm_min; // slow latch pass
-    float backoff_mm; // how far to back off after a hit
-    float seek_span_mm;
-    float home_offset_mm; // where to leave the axis after homing (>=0, usually a tiny clearance)
-} home_params_t;
+#include "home_sm.h"
 
 void home_init(void);
 
+/*
+Non-blocking homing: axis groups run in order, the axes of one group together, e.g.
+    const uint8_t order[] = {HOME_BIT(AXIS_Z), HOME_BIT(AXIS_X) | HOME_BIT(AXIS_Y)};
+    home_start(params, order, 2);
+home_tick() drives it from SysTick (after the limit debouncers); poll home_busy() /
+home_phase() for progress. false if homing is already running or lines are queued.
+*/
+bool home_start(const home_params_t p[3], const uint8_t* groups, uint8_t n_groups);
+void home_tick(void); // 1 kHz, SysTick
+bool home_busy(void);
+bool home_ok(void); // last run finished with every axis of every group homed
+home_phase_t home_phase(axis_t a);
+home_err_t home_error(axis_t a);
+
 // returns true on success (switch found and latched), false if not found
-bool home_axis_blocking(axis_t a, const home_params_t* p);
\ No newline at end of file
+bool home_axis_blocking(axis_t a, const home_params_t* p);
@@ -0,0 +1,179 @@
+#include "home_sm.h"
+
+static void enter(home_sm_t* s, home_phase_t ph) {
+    s->phase = ph;
+    s->issued = 0;
+    s->wait_ms = 0;
+    s->phase_ms[ph] = s->ms;
+    if (ph == HOME_SEEK) {
+        s->triggered = 0;
+    }
+}
+
+static void fail(home_sm_t* s, home_err_t e) {
+    s->err = e;
+    enter(s, HOME_FAILED);
+}
+
+/* Clearance: from where the latch stopped, or from the captured edge plus the run-on */
+static float clear_mm(const home_sm_t* s) {
+    return s->p.home_offset_mm + (s->triggered ? s->past_mm : 0.0f);
+}
+
+/* The move each phase makes */
+static home_move_t phase_move(const home_sm_t* s) {
+    const home_params_t* p = &s->p;
+    switch (s->phase) {
+    case HOME_SEEK:
+        return (home_move_t){p->seek_span_mm, p->fast_feed_mm_min, true, p->single_pass};
+    case HOME_LATCH:
+        return (home_move_t){p->backoff_mm * 2.0f, p->slow_feed_mm_min, true, false};
+    case HOME_CLEAR:
+        return (home_move_t){clear_mm(s), p->slow_feed_mm_min, false, false};
+    case HOME_PULLOFF:
+    case HOME_BACKOFF:
+    default:
+        return (home_move_t){p->backoff_mm, p->slow_feed_mm_min, false, false};
+    }
+}
+
+void home_sm_start(home_sm_t* s, const home_params_t* p) {
+    s->p = *p;
+    s->err = HOME_ERR_NONE;
+    s->ms = 0;
+    enter(s, HOME_PULLOFF);
+}
+
+/* Hand out the current phase's move (or skip a phase that has nothing to do) */
+static bool issue(home_sm_t* s, bool pressed, home_move_t* mv) {
+    if (s->phase == HOME_PULLOFF && !pressed) {
+        enter(s, HOME_SEEK); // not on the switch: nothing to pull off
+    }
+    if (s->phase == HOME_CLEAR && clear_mm(s) <= 0.0f) {
+        enter(s, HOME_DONE); // homing on the switch edge
+        return false;
+    }
+    *mv = phase_move(s);
+    s->issued = 1;
+    return true;
+}
+
+bool home_sm_tick(home_sm_t* s, bool pressed, bool busy, home_move_t* mv) {
+    s->ms++;
+    if (!home_sm_active(s)) {
+        return false;
+    }
+    if (!s->issued) {
+        return issue(s, pressed, mv);
+    }
+    if (busy) {
+        return false;
+    }
+
+    // The phase's move has ended (run out, or stopped by the switch)
+    switch (s->phase) {
+    case HOME_SEEK:
+    case HOME_LATCH:
+        if (!pressed) {
+            if (++s->wait_ms < HOME_SETTLE_MS) {
+                break; // stopped on the first edge: the debouncer is still confirming it
+            }
+            fail(s, s->phase == HOME_SEEK ? HOME_ERR_NOT_FOUND : HOME_ERR_NO_LATCH);
+        } else if (s->phase == HOME_LATCH) {
+            enter(s, HOME_CLEAR);
+        } else if (s->p.single_pass && s->triggered) {
+            enter(s, HOME_CLEAR); // edge known to the step: no second pass
+        } else {
+            enter(s, HOME_BACKOFF);
+        }
+        break;
+    case HOME_PULLOFF:
+    case HOME_BACKOFF:
+    case HOME_CLEAR:
+    default:
+        if (pressed) {
+            if (++s->wait_ms < HOME_SETTLE_MS) {
+                break;
+            }
+            fail(s, s->phase == HOME_PULLOFF ? HOME_ERR_STUCK : HOME_ERR_NO_RELEASE);
+        } else {
+            enter(s, s->phase == HOME_PULLOFF ? HOME_SEEK
+                     : s->phase == HOME_BACKOFF ? HOME_LATCH
+                                                : HOME_DONE);
+        }
+        break;
+    }
+    if (home_sm_active(s) && !s->issued) {
+        return issue(s, pressed, mv); // next phase's move in the same tick
+    }
+    return false;
+}
+
+void home_sm_trigger(home_sm_t* s, float past_mm) {
+    if (s->phase == HOME_SEEK) {
+        s->triggered = 1;
+        s->past_mm = past_mm;
+    }
+}
+
+void home_seq_start(home_seq_t* q, const home_params_t p[HOME_AXES], const uint8_t* groups,
+                    uint8_t n_groups) {
+    q->n_groups = n_groups > HOME_AXES ? HOME_AXES : n_groups;
+    for (uint8_t g = 0; g < q->n_groups; ++g) {
+        q->groups[g] = groups[g];
+    }
+    for (uint8_t a = 0; a < HOME_AXES; ++a) {
+        q->axis[a].phase = HOME_IDLE;
+        q->axis[a].err = HOME_ERR_NONE;
+        q->axis[a].p = p[a];
+    }
+    q->group = 0;
+    q->failed = false;
+    if (q->n_groups > 0) {
+        for (uint8_t a = 0; a < HOME_AXES; ++a) {
+            if (q->groups[0] & HOME_BIT(a)) {
+                home_sm_start(&q->axis[a], &p[a]);
+            }
+        }
+    }
+}
+
+uint8_t home_seq_tick(home_seq_t* q, uint8_t pressed, uint8_t busy, home_move_t mv[HOME_AXES]) {
+    if (!home_seq_active(q)) {
+        return 0;
+    }
+    const uint8_t mask = q->groups[q->group];
+    uint8_t start = 0;
+    bool active = false;
+    for (uint8_t a = 0; a < HOME_AXES; ++a) {
+        if (!(mask & HOME_BIT(a))) {
+            continue;
+        }
+        home_sm_t* s = &q->axis[a];
+        if (home_sm_tick(s, (pressed & HOME_BIT(a)) != 0U, (busy & HOME_BIT(a)) != 0U, &mv[a])) {
+            start |= (uint8_t)HOME_BIT(a);
+        }
+        q->failed = q->failed || s->phase == HOME_FAILED;
+        active = active || home_sm_active(s);
+    }
+
+    if (q->failed) {
+        // One axis failed: the rest of the group stops where it is, later groups never run
+        for (uint8_t a = 0; a < HOME_AXES; ++a) {
+            if ((mask & HOME_BIT(a)) && home_sm_active(&q->axis[a])) {
+                q->axis[a].err = HOME_ERR_ABORTED;
+                enter(&q->axis[a], HOME_FAILED);
+            }
+        }
+        q->group = q->n_groups;
+        return 0;
+    }
+    if (!active && ++q->group < q->n_groups) {
+        for (uint8_t a = 0; a < HOME_AXES; ++a) {
+            if (q->groups[q->group] & HOME_BIT(a)) {
+                home_sm_start(&q->axis[a], &q->axis[a].p);
+            }
+        }
+    }
+    return start;
+}
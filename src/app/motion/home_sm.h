@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Homing as tick-driven state machines (hardware independent).
+ *
+ * One home_sm_t per axis walks pull-off -> fast seek -> back-off -> slow latch -> clearance.
+ * Each 1 ms tick it is told whether the MIN switch is pressed (debounced) and whether the
+ * axis is still stepping, and it answers with the next move to start, if any; the step
+ * engine still stops a move toward MIN on the switch. home_seq_t runs groups of axes one
+ * after the other, the axes of a group at the same time (e.g. Z first, then X and Y).
+ *
+ * single_pass: the fast seek arms a hardware capture of the switch edge (EXTI + step count,
+ * see limits_capture_arm()). Knowing how far past the edge the seek stopped, the clearance
+ * move lands exactly home_offset_mm off the edge and the back-off / slow latch are skipped.
+ * Without a capture the cycle falls back to the two-pass latch.
+ */
+
+typedef struct {
+    float fast_feed_mm_min; // fast seek speed
+    float slow_feed_mm_min; // slow latch pass
+    float backoff_mm; // how far to back off after a hit
+    float seek_span_mm;
+    float home_offset_mm; // where to leave the axis after homing (>=0, usually a tiny clearance)
+    bool single_pass; // fast seek only, edge from the hardware capture (home_offset_mm > 0)
+} home_params_t;
+
+typedef enum {
+    HOME_IDLE = 0,
+    HOME_PULLOFF, // started on the switch: move off it first
+    HOME_SEEK, // fast toward MIN until the switch stops the move
+    HOME_BACKOFF, // away until released
+    HOME_LATCH, // slow toward MIN for the precise edge
+    HOME_CLEAR, // park at home_offset_mm off the edge, released
+    HOME_DONE,
+    HOME_FAILED,
+} home_phase_t;
+
+typedef enum {
+    HOME_ERR_NONE = 0,
+    HOME_ERR_STUCK, // still pressed after the pull-off
+    HOME_ERR_NOT_FOUND, // no switch within seek_span_mm (or a spike stopped the seek)
+    HOME_ERR_NO_RELEASE, // still pressed after a back-off / clearance move
+    HOME_ERR_NO_LATCH, // slow pass ended without the switch
+    HOME_ERR_ABORTED, // another axis of the group failed
+} home_err_t;
+
+#define HOME_SETTLE_MS 50U // the debounced switch may trail the end of a move (press or release)
+
+typedef struct {
+    float mm;
+    float feed_mm_min;
+    bool toward_negative;
+    bool capture; // arm the switch-edge capture for this move
+} home_move_t;
+
+typedef struct {
+    home_params_t p;
+    home_phase_t phase;
+    home_err_t err;
+    uint8_t issued; // this phase's move has been handed out
+    uint16_t wait_ms; // waiting for the debounced switch to catch up
+    uint8_t triggered; // the seek's switch edge was captured
+    float past_mm; // how far the seek ran on after that edge
+    uint32_t ms; // ticks since start
+    uint32_t phase_ms[HOME_FAILED + 1]; // tick at which each phase began
+} home_sm_t;
+
+void home_sm_start(home_sm_t* s, const home_params_t* p);
+// One 1 ms tick. true with *mv filled when that move must be started now.
+bool home_sm_tick(home_sm_t* s, bool pressed, bool busy, home_move_t* mv);
+// The capture of the seek's edge, given once the seek has stopped (before that tick)
+void home_sm_trigger(home_sm_t* s, float past_mm);
+
+static inline bool home_sm_active(const home_sm_t* s) {
+    return s->phase != HOME_IDLE && s->phase != HOME_DONE && s->phase != HOME_FAILED;
+}
+
+/* Axis groups in order; masks use bit a for axis a */
+#define HOME_AXES 3U
+#define HOME_BIT(a) (1U << (a))
+
+typedef struct {
+    home_sm_t axis[HOME_AXES];
+    uint8_t groups[HOME_AXES];
+    uint8_t n_groups;
+    uint8_t group; // running group index (n_groups once finished)
+    bool failed;
+} home_seq_t;
+
+void home_seq_start(home_seq_t* q, const home_params_t p[HOME_AXES], const uint8_t* groups,
+                    uint8_t n_groups);
+// One 1 ms tick with MIN / busy bit masks; returns the mask of axes to start with mv[a].
+// On a failure the rest of the group is marked HOME_ERR_ABORTED: the caller stops them.
+uint8_t home_seq_tick(home_seq_t* q, uint8_t pressed, uint8_t busy, home_move_t mv[HOME_AXES]);
+
+static inline void home_seq_trigger(home_seq_t* q, uint8_t a, float past_mm) {
+    home_sm_trigger(&q->axis[a], past_mm);
+}
+
+static inline bool home_seq_active(const home_seq_t* q) {
+    return q->group < q->n_groups;
+}
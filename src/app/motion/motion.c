@@ -0,0 +1,230 @@
+#include "motion.h"
+
+#include <math.h>
+
+#include "estop.h"
+#include "irq_lock.h"
+#include "motion_units.h"
+#include "planner.h"
+#include "stepgen_pwm_tim3.h"
+
+#define JUNCTION_DEV_MM 0.02f // corner rounding allowed at junction speed
+#define MIN_JUNCTION_MM_S 0.0f // reversals and sharp corners come to a stop
+
+static float s_target_mm[3]; // end of the last queued line (machine mm)
+static int32_t s_target_steps[3]; // same, rounded once per axis so no fraction is lost
+static float s_target_frac[3]; // s_target_mm - s_target_steps, in steps (-0.5..0.5)
+static float s_last_exit2; // exit speed^2 of the block last handed to the step engine
+static volatile uint16_t s_ovr_req = 100U | 100U << 8; // feed | rapid << 8, set from any context
+static uint16_t s_ovr; // what the planner has
+
+void motion_init(void) {
+    planner_cfg_t cfg = {.junction_dev_mm = JUNCTION_DEV_MM,
+                         .min_junction_mm_s = MIN_JUNCTION_MM_S};
+    for (int i = 0; i < 3; ++i) {
+        cfg.accel_mm_s2[i] = accel_mm_s2((axis_t)i);
+        cfg.soft_min[i] = 0;
+        cfg.soft_max[i] = (int32_t)mm_to_steps((axis_t)i, travel_mm((axis_t)i));
+        s_target_mm[i] = 0.0f;
+        s_target_steps[i] = 0;
+        s_target_frac[i] = 0.0f;
+    }
+    const uint32_t key = irq_lock_systick();
+    planner_init(&cfg);
+    s_last_exit2 = 0.0f;
+    s_ovr = 100U | 100U << 8;
+    s_ovr_req = s_ovr;
+    irq_unlock(key);
+}
+
+/*
+ * Plan the line to `target_mm`: `target` steps and `frac` past them. A line of no whole step
+ * only keeps its fraction; its length goes to the next line, so the planner's mm still match
+ * the steps it moves.
+ */
+static motion_status_t queue(const float target_mm[3],
+                             const int32_t target[3],
+                             const float frac[3],
+                             float feed_mm_min,
+                             bool rapid) {
+    float d[3];
+    int32_t steps[3];
+    bool any = false;
+    for (int i = 0; i < 3; ++i) {
+        d[i] = target_mm[i] - s_target_mm[i];
+        steps[i] = target[i] - s_target_steps[i];
+        any = any || steps[i] != 0;
+    }
+    if (feed_mm_min <= 0.0f) {
+        return MOTION_OK; // nothing to move
+    }
+    if (!any) {
+        for (int i = 0; i < 3; ++i) {
+            s_target_frac[i] = frac[i];
+        }
+        return MOTION_OK;
+    }
+
+    const uint32_t key = irq_lock_systick();
+    const planner_status_t st = planner_add(steps, d, feed_mm_min / 60.0f, rapid);
+    irq_unlock(key);
+    if (st == PLANNER_FULL) {
+        return MOTION_FULL; // nothing changed, the caller retries
+    }
+    if (st == PLANNER_SOFT_LIMIT) {
+        return MOTION_SOFT_LIMIT;
+    }
+    for (int i = 0; i < 3; ++i) {
+        s_target_mm[i] = target_mm[i];
+        s_target_steps[i] = target[i];
+        s_target_frac[i] = frac[i];
+    }
+    return MOTION_OK;
+}
+
+motion_status_t motion_line_to(const float target_mm[3], float feed_mm_min, bool rapid) {
+    // Absolute: each axis rounds its own target, whatever the lines before it were
+    float frac[3];
+    int32_t target[3];
+    for (int i = 0; i < 3; ++i) {
+        target[i] = mm_to_steps_frac((axis_t)i, target_mm[i], &frac[i]);
+    }
+    return queue(target_mm, target, frac, feed_mm_min, rapid);
+}
+
+void motion_position(float out_mm[3]) {
+    for (int i = 0; i < 3; ++i) {
+        out_mm[i] = s_target_mm[i];
+    }
+}
+
+void motion_machine_position(float out_mm[3]) {
+    int32_t steps[3];
+    stepgen_position(steps);
+    for (int i = 0; i < 3; ++i) {
+        out_mm[i] = steps_to_mm((axis_t)i, steps[i]);
+    }
+}
+
+void motion_sync(void) {
+    int32_t steps[3];
+    stepgen_position(steps);
+    for (int i = 0; i < 3; ++i) {
+        s_target_steps[i] = steps[i];
+        s_target_frac[i] = 0.0f;
+        s_target_mm[i] = steps_to_mm((axis_t)i, steps[i]);
+    }
+    const uint32_t key = irq_lock_systick();
+    planner_set_position(steps);
+    irq_unlock(key);
+}
+
+void motion_soft_limits(uint8_t axes) {
+    uint8_t checked = 0;
+    for (int i = 0; i < 3; ++i) {
+        if ((axes & (1U << i)) && travel_mm((axis_t)i) > 0.0f) {
+            checked |= (uint8_t)(1U << i);
+        }
+    }
+    const uint32_t key = irq_lock_systick();
+    planner_set_soft_axes(checked);
+    irq_unlock(key);
+}
+
+motion_status_t motion_line(float dx_mm, float dy_mm, float dz_mm, float feed_mm_min) {
+    // Relative: steps follow the carried fraction, so a long run of short moves steps their sum
+    // rounded once, not each one rounded (or the float sum of the mm targets)
+    const float d[3] = {dx_mm, dy_mm, dz_mm};
+    float frac[3];
+    int32_t target[3];
+    float t[3];
+    for (int i = 0; i < 3; ++i) {
+        const axis_t a = (axis_t)i;
+        frac[i] = s_target_frac[i];
+        target[i] = s_target_steps[i] + mm_to_steps_carry(a, d[i], &frac[i]);
+        t[i] = steps_to_mm(a, target[i]) + frac[i] * mm_per_step(a); // not a float sum of d
+    }
+    return queue(t, target, frac, feed_mm_min, false);
+}
+
+/* Planner block -> step engine block: path speeds scale to the dominant axis by steps/mm */
+static void to_stepgen(const planner_block_t* p, float exit2, stepgen_block_t* b) {
+    const float k = (float)p->step_count / p->millimeters;
+    for (int i = 0; i < 3; ++i) {
+        b->steps[i] = p->steps[i];
+    }
+    b->rate_hz = (uint32_t)(sqrtf(p->nominal_speed2) * k + 0.5f);
+    b->accel_hz_s = (uint32_t)(p->accel * k + 0.5f);
+    b->entry_hz = (uint32_t)(sqrtf(p->entry_speed2) * k + 0.5f);
+    b->exit_hz = (uint32_t)(sqrtf(exit2) * k + 0.5f);
+    b->pct = p->pct;
+    b->rapid = p->rapid;
+}
+
+void motion_feed_hold(void) {
+    stepgen_hold();
+}
+
+void motion_cycle_start(void) {
+    stepgen_resume();
+}
+
+/* The step engine rescales what it already holds at once; the planner follows in SysTick */
+void motion_override(uint8_t feed_pct, uint8_t rapid_pct) {
+    stepgen_override(feed_pct, rapid_pct);
+    s_ovr_req = (uint16_t)(feed_pct | rapid_pct << 8);
+}
+
+bool motion_held(void) {
+    return stepgen_held();
+}
+
+/*
+Feed the step engine while it has room. The newest block is held back for more look-ahead
+while the engine still has a queued block and the block before it ends at rest; a block that
+must carry speed into its successor always gets that successor right behind it.
+*/
+void motion_service(void) {
+    if (estop_latched()) {
+        planner_reset();
+        s_last_exit2 = 0.0f;
+        return;
+    }
+    const uint16_t ovr = s_ovr_req;
+    if (ovr != s_ovr) {
+        s_ovr = ovr;
+        planner_set_override((uint8_t)ovr, (uint8_t)(ovr >> 8));
+    }
+
+    planner_block_t p;
+    float exit2;
+    while (stepgen_line_free() > 0 && planner_count() > 0) {
+        if (planner_count() == 1 && s_last_exit2 == 0.0f && stepgen_line_queued() > 0) {
+            return;
+        }
+        planner_pop(&p, &exit2);
+
+        stepgen_block_t b;
+        to_stepgen(&p, exit2, &b);
+        if (!stepgen_line(&b)) {
+            planner_reset(); // refused (MIN, e-stop): drop the rest rather than skip a block
+            s_last_exit2 = 0.0f;
+            return;
+        }
+        s_last_exit2 = exit2;
+    }
+}
+
+bool motion_busy(void) {
+    const uint32_t key = irq_lock_systick();
+    const bool busy = planner_count() > 0 || stepgen_line_busy();
+    irq_unlock(key);
+    return busy;
+}
+
+uint8_t motion_free(void) {
+    const uint32_t key = irq_lock_systick();
+    const uint8_t n = planner_free();
+    irq_unlock(key);
+    return n;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Queued motion API: motion_line() plans a straight line through the look-ahead planner and
+ * returns at once; motion_service() (SysTick, same context as stepgen_prep()) hands planned
+ * blocks to the step engine with their junction entry/exit rates.
+ */
+
+void motion_init(void); // planner limits from motion_units (after motion_init_defaults())
+
+typedef enum {
+    MOTION_OK = 0, // queued (or nothing to move)
+    MOTION_FULL, // planner full: call again later
+    MOTION_SOFT_LIMIT, // target outside the travel envelope: refused, nothing changed
+} motion_status_t;
+
+// Relative line in mm at feed (mm/min along the path)
+motion_status_t motion_line(float dx_mm, float dy_mm, float dz_mm, float feed_mm_min);
+// Absolute target; a rapid follows the rapid override instead of the feed one
+motion_status_t motion_line_to(const float target_mm[3], float feed_mm_min, bool rapid);
+void motion_position(float out_mm[3]); // end of the last queued line
+void motion_machine_position(float out_mm[3]); // live, from the step counters
+// Restart planning from the step counters (idle only): after homing re-zeroes them, or after
+// an e-stop dropped the queue part way.
+void motion_sync(void);
+// Check these axes (bit i = axis i) against 0..travel_mm() from here on: once they are homed
+void motion_soft_limits(uint8_t axes);
+
+// Realtime control, any context (e.g. the UART RX interrupt). Feed hold brings the lines to a
+// stop along their acceleration and keeps the rest queued; cycle start carries on from there.
+// Overrides (10..200 %) scale the programmed feed / rapid rate of everything queued.
+void motion_feed_hold(void);
+void motion_cycle_start(void);
+void motion_override(uint8_t feed_pct, uint8_t rapid_pct);
+bool motion_held(void); // stopped by a feed hold (motion_busy() stays true)
+
+void motion_service(void); // call at ~1 kHz from SysTick, before stepgen_prep()
+bool motion_busy(void); // blocks queued or still stepping
+uint8_t motion_free(void); // blocks motion_line() can still take
@@ -1,22 +1,77 @@
 #include "motion_units.h"
+
+#include <math.h>
+
 static axis_cfg_t cfg[3];
 
+/* Derived from cfg[] by update(): every conversion is a multiply */
+static struct {
+    float steps_per_mm;
+    float mm_per_step;
+    float hz_per_mm_min; // steps/s per mm/min
+} conv[3];
+
+static void update(axis_t a) {
+    const float spr = (float)cfg[a].full_steps_rev * (float)cfg[a].microsteps; // steps per rev
+    conv[a].steps_per_mm = spr / cfg[a].mm_per_rev;
+    conv[a].mm_per_step = cfg[a].mm_per_rev / spr;
+    conv[a].hz_per_mm_min = conv[a].steps_per_mm / 60.0f;
+}
+
 void motion_init_defaults(void) {
-    cfg[AXIS_X] = (axis_cfg_t){200, 8, 40.0f};
-    cfg[AXIS_Y] = (axis_cfg_t){200, 8, 40.0f};
-    cfg[AXIS_Z] = (axis_cfg_t){200, 8, 8.0f};
+    motion_set_axis(AXIS_X, &(axis_cfg_t){200, 8, 40.0f, 500.0f, 200.0f});
+    motion_set_axis(AXIS_Y, &(axis_cfg_t){200, 8, 40.0f, 500.0f, 200.0f});
+    motion_set_axis(AXIS_Z, &(axis_cfg_t){200, 8, 8.0f, 200.0f, 60.0f});
+}
+
+void motion_set_axis(axis_t a, const axis_cfg_t* c) {
+    cfg[a] = *c;
+    update(a);
 }
 
 float steps_per_mm(axis_t a) {
-    float spr = (float)cfg[a].full_steps_rev * (float)cfg[a].microsteps; // steps per revolution
-    return spr / cfg[a].mm_per_rev;
+    return conv[a].steps_per_mm;
+}
+
+float mm_per_step(axis_t a) {
+    return conv[a].mm_per_step;
 }
 
 uint32_t mm_to_steps(axis_t a, float mm) {
-    return (uint32_t)(steps_per_mm(a) * mm + 0.5f);
+    return (uint32_t)(conv[a].steps_per_mm * mm + 0.5f);
+}
+
+float steps_to_mm(axis_t a, int32_t steps) {
+    return (float)steps * conv[a].mm_per_step;
 }
 
 uint32_t feed_to_hz(axis_t a, float feed_mm_min) {
-    float feed_mm_s = feed_mm_min / 60.0f;
-    return (uint32_t)(steps_per_mm(a) * feed_mm_s + 0.5f);
+    return (uint32_t)(conv[a].hz_per_mm_min * feed_mm_min + 0.5f);
+}
+
+float accel_mm_s2(axis_t a) {
+    return cfg[a].accel_mm_s2;
+}
+
+uint32_t accel_to_hz_s(axis_t a, float accel_mm_s2) {
+    return (uint32_t)(conv[a].steps_per_mm * accel_mm_s2 + 0.5f);
+}
+
+float travel_mm(axis_t a) {
+    return cfg[a].travel_mm;
+}
+
+int32_t mm_to_steps_frac(axis_t a, float mm, float* frac) {
+    const float x = conv[a].steps_per_mm * mm;
+    const float n = roundf(x);
+    *frac = x - n;
+    return (int32_t)n;
+}
+
+int32_t mm_to_steps_carry(axis_t a, float d_mm, float* carry) {
+    // The fraction is added after the product so it keeps its full precision at any length
+    const float x = conv[a].steps_per_mm * d_mm + *carry;
+    const float n = roundf(x);
+    *carry = x - n;
+    return (int32_t)n;
 }
@@ -7,9 +7,26 @@ typedef struct {
     uint16_t full_steps_rev; // e.g., 200
     uint16_t microsteps; // e.g., 8 --> 200*8 - 1600 steps/rev
     float mm_per_rev; // e.g., 8.0 for TR8x8
+    float accel_mm_s2; // e.g., 500 mm/s^2 (0 = no ramp)
+    float travel_mm; // soft limits: machine 0 (homed) .. travel_mm (0 = unchecked)
 } axis_cfg_t;
 
+// Conversion factors are worked out here, once per config change: the conversions below are
+// multiplies, with no divide per call.
 void motion_init_defaults(void);
+void motion_set_axis(axis_t a, const axis_cfg_t* cfg);
 float steps_per_mm(axis_t a);
+float mm_per_step(axis_t a);
 uint32_t mm_to_steps(axis_t a, float mm);
+float steps_to_mm(axis_t a, int32_t steps);
 uint32_t feed_to_hz(axis_t a, float feed_mm_min); // feed in mm/min → steps/s
+float accel_mm_s2(axis_t a); // configured acceleration limit
+uint32_t accel_to_hz_s(axis_t a, float accel_mm_s2); // mm/s^2 → steps/s^2
+float travel_mm(axis_t a); // configured soft-limit travel (0 = none)
+
+// Nearest whole step to `mm` (ties away from zero); *frac gets the rest, -0.5..0.5 steps
+int32_t mm_to_steps_frac(axis_t a, float mm, float* frac);
+// Relative move: whole steps for `d_mm` plus the fraction *carry holds from the moves before,
+// which is left with the new fraction. A run of moves then steps the rounded sum of their
+// lengths, however short each one is.
+int32_t mm_to_steps_carry(axis_t a, float d_mm, float* carry);
@@ -0,0 +1,252 @@
+#include "planner.h"
+
+#include <math.h>
+#include <string.h>
+
+#define SPEED2_UNLIMITED 1e12f // straight junction: only the nominal speeds limit it
+
+static planner_cfg_t s_cfg;
+static planner_block_t s_buf[PLANNER_BUF_LEN];
+static uint8_t s_head; // next free slot
+static uint8_t s_tail; // oldest block (next to execute)
+static uint8_t s_planned; // first block whose entry speed may still change
+static int32_t s_end[3]; // machine position (steps) at the end of the newest block
+
+// Direction and speed of the last block added, kept after it is popped for the next corner
+static float s_prev_unit[3];
+static float s_prev_nominal2;
+static float s_prev_feed2;
+static uint8_t s_prev_rapid;
+static bool s_have_prev;
+static uint8_t s_pct[2] = {100U, 100U}; // feed, rapid override
+
+static inline uint8_t next_idx(uint8_t i) {
+    return (uint8_t)((i + 1U) & (PLANNER_BUF_LEN - 1U));
+}
+
+static inline uint8_t prev_idx(uint8_t i) {
+    return (uint8_t)((i - 1U) & (PLANNER_BUF_LEN - 1U));
+}
+
+static inline float minf(float a, float b) {
+    return a < b ? a : b;
+}
+
+static inline float overridden2(float feed2, uint8_t rapid) {
+    const float k = (float)s_pct[rapid ? 1 : 0] * 0.01f;
+    return feed2 * k * k;
+}
+
+void planner_init(const planner_cfg_t* cfg) {
+    s_cfg = *cfg;
+    memset(s_end, 0, sizeof s_end);
+    s_pct[0] = s_pct[1] = 100U;
+    planner_reset();
+}
+
+void planner_set_position(const int32_t steps[3]) {
+    memcpy(s_end, steps, sizeof s_end);
+}
+
+void planner_set_soft_axes(uint8_t axes) {
+    s_cfg.soft_axes = axes;
+}
+
+/* Only the end point needs checking: a straight line stays between its two ends */
+static bool within_soft_limits(const int32_t steps[3]) {
+    for (int i = 0; i < 3; ++i) {
+        if (!(s_cfg.soft_axes & (1U << i)) || steps[i] == 0) {
+            continue; // an axis that does not move may sit anywhere (e.g. before homing)
+        }
+        const int64_t to = (int64_t)s_end[i] + steps[i];
+        if (to < s_cfg.soft_min[i] || to > s_cfg.soft_max[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void planner_reset(void) {
+    s_head = 0;
+    s_tail = 0;
+    s_planned = 0;
+    s_have_prev = false;
+    s_prev_nominal2 = 0.0f;
+    s_prev_feed2 = 0.0f;
+    s_prev_rapid = 0;
+    memset(s_prev_unit, 0, sizeof s_prev_unit);
+}
+
+uint8_t planner_count(void) {
+    return (uint8_t)((s_head - s_tail) & (PLANNER_BUF_LEN - 1U));
+}
+
+uint8_t planner_free(void) {
+    return (uint8_t)(PLANNER_BUF_LEN - 1U - planner_count());
+}
+
+/*
+Backward pass from the newest block down to `planned` (exclusive): each entry is the most
+from which the block can still slow to the next block's entry. Then a forward pass from
+`planned`: each entry is cut to what the previous block can accelerate to, and `planned`
+moves up past every block that can no longer change.
+*/
+static void recalculate(void) {
+    uint8_t idx = prev_idx(s_head); // newest: must be able to stop at its end
+    if (idx == s_planned) {
+        return; // its entry is fixed already
+    }
+
+    planner_block_t* cur = &s_buf[idx];
+    cur->entry_speed2 = minf(cur->max_entry_speed2, 2.0f * cur->accel * cur->millimeters);
+
+    idx = prev_idx(idx);
+    while (idx != s_planned) {
+        const planner_block_t* nxt = cur;
+        cur = &s_buf[idx];
+        if (cur->entry_speed2 != cur->max_entry_speed2) {
+            const float v2 = nxt->entry_speed2 + 2.0f * cur->accel * cur->millimeters;
+            cur->entry_speed2 = minf(v2, cur->max_entry_speed2);
+        }
+        idx = prev_idx(idx);
+    }
+
+    planner_block_t* nxt = &s_buf[s_planned];
+    idx = next_idx(s_planned);
+    while (idx != s_head) {
+        cur = nxt;
+        nxt = &s_buf[idx];
+        if (cur->entry_speed2 < nxt->entry_speed2) {
+            const float v2 = cur->entry_speed2 + 2.0f * cur->accel * cur->millimeters;
+            if (v2 < nxt->entry_speed2) {
+                nxt->entry_speed2 = v2; // acceleration-limited from a fixed start: final
+                s_planned = idx;
+            }
+        }
+        if (nxt->entry_speed2 == nxt->max_entry_speed2) {
+            s_planned = idx; // at its junction limit: nothing later can raise it
+        }
+        idx = next_idx(idx);
+    }
+}
+
+planner_status_t planner_add(const int32_t steps[3],
+                             const float delta_mm[3],
+                             float feed_mm_s,
+                             bool rapid) {
+    if (planner_free() == 0) {
+        return PLANNER_FULL;
+    }
+    if (feed_mm_s <= 0.0f) {
+        return PLANNER_EMPTY;
+    }
+    if (!within_soft_limits(steps)) {
+        return PLANNER_SOFT_LIMIT;
+    }
+
+    planner_block_t* b = &s_buf[s_head];
+    b->step_count = 0;
+    float len2 = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+        b->steps[i] = steps[i];
+        const uint32_t n = (uint32_t)(steps[i] < 0 ? -(int64_t)steps[i] : steps[i]);
+        b->step_count = n > b->step_count ? n : b->step_count;
+        len2 += delta_mm[i] * delta_mm[i];
+    }
+    if (b->step_count == 0 || len2 <= 0.0f) {
+        return PLANNER_EMPTY;
+    }
+    b->millimeters = sqrtf(len2);
+
+    // Path acceleration: the largest one no axis exceeds (a_i / |u_i|)
+    float unit[3];
+    b->accel = SPEED2_UNLIMITED;
+    for (int i = 0; i < 3; ++i) {
+        unit[i] = delta_mm[i] / b->millimeters;
+        const float u = fabsf(unit[i]);
+        if (u > 0.0f) {
+            b->accel = minf(b->accel, s_cfg.accel_mm_s2[i] / u);
+        }
+    }
+
+    b->rapid = rapid ? 1U : 0U;
+    b->pct = s_pct[b->rapid];
+    b->feed2 = feed_mm_s * feed_mm_s;
+    b->nominal_speed2 = overridden2(b->feed2, b->rapid);
+    b->entry_speed2 = 0.0f; // stays 0 if the machine is at rest when this block starts
+
+    // Junction deviation: a circular arc of deviation `junction_dev_mm` tangent to both
+    // segments, taken at the path acceleration: v^2 = a * d * sin(t/2) / (1 - sin(t/2))
+    float v_junction2 = 0.0f;
+    if (s_have_prev) {
+        const float cos_theta = -(s_prev_unit[0] * unit[0] + s_prev_unit[1] * unit[1] +
+                                  s_prev_unit[2] * unit[2]);
+        const float min2 = s_cfg.min_junction_mm_s * s_cfg.min_junction_mm_s;
+        if (cos_theta > 0.999999f) {
+            v_junction2 = min2; // reversal
+        } else if (cos_theta < -0.999999f) {
+            v_junction2 = SPEED2_UNLIMITED; // straight on
+        } else {
+            const float sin_half = sqrtf(0.5f * (1.0f - cos_theta));
+            v_junction2 = b->accel * s_cfg.junction_dev_mm * sin_half / (1.0f - sin_half);
+            v_junction2 = v_junction2 > min2 ? v_junction2 : min2;
+        }
+    }
+    b->junction2 = v_junction2;
+    b->max_entry_speed2 = minf(v_junction2, minf(b->nominal_speed2, s_prev_nominal2));
+
+    memcpy(s_prev_unit, unit, sizeof unit);
+    s_prev_nominal2 = b->nominal_speed2;
+    s_prev_feed2 = b->feed2;
+    s_prev_rapid = b->rapid;
+    s_have_prev = true;
+
+    for (int i = 0; i < 3; ++i) {
+        s_end[i] += steps[i];
+    }
+    s_head = next_idx(s_head);
+    recalculate();
+    return PLANNER_OK;
+}
+
+/*
+Lowering a speed can lower entries that the incremental passes treat as final, so every entry
+after the (running) oldest block is cleared and the queue is planned again from scratch.
+*/
+void planner_set_override(uint8_t feed_pct, uint8_t rapid_pct) {
+    s_pct[0] = feed_pct;
+    s_pct[1] = rapid_pct;
+    s_prev_nominal2 = overridden2(s_prev_feed2, s_prev_rapid);
+    if (s_head == s_tail) {
+        return;
+    }
+
+    float prev_nominal2 = 0.0f;
+    for (uint8_t idx = s_tail; idx != s_head; idx = next_idx(idx)) {
+        planner_block_t* b = &s_buf[idx];
+        b->pct = s_pct[b->rapid];
+        b->nominal_speed2 = overridden2(b->feed2, b->rapid);
+        if (idx != s_tail) {
+            b->max_entry_speed2 = minf(b->junction2, minf(b->nominal_speed2, prev_nominal2));
+            b->entry_speed2 = 0.0f;
+        }
+        prev_nominal2 = b->nominal_speed2;
+    }
+    s_planned = s_tail;
+    recalculate();
+}
+
+bool planner_pop(planner_block_t* out, float* exit_speed2) {
+    if (s_head == s_tail) {
+        return false;
+    }
+    *out = s_buf[s_tail];
+    const uint8_t nxt = next_idx(s_tail);
+    *exit_speed2 = (nxt != s_head) ? s_buf[nxt].entry_speed2 : 0.0f;
+
+    if (s_planned == s_tail) {
+        s_planned = nxt; // the next entry is now the engine's exit speed: frozen
+    }
+    s_tail = nxt;
+    return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Look-ahead planner (hardware independent, no allocation).
+ *
+ * A fixed ring of line blocks sits between motion_line() and the step engine. For each new
+ * block:
+ *  - the corner with the previous block limits its entry speed (junction deviation);
+ *  - a backward pass makes every block able to stop by the end of the queue;
+ *  - a forward pass keeps every entry reachable from the block before it.
+ * Blocks from tail up to `planned` can no longer change (they are accel-limited from a fixed
+ * start or already at their junction limit), so each recalculation only walks the blocks a
+ * new one can still speed up.
+ *
+ * Lengths in mm, speeds in mm/s, accelerations in mm/s^2. Speeds are kept squared, so the
+ * passes need no sqrt.
+ *
+ * Soft limits: the planner follows the machine position (steps) at the end of the queue, and a
+ * block whose target leaves the travel envelope on a moving axis is refused on entry, before
+ * anything runs. The step ISR does no per-step travel checks.
+ *
+ * Overrides: each block keeps the feed it was asked for; its nominal speed is that feed times
+ * the feed (or, for rapids, the rapid) override. A new override re-plans every queued block.
+ */
+
+#define PLANNER_BUF_LEN 16U // ring slots (power of two, one kept free)
+
+typedef struct {
+    float accel_mm_s2[3]; // per-axis acceleration limit
+    float junction_dev_mm; // how far the path may cut a corner at junction speed (e.g. 0.02)
+    float min_junction_mm_s; // speed allowed through reversals / the sharpest corners
+    int32_t soft_min[3]; // travel envelope in machine steps, inclusive
+    int32_t soft_max[3];
+    uint8_t soft_axes; // bit i: axis i is checked against its envelope (0 = soft limits off)
+} planner_cfg_t;
+
+typedef enum {
+    PLANNER_OK = 0,
+    PLANNER_FULL, // no free slot: retry once a block has been popped
+    PLANNER_EMPTY, // no steps, no length, or no feed: nothing queued
+    PLANNER_SOFT_LIMIT, // the target is outside the travel envelope: nothing queued
+} planner_status_t;
+
+typedef struct {
+    int32_t steps[3]; // signed step deltas
+    uint32_t step_count; // dominant |steps| (one DDA tick each)
+    float millimeters; // path length
+    float accel; // path acceleration (no axis exceeds its own limit)
+    float feed2; // requested feed, squared
+    float nominal_speed2; // feed2 with the override applied
+    float junction2; // corner limit on the entry speed, squared
+    float max_entry_speed2; // junction / nominal limit on the entry speed, squared
+    float entry_speed2; // planned entry speed, squared
+    uint8_t rapid; // scaled by the rapid override instead of the feed one
+    uint8_t pct; // override percentage in nominal_speed2
+} planner_block_t;
+
+void planner_init(const planner_cfg_t* cfg);
+void planner_reset(void); // drop every queued block (e-stop, abort); the position is kept
+
+// Machine position (steps) the next block starts from: after homing, or after an abort
+void planner_set_position(const int32_t steps[3]);
+void planner_set_soft_axes(uint8_t axes); // which axes planner_add() checks (cfg.soft_axes)
+
+/**
+ * Append a line of `steps` (delta_mm is the same move in mm) at `feed_mm_s` and re-plan.
+ * Anything but PLANNER_OK leaves the queue and the position untouched.
+ */
+planner_status_t planner_add(const int32_t steps[3],
+                             const float delta_mm[3],
+                             float feed_mm_s,
+                             bool rapid);
+
+/**
+ * Feed / rapid override in percent (100 = as programmed). Rescales every queued block except
+ * the oldest block's entry, which may already be running, then re-plans the whole queue.
+ */
+void planner_set_override(uint8_t feed_pct, uint8_t rapid_pct);
+
+/**
+ * Take the oldest block for execution with its exit speed (the next block's entry, or 0).
+ * The next block's entry speed is frozen from here on. False if the ring is empty.
+ */
+bool planner_pop(planner_block_t* out, float* exit_speed2);
+
+uint8_t planner_count(void); // queued blocks
+uint8_t planner_free(void); // blocks planner_add() can still take
@@ -65,4 +65,24 @@ void bsp_gpio_af_pp_hs(GPIO_TypeDef* port, uint32_t pin, uint8_t af_val) {
     port->OTYPER &= ~(1UL << pin); // type: output push pull (00 reset state)
     port->OSPEEDR |= (3UL << (pin * 2)); // speed: High speed (11)
     port->PUPDR &= ~(3UL << (pin * 2)); // resistor: no pull (00 reset state)
-}
\ No newline at end of file
+}
+
+void bsp_gpio_af_in(GPIO_TypeDef* port, uint32_t pin, uint8_t af_val, bool pull_up) {
+    bsp_gpio_af_pp_hs(port, pin, af_val);
+    port->PUPDR |= ((pull_up ? 1UL : 2UL) << (pin * 2)); // resistor: pull-up (01) / down (10)
+}
+
+void bsp_gpio_exti(GPIO_TypeDef* port, uint8_t pin, bool rising, bool falling) {
+    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+    const uint32_t m = 1UL << pin;
+    EXTI->IMR &= ~m;
+
+    // EXTICR[pin / 4] holds a 4-bit port index per line: 0 = GPIOA, 1 = GPIOB, ...
+    const uint32_t port_idx = ((uint32_t)port - GPIOA_BASE) / (GPIOB_BASE - GPIOA_BASE);
+    const uint32_t sh = (pin % 4U) * 4U;
+    SYSCFG->EXTICR[pin / 4U] = (SYSCFG->EXTICR[pin / 4U] & ~(0xFUL << sh)) | (port_idx << sh);
+
+    EXTI->RTSR = rising ? (EXTI->RTSR | m) : (EXTI->RTSR & ~m);
+    EXTI->FTSR = falling ? (EXTI->FTSR | m) : (EXTI->FTSR & ~m);
+    EXTI->PR = m; // rc_w1
+}
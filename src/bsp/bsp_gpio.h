@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "stm32f4xx.h"
@@ -30,3 +31,15 @@ void bsp_gpio_out_pp_hs(GPIO_TypeDef* port, uint32_t pin);
  * and set AF value (0..15).
  */
 void bsp_gpio_af_pp_hs(GPIO_TypeDef* port, uint32_t pin, uint8_t af_val);
+
+/**
+ * Configure pin as an Alternate Function input (e.g. a timer break input) with a pull-up
+ * or pull-down. IDR and the EXTI line still see the pin.
+ */
+void bsp_gpio_af_in(GPIO_TypeDef* port, uint32_t pin, uint8_t af_val, bool pull_up);
+
+/**
+ * Route pin to its EXTI line (SYSCFG EXTICR) and select the trigger edge(s).
+ * The line is left masked and its pending flag cleared; unmask with EXTI->IMR.
+ */
+void bsp_gpio_exti(GPIO_TypeDef* port, uint8_t pin, bool rising, bool falling);
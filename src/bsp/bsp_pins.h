@@ -7,10 +7,11 @@
  * PA2 USART2_TX
  * PA3 USART2_RX
  * PA4 Z_MIN (Limit Switch)
- * PA6 X_STEP
- * PA7 Y_STEP
+ * PA6 ESTOP (TIM1_BKIN)
+ * PA8 X_STEP
+ * PA9 Y_STEP
+ * PA10 Z_STEP
  *
- * PB0 Z_STEP
  * PB4 X_DIR
  * PB5 Y_DIR
  * PB12 X_EN
@@ -18,14 +19,13 @@
  * PB14 Z_EN
  *
  * PC2 Z_DIR
- * PC13 ESTOP (USER Button/Switch)
  */
 
 ////////// Axes STEP/DIR/EN + IO //////////
 // X-Axis
 #define X_STEP_PORT GPIOA
-#define X_STEP_PIN 6UL // PA6, e.g. TIM3_CH1
-#define X_STEP_AF_VAL 2UL // AF2 -> TIM3_CH1
+#define X_STEP_PIN 8UL // PA8, TIM1_CH1
+#define X_STEP_AF_VAL 1UL // AF1 -> TIM1_CH1
 
 #define X_DIR_PORT GPIOB
 #define X_DIR_PIN 4UL // PB4
@@ -39,8 +39,8 @@
 
 // Y-Axis
 #define Y_STEP_PORT GPIOA
-#define Y_STEP_PIN 7UL // PA7, e.g. TIM3_CH2
-#define Y_STEP_AF_VAL 2UL // AF2 -> TIM3_CH2
+#define Y_STEP_PIN 9UL // PA9, TIM1_CH2
+#define Y_STEP_AF_VAL 1UL // AF1 -> TIM1_CH2
 
 #define Y_DIR_PORT GPIOB
 #define Y_DIR_PIN 5UL // PB5
@@ -53,9 +53,9 @@
 #define Y_MIN_ACTIVE_LOW 1 // 1 = pressed when pin reads 0
 
 // Z-Axis
-#define Z_STEP_PORT GPIOB
-#define Z_STEP_PIN 0UL // PB0 TIM3_CH3
-#define Z_STEP_AF_VAL 2UL // AF2 -> TIM3_CH2
+#define Z_STEP_PORT GPIOA
+#define Z_STEP_PIN 10UL // PA10, TIM1_CH3
+#define Z_STEP_AF_VAL 1UL // AF1 -> TIM1_CH3
 
 #define Z_DIR_PORT GPIOC
 #define Z_DIR_PIN 2UL // PC2
@@ -69,10 +69,12 @@
 
 /*---- IO ----*/
 
-// Emergency Stop (USER button)
-#define ESTOP_PORT GPIOC
-#define ESTOP_PIN 13UL // PC13 Emergency Switch (Default: Nucleo blue USER button)
-#define ESTOP_ACTIVE_HIGH 0 // pressed = logic HIGH on Nucleo
+// Emergency Stop: on the step timer's break input, so the switch itself forces every STEP
+// output low (also sampled through IDR / EXTI6 for the software latch)
+#define ESTOP_PORT GPIOA
+#define ESTOP_PIN 6UL // PA6 TIM1_BKIN (Arduino D12 on the Nucleo)
+#define ESTOP_AF_VAL 1UL // AF1 -> TIM1_BKIN
+#define ESTOP_ACTIVE_HIGH 0 // pressed = pin pulled to GND (internal pull-up)
 
 // Debug UART2
 #define DBG_TX_PORT GPIOA
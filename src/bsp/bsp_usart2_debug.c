@@ -2,12 +2,145 @@
 
 #include "bsp_gpio.h"
 #include "bsp_pins.h"
+#include "byte_ring.h"
+#include "isr_prof.h"
 #include "stm32f4xx.h"
 
 // PA 2 TX
 // PA 3 RX
 
-void dbg_uart_init(uint32_t pclk1_hz, uint32_t baud) {
+/*
+RX runs without per-byte interrupts: DMA1 Stream5 (channel 4 = USART2_RX) writes every byte
+into rx_dma[] in circular mode. Interrupts only come at half/full buffer (DMA HT/TC) and when
+the line goes idle after a burst (USART IDLE); each one works out how far the DMA has moved
+since the last one (from NDTR) and publishes that to the ring's head. The consumer reads
+straight out of rx_dma[], so nothing is copied. HT/TC guarantee an update at least every
+RX_DMA_LEN / 2 bytes, so the modulo distance never misses a lap.
+*/
+#define RX_DMA_LEN 256U // power of two (byte_ring)
+#define RX_DMA_STREAM DMA1_Stream5
+#define RX_DMA_CHANNEL 4UL
+#define RX_IRQ_PRIO 1U // below the step timer (0) so stepping is never delayed, above SysTick
+
+static volatile uint8_t rx_dma[RX_DMA_LEN];
+static byte_ring_t s_rx;
+static uint32_t s_rx_pos; // DMA write index at the last update
+static void (*volatile s_rx_hook)(uint8_t c);
+
+static void rx_dma_init(void) {
+    RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+
+    RX_DMA_STREAM->CR &= ~DMA_SxCR_EN;
+    while (RX_DMA_STREAM->CR & DMA_SxCR_EN) {
+    }
+    DMA1->HIFCR = DMA_HIFCR_CTCIF5 | DMA_HIFCR_CHTIF5 | DMA_HIFCR_CTEIF5 | DMA_HIFCR_CDMEIF5
+                  | DMA_HIFCR_CFEIF5;
+
+    byte_ring_init(&s_rx, rx_dma, RX_DMA_LEN);
+    s_rx_pos = 0;
+
+    RX_DMA_STREAM->PAR = (uint32_t)&USART2->DR;
+    RX_DMA_STREAM->M0AR = (uint32_t)rx_dma;
+    RX_DMA_STREAM->NDTR = RX_DMA_LEN;
+    RX_DMA_STREAM->FCR = 0; // direct mode
+    // Peripheral -> memory, byte wide, memory increment, circular, half + full interrupts
+    RX_DMA_STREAM->CR = (RX_DMA_CHANNEL << DMA_SxCR_CHSEL_Pos) | DMA_SxCR_MINC | DMA_SxCR_CIRC
+                        | DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+    RX_DMA_STREAM->CR |= DMA_SxCR_EN;
+
+    NVIC_SetPriority(DMA1_Stream5_IRQn, RX_IRQ_PRIO);
+    NVIC_SetPriority(USART2_IRQn, RX_IRQ_PRIO); // same level: the two updates never nest
+    NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+    NVIC_EnableIRQ(USART2_IRQn);
+}
+
+/* Publish whatever the DMA wrote since the last call (ISR context) */
+static void rx_dma_update(void) {
+    const uint32_t pos = (RX_DMA_LEN - RX_DMA_STREAM->NDTR) & (RX_DMA_LEN - 1U);
+    void (*const hook)(uint8_t c) = s_rx_hook;
+    if (hook) {
+        for (uint32_t i = s_rx_pos; i != pos; i = (i + 1U) & (RX_DMA_LEN - 1U)) {
+            hook(rx_dma[i]);
+        }
+    }
+    byte_ring_commit(&s_rx, (pos - s_rx_pos) & (RX_DMA_LEN - 1U));
+    s_rx_pos = pos;
+}
+
+void DMA1_Stream5_IRQHandler(void) {
+    ISR_PROF_ENTER();
+    DMA1->HIFCR = DMA_HIFCR_CHTIF5 | DMA_HIFCR_CTCIF5;
+    rx_dma_update();
+    ISR_PROF_EXIT(ISR_PROF_DMA_RX);
+}
+
+void USART2_IRQHandler(void) {
+    ISR_PROF_ENTER();
+    if (USART2->SR & USART_SR_IDLE) {
+        (void)USART2->DR; // SR then DR read clears IDLE (the byte itself went to DMA)
+        rx_dma_update();
+    }
+    ISR_PROF_EXIT(ISR_PROF_USART2);
+}
+
+/*
+TX never waits for the UART: dbg_write() copies into tx_buf[] and returns. DMA1 Stream6
+(channel 4 = USART2_TX) sends the longest contiguous run from the ring's tail; its
+transfer-complete interrupt releases those bytes and starts the next run. The writer masks
+only that interrupt while it touches the ring, so the step timer and SysTick never wait.
+*/
+#define TX_DMA_LEN 512U // power of two (byte_ring)
+#define TX_DMA_STREAM DMA1_Stream6
+#define TX_DMA_CHANNEL 4UL
+
+static volatile uint8_t tx_dma[TX_DMA_LEN];
+static byte_ring_t s_tx;
+static volatile uint32_t s_tx_busy; // bytes the running transfer still reads from tx_dma[]
+static byte_ring_policy_t s_tx_policy = BYTE_RING_DROP;
+
+/* Start the next transfer if the stream is idle (stream IRQ masked, or from the IRQ) */
+static void tx_kick(void) {
+    if (s_tx_busy != 0U) {
+        return;
+    }
+    const uint32_t n = byte_ring_span(&s_tx);
+    if (n == 0U) {
+        return;
+    }
+    TX_DMA_STREAM->M0AR = (uint32_t)&tx_dma[s_tx.tail & s_tx.mask];
+    TX_DMA_STREAM->NDTR = n;
+    byte_ring_skip(&s_tx, n);
+    s_tx_busy = n;
+    DMA1->HIFCR = DMA_HIFCR_CTCIF6 | DMA_HIFCR_CHTIF6 | DMA_HIFCR_CTEIF6 | DMA_HIFCR_CFEIF6;
+    TX_DMA_STREAM->CR |= DMA_SxCR_EN;
+}
+
+static void tx_dma_init(void) {
+    TX_DMA_STREAM->CR &= ~DMA_SxCR_EN;
+    while (TX_DMA_STREAM->CR & DMA_SxCR_EN) {
+    }
+    byte_ring_init(&s_tx, tx_dma, TX_DMA_LEN);
+    s_tx_busy = 0;
+
+    TX_DMA_STREAM->PAR = (uint32_t)&USART2->DR;
+    TX_DMA_STREAM->FCR = 0; // direct mode
+    // Memory -> peripheral, byte wide, memory increment, transfer-complete interrupt
+    TX_DMA_STREAM->CR = (TX_DMA_CHANNEL << DMA_SxCR_CHSEL_Pos) | DMA_SxCR_DIR_0 | DMA_SxCR_MINC
+                        | DMA_SxCR_TCIE;
+
+    NVIC_SetPriority(DMA1_Stream6_IRQn, RX_IRQ_PRIO);
+    NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+}
+
+void DMA1_Stream6_IRQHandler(void) {
+    ISR_PROF_ENTER();
+    DMA1->HIFCR = DMA_HIFCR_CTCIF6;
+    s_tx_busy = 0; // the claimed run is out, its bytes are free again
+    tx_kick();
+    ISR_PROF_EXIT(ISR_PROF_DMA_TX);
+}
+
+uint32_t dbg_uart_init(uint32_t pclk1_hz, uint32_t baud) {
     // Clocks
     RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
     RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
@@ -40,29 +173,92 @@ void dbg_uart_init(uint32_t pclk1_hz, uint32_t baud) {
     // Configuration: 8N1 (8 data bits, no parity bit, and 1 stop bit), oversampling by 16
     USART2->CR1 |= USART_CR1_TE | USART_CR1_RE; // Transmit and Receive enable
 
-    // BRR = pclk/baud (oversampling 16) rounded
-    uint32_t brr = (pclk1_hz + (baud / 2u)) / baud;
+    // RX through DMA + idle-line interrupt (no RXNE interrupt per byte), TX through DMA
+    rx_dma_init();
+    tx_dma_init();
+    USART2->CR3 |= USART_CR3_DMAR | USART_CR3_DMAT;
+    USART2->CR1 |= USART_CR1_IDLEIE;
 
-    USART2->BRR = brr;
+    /*
+    div = pclk/baud rounded, in 1/16 (OVER8=0) or 1/8 (OVER8=1) bit times. Both give the
+    same rate pclk/div; oversampling by 16 samples more per bit, so it is kept as long as
+    div >= 16 (up to 2.8 Mbaud on a 45 MHz APB1). Above that, oversampling by 8 reaches
+    pclk/8, with the fraction in BRR[2:0] and BRR[3] kept clear.
+    e.g. 45 MHz: 1 M, 1.5 M and 2.25 Mbaud are exact; 2 Mbaud is 2.2% off (div 22.5).
+    */
+    const uint32_t div = (pclk1_hz + (baud / 2u)) / baud;
+    if (div >= 16u) {
+        USART2->CR1 &= ~USART_CR1_OVER8;
+        USART2->BRR = div;
+    } else {
+        USART2->CR1 |= USART_CR1_OVER8;
+        USART2->BRR = ((div & ~7u) << 1) | (div & 7u);
+    }
 
     USART2->CR1 |= USART_CR1_UE; // enable
+    return pclk1_hz / div;
+}
+
+static void tx_enqueue(const uint8_t* p, uint32_t n) {
+    NVIC_DisableIRQ(DMA1_Stream6_IRQn); // keeps s_tx_busy and the tail still
+    byte_ring_write(&s_tx, p, n, s_tx_policy, s_tx_busy);
+    tx_kick();
+    NVIC_EnableIRQ(DMA1_Stream6_IRQn);
 }
 
 void dbg_putc(char c) {
-    while (!(USART2->SR & USART_SR_TXE)) {
-    } // Wait until transmit buffer empty
-    USART2->DR = (c & 0xFF);
+    const uint8_t b = (uint8_t)c;
+    tx_enqueue(&b, 1U);
 }
 
 void dbg_write(const char* s) {
-    while (*s) {
-        dbg_putc(*s++);
+    uint32_t n = 0;
+    while (s[n] != '\0') {
+        n++;
     }
+    tx_enqueue((const uint8_t*)s, n);
 }
 
-int dbg_getc_nonblock(void) {
-    if (USART2->SR & USART_SR_RXNE) {
-        return (int)(USART2->DR & 0xFF);
+void dbg_tx_policy(byte_ring_policy_t policy) {
+    s_tx_policy = policy;
+}
+
+uint32_t dbg_tx_pending(void) {
+    return byte_ring_used(&s_tx) + s_tx_busy;
+}
+
+uint32_t dbg_tx_dropped(void) {
+    return s_tx.dropped;
+}
+
+void dbg_flush(void) {
+    while (dbg_tx_pending() != 0U) {
     }
-    return -1;
+    while (!(USART2->SR & USART_SR_TC)) {
+    } // last stop bit out
+}
+
+int dbg_getc_nonblock(void) {
+    return byte_ring_get(&s_rx);
+}
+
+uint32_t dbg_rx_available(void) {
+    const uint32_t n = byte_ring_used(&s_rx);
+    return n > RX_DMA_LEN ? RX_DMA_LEN : n;
+}
+
+uint32_t dbg_rx_free(void) {
+    return RX_DMA_LEN - dbg_rx_available();
+}
+
+uint32_t dbg_rx_size(void) {
+    return RX_DMA_LEN;
+}
+
+void dbg_rx_hook(void (*fn)(uint8_t c)) {
+    s_rx_hook = fn;
+}
+
+uint32_t dbg_rx_lost(void) {
+    return s_rx.lost;
 }
@@ -2,7 +2,24 @@
 
 #include <stdint.h>
 
-void dbg_uart_init(uint32_t pclk1_hz, uint32_t baud);
+#include "byte_ring.h"
+
+// 8N1 at `baud` (up to pclk1 / 8, oversampling by 8 above pclk1 / 16); returns the real rate
+uint32_t dbg_uart_init(uint32_t pclk1_hz, uint32_t baud);
+
+/* TX: queued for DMA, never blocks. A full ring drops per dbg_tx_policy() (default DROP) */
 void dbg_putc(char c);
 void dbg_write(const char* s);
-int dbg_getc_nonblock(void);
\ No newline at end of file
+void dbg_tx_policy(byte_ring_policy_t policy);
+uint32_t dbg_tx_pending(void); // bytes queued or in flight
+uint32_t dbg_tx_dropped(void); // bytes discarded because the ring was full
+void dbg_flush(void); // blocking: wait until everything has left the pin
+
+int dbg_getc_nonblock(void); // next received byte from the DMA ring, -1 if none
+uint32_t dbg_rx_available(void); // bytes waiting (published at DMA half/full and line idle)
+uint32_t dbg_rx_free(void); // room before unread bytes get overwritten (flow control)
+uint32_t dbg_rx_size(void);
+uint32_t dbg_rx_lost(void); // bytes overwritten by the DMA before they were read
+// Called from the RX interrupt with every byte as it is published, before the reader sees it
+// (realtime commands). Keep it short: it runs at the RX priority. NULL removes it.
+void dbg_rx_hook(void (*fn)(uint8_t c));
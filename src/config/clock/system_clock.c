@@ -91,7 +91,7 @@ void dwt_enable(void) {
     DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk; // start counting
 }
 
-static inline uint32_t dwt_cycles(void) { // reads the current cycle count
+uint32_t dwt_cycles(void) { // reads the current cycle count
     return DWT->CYCCNT;
 }
 
@@ -4,4 +4,7 @@
 
 void system_clock_init(void);
 
-uint32_t measure_10ms_cycles(void);
\ No newline at end of file
+uint32_t measure_10ms_cycles(void);
+
+void dwt_enable(void); // start the DWT cycle counter (CYCCNT)
+uint32_t dwt_cycles(void); // core cycles since dwt_enable(), wraps every ~23.8 s at 180 MHz
\ No newline at end of file
@@ -1,60 +1,50 @@
 #include "estop.h"
 
+#include <stddef.h>
+
 #include "bsp_gpio.h"
 #include "bsp_pins.h"
+#include "inputs.h"
+#include "isr_prof.h"
 #include "stm32f446xx.h"
+#include "system_clock.h"
 
-#define ESTOP_DEBOUNCE_TICKS 5 // ≈5 ms
-
-typedef struct {
-    uint8_t cnt;
-    uint8_t stable;
-    uint8_t last_sample;
-} Deb;
+#define ESTOP_EXTI (1UL << ESTOP_PIN) // PA6 -> EXTI6 (EXTI9_5_IRQn)
 
-static Deb s_estop_db;
+static uint32_t s_lane; // the e-stop's bit in the inputs word
 static volatile uint8_t s_latched = 0;
-
-static inline uint8_t deb_tick(Deb* d, uint8_t sample) {
-    if (sample == d->stable) {
-        d->cnt = 0;
-        d->last_sample = sample;
-        return d->stable;
-    }
-    if (sample != d->last_sample) {
-        d->last_sample = sample;
-        d->cnt = 1;
-    } else if (d->cnt < 255) {
-        d->cnt++;
-    }
-    if (d->cnt >= ESTOP_DEBOUNCE_TICKS) {
-        d->stable = sample;
-        d->cnt = 0;
-    }
-    return d->stable;
-}
-
-static inline bool read_active(GPIO_TypeDef* port, uint8_t pin, bool active_high) {
-    const bool hi = ((port->IDR >> pin) & 1UL) != 0;
-    return active_high ? hi : !hi;
-}
+static estop_trip_fn s_on_trip;
+static volatile uint32_t s_edge_cyc; // DWT stamp of the last tripping edge
+static volatile uint8_t s_timing; // an edge is waiting for the debouncer to confirm it
+static estop_latency_t s_lat;
 
 void estop_init(void) {
     bsp_gpio_en(ESTOP_PORT);
-    bsp_gpio_in_pd(ESTOP_PORT, ESTOP_PIN);
+    // TIM1_BKIN: the step timer drops its outputs on its own (stepgen_init_all() sets BDTR)
+    bsp_gpio_af_in(ESTOP_PORT, ESTOP_PIN, ESTOP_AF_VAL, ESTOP_ACTIVE_HIGH == 0);
     s_latched = 0;
 
-    uint8_t raw = read_active(ESTOP_PORT, ESTOP_PIN, ESTOP_ACTIVE_HIGH != 0) ? 1 : 0;
-    s_estop_db.cnt = 0;
-    s_estop_db.last_sample = raw;
-    s_estop_db.stable = raw;
+    // First pressed edge: EXTI, same priority as the step ISR (they never nest)
+    s_lane = inputs_add(ESTOP_PORT, ESTOP_PIN, ESTOP_ACTIVE_HIGH == 0, true);
+    NVIC_EnableIRQ(EXTI9_5_IRQn);
+}
+
+void estop_on_trip(estop_trip_fn fn) {
+    s_on_trip = fn;
 }
 
+/* After inputs_tick() */
 void estop_poll_tick(void) {
-    uint8_t raw = read_active(ESTOP_PORT, ESTOP_PIN, ESTOP_ACTIVE_HIGH != 0) ? 1 : 0;
-    uint8_t deb = deb_tick(&s_estop_db, raw);
-    if (deb)
-        s_latched = 1;
+    if (inputs_state() & s_lane) {
+        s_latched = 1; // also covers an edge the EXTI did not see
+        if (s_timing) {
+            s_lat.edge_to_debounced = dwt_cycles() - s_edge_cyc; // what the poll alone costs
+            s_timing = 0;
+        }
+    }
+    if (inputs_rearmed() & s_lane) {
+        s_timing = 0; // a spike: never confirmed
+    }
 }
 
 bool estop_latched(void) {
@@ -63,4 +53,29 @@ bool estop_latched(void) {
 
 void estop_clear(void) {
     s_latched = 0;
-}
\ No newline at end of file
+}
+
+void estop_latency(estop_latency_t* out) {
+    *out = s_lat;
+}
+
+/* First pressed edge: latch and stop the steps before anything else (the break input has
+   already forced STEP low; this stops the scheduling behind it) */
+void EXTI9_5_IRQHandler(void) {
+    ISR_PROF_ENTER();
+    const uint32_t t0 = dwt_cycles();
+    // masks the line: bounce is over when the debouncer says released
+    if (!(inputs_exti(ESTOP_EXTI) & s_lane)) {
+        ISR_PROF_EXIT(ISR_PROF_ESTOP);
+        return;
+    }
+    s_latched = 1;
+    if (s_on_trip != NULL) {
+        s_on_trip();
+    }
+    s_lat.edge_to_halt = dwt_cycles() - t0 + ESTOP_IRQ_ENTRY_CYCLES;
+    s_lat.trips++;
+    s_edge_cyc = t0;
+    s_timing = 1;
+    ISR_PROF_EXIT(ISR_PROF_ESTOP);
+}
@@ -1,9 +1,28 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 void estop_init(void);
 bool estop_latched(void);
-void estop_clear(void);
+void estop_clear(void); // the step outputs come back with the next move (switch released)
 
-void estop_poll_tick(void); // call at 1 kHz for debounce + latch
\ No newline at end of file
+void estop_poll_tick(void); // 1 kHz, after inputs_tick(): latches on the debounced press
+
+/*
+The switch is on TIM1_BKIN (PA6): the step timer forces every STEP output low by itself
+the moment it closes. The first pressed edge (EXTI) also latches the e-stop and calls the
+trip hook right away, e.g. stepgen_trip_all, instead of waiting 4-5 ms for the debouncer.
+The hook runs in EXTI context at the step ISR's priority.
+*/
+typedef void (*estop_trip_fn)(void);
+void estop_on_trip(estop_trip_fn fn);
+
+// Latency of the last trip in DWT core cycles (180 per us)
+#define ESTOP_IRQ_ENTRY_CYCLES 12U // Cortex-M4 exception entry, before the first stamp
+typedef struct {
+    uint32_t edge_to_halt; // edge -> trip hook returned
+    uint32_t edge_to_debounced; // edge -> debouncer agreed (the old stop path)
+    uint32_t trips;
+} estop_latency_t;
+void estop_latency(estop_latency_t* out);
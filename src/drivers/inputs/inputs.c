@@ -0,0 +1,116 @@
+#include "inputs.h"
+
+#include "bsp_gpio.h"
+#include "vdeb.h"
+
+typedef struct {
+    GPIO_TypeDef* port;
+    uint32_t pins; // IDR bits in use
+} Slot;
+
+static Slot s_slot[INPUTS_PORTS];
+static uint32_t s_invert; // lanes that are active low
+static uint32_t s_edge; // lanes with an EXTI line
+static uint32_t s_rearmed;
+static vdeb_t s_deb;
+
+/* One IDR read per port, polarity in one XOR */
+static inline uint32_t sample(void) {
+    uint32_t raw = 0;
+    for (uint32_t i = 0; i < INPUTS_PORTS; ++i) {
+        if (s_slot[i].port) {
+            raw |= (s_slot[i].port->IDR & s_slot[i].pins) << (16U * i);
+        }
+    }
+    return raw ^ s_invert;
+}
+
+/* Lanes -> EXTI lines (the pin number, whichever port) */
+static inline uint32_t lines_of(uint32_t lanes) {
+    return (lanes | (lanes >> 16)) & 0xFFFFU;
+}
+
+void inputs_init(void) {
+    for (uint32_t i = 0; i < INPUTS_PORTS; ++i) {
+        s_slot[i].port = 0;
+        s_slot[i].pins = 0;
+    }
+    s_invert = 0;
+    s_edge = 0;
+    s_rearmed = 0;
+    vdeb_init(&s_deb, 0, INPUTS_DEBOUNCE_TICKS);
+}
+
+uint32_t inputs_add(GPIO_TypeDef* port, uint8_t pin, bool active_low, bool edge) {
+    uint32_t i = 0;
+    while (i < INPUTS_PORTS && s_slot[i].port && s_slot[i].port != port) {
+        ++i;
+    }
+    if (i == INPUTS_PORTS || pin > 15U) {
+        return 0;
+    }
+    const uint32_t lane = 1UL << (16U * i + pin);
+    if (s_slot[i].port == port && (s_slot[i].pins & (1UL << pin))) {
+        return lane; // registered before: same lane, its debounce and EXTI state kept
+    }
+    if (edge && (lines_of(s_edge) & (1UL << pin))) {
+        return 0; // EXTI line taken by the same pin number on another port
+    }
+    s_slot[i].port = port;
+    s_slot[i].pins |= 1UL << pin;
+    if (active_low) {
+        s_invert |= lane;
+    } else {
+        s_invert &= ~lane;
+    }
+    // Seed with the current level: an input already active starts tripped
+    const uint32_t now = sample() & lane;
+    vdeb_set(&s_deb, lane, now, INPUTS_DEBOUNCE_TICKS);
+    if (edge) {
+        s_edge |= lane;
+        bsp_gpio_exti(port, pin, !active_low, active_low);
+        if (!now) {
+            EXTI->IMR |= 1UL << pin; // armed while released
+        }
+    }
+    return lane;
+}
+
+void inputs_tick(void) {
+    const uint32_t rearm = vdeb_tick(&s_deb, sample());
+    s_rearmed = rearm;
+    const uint32_t lines = lines_of(rearm & s_edge);
+    if (lines != 0U) {
+        EXTI->PR = lines; // forget edges from before (rc_w1)
+        EXTI->IMR |= lines;
+    }
+}
+
+uint32_t inputs_exti(uint32_t lines) {
+    lines &= EXTI->PR;
+    EXTI->PR = lines;
+    const uint32_t lanes = s_edge & (lines | (lines << 16));
+    const uint32_t fresh = vdeb_trip(&s_deb, lanes);
+    EXTI->IMR &= ~lines_of(fresh); // until released
+    return fresh;
+}
+
+uint32_t inputs_state(void) {
+    return s_deb.stable;
+}
+
+uint32_t inputs_active(void) {
+    return vdeb_active(&s_deb);
+}
+
+uint32_t inputs_rose(void) {
+    return s_deb.rose;
+}
+
+uint32_t inputs_fell(void) {
+    return s_deb.fell;
+}
+
+uint32_t inputs_rearmed(void) {
+    return s_rearmed;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stm32f4xx.h"
+
+/**
+ * Switch inputs, sampled and debounced as one 32-bit word.
+ *
+ * Each input is a lane (a bit) in the word: lane = slot * 16 + pin, with up to two GPIO
+ * ports per board (slot 0 and 1, e.g. GPIOA and GPIOC). inputs_tick() reads each port's IDR
+ * once, applies polarity with one XOR and runs the bit-sliced debouncer (vdeb.h) over all
+ * lanes together, so adding an input adds no work to the 1 kHz tick.
+ *
+ * Inputs added with an edge have the first-edge trip: their EXTI line fires on the active
+ * edge, the owner's handler calls inputs_exti() and acts on the lanes it returns; the line
+ * stays masked until the debouncer has seen the input released. The owners (limits, estop)
+ * keep their EXTI handlers and NVIC setup; only one input per EXTI line (pin number).
+ */
+
+#define INPUTS_PORTS 2U
+#define INPUTS_DEBOUNCE_TICKS 5U // ≈5 ms at 1 kHz (1..7)
+
+void inputs_init(void); // before the first inputs_add()
+
+// Register an input (pull-up / pull-down is the owner's). edge: EXTI on the active edge.
+// Returns the input's lane mask, 0 if the port or EXTI line is taken. Registering the same
+// port / pin again returns its lane unchanged (an owner's init may run twice).
+uint32_t inputs_add(GPIO_TypeDef* port, uint8_t pin, bool active_low, bool edge);
+
+// 1 kHz: sample and debounce every input, re-arm the EXTI of trips that have ended
+void inputs_tick(void);
+
+// EXTI context: clear the pending `lines` (EXTI bits), trip and mask their inputs.
+// Returns the lanes this edge tripped (not the ones that were tripped already).
+uint32_t inputs_exti(uint32_t lines);
+
+uint32_t inputs_state(void); // debounced, 1 = active
+uint32_t inputs_active(void); // tripped by an edge or debounced active (any context)
+uint32_t inputs_rose(void); // became active at the last tick
+uint32_t inputs_fell(void); // became inactive at the last tick
+uint32_t inputs_rearmed(void); // trips that ended at the last tick
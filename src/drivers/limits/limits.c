@@ -1,40 +1,15 @@
 #include "limits.h"
 
+#include <stddef.h>
+
 #include "bsp_gpio.h"
 #include "bsp_pins.h"
+#include "inputs.h"
+#include "isr_prof.h"
 #include "stm32f446xx.h"
 
-#define DEBOUNCE_TICKS 5 // ≈5 ms at 1 kHz; bump to 8–10 if needed
-
-typedef struct {
-    uint8_t cnt;
-    uint8_t stable; // 0/1 debounced state
-    uint8_t last_sample; // 0/1 previous raw sample
-} Deb;
-
-static Deb s_min_db[3]; // one MIN switch per axis
-
-static inline uint8_t deb_tick(Deb* d, uint8_t sample) {
-    if (sample == d->stable) {
-        d->cnt = 0;
-        d->last_sample = sample;
-        return d->stable;
-    }
-
-    if (sample != d->last_sample) {
-        d->last_sample = sample;
-        d->cnt = 1;
-    } else if (d->cnt < 255) {
-        d->cnt++;
-    }
-
-    if (d->cnt >= DEBOUNCE_TICKS) {
-        d->stable = sample;
-        d->cnt = 0;
-    }
-
-    return d->stable;
-}
+static uint32_t s_lane[3]; // each MIN switch's bit in the inputs word (0 = not fitted)
+static uint32_t s_lines; // their EXTI lines
 
 typedef struct {
     GPIO_TypeDef* port;
@@ -48,39 +23,136 @@ static const LimHw LIM_MIN[3] = {
         {Z_MIN_PORT, Z_MIN_PIN, Z_MIN_ACTIVE_LOW},
 };
 
-static inline bool read_active(const LimHw* h) {
-    const bool hi = ((h->port->IDR >> h->pin) & 1U) != 0;
-    return h->active_low ? !hi : hi;
+static limits_trip_fn s_on_trip;
+
+/*
+First edge: the EXTI line of each MIN pin fires on the pressed edge, marks the switch
+tripped (limits_block_neg() is true from here) and calls the trip hook, which stops a move
+toward MIN within microseconds instead of the 5-6 ms the debouncer needs. The line then
+stays masked until the debouncer has seen the switch released, so bounce costs nothing.
+
+Trigger capture (homing): while armed, the same edge also samples the caller's step
+counter. A hit the debouncer never confirms (a spike) is dropped and the capture re-armed
+together with the line.
+*/
+enum { CAP_OFF = 0, CAP_ARMED, CAP_HIT };
+
+typedef struct {
+    limits_count_fn count;
+    volatile uint32_t steps;
+    volatile uint8_t state;
+    uint8_t confirmed; // the debouncer saw the switch pressed after the hit
+} Cap;
+
+static Cap s_cap[3];
+
+/* EXTI context: pressed edges (inputs_exti() masks the lines until released) */
+static void on_edge(void) {
+    const uint32_t fresh = inputs_exti(s_lines);
+    for (int i = 0; i < 3; ++i) {
+        if (!(fresh & s_lane[i])) {
+            continue;
+        }
+        Cap* c = &s_cap[i];
+        if (c->state == CAP_ARMED) {
+            c->steps = c->count((axis_t)i);
+            c->confirmed = 0;
+            c->state = CAP_HIT;
+        }
+        if (s_on_trip != NULL) {
+            s_on_trip((axis_t)i);
+        }
+    }
 }
 
 void limits_init_min(void) {
     // enable clocks and set input+PU for each configured MIN pin
+    s_lines = 0;
     for (int i = 0; i < 3; ++i) {
+        s_lane[i] = 0;
         if (LIM_MIN[i].port) {
             bsp_gpio_en(LIM_MIN[i].port);
             bsp_gpio_in_pu(LIM_MIN[i].port, LIM_MIN[i].pin);
-            // seed debouncer with current raw level
-            s_min_db[i].cnt = 0;
-            s_min_db[i].last_sample = read_active(&LIM_MIN[i]) ? 1 : 0;
-            s_min_db[i].stable = s_min_db[i].last_sample;
+            // debounced with the other inputs, EXTI on the pressed edge (already pressed:
+            // starts tripped)
+            s_lane[i] = inputs_add(LIM_MIN[i].port, LIM_MIN[i].pin, LIM_MIN[i].active_low != 0,
+                                   true);
+            s_cap[i].state = CAP_OFF;
+            if (s_lane[i]) {
+                s_lines |= 1UL << LIM_MIN[i].pin;
+            }
         }
     }
+    NVIC_EnableIRQ(EXTI0_IRQn); // PA0 X_MIN
+    NVIC_EnableIRQ(EXTI1_IRQn); // PA1 Y_MIN
+    NVIC_EnableIRQ(EXTI4_IRQn); // PA4 Z_MIN
 }
 
+void limits_on_trip(limits_trip_fn fn) {
+    s_on_trip = fn;
+}
+
+/* After inputs_tick(): the captures follow the debounced switches */
 void limits_poll_tick(void) {
+    const uint32_t state = inputs_state();
+    const uint32_t rearmed = inputs_rearmed();
     for (int i = 0; i < 3; ++i) {
-        if (!LIM_MIN[i].port)
+        Cap* c = &s_cap[i];
+        if (c->state != CAP_HIT) {
             continue;
-        uint8_t raw = read_active(&LIM_MIN[i]) ? 1 : 0;
-        deb_tick(&s_min_db[i], raw);
+        }
+        if (state & s_lane[i]) {
+            c->confirmed = 1;
+        }
+        if ((rearmed & s_lane[i]) && !c->confirmed) {
+            c->state = CAP_ARMED; // spike: wait for the real edge
+        }
     }
 }
 
 bool limits_min_pressed(axis_t a) {
-    return s_min_db[(int)a].stable != 0;
+    return (inputs_state() & s_lane[(int)a]) != 0U;
 }
 
 bool limits_block_neg(axis_t a) {
-    // policy: block negative motion when MIN is debounced-pressed
-    return limits_min_pressed(a);
+    // policy: block negative motion from the first edge until the debounced release
+    return (inputs_active() & s_lane[(int)a]) != 0U;
+}
+
+void limits_capture_arm(axis_t a, limits_count_fn count) {
+    const int i = (int)a;
+    s_cap[i].count = count;
+    s_cap[i].confirmed = 0;
+    s_cap[i].state = CAP_ARMED; // the line itself is armed whenever the switch is released
+}
+
+void limits_capture_disarm(axis_t a) {
+    s_cap[(int)a].state = CAP_OFF;
+}
+
+bool limits_capture_get(axis_t a, uint32_t* steps) {
+    const Cap* c = &s_cap[(int)a];
+    if (c->state != CAP_HIT) {
+        return false;
+    }
+    *steps = c->steps;
+    return true;
+}
+
+void EXTI0_IRQHandler(void) {
+    ISR_PROF_ENTER();
+    on_edge();
+    ISR_PROF_EXIT(ISR_PROF_LIMITS);
+}
+
+void EXTI1_IRQHandler(void) {
+    ISR_PROF_ENTER();
+    on_edge();
+    ISR_PROF_EXIT(ISR_PROF_LIMITS);
+}
+
+void EXTI4_IRQHandler(void) {
+    ISR_PROF_ENTER();
+    on_edge();
+    ISR_PROF_EXIT(ISR_PROF_LIMITS);
 }
@@ -1,10 +1,27 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "axis.h"
 
 void limits_init_min(void); // configure X/Y/Z MIN pins as input + pull-up
-void limits_poll_tick(void);
-bool limits_min_pressed(axis_t a); // raw reading with polarity from bsp_pins.h
-bool limits_block_neg(axis_t a); // true if we must block motion toward MIN
+void limits_poll_tick(void); // 1 kHz, after inputs_tick(): drops captures of spikes
+bool limits_min_pressed(axis_t a); // debounced, polarity from bsp_pins.h
+bool limits_block_neg(axis_t a); // true if we must block motion toward MIN (from the 1st edge)
+
+// Called from the EXTI on the first pressed edge of axis a's MIN (e.g. stepgen_trip_min),
+// at the step ISR's priority
+typedef void (*limits_trip_fn)(axis_t a);
+void limits_on_trip(limits_trip_fn fn);
+
+/*
+Hardware trigger capture for homing: arm an axis before a move toward MIN and the first
+pressed edge (EXTI) samples count(a), e.g. stepgen_steps_issued, within microseconds.
+Call from thread / SysTick context; limits_poll_tick() drops hits the debouncer never sees.
+The capture is the edge that trips the switch: arm it while the switch is released.
+*/
+typedef uint32_t (*limits_count_fn)(axis_t a);
+void limits_capture_arm(axis_t a, limits_count_fn count);
+void limits_capture_disarm(axis_t a);
+bool limits_capture_get(axis_t a, uint32_t* steps); // true once the edge has been captured
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stm32f4xx.h"
+
+/**
+ * Hardware e-stop on the step timer's break input (TIM1_BKIN).
+ *
+ * With BKE set, the active level on BKIN clears MOE asynchronously: no clock, no interrupt,
+ * no software. With OSSI set the STEP outputs are then driven to their idle level (OISx = 0,
+ * low) instead of floating. AOE stays off, so MOE does not come back by itself when the
+ * switch is released: it is the hardware half of the e-stop latch. The software half
+ * (estop_latched(), the EXTI trip) stops the scheduling behind it, and the step engine only
+ * sets MOE again for the first move after estop_clear().
+ */
+
+#define STEPGEN_BDTR_BREAK(active_high)                                                      \
+    (TIM_BDTR_BKE | TIM_BDTR_OSSI | TIM_BDTR_OSSR | ((active_high) ? TIM_BDTR_BKP : 0UL))
+
+// MOE may be set again: latch cleared and the break input released (BIF clears with it)
+static inline bool stepgen_break_may_rearm(bool latched, bool bkin_active) {
+    return !latched && !bkin_active;
+}
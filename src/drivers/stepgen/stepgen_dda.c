@@ -0,0 +1,35 @@
+#include "stepgen_dda.h"
+
+void stepgen_dda_load(stepgen_dda_t* d, const uint32_t steps[STEPGEN_DDA_AXES]) {
+    uint32_t n = 0;
+    for (int i = 0; i < STEPGEN_DDA_AXES; ++i) {
+        d->steps[i] = steps[i];
+        if (steps[i] > n) {
+            n = steps[i];
+        }
+    }
+    d->total = n;
+    d->ticks_left = n;
+
+    // Start every accumulator half way so minor-axis steps land centred on the line
+    for (int i = 0; i < STEPGEN_DDA_AXES; ++i) {
+        d->err[i] = n >> 1;
+    }
+}
+
+uint8_t stepgen_dda_tick(stepgen_dda_t* d) {
+    if (d->ticks_left == 0) {
+        return 0;
+    }
+    d->ticks_left--;
+
+    uint8_t mask = 0;
+    for (int i = 0; i < STEPGEN_DDA_AXES; ++i) {
+        d->err[i] += d->steps[i];
+        if (d->err[i] >= d->total) {
+            d->err[i] -= d->total;
+            mask |= (uint8_t)(1U << i);
+        }
+    }
+    return mask;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Integer DDA (Bresenham) for coordinated X/Y/Z lines (hardware independent).
+ *
+ * A block of (|dx|, |dy|, |dz|) steps is executed in N = max(|d|) ticks of one fixed-rate
+ * step ISR. The dominant axis steps on every tick; the others step when their error term
+ * overflows, so every axis stays within half a step of the ideal straight line.
+ * No division or floating point per tick: one add/compare per axis.
+ */
+
+#define STEPGEN_DDA_AXES 3
+
+typedef struct {
+    uint32_t steps[STEPGEN_DDA_AXES]; // |d| per axis
+    uint32_t total; // N = dominant axis steps = ticks in the block
+    uint32_t err[STEPGEN_DDA_AXES]; // Bresenham accumulators (0..N-1)
+    uint32_t ticks_left;
+} stepgen_dda_t;
+
+/* Load a block of unsigned step counts (directions are handled by the caller). */
+void stepgen_dda_load(stepgen_dda_t* d, const uint32_t steps[STEPGEN_DDA_AXES]);
+
+/* Advance one tick. Returns the axes that step on this tick (bit0=X, bit1=Y, bit2=Z). */
+uint8_t stepgen_dda_tick(stepgen_dda_t* d);
+
+static inline bool stepgen_dda_done(const stepgen_dda_t* d) {
+    return d->ticks_left == 0;
+}
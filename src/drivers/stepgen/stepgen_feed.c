@@ -0,0 +1,169 @@
+#include "stepgen_feed.h"
+
+#include <math.h>
+#include <stddef.h>
+
+static uint8_t clamp_pct(uint8_t p) {
+    return p < STEPGEN_FEED_PCT_MIN ? STEPGEN_FEED_PCT_MIN
+                                    : (p > STEPGEN_FEED_PCT_MAX ? STEPGEN_FEED_PCT_MAX : p);
+}
+
+void stepgen_feed_init(stepgen_feed_t* f) {
+    f->rest = 0;
+    f->v_end = 0.0f;
+    f->state = STEPGEN_FEED_RUN;
+    f->hold_req = 0;
+    f->resume_req = 0;
+    f->pct_req[0] = f->pct_req[1] = 100U;
+    f->pct[0] = f->pct[1] = 100U;
+}
+
+void stepgen_feed_hold(stepgen_feed_t* f) {
+    f->hold_req = 1;
+}
+
+void stepgen_feed_resume(stepgen_feed_t* f) {
+    f->resume_req = 1;
+}
+
+void stepgen_feed_override(stepgen_feed_t* f, uint8_t feed_pct, uint8_t rapid_pct) {
+    f->pct_req[0] = clamp_pct(feed_pct);
+    f->pct_req[1] = clamp_pct(rapid_pct);
+}
+
+static void load(stepgen_feed_t* f, const stepgen_feed_blk_t* b, float v_in) {
+    f->blk = *b;
+    if (f->blk.pct == 0) {
+        f->blk.pct = 100U;
+    }
+    f->rest = b->steps;
+    f->v_end = v_in;
+}
+
+void stepgen_feed_start(stepgen_feed_t* f, stepgen_ramp_t* r, const stepgen_feed_blk_t* b) {
+    f->hold_req = 0;
+    f->resume_req = 0;
+    f->state = STEPGEN_FEED_RUN;
+    load(f, b, b->v_entry);
+    r->total = 0; // nothing planned yet: the first fill plans from the block
+    r->planned = 0;
+    r->scurve = 0;
+}
+
+/* Cut the ramp at the step the producer has reached; the rest goes back to `rest` */
+static void retarget(stepgen_feed_t* f, stepgen_ramp_t* r) {
+    if (r->planned < r->total) {
+        f->v_end = stepgen_ramp_rate_at(r, (float)r->planned);
+        f->rest += r->total - r->planned;
+        r->total = r->planned;
+    }
+}
+
+static float cruise(const stepgen_feed_t* f) {
+    const float c = f->blk.v_nominal * (float)f->pct[f->blk.rapid ? 1 : 0] / (float)f->blk.pct;
+    return c > (float)STEPGEN_MAX_HZ ? (float)STEPGEN_MAX_HZ : c;
+}
+
+/* Decelerate from v_end toward v_to over at most `rest` ticks (one ramp) */
+static void plan_down(stepgen_feed_t* f, stepgen_ramp_t* r, float v_to) {
+    const float v = f->v_end;
+    const float two_a = 2.0f * f->blk.accel;
+    uint32_t n = (uint32_t)ceilf((v * v - v_to * v_to) / two_a);
+    float out = v_to;
+    if (n == 0) {
+        n = 1;
+    }
+    if (n >= f->rest) {
+        n = f->rest;
+        const float o2 = v * v - two_a * (float)n;
+        out = o2 > v_to * v_to ? sqrtf(o2) : v_to;
+    }
+    stepgen_ramp_plan(r, n, v, v, out, f->blk.accel);
+    f->rest -= n;
+    f->v_end = out;
+}
+
+/* Plan (part of) the ticks left in the block; f->rest > 0 */
+static void plan_rest(stepgen_feed_t* f, stepgen_ramp_t* r) {
+    const float a = f->blk.accel;
+    if (f->state == STEPGEN_FEED_DECEL) {
+        if (f->v_end <= 0.0f || a <= 0.0f) {
+            f->v_end = 0.0f; // at rest (or a constant-rate block: stop at its start)
+            f->state = STEPGEN_FEED_HOLD;
+            return;
+        }
+        plan_down(f, r, 0.0f);
+        return;
+    }
+
+    const float c = cruise(f);
+    if (a > 0.0f && f->v_end > c + 1.0f) {
+        plan_down(f, r, c); // override lowered below the current rate: come down first
+        return;
+    }
+    float x = f->blk.v_exit < c ? f->blk.v_exit : c;
+    if (a > 0.0f) {
+        const float reach = sqrtf(f->v_end * f->v_end + 2.0f * a * (float)f->rest);
+        x = x < reach ? x : reach;
+    } else {
+        x = c;
+    }
+    stepgen_ramp_plan(r, f->rest, f->v_end, c, x, a);
+    f->rest = 0;
+    f->v_end = x;
+}
+
+static void apply_requests(stepgen_feed_t* f, stepgen_ramp_t* r) {
+    if (f->hold_req) {
+        f->hold_req = 0;
+        if (f->state == STEPGEN_FEED_RUN) {
+            retarget(f, r);
+            f->state = STEPGEN_FEED_DECEL;
+        }
+    }
+    if (f->resume_req) {
+        f->resume_req = 0;
+        if (f->state == STEPGEN_FEED_DECEL) {
+            retarget(f, r); // back up from the rate the stop had reached
+        }
+        f->state = STEPGEN_FEED_RUN;
+    }
+    if (f->pct_req[0] != f->pct[0] || f->pct_req[1] != f->pct[1]) {
+        f->pct[0] = f->pct_req[0];
+        f->pct[1] = f->pct_req[1];
+        if (f->state == STEPGEN_FEED_RUN) {
+            retarget(f, r); // a hold keeps stopping; the new rates apply on resume
+        }
+    }
+}
+
+bool stepgen_feed_fill(stepgen_feed_t* f, stepgen_lane_t* l, const stepgen_feed_blk_t* next) {
+    stepgen_ramp_t* r = &l->ramp;
+    apply_requests(f, r);
+    for (;;) {
+        stepgen_lane_fill(l);
+        if (r->planned < r->total || f->state == STEPGEN_FEED_HOLD) {
+            return false; // lane full, or the stop is all queued
+        }
+        if (f->rest > 0) {
+            plan_rest(f, r);
+            continue;
+        }
+        if (f->state == STEPGEN_FEED_DECEL && f->v_end <= 0.0f) {
+            f->state = STEPGEN_FEED_HOLD; // stopped exactly at the block's end
+            return false;
+        }
+        if (next == NULL) {
+            return false;
+        }
+
+        // Carry the rate across the junction in proportion to the planned one
+        float v_in = 0.0f;
+        if (f->blk.v_exit > 0.0f) {
+            v_in = f->v_end * next->v_entry / f->blk.v_exit;
+            v_in = v_in < next->v_entry ? v_in : next->v_entry;
+        }
+        load(f, next, v_in);
+        return true;
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stepgen_ramp.h"
+
+/**
+ * Feed hold, cycle start and feed / rapid overrides for the line lane (hardware independent).
+ *
+ * The line lane's producer walks the queued blocks itself instead of planning each one whole.
+ * That way it can cut the ramp it is segmenting at the step it has reached and re-plan what is
+ * left of the block from the rate there:
+ *  - hold: decelerate at the block's acceleration to rest. If the block is too short, the stop
+ *    carries on into the blocks behind it. Once the stop is segmented the producer stops, and the
+ *    tick pauses when the lane runs dry (stepgen_feed_should_pause()).
+ *  - cycle start: the remaining ticks are re-planned from rest.
+ *  - overrides: each block's cruise rate is scaled by now / planned percentage. The change
+ *    follows the acceleration limit from the current rate.
+ * Junction rates are never raised. A block that arrives slower than planned is re-planned
+ * from the rate it actually has, so the next entry stays reachable. Reaction time is what the
+ * lane already holds (at most STEPGEN_SEGQ_LEN segments of ~STEPGEN_SEG_US).
+ *
+ * Requests (hold / resume / override) are single stores, safe from any context; they take
+ * effect at the next stepgen_feed_fill().
+ */
+
+#define STEPGEN_FEED_PCT_MIN 10U
+#define STEPGEN_FEED_PCT_MAX 200U
+
+typedef struct {
+    uint32_t steps; // ticks (dominant-axis steps)
+    float v_entry; // planned rates, dominant axis steps/s
+    float v_nominal;
+    float v_exit;
+    float accel; // steps/s^2 (0 = constant rate, cannot hold early)
+    uint8_t pct; // override percentage v_nominal already includes (0 = 100)
+    uint8_t rapid; // follows the rapid override rather than the feed one
+} stepgen_feed_blk_t;
+
+typedef enum {
+    STEPGEN_FEED_RUN = 0,
+    STEPGEN_FEED_DECEL, // hold requested: decelerating
+    STEPGEN_FEED_HOLD, // the stop is fully segmented: paused once the lane drains
+} stepgen_feed_state_t;
+
+typedef struct {
+    stepgen_feed_blk_t blk; // block being segmented
+    uint32_t rest; // its ticks not yet given to a ramp
+    float v_end; // rate the queued segments end at
+    volatile uint8_t state; // stepgen_feed_state_t (read by the ISR)
+    volatile uint8_t hold_req;
+    volatile uint8_t resume_req;
+    volatile uint8_t pct_req[2]; // feed, rapid override requested
+    uint8_t pct[2]; // in force on the ramps
+} stepgen_feed_t;
+
+void stepgen_feed_init(stepgen_feed_t* f); // RUN, both overrides at 100 %
+
+/* First block of a line (lane idle and reset): pending hold / resume requests are dropped */
+void stepgen_feed_start(stepgen_feed_t* f, stepgen_ramp_t* r, const stepgen_feed_blk_t* b);
+
+/**
+ * Top the lane up. `next` is the block queued behind the current one (NULL if none). Returns
+ * true when it moved on to `next`: the caller then offers the one after it.
+ */
+bool stepgen_feed_fill(stepgen_feed_t* f, stepgen_lane_t* l, const stepgen_feed_blk_t* next);
+
+void stepgen_feed_hold(stepgen_feed_t* f);
+void stepgen_feed_resume(stepgen_feed_t* f);
+void stepgen_feed_override(stepgen_feed_t* f, uint8_t feed_pct, uint8_t rapid_pct); // clamped
+
+/* ISR side: the hold has run out of segments, stop ticking (keeps the line) */
+static inline bool stepgen_feed_should_pause(const stepgen_feed_t* f, const stepgen_lane_t* l) {
+    return f->state == STEPGEN_FEED_HOLD && l->seg_left == 0 && l->tail == l->head;
+}
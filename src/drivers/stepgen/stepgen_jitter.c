@@ -0,0 +1,43 @@
+#include "stepgen_jitter.h"
+
+#include <string.h>
+
+void stepgen_jitter_reset(stepgen_jitter_t* j) {
+    memset(j, 0, sizeof *j);
+}
+
+uint32_t stepgen_jitter_bin(int32_t deviation) {
+    const int32_t w = STEPGEN_JITTER_BIN_CYCLES;
+    const int32_t mid = (int32_t)STEPGEN_JITTER_MID;
+    // Nearest bin, rounding down on negative values as well (C division truncates)
+    int32_t k = deviation + w / 2;
+    k = k >= 0 ? k / w : -((-k + w - 1) / w);
+    if (k < -mid) {
+        return 0U;
+    }
+    if (k > mid) {
+        return STEPGEN_JITTER_BINS - 1U;
+    }
+    return (uint32_t)(k + mid);
+}
+
+void stepgen_jitter_rise(stepgen_jitter_t* j,
+                         uint32_t stamp,
+                         uint16_t ccr,
+                         uint32_t cycles_per_tick) {
+    if (j->have_last && stamp - j->last_stamp < STEPGEN_JITTER_MAX_TICKS * cycles_per_tick) {
+        const uint32_t commanded = (uint16_t)(ccr - j->last_ccr) * cycles_per_tick;
+        const int32_t d = (int32_t)(stamp - j->last_stamp - commanded);
+        j->bins[stepgen_jitter_bin(d)]++;
+        if (j->count == 0U || d < j->min) {
+            j->min = d;
+        }
+        if (j->count == 0U || d > j->max) {
+            j->max = d;
+        }
+        j->count++;
+    }
+    j->last_stamp = stamp;
+    j->last_ccr = ccr;
+    j->have_last = true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Step-timing jitter histogram for one axis (hardware independent).
+ *
+ * The step ISR stamps every rising-edge compare with the core cycle counter. The interval
+ * between two stamps, minus the interval the compare registers commanded (CCR to CCR, in
+ * timer ticks), is how much the ISR's own latency moved from one step to the next. With the
+ * pulses toggled by the timer that is headroom, not edge error: the edge is exact as long as
+ * the ISR re-arms the channel in time. A step engine that drives STEP from software would
+ * see it on the pin one to one, so the same histogram compares the two.
+ *
+ * The compare values are absolute timer times, so any two rises less than one 16-bit timer
+ * period apart (65.5 ms at 1 MHz) give a valid interval: across single DDA pulses and short
+ * pauses too. A longer gap only starts a new chain.
+ *
+ * STEPGEN_JITTER_BINS bins of STEPGEN_JITTER_BIN_CYCLES each, centred on 0; the two end
+ * bins also take everything beyond them.
+ */
+
+#define STEPGEN_JITTER_BINS 65U // odd: bin STEPGEN_JITTER_MID is "on time"
+#define STEPGEN_JITTER_MID (STEPGEN_JITTER_BINS / 2U)
+#define STEPGEN_JITTER_BIN_CYCLES 36 // 0.2 us at 180 MHz, +-6.4 us across the table
+#define STEPGEN_JITTER_MAX_TICKS 0xFF00U // longest interval taken (CCR wrap, latency slack)
+
+typedef struct {
+    uint32_t bins[STEPGEN_JITTER_BINS];
+    uint32_t count; // intervals binned
+    int32_t min, max; // deviation in cycles (valid once count != 0)
+    uint32_t last_stamp; // cycle stamp of the previous rise
+    uint16_t last_ccr; // its compare value
+    bool have_last; // false: the next rise only starts a chain
+} stepgen_jitter_t;
+
+void stepgen_jitter_reset(stepgen_jitter_t* j);
+
+// A rising edge whose compare value was `ccr`, serviced at core cycle `stamp`
+void stepgen_jitter_rise(stepgen_jitter_t* j,
+                         uint32_t stamp,
+                         uint16_t ccr,
+                         uint32_t cycles_per_tick);
+
+// Bin of a deviation in cycles (rounded to the nearest bin, ends open)
+uint32_t stepgen_jitter_bin(int32_t deviation);
@@ -0,0 +1,64 @@
+#include "stepgen_oc.h"
+
+static inline uint16_t clamp_edge(uint32_t ticks) {
+    if (ticks < STEPGEN_OC_MIN_EDGE_TICKS) {
+        return (uint16_t)STEPGEN_OC_MIN_EDGE_TICKS;
+    }
+    if (ticks > STEPGEN_OC_MAX_EDGE_TICKS) {
+        return (uint16_t)STEPGEN_OC_MAX_EDGE_TICKS;
+    }
+    return (uint16_t)ticks;
+}
+
+void stepgen_oc_set_period(stepgen_oc_t* oc, uint32_t period_ticks) {
+    // Odd periods put the extra tick in the low half; the rising-edge spacing stays exact.
+    uint32_t high = period_ticks >> 1;
+    oc->high_ticks = clamp_edge(high);
+    oc->low_ticks = clamp_edge(period_ticks - high);
+}
+
+void stepgen_oc_start(stepgen_oc_t* oc, uint16_t now, uint32_t steps) {
+    oc->level = 0;
+    oc->steps_left = steps;
+    oc->issued = 0;
+    oc->ccr = (uint16_t)(now + STEPGEN_OC_LEAD_TICKS);
+}
+
+bool stepgen_oc_queue_step(stepgen_oc_t* oc, uint16_t at) {
+    if (oc->steps_left != 0) {
+        oc->steps_left++;
+        return false;
+    }
+    oc->level = 0;
+    oc->steps_left = 1;
+    oc->ccr = at;
+    return true;
+}
+
+stepgen_oc_event_t stepgen_oc_on_match(stepgen_oc_t* oc) {
+    if (oc->level == 0) {
+        // Rising edge just fired -> schedule the fall
+        oc->level = 1;
+        oc->issued++;
+        oc->pos += oc->dir;
+        oc->ccr = (uint16_t)(oc->ccr + oc->high_ticks);
+        return STEPGEN_OC_RISE;
+    }
+
+    // Falling edge just fired -> one full pulse is out
+    oc->level = 0;
+    if (oc->steps_left != 0) {
+        oc->steps_left--;
+    }
+    if (oc->steps_left == 0) {
+        return STEPGEN_OC_DONE;
+    }
+    oc->ccr = (uint16_t)(oc->ccr + oc->low_ticks);
+    return STEPGEN_OC_FALL;
+}
+
+bool stepgen_oc_stop(stepgen_oc_t* oc) {
+    // Keep one "owed" step while high so the fall completes and reports DONE
+    oc->steps_left = oc->level ? 1U : 0U;
+    return oc->level == 0;
+}
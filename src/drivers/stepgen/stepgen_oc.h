@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Per-axis output-compare step scheduler (hardware independent).
+ *
+ * The step timer free-runs over its full 16-bit range and every STEP channel runs in
+ * output-compare TOGGLE mode. Each compare match flips the pin; the ISR then calls
+ * stepgen_oc_on_match() to get the next compare value. Because every axis owns its own
+ * CCR, X/Y/Z run at independent periods on one timer.
+ *
+ * All times are in timer ticks (1 tick = 1 us with the 1 MHz prescaler) and use
+ * wrap-around uint16_t arithmetic, exactly like the CNT/CCR registers.
+ */
+
+#define STEPGEN_OC_MIN_EDGE_TICKS 4U // shortest high/low time we schedule (ISR headroom)
+#define STEPGEN_OC_MAX_EDGE_TICKS 0xFFFFU // longest gap a 16-bit compare can represent
+#define STEPGEN_OC_LEAD_TICKS 8U // delay from "start" to the first rising edge
+
+typedef enum {
+    STEPGEN_OC_RISE = 0, // STEP went high: one step issued, falling edge scheduled
+    STEPGEN_OC_FALL, // STEP went low: next rising edge scheduled
+    STEPGEN_OC_DONE, // STEP went low and no steps remain: freeze the channel
+} stepgen_oc_event_t;
+
+typedef struct {
+    uint16_t ccr; // compare value of the pending edge
+    uint16_t high_ticks; // STEP high time
+    uint16_t low_ticks; // STEP low time
+    uint8_t level; // STEP level before the pending edge fires (0 = next edge rises)
+    uint32_t steps_left; // rising edges still owed, including one in flight
+    uint32_t issued; // rising edges since stepgen_oc_start() (wraps)
+    int32_t pos; // machine position in steps: every rising edge adds dir (never reset here)
+    int8_t dir; // +1 away from MIN, -1 toward it (set with DIR, between steps)
+} stepgen_oc_t;
+
+/**
+ * Split a step period into high/low halves, clamped to what the timer can represent.
+ * Takes effect from the next scheduled edge, so it is safe to call mid-move.
+ */
+void stepgen_oc_set_period(stepgen_oc_t* oc, uint32_t period_ticks);
+
+/**
+ * Arm a move of `steps` pulses. The first rising edge is at now + STEPGEN_OC_LEAD_TICKS.
+ * Call stepgen_oc_set_period() first.
+ */
+void stepgen_oc_start(stepgen_oc_t* oc, uint16_t now, uint32_t steps);
+
+/**
+ * Queue one more step from an external step source (the coordinated DDA tick).
+ * Idle channel: arms a single pulse rising at `at` and returns true (caller arms the
+ * hardware). Active channel: appends the step; the pending falling edge schedules the
+ * rise `low_ticks` later, which keeps it on the caller's tick grid when the period is set
+ * to the tick period. Returns false (nothing to arm).
+ */
+bool stepgen_oc_queue_step(stepgen_oc_t* oc, uint16_t at);
+
+/**
+ * Called after the hardware has toggled at `oc->ccr`. Advances to the next edge and
+ * reports what just happened. On STEPGEN_OC_DONE the caller must freeze the channel.
+ */
+stepgen_oc_event_t stepgen_oc_on_match(stepgen_oc_t* oc);
+
+/**
+ * Abort: drop any owed steps. If the pin is high, the pending falling edge still fires
+ * and then reports STEPGEN_OC_DONE, so no runt pulse is produced.
+ * Returns true when the pin is already low and the caller should freeze the channel now.
+ */
+bool stepgen_oc_stop(stepgen_oc_t* oc);
+
+/**
+ * True when the counter (`cnt`) has already reached an edge scheduled at `at`, `at - from`
+ * ticks after the edge at `from` that was just serviced. Lateness is judged against that
+ * commanded gap, not half the counter range, so every gap up to STEPGEN_OC_MAX_EDGE_TICKS
+ * keeps its length as long as the ISR runs within one wrap of `from`.
+ */
+static inline bool stepgen_oc_late(uint16_t from, uint16_t at, uint16_t cnt) {
+    return (uint16_t)(cnt - from) >= (uint16_t)(at - from);
+}
+
+static inline bool stepgen_oc_active(const stepgen_oc_t* oc) {
+    return oc->steps_left != 0;
+}
@@ -5,27 +5,84 @@
 #include "bsp_gpio.h"
 #include "bsp_pins.h"
 #include "estop.h"
+#include "isr_prof.h"
 #include "limits.h"
+#include "stepgen_break.h"
+#include "stepgen_dda.h"
+#include "stepgen_feed.h"
+#include "stepgen_jitter.h"
+#include "stepgen_oc.h"
+#include "stepgen_ramp.h"
 
 /*
-On STM32F446 with SYSCLK=180MHz, APB1 prescaler = 4
-==> APB1 bus clock = 180/4 = 45MHz
+Step timer: TIM1, an advanced timer, for its break input (see stepgen_break.h). The e-stop
+switch on TIM1_BKIN forces every STEP output low in hardware, whatever the ISR is doing.
+
+On STM32F446 with SYSCLK=180MHz, APB2 prescaler = 2
+==> APB2 bus clock = 180/2 = 90MHz
 Timers on STM32 have special rules:
 -Case 1: If APB prescaler = 1 --> timer clock = APB clock
 -Case 2: If APB precaaler > 1 --> timer clock = 2*APB clock
-==> TIM3clk=2*APB1=90MHz.
+==> TIM1clk=2*APB2=180MHz.
 Now the counter clock frequency (CK_CNT) = fck_psc/(PSC[15:0]+1)
-we want CK_CNT = 1MHz = 90MHz(PSC + 1)
-Therefore PSC = (90MHz/1MHz) - 1 = 89  TIM_PSC_1MHz (90UL - 1UL)
+we want CK_CNT = 1MHz = 180MHz(PSC + 1)
+Therefore PSC = (180MHz/1MHz) - 1 = 179  TIM_PSC_1MHz (180UL - 1UL)
 */
-#define TIM_PSC_1MHz (90UL - 1UL)
+#define STEP_TIM TIM1
+#define TIM_PSC_1MHz (180UL - 1UL)
 
-static volatile uint32_t steps_remaining[3] = {0, 0, 0};
-static volatile uint8_t moving_mask = 0; // bit0=X, bit1=Y, bit2=Z
+/*
+Per-axis rates: the timer free-runs over 0..0xFFFF and each STEP channel is an independent
+output-compare in TOGGLE mode. Every compare match flips the pin and raises CCxIF; the ISR
+pushes that channel's CCR forward by its own high/low time (see stepgen_oc.c).
+An idle channel is parked in "force inactive" so the wrapped counter never toggles it.
+
+Coordinated lines: CH4 has no pin; its compare is the fixed-rate DDA tick. Each tick the
+Bresenham decides which axes step and queues one pulse on their channels at tick + lead,
+so every axis' edges sit on the same tick grid. Lines are queued (LINEQ_LEN) and chained at
+the tick that follows a block's last step, so planned junction speeds carry across blocks.
+
+Acceleration: every move owns a lane of precomputed {steps, period} segments (stepgen_ramp.c).
+The ISR pops one interval per step; stepgen_prep() (1 kHz, SysTick) keeps lanes topped up.
+Lanes 0..2 serve independent axis moves, LINE_LANE serves the DDA tick.
+
+Feed hold: the line lane's producer (stepgen_feed.c) segments a stop instead of the rest of
+the block; when the lane runs dry the tick interrupt is switched off with the line still
+loaded (paused). Cycle start re-plans the rest and stepgen_prep() re-arms the tick.
+*/
+#define OCM_TOGGLE 3UL
+#define OCM_FORCE_LOW 4UL
+#define TICK_CH 4U
+#define LINE_LANE 3
+#define LINEQ_LEN 4U // queued coordinated blocks (power of two, one slot kept free)
+
+typedef struct {
+    uint32_t n[3]; // |steps| per axis
+    uint8_t cw_mask; // DIR per axis (bit i = CW)
+    stepgen_feed_blk_t feed; // dominant-axis rates, entry -> cruise -> exit
+} line_blk_t;
+
+static stepgen_oc_t s_oc[3];
+static stepgen_dda_t s_dda;
+static stepgen_lane_t s_lane[4];
+static uint32_t s_accel[3] = {0, 0, 0}; // steps/s^2 for independent moves (0 = no ramp)
+static uint32_t s_jerk[3] = {0, 0, 0}; // steps/s^3: non-zero selects the S-curve profile
+static volatile uint8_t s_line_active;
+static volatile uint8_t s_line_paused; // held: line loaded, tick interrupt off
+static stepgen_feed_t s_feed;
+static line_blk_t s_lineq[LINEQ_LEN];
+static volatile uint8_t s_lineq_head; // written by stepgen_line() only
+static volatile uint8_t s_lineq_tail; // next block the tick loads (ISR)
+static uint8_t s_lane_blk; // next block the line lane segments (producer)
 static volatile uint8_t dir_is_cw[3] = {1, 1, 1}; // remember last CW/CCW
+static volatile uint32_t s_pos_seq; // bumped by every step ISR: position snapshots retry on it
+#if STEP_JITTER
+static stepgen_jitter_t s_jit[3]; // written by the step ISR only
+static volatile uint8_t s_jit_clear[3]; // stepgen_jitter_clear() -> the axis' next rise
+#endif
 
 typedef struct {
-    // STEP (AF = TIM3 CHn)
+    // STEP (AF = TIM1 CHn)
     GPIO_TypeDef* step_port;
     uint8_t step_pin;
     uint8_t step_af;
@@ -58,14 +115,37 @@ static inline const AxisHw* ainfo(axis_t a) {
 static inline void ch_enable(uint8_t ch, bool on) {
     uint32_t m = (ch == 1) ? TIM_CCER_CC1E : (ch == 2) ? TIM_CCER_CC2E : TIM_CCER_CC3E;
     if (on) {
-        TIM3->CCER |= m;
+        STEP_TIM->CCER |= m;
     } else {
-        TIM3->CCER &= ~m;
+        STEP_TIM->CCER &= ~m;
     }
 }
 
 /* Map CH -> CCR pointer (array index 1..3 valid) */
-static volatile uint32_t* const CCRn[4] = {NULL, &TIM3->CCR1, &TIM3->CCR2, &TIM3->CCR3};
+static volatile uint32_t* const CCRn[4] = {NULL, &STEP_TIM->CCR1, &STEP_TIM->CCR2, &STEP_TIM->CCR3};
+
+/* CCxIE (DIER) and CCxIF (SR) share the same bit position: bit n for channel n */
+static inline uint32_t cc_bit(uint8_t ch) {
+    return 1UL << ch;
+}
+
+/* Output-compare mode for CH1..3 (OCxM lives in CCMR1 for CH1/2, CCMR2 for CH3) */
+static inline void ch_mode(uint8_t ch, uint32_t ocm) {
+    volatile uint32_t* ccmr = (ch <= 2U) ? &STEP_TIM->CCMR1 : &STEP_TIM->CCMR2;
+    uint32_t pos = (ch == 2U) ? TIM_CCMR1_OC2M_Pos : TIM_CCMR1_OC1M_Pos; // CH3 uses OC1M slot
+    *ccmr = (*ccmr & ~(7UL << pos)) | (ocm << pos);
+}
+
+/* Never write a compare value the counter has already passed: it would fire one wrap
+   (65.5 ms) late. `ccr` is scheduled from the edge at `from`; if the ISR ran past it,
+   re-base the edge just ahead of CNT. */
+static inline uint16_t ccr_ahead_of_cnt(uint16_t from, uint16_t ccr) {
+    const uint16_t cnt = (uint16_t)STEP_TIM->CNT;
+    if (stepgen_oc_late(from, ccr, cnt)) {
+        ccr = (uint16_t)(cnt + STEPGEN_OC_MIN_EDGE_TICKS);
+    }
+    return ccr;
+}
 
 static void init_axis_gpio_and_channel(axis_t a) {
     const AxisHw* h = ainfo(a);
@@ -75,91 +155,142 @@ static void init_axis_gpio_and_channel(axis_t a) {
     bsp_gpio_en(h->dir_port);
     bsp_gpio_en(h->en_port);
 
-    bsp_gpio_af_pp_hs(h->step_port, h->step_pin, h->step_af); // STEP (AF -> TIM3 CHn)
+    bsp_gpio_af_pp_hs(h->step_port, h->step_pin, h->step_af); // STEP (AF -> TIM1 CHn)
     bsp_gpio_out_pp_hs(h->dir_port, h->dir_pin); // DIR
     bsp_gpio_out_pp_hs(h->en_port, h->en_pin); // EN
 
     // Default state for safety (TMC2209 Disabled: Enable_Pin = HIGH)
     h->en_port->BSRR = (1UL << h->en_pin);
 
-    /* Channel config: PWM mode 1 + preload, active high */
+    /* Channel config: output compare, no preload (CCR must update on the fly), active high */
     if (h->ch == 1) {
-        TIM3->CCMR1 &= ~(TIM_CCMR1_CC1S | TIM_CCMR1_OC1M);
-        TIM3->CCMR1 |= (6UL << TIM_CCMR1_OC1M_Pos) | TIM_CCMR1_OC1PE;
-        TIM3->CCER &= ~TIM_CCER_CC1P;
+        STEP_TIM->CCMR1 &= ~(TIM_CCMR1_CC1S | TIM_CCMR1_OC1M | TIM_CCMR1_OC1PE);
+        STEP_TIM->CCER &= ~TIM_CCER_CC1P;
     } else if (h->ch == 2) {
-        TIM3->CCMR1 &= ~(TIM_CCMR1_CC2S | TIM_CCMR1_OC2M);
-        TIM3->CCMR1 |= (6UL << TIM_CCMR1_OC2M_Pos) | TIM_CCMR1_OC2PE;
-        TIM3->CCER &= ~TIM_CCER_CC2P;
+        STEP_TIM->CCMR1 &= ~(TIM_CCMR1_CC2S | TIM_CCMR1_OC2M | TIM_CCMR1_OC2PE);
+        STEP_TIM->CCER &= ~TIM_CCER_CC2P;
     } else { /* ch == 3 */
-        TIM3->CCMR2 &= ~(TIM_CCMR2_CC3S | TIM_CCMR2_OC3M);
-        TIM3->CCMR2 |= (6UL << TIM_CCMR2_OC3M_Pos) | TIM_CCMR2_OC3PE;
-        TIM3->CCER &= ~TIM_CCER_CC3P;
+        STEP_TIM->CCMR2 &= ~(TIM_CCMR2_CC3S | TIM_CCMR2_OC3M | TIM_CCMR2_OC3PE);
+        STEP_TIM->CCER &= ~TIM_CCER_CC3P;
     }
+    ch_mode(h->ch, OCM_FORCE_LOW); // park STEP low until a move arms it
 
     ch_enable(h->ch, true);
 }
 
-static inline uint8_t axis_bit(axis_t a) {
-    return (uint8_t)(1UL << (int)a);
+/* E-stop: latched in software, or the break input has taken the outputs (MOE cleared) */
+static inline bool halted(void) {
+    return estop_latched() || !(STEP_TIM->BDTR & TIM_BDTR_MOE);
+}
+
+/* Give the outputs back after estop_clear(); MOE does not stick while BKIN is active */
+static bool outputs_on(void) {
+    if (STEP_TIM->BDTR & TIM_BDTR_MOE) {
+        return true;
+    }
+    const bool bkin = (((ESTOP_PORT->IDR >> ESTOP_PIN) & 1UL) != 0) == (ESTOP_ACTIVE_HIGH != 0);
+    if (!stepgen_break_may_rearm(estop_latched(), bkin)) {
+        return false;
+    }
+    STEP_TIM->SR = (uint32_t)~TIM_SR_BIF; // rc_w0
+    STEP_TIM->BDTR |= TIM_BDTR_MOE;
+    return (STEP_TIM->BDTR & TIM_BDTR_MOE) != 0U;
+}
+
+static inline bool moving_negative(axis_t a) {
+    bool cw = dir_is_cw[(int)a];
+    return cw ? axis_cw_is_negative(a) : !axis_cw_is_negative(a);
+}
+
+/* Park the channel low and forget the move. ISR context, or with the channel's CCxIE off. */
+static void axis_halt(axis_t a) {
+    const AxisHw* h = ainfo(a);
+    ch_mode(h->ch, OCM_FORCE_LOW);
+    STEP_TIM->DIER &= ~cc_bit(h->ch);
+    s_oc[(int)a].steps_left = 0;
+    s_oc[(int)a].level = 0;
+    s_lane[(int)a].active = 0;
 }
 
-static inline bool any_moving(void) {
-    return moving_mask != 0;
+/* Drop the owed steps; a pulse in flight still finishes low (no runt). Any context. */
+static void axis_stop(axis_t a) {
+    const AxisHw* h = ainfo(a);
+    STEP_TIM->DIER &= ~cc_bit(h->ch);
+    if (stepgen_oc_stop(&s_oc[(int)a])) {
+        axis_halt(a);
+    } else {
+        STEP_TIM->DIER |= cc_bit(h->ch); // let the pulse in flight finish low
+    }
 }
 
+static void line_abort(void);
+
 /*------------ Public API ---------------*/
 
 void stepgen_init_all(void) {
-    // Timer 3 Clock Enable
-    RCC->APB1ENR |= RCC_APB1ENR_TIM3EN;
+    // Timer 1 Clock Enable
+    RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
 
-    // Timer 3 DMA/interrupt enable register (Enable update interrupt, NVIC)
-    TIM3->DIER |= TIM_DIER_UIE;
-    NVIC_EnableIRQ(TIM3_IRQn);
+    // Compare interrupts are enabled per channel while that axis moves
+    STEP_TIM->DIER = 0;
+    NVIC_EnableIRQ(TIM1_CC_IRQn);
 
     /**
-     * Timer 3 Base Configuration
-     * 1 MHz tick, 1kHz default period, ARPE on
+     * Timer 1 Base Configuration
+     * 1 MHz tick, free-running over the full 16-bit range (each channel keeps its own period)
      */
-    TIM3->CR1 = 0;
-    TIM3->PSC = TIM_PSC_1MHz; // 1 MHz timer clock
-    TIM3->ARR = 1000 - 1; // period => 1 kHz PWM (With a 1 MHz tick, ARR = 999 → period = 1000 ticks
-                          // → 1 kHz.)
-    TIM3->CR1 |= TIM_CR1_ARPE; // Don’t immediately change the timer period when ARR is updated
-                               // instead wait until the next update event
-
-    // Init all axes (pins + per-channel PWM config)
+    STEP_TIM->CR1 = 0;
+    STEP_TIM->PSC = TIM_PSC_1MHz; // 1 MHz timer clock
+    STEP_TIM->ARR = 0xFFFFUL; // no shared period: CNT wraps every 65.536 ms
+    STEP_TIM->RCR = 0;
+
+    // Break: BKIN (e-stop) clears MOE and parks every STEP low in hardware. Outputs idle low
+    // (OISx = 0, OSSI: driven, not floating) from here on, before the pins go to AF.
+    // MOE is set at the end and after estop_clear(), never automatically (AOE = 0).
+    STEP_TIM->CR2 &= ~(TIM_CR2_OIS1 | TIM_CR2_OIS2 | TIM_CR2_OIS3);
+    STEP_TIM->BDTR = STEPGEN_BDTR_BREAK(ESTOP_ACTIVE_HIGH != 0);
+
+    // Init all axes (pins + per-channel compare config)
     init_axis_gpio_and_channel(AXIS_X);
     init_axis_gpio_and_channel(AXIS_Y);
     init_axis_gpio_and_channel(AXIS_Z);
 
-    /* 50% duty on all channels initially */
-    uint16_t ccr = (uint16_t)((TIM3->ARR + 1U) >> 1);
-    TIM3->CCR1 = ccr;
-    TIM3->CCR2 = ccr;
-    TIM3->CCR3 = ccr;
+    // CH4: frozen output compare with no pin (CC4E stays off), used only as the DDA tick
+    STEP_TIM->CCMR2 &= ~(TIM_CCMR2_CC4S | TIM_CCMR2_OC4M | TIM_CCMR2_OC4PE);
+    STEP_TIM->CCER &= ~TIM_CCER_CC4E;
+
+    // Default 1 kHz on every axis until stepgen_set_hz() says otherwise
+    for (int i = 0; i < 3; ++i) {
+        stepgen_oc_set_period(&s_oc[i], STEPGEN_TICK_HZ / 1000UL);
+        s_oc[i].steps_left = 0;
+        s_oc[i].level = 0;
+        s_oc[i].pos = 0; // unknown until homed
+        s_oc[i].dir = moving_negative((axis_t)i) ? -1 : 1;
+    }
+    stepgen_feed_init(&s_feed);
 
     // Update generation
-    TIM3->EGR = TIM_EGR_UG; // Update Generation: load ARR/CCR1, reset CNT
+    STEP_TIM->EGR = TIM_EGR_UG; // Update Generation: load PSC/ARR, reset CNT
     /*
     Reinitialize the counter and generates an update of the registers. Note that the prescaler
     counter is cleared too (anyway the prescaler ratio is not affected). The counter is cleared
     if the center-aligned mode is selected or if DIR=0 (upcounting), else it takes the
     auto-reload value (TIMx_ARR) if DIR=1 (downcounting).
 
-    Forces an update event: copies ARR/CCR1 from their preload buffers into the active registers
-    and resets the counter to 0. Without this, your preloads wouldn’t take effect until the first
-    natural rollover
+    Forces an update event: copies PSC/ARR from their preload buffers into the active registers
+    and resets the counter to 0. Without this, the prescaler wouldn’t take effect until the
+    first natural rollover
     */
+    STEP_TIM->SR = 0;
+    STEP_TIM->BDTR |= TIM_BDTR_MOE; // stays clear if the e-stop is pressed at power-up
 }
 
 void stepgen_start_all(void) {
-    TIM3->CR1 |= TIM_CR1_CEN; // Counter enabled
+    STEP_TIM->CR1 |= TIM_CR1_CEN; // Counter enabled
 }
 
 void stepgen_stop_all(void) {
-    TIM3->CR1 &= ~TIM_CR1_CEN; // Counter disabled
+    STEP_TIM->CR1 &= ~TIM_CR1_CEN; // Counter disabled
 }
 
 void stepgen_enable(axis_t a, bool enable_low_active) {
@@ -177,6 +308,8 @@ void stepgen_dir(axis_t a, bool cw) {
     const AxisHw* h = ainfo(a);
     dir_is_cw[(int)a] = cw;
 
+    s_oc[(int)a].dir = moving_negative(a) ? -1 : 1; // what each rise adds to the position
+
     const bool high_is_cw = axis_dir_high_is_cw(a);
     const bool want_high = (cw == high_is_cw);
 
@@ -188,102 +321,450 @@ void stepgen_dir(axis_t a, bool cw) {
 }
 
 /**
- * Shared frequency (TIM3): set ARR from 1 MHz base, and 50% duty for selected axis
-   ARR is shared -> all axes run at the same Hz
+ * Per-axis frequency: period = 1 MHz / hz ticks, split 50/50 into high/low.
+ * Only this axis is affected; the new rate applies from its next edge (a running ramp
+ * overrides it again on the following step). hz == 0 aborts this axis' move.
  */
 void stepgen_set_hz(axis_t a, uint32_t hz) {
-    // Guard and compute ARR from 1 MHz base: ARR = 1e6/hz - 1
     if (hz == 0UL) {
-        stepgen_stop_all();
+        axis_stop(a);
         return;
     }
-    uint32_t arr = (1000000UL / hz); // 1 MHz base
-    if (arr == 0UL) {
-        arr = 1UL; // clamp
-    }
-    arr -= 1UL;
+    stepgen_oc_set_period(&s_oc[(int)a], STEPGEN_TICK_HZ / hz); // 1 MHz base
+}
 
-    TIM3->ARR = (uint16_t)arr;
+void stepgen_set_accel(axis_t a, uint32_t steps_per_s2) {
+    s_accel[(int)a] = steps_per_s2;
+}
 
-    // Selected axis keeps 50% duty
-    const AxisHw* h = ainfo(a);
-    *CCRn[h->ch] = (uint16_t)((arr + 1U) >> 1);
+void stepgen_set_jerk(axis_t a, uint32_t steps_per_s3) {
+    s_jerk[(int)a] = steps_per_s3;
+}
+
+static void line_lane_fill(void);
+static void line_unpause(void);
 
-    TIM3->EGR = TIM_EGR_UG; /* latch ARR/CCR */
+void stepgen_prep(void) {
+    for (int i = 0; i < 3; ++i) {
+        if (s_lane[i].active) {
+            stepgen_lane_fill(&s_lane[i]);
+        }
+    }
+    if (s_lane[LINE_LANE].active) {
+        line_lane_fill();
+        line_unpause();
+    }
 }
 
 bool stepgen_busy(axis_t a) {
-    return (moving_mask & axis_bit(a)) != 0;
+    if (s_line_active && s_dda.steps[(int)a] != 0) {
+        return true;
+    }
+    return *(volatile uint32_t*)&s_oc[(int)a].steps_left != 0;
+}
+
+uint32_t stepgen_steps_issued(axis_t a) {
+    return *(volatile uint32_t*)&s_oc[(int)a].issued;
+}
+
+/* Seqlock read: the step ISR never runs concurrently with a reader, it only preempts one,
+   so a snapshot is consistent when no ISR ran while it was taken (usually the first try) */
+void stepgen_position(int32_t out[3]) {
+    uint32_t seq;
+    do {
+        seq = s_pos_seq;
+        for (int i = 0; i < 3; ++i) {
+            out[i] = *(volatile int32_t*)&s_oc[i].pos;
+        }
+    } while (seq != s_pos_seq);
+}
+
+bool stepgen_jitter_get(axis_t a, stepgen_jitter_t* out) {
+#if STEP_JITTER
+    uint32_t seq;
+    do {
+        seq = s_pos_seq;
+        if (s_jit_clear[(int)a]) {
+            stepgen_jitter_reset(out);
+        } else {
+            *out = *(volatile stepgen_jitter_t*)&s_jit[(int)a];
+        }
+    } while (seq != s_pos_seq);
+    return true;
+#else
+    (void)a;
+    stepgen_jitter_reset(out);
+    return false;
+#endif
+}
+
+void stepgen_jitter_clear(void) {
+#if STEP_JITTER
+    for (int i = 0; i < 3; ++i) {
+        s_jit_clear[i] = 1;
+    }
+#endif
+}
+
+void stepgen_position_set(axis_t a, int32_t steps) {
+    s_oc[(int)a].pos = steps;
 }
 
 void stepgen_move_n(axis_t a, uint32_t steps, uint32_t hz) {
 
-    if (steps == 0 || hz == 0 || estop_latched()) {
+    if (steps == 0 || hz == 0 || estop_latched() || s_line_active || stepgen_busy(a) ||
+        !outputs_on()) {
         return;
     }
 
     // guard: if we're commanding motion toward MIN and MIN is pressed → refuse
-    bool cw = dir_is_cw[(int)a];
-    bool moving_neg = cw ? axis_cw_is_negative(a) : !axis_cw_is_negative(a);
-    if (moving_neg && limits_block_neg(a)) {
+    if (moving_negative(a) && limits_block_neg(a)) {
         return; // ignore unsafe command
     }
 
-    stepgen_set_hz(a, hz); // shared timer freq for now
+    const AxisHw* h = ainfo(a);
+    stepgen_oc_t* oc = &s_oc[(int)a];
 
-    steps_remaining[(int)a] = steps;
-    moving_mask |= axis_bit(a);
+    stepgen_lane_t* l = &s_lane[(int)a];
 
-    ch_enable(ainfo(a)->ch, true);
-    TIM3->CR1 |= TIM_CR1_CEN;
+    // Ramp 0 -> hz -> 0 (constant hz when no acceleration is configured), pre-filled
+    stepgen_lane_reset(l);
+    if (s_jerk[(int)a] != 0) {
+        stepgen_ramp_plan_scurve(&l->ramp, steps, (float)hz, (float)s_accel[(int)a],
+                                 (float)s_jerk[(int)a]);
+    } else {
+        stepgen_ramp_plan(&l->ramp, steps, 0.0f, (float)hz, 0.0f, (float)s_accel[(int)a]);
+    }
+    stepgen_lane_fill(l);
+    l->active = 1;
+
+    stepgen_oc_start(oc, (uint16_t)STEP_TIM->CNT, steps);
+    *CCRn[h->ch] = oc->ccr;
+    STEP_TIM->SR = ~cc_bit(h->ch); // drop a stale match flag
+    ch_mode(h->ch, OCM_TOGGLE);
+    STEP_TIM->DIER |= cc_bit(h->ch);
+    STEP_TIM->CR1 |= TIM_CR1_CEN;
 }
 
-void TIM3_IRQHandler(void) {
-    if (TIM3->SR & TIM_SR_UIF) {
-        TIM3->SR &= ~TIM_SR_UIF; // clear update flag
+/* Queue one DDA step on axis a; arms the channel if it was idle */
+static void axis_queue_step(axis_t a, uint16_t at) {
+    const AxisHw* h = ainfo(a);
+    stepgen_oc_t* oc = &s_oc[(int)a];
+    if (stepgen_oc_queue_step(oc, at)) {
+        *CCRn[h->ch] = oc->ccr;
+        STEP_TIM->SR = ~cc_bit(h->ch);
+        ch_mode(h->ch, OCM_TOGGLE);
+        STEP_TIM->DIER |= cc_bit(h->ch);
+    }
+}
 
-        if (estop_latched()) {
-            // Stop every channel, zero counters, and halt the timer
-            for (int i = 0; i < 3; ++i) {
-                if (steps_remaining[i]) {
-                    ch_enable(AXIS_HW[i].ch, false);
-                    steps_remaining[i] = 0;
-                }
-            }
-            moving_mask = 0;
-            TIM3->CR1 &= ~TIM_CR1_CEN;
-            return; // nothing else to do this tick
+static void line_finish(void) {
+    STEP_TIM->DIER &= ~cc_bit(TICK_CH);
+    s_lane[LINE_LANE].active = 0;
+    s_line_paused = 0;
+    s_line_active = 0; // queued pulses drain on their own
+}
+
+/* Abort: drop every queued block too (ISR context) */
+static void line_abort(void) {
+    s_lineq_tail = s_lineq_head;
+    line_finish();
+}
+
+static inline uint8_t lineq_next(uint8_t i) {
+    return (uint8_t)((i + 1U) & (LINEQ_LEN - 1U));
+}
+
+/* Slots between `from` and head still needed (by the ISR or by the lane producer) */
+static inline uint8_t lineq_used_from(uint8_t from) {
+    return (uint8_t)((s_lineq_head - from) & (LINEQ_LEN - 1U));
+}
+
+/* Start the next queued block: DIR + DDA. Called from the tick (or at start, tick off) */
+static bool line_load_next(void) {
+    const uint8_t t = s_lineq_tail;
+    if (t == s_lineq_head) {
+        return false;
+    }
+    const line_blk_t* b = &s_lineq[t];
+    for (int i = 0; i < 3; ++i) {
+        if (b->n[i] != 0) {
+            stepgen_dir((axis_t)i, (b->cw_mask >> i) & 1U);
+        }
+    }
+    stepgen_dda_load(&s_dda, b->n);
+    s_lineq_tail = lineq_next(t);
+    return true;
+}
+
+/* Producer side of the line lane: segment queued blocks back to back */
+static void line_lane_fill(void) {
+    stepgen_lane_t* l = &s_lane[LINE_LANE];
+    for (;;) {
+        const stepgen_feed_blk_t* next =
+            (s_lane_blk != s_lineq_head) ? &s_lineq[s_lane_blk].feed : NULL;
+        if (!stepgen_feed_fill(&s_feed, l, next)) {
+            return; // lane full, every queued block segmented, or held
+        }
+        s_lane_blk = lineq_next(s_lane_blk);
+    }
+}
+
+/* Cycle start after a hold: re-arm the tick once the re-planned segments are queued */
+static void line_unpause(void) {
+    stepgen_lane_t* l = &s_lane[LINE_LANE];
+    if (!s_line_paused || s_feed.state != STEPGEN_FEED_RUN || l->tail == l->head) {
+        return;
+    }
+    if (halted()) {
+        line_abort();
+        return;
+    }
+    s_line_paused = 0;
+    STEP_TIM->CCR4 = (uint16_t)(STEP_TIM->CNT + STEPGEN_OC_LEAD_TICKS);
+    STEP_TIM->SR = ~cc_bit(TICK_CH);
+    STEP_TIM->DIER |= cc_bit(TICK_CH);
+}
+
+void stepgen_hold(void) {
+    stepgen_feed_hold(&s_feed);
+}
+
+void stepgen_resume(void) {
+    stepgen_feed_resume(&s_feed);
+}
+
+void stepgen_override(uint8_t feed_pct, uint8_t rapid_pct) {
+    stepgen_feed_override(&s_feed, feed_pct, rapid_pct);
+}
+
+bool stepgen_held(void) {
+    return s_line_paused != 0;
+}
+
+bool stepgen_line_busy(void) {
+    if (s_line_active) {
+        return true;
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (stepgen_busy((axis_t)i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t stepgen_line_free(void) {
+    const uint8_t used_isr = lineq_used_from(s_lineq_tail);
+    const uint8_t used_lane = s_line_active ? lineq_used_from(s_lane_blk) : 0U;
+    const uint8_t used = used_isr > used_lane ? used_isr : used_lane;
+    return (uint8_t)(LINEQ_LEN - 1U - used);
+}
+
+uint8_t stepgen_line_queued(void) {
+    return lineq_used_from(s_lineq_tail);
+}
+
+bool stepgen_line(const stepgen_block_t* b) {
+    if (b->rate_hz == 0 || estop_latched() || stepgen_line_free() == 0 || !outputs_on()) {
+        return false;
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (s_lane[i].active) {
+            return false; // an independent move owns this channel
+        }
+    }
+
+    line_blk_t* q = &s_lineq[s_lineq_head];
+    q->cw_mask = 0;
+    for (int i = 0; i < 3; ++i) {
+        const axis_t a = (axis_t)i;
+        const bool positive = b->steps[i] >= 0;
+        q->n[i] = positive ? (uint32_t)b->steps[i] : (uint32_t)(-(int64_t)b->steps[i]);
+        if (q->n[i] == 0) {
+            continue;
+        }
+        // DIR: + is away from MIN
+        if (positive ? !axis_cw_is_negative(a) : axis_cw_is_negative(a)) {
+            q->cw_mask |= (uint8_t)(1U << i);
+        }
+        if (!positive && limits_block_neg(a)) {
+            return false; // refuse the whole line rather than distort it
+        }
+    }
+
+    // One tick per dominant-axis step; the ramp shapes the tick period
+    uint32_t total = q->n[0];
+    total = q->n[1] > total ? q->n[1] : total;
+    total = q->n[2] > total ? q->n[2] : total;
+    if (total == 0) {
+        return false;
+    }
+    q->feed.steps = total;
+    q->feed.v_entry = (float)b->entry_hz;
+    q->feed.v_nominal = (float)b->rate_hz;
+    q->feed.v_exit = (float)b->exit_hz;
+    q->feed.accel = (float)b->accel_hz_s;
+    q->feed.pct = b->pct;
+    q->feed.rapid = b->rapid;
+    s_lineq_head = lineq_next(s_lineq_head); // publish: the ISR may pick it up from here
+
+    if (s_line_active) {
+        line_lane_fill(); // chained behind the running block
+        return true;
+    }
+
+    // Idle: load the first block and start ticking
+    stepgen_lane_t* l = &s_lane[LINE_LANE];
+    stepgen_lane_reset(l);
+    stepgen_feed_start(&s_feed, &l->ramp, &s_lineq[s_lineq_tail].feed);
+    s_lane_blk = lineq_next(s_lineq_tail);
+    line_load_next();
+    line_lane_fill();
+    l->active = 1;
+
+    s_line_active = 1;
+    STEP_TIM->CCR4 = (uint16_t)(STEP_TIM->CNT + STEPGEN_OC_LEAD_TICKS);
+    STEP_TIM->SR = ~cc_bit(TICK_CH);
+    STEP_TIM->DIER |= cc_bit(TICK_CH);
+    STEP_TIM->CR1 |= TIM_CR1_CEN;
+    return true;
+}
+
+/* Fixed-rate DDA tick (CH4 compare): decide who steps, queue their pulses */
+static void line_on_tick(void) {
+    if (halted()) {
+        line_abort();
+        return;
+    }
+    if (stepgen_feed_should_pause(&s_feed, &s_lane[LINE_LANE])) {
+        STEP_TIM->DIER &= ~cc_bit(TICK_CH); // held: the stop's last step went out last tick
+        s_line_paused = 1;
+        return;
+    }
+
+    // Block boundary: chain the next queued block without stopping. DIR changes here, a full
+    // tick after the previous block's last rise and one lead before the next one. A block that
+    // turns toward a MIN switch still tripped (EXTI masked until release) ends the line.
+    if (stepgen_dda_done(&s_dda)) {
+        if (!line_load_next()) {
+            line_finish();
+            return;
         }
-        // Each update event = one PWM period = one step
         for (int i = 0; i < 3; ++i) {
-            if (steps_remaining[i]) {
-
-                // hard stop if moving toward MIN and MIN is asserted
-                bool cw = dir_is_cw[i];
-                bool moving_neg =
-                        cw ? axis_cw_is_negative((axis_t)i) : !axis_cw_is_negative((axis_t)i);
-                if (moving_neg && limits_block_neg((axis_t)i)) {
-                    uint8_t ch = AXIS_HW[i].ch;
-                    ch_enable(ch, false);
-                    moving_mask &= ~(1u << i);
-                    steps_remaining[i] = 0;
-                    continue; // skip decrement
-                }
-
-                if (--steps_remaining[i] == 0) {
-                    // Finished this axis → disable its channel
-                    uint8_t ch = AXIS_HW[i].ch;
-                    ch_enable(ch, false);
-                    moving_mask &= ~(1u << i);
-                }
-                // NOTE: in this simple version, we assume only ONE axis is moving at a time.
-                // If multiple were armed, they'd all decrement together (shared frequency).
+            const axis_t a = (axis_t)i;
+            if (s_dda.steps[i] != 0 && moving_negative(a) && limits_block_neg(a)) {
+                line_abort();
+                return;
             }
         }
+    }
+
+    const uint16_t now = (uint16_t)STEP_TIM->CCR4;
+    const uint8_t mask = stepgen_dda_tick(&s_dda);
 
-        // Stop timer if nothing left
-        if (!any_moving()) {
-            TIM3->CR1 &= ~TIM_CR1_CEN;
+    // Interval to the next tick; minor axes pulse with the same 50% width
+    const uint16_t period = stepgen_lane_next_period(&s_lane[LINE_LANE]);
+    const uint16_t at = ccr_ahead_of_cnt(now, (uint16_t)(now + STEPGEN_OC_LEAD_TICKS));
+    for (int i = 0; i < 3; ++i) {
+        if (mask & (1U << i)) {
+            stepgen_oc_set_period(&s_oc[i], period);
+            axis_queue_step((axis_t)i, at);
         }
     }
-}
\ No newline at end of file
+    STEP_TIM->CCR4 = (uint16_t)(now + period);
+}
+
+#if STEP_JITTER
+/* The rise at `ccr` has just been serviced: bin its stamp against the commanded interval */
+static void jitter_rise(axis_t a, uint16_t ccr) {
+    const uint32_t now = DWT->CYCCNT;
+    stepgen_jitter_t* j = &s_jit[(int)a];
+    if (s_jit_clear[(int)a]) {
+        s_jit_clear[(int)a] = 0;
+        stepgen_jitter_reset(j); // this rise starts the new chain
+    }
+    stepgen_jitter_rise(j, now, ccr, TIM_PSC_1MHz + 1UL); // timer ticks -> core cycles
+}
+#endif
+
+/* One compare match on axis a: the pin has just toggled in hardware */
+static void axis_on_compare(axis_t a) {
+    const AxisHw* h = ainfo(a);
+    stepgen_oc_t* oc = &s_oc[(int)a];
+    const uint16_t fired = oc->ccr;
+
+#if STEP_JITTER
+    if (oc->level == 0) {
+        jitter_rise(a, oc->ccr);
+    }
+#endif
+    // A rise is being issued: its interval to the next rise comes from the ramp
+    if (oc->level == 0 && s_lane[(int)a].active) {
+        stepgen_oc_set_period(oc, stepgen_lane_next_period(&s_lane[(int)a]));
+    }
+
+    switch (stepgen_oc_on_match(oc)) {
+    case STEPGEN_OC_RISE:
+        break;
+    case STEPGEN_OC_FALL:
+        // E-stop is checked with STEP low, before the next rise is committed. MIN needs no
+        // per-step check: its EXTI stops the axis (stepgen_trip_min) and moves toward an
+        // asserted switch are refused at start; the planner keeps lines inside the envelope.
+        if (halted()) {
+            axis_halt(a);
+            return;
+        }
+        break;
+    case STEPGEN_OC_DONE:
+    default:
+        axis_halt(a); // finished this axis → park its channel
+        return;
+    }
+
+    oc->ccr = ccr_ahead_of_cnt(fired, oc->ccr);
+    *CCRn[h->ch] = oc->ccr;
+}
+
+/* E-stop edge (EXTI, same priority as TIM1_CC): the break input already holds STEP low;
+   every axis stops after its pulse in flight, so the outputs come back to a clean state */
+void stepgen_trip_all(void) {
+    if (s_line_active) {
+        line_abort();
+    }
+    for (int i = 0; i < 3; ++i) {
+        axis_stop((axis_t)i);
+    }
+}
+
+/* MIN edge (EXTI, same priority as TIM1_CC): stop whatever is driving axis a into the switch */
+void stepgen_trip_min(axis_t a) {
+    if (!moving_negative(a)) {
+        return; // moving off the switch (back-off, pull-off): let it go
+    }
+    if (s_line_active && s_dda.steps[(int)a] != 0) {
+        line_abort(); // the whole line, not just one axis of it
+    }
+    axis_stop(a);
+}
+
+void TIM1_CC_IRQHandler(void) {
+    ISR_PROF_ENTER();
+    const uint32_t pending = STEP_TIM->SR & STEP_TIM->DIER;
+    s_pos_seq++; // before any position changes
+
+    // Each axis has its own compare channel → its own timing, no shared period
+    for (int i = 0; i < 3; ++i) {
+        const uint32_t m = cc_bit(AXIS_HW[i].ch);
+        if (pending & m) {
+            STEP_TIM->SR = ~m; // clear only this flag (rc_w0)
+            axis_on_compare((axis_t)i);
+        }
+    }
+
+    if (pending & cc_bit(TICK_CH)) {
+        STEP_TIM->SR = ~cc_bit(TICK_CH);
+        line_on_tick();
+    }
+    ISR_PROF_EXIT(ISR_PROF_STEP);
+}
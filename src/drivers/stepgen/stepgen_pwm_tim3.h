@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include "axis.h"
+#include "stepgen_jitter.h"
 
 void stepgen_init_all(void);
 void stepgen_start_all(void);
@@ -12,6 +13,58 @@ void stepgen_stop_all(void);
 void stepgen_enable(axis_t a, bool enable_outputs_low_active);
 void stepgen_dir(axis_t a, bool fwd);
 void stepgen_set_hz(axis_t a, uint32_t hz);
+void stepgen_set_accel(axis_t a, uint32_t steps_per_s2); // ramp for stepgen_move_n (0 = none)
+void stepgen_set_jerk(axis_t a, uint32_t steps_per_s3); // non-zero: S-curve instead of trapezoid
+
+// Keep acceleration ramps topped up (call at ~1 kHz from SysTick, below the step ISR)
+void stepgen_prep(void);
 
 void stepgen_move_n(axis_t a, uint32_t steps, uint32_t hz);
 bool stepgen_busy(axis_t a); // quick poll to know if a move is still running on that axis
+// Rising edges since the last stepgen_move_n() on this axis started; stays put once it ends.
+// Any context (a single word): e.g. sampled by a limit-switch EXTI at the trigger.
+uint32_t stepgen_steps_issued(axis_t a);
+
+// Machine position in steps per axis (+ = away from MIN), counted at every rising edge in the
+// step ISR from the DIR in force. A consistent X/Y/Z snapshot, lock-free (any lower-priority
+// context). _set() only while the axis is idle, e.g. zero at homing.
+void stepgen_position(int32_t out[3]);
+void stepgen_position_set(axis_t a, int32_t steps);
+
+// Step-timing jitter (STEP_JITTER builds): per-axis histogram of every rise's service time in
+// the step ISR against its commanded interval, stamped with DWT CYCCNT (stepgen_jitter.h).
+// _get() is a consistent snapshot, false (and empty) if compiled out; _clear() empties every
+// axis, each starting over at its next rise.
+bool stepgen_jitter_get(axis_t a, stepgen_jitter_t* out);
+void stepgen_jitter_clear(void);
+
+// Edge-triggered stops (EXTI hooks, at the step ISR's priority): each axis stops after the pulse in
+// flight, microseconds after the switch edge. trip_min only acts when a moves toward MIN.
+void stepgen_trip_all(void); // e-stop: every axis and the queued lines
+void stepgen_trip_min(axis_t a);
+
+// Coordinated straight line: all axes start and finish together (integer DDA on TIM1 CH4)
+typedef struct {
+    int32_t steps[3]; // signed step deltas X/Y/Z (+ = away from MIN)
+    uint32_t rate_hz; // step rate of the dominant (longest) axis
+    uint32_t accel_hz_s; // dominant axis steps/s^2 (0 = constant rate)
+    uint32_t entry_hz; // dominant rate at the start of the block (0 = from rest)
+    uint32_t exit_hz; // dominant rate at the end (0 = stop; the next block must match it)
+    uint8_t pct; // override percentage rate_hz already includes (0 = 100)
+    uint8_t rapid; // 1 = scaled by the rapid override, 0 = by the feed override
+} stepgen_block_t;
+
+// Queue a line behind the running ones (same context as stepgen_prep()).
+// false if refused (queue full, independent moves running, e-stop, MIN, no-op)
+bool stepgen_line(const stepgen_block_t* b);
+bool stepgen_line_busy(void);
+uint8_t stepgen_line_free(void); // blocks stepgen_line() can still take
+uint8_t stepgen_line_queued(void); // accepted blocks not yet started
+
+// Feed hold / cycle start / overrides (10..200 %) for the coordinated lines. Single stores, any
+// context; stepgen_prep() applies them. A hold decelerates along the blocks' acceleration and
+// pauses with the line still loaded; resume re-plans the rest of it from rest.
+void stepgen_hold(void);
+void stepgen_resume(void);
+void stepgen_override(uint8_t feed_pct, uint8_t rapid_pct);
+bool stepgen_held(void); // paused by a hold (stepgen_line_busy() stays true)
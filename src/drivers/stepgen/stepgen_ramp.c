@@ -0,0 +1,293 @@
+#include "stepgen_ramp.h"
+
+#include <math.h>
+
+static inline float clampf(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+void stepgen_ramp_plan(stepgen_ramp_t* r,
+                       uint32_t steps,
+                       float v_entry,
+                       float v_cruise,
+                       float v_exit,
+                       float accel) {
+    v_cruise = clampf(v_cruise, (float)STEPGEN_MIN_HZ, (float)STEPGEN_MAX_HZ);
+    v_entry = clampf(v_entry, 0.0f, v_cruise);
+    v_exit = clampf(v_exit, 0.0f, v_cruise);
+
+    r->total = steps;
+    r->planned = 0;
+    r->scurve = 0;
+    r->v_entry2 = v_entry * v_entry;
+    r->v_exit2 = v_exit * v_exit;
+    r->v_cruise = v_cruise;
+
+    if (accel <= 0.0f) {
+        r->two_a = 0.0f;
+        r->accel_until = 0;
+        r->decel_from = steps;
+        return;
+    }
+    r->two_a = 2.0f * accel;
+
+    const float vc2 = v_cruise * v_cruise;
+    const float s = (float)steps;
+    float d_acc = (vc2 - r->v_entry2) / r->two_a;
+    float d_dec = (vc2 - r->v_exit2) / r->two_a;
+
+    if (d_acc + d_dec > s) {
+        // Triangle: the accel and decel curves meet at v_peak before v_cruise
+        const float vp2 = 0.5f * (r->two_a * s + r->v_entry2 + r->v_exit2);
+        r->v_cruise = sqrtf(vp2);
+        d_acc = clampf((vp2 - r->v_entry2) / r->two_a, 0.0f, s);
+        d_dec = s - d_acc;
+    }
+
+    r->accel_until = (uint32_t)(d_acc + 0.5f);
+    const uint32_t dec = (uint32_t)(d_dec + 0.5f);
+    r->decel_from = (dec >= steps) ? 0U : steps - dec;
+    if (r->decel_from < r->accel_until) {
+        r->decel_from = r->accel_until;
+    }
+}
+
+// Rest -> v under (accel, jerk): jerk-phase and constant-accel times, and the distance it
+// takes. The accel phase is point-symmetric, so that distance is v * (2 t_j + t_c) / 2.
+static float scurve_ramp(float v, float accel, float jerk, float* t_j, float* t_c) {
+    if (v * jerk >= accel * accel) {
+        *t_j = accel / jerk;
+        *t_c = v / accel - *t_j;
+    } else {
+        *t_j = sqrtf(v / jerk); // accel limit never reached
+        *t_c = 0.0f;
+    }
+    return 0.5f * v * (2.0f * *t_j + *t_c);
+}
+
+void stepgen_ramp_plan_scurve(stepgen_ramp_t* r,
+                              uint32_t steps,
+                              float v_max,
+                              float accel,
+                              float jerk) {
+    stepgen_ramp_plan(r, steps, 0.0f, v_max, 0.0f, accel);
+    if (accel <= 0.0f || jerk <= 0.0f || steps == 0) {
+        return; // trapezoid / constant rate
+    }
+
+    float v = clampf(v_max, (float)STEPGEN_MIN_HZ, (float)STEPGEN_MAX_HZ);
+    float t_j, t_c;
+    float d = scurve_ramp(v, accel, jerk, &t_j, &t_c);
+    const float s = (float)steps;
+    if (2.0f * d > s) {
+        // Too short to cruise at v_max: find the peak rate whose two ramps cover s exactly
+        float lo = 0.0f, hi = v;
+        for (int i = 0; i < 24; ++i) {
+            v = 0.5f * (lo + hi);
+            if (2.0f * scurve_ramp(v, accel, jerk, &t_j, &t_c) > s) {
+                hi = v;
+            } else {
+                lo = v;
+            }
+        }
+        v = lo;
+        d = scurve_ramp(v, accel, jerk, &t_j, &t_c);
+    }
+
+    const float t_acc = 2.0f * t_j + t_c;
+    r->scurve = 1;
+    r->jerk = jerk;
+    r->v_cruise = v;
+    r->a_peak = jerk * t_j;
+    r->t_j = t_j;
+    r->t_c = t_c;
+    r->t_total = 2.0f * t_acc + (s - 2.0f * d) / v;
+    r->t_us = 0;
+}
+
+// Accelerating half of the S-curve: jerk up, constant accel, jerk down (t from its start)
+static void scurve_accel_phase(const stepgen_ramp_t* r, float t, float* s, float* v, float* a) {
+    const float j = r->jerk;
+    const float tj = r->t_j;
+    const float ap = r->a_peak;
+    if (t <= tj) {
+        *a = j * t;
+        *v = 0.5f * j * t * t;
+        *s = j * t * t * t / 6.0f;
+        return;
+    }
+
+    const float v1 = 0.5f * j * tj * tj;
+    const float s1 = j * tj * tj * tj / 6.0f;
+    t -= tj;
+    if (t <= r->t_c) {
+        *a = ap;
+        *v = v1 + ap * t;
+        *s = s1 + v1 * t + 0.5f * ap * t * t;
+        return;
+    }
+
+    const float v2 = v1 + ap * r->t_c;
+    const float s2 = s1 + v1 * r->t_c + 0.5f * ap * r->t_c * r->t_c;
+    t -= r->t_c;
+    if (t > tj) {
+        t = tj;
+    }
+    *a = ap - j * t;
+    *v = v2 + ap * t - 0.5f * j * t * t;
+    *s = s2 + v2 * t + 0.5f * ap * t * t - j * t * t * t / 6.0f;
+}
+
+void stepgen_scurve_eval(const stepgen_ramp_t* r, float t, float* s, float* v, float* a) {
+    const float t_acc = 2.0f * r->t_j + r->t_c;
+    t = clampf(t, 0.0f, r->t_total);
+
+    if (t <= t_acc) {
+        scurve_accel_phase(r, t, s, v, a);
+    } else if (t < r->t_total - t_acc) {
+        *s = 0.5f * r->v_cruise * t_acc + r->v_cruise * (t - t_acc);
+        *v = r->v_cruise;
+        *a = 0.0f;
+    } else {
+        // Decelerating half mirrors the accelerating one in time
+        float sm, vm, am;
+        scurve_accel_phase(r, r->t_total - t, &sm, &vm, &am);
+        *s = (float)r->total - sm;
+        *v = vm;
+        *a = -am;
+    }
+}
+
+// S-curve segments: walk the profile in STEPGEN_SEG_US strides, end each segment on a whole
+// step and spread the time to it evenly over the segment's steps.
+static bool scurve_next(stepgen_ramp_t* r, stepgen_seg_t* seg) {
+    const uint32_t p = r->planned;
+    const uint32_t t_end = (uint32_t)(r->t_total * (float)STEPGEN_TICK_HZ + 0.5f);
+
+    uint32_t t1 = r->t_us;
+    float s1 = (float)p, v1 = 0.0f, a1;
+    for (;;) {
+        t1 += STEPGEN_SEG_US;
+        if (t1 >= t_end) {
+            break;
+        }
+        stepgen_scurve_eval(r, (float)t1 * (1.0f / (float)STEPGEN_TICK_HZ), &s1, &v1, &a1);
+        if (s1 >= (float)p + 1.0f) {
+            break; // at least one step is due (slow near the ends: several strides)
+        }
+    }
+
+    uint32_t n;
+    uint32_t t_k;
+    if (t1 >= t_end) {
+        n = r->total - p;
+        t_k = t_end;
+    } else {
+        uint32_t k = (uint32_t)s1;
+        if (k > r->total) {
+            k = r->total;
+        }
+        n = k - p;
+        // Step k fell due slightly before t1: one Newton step back along the rate
+        const uint32_t back = (uint32_t)((s1 - (float)k) / v1 * (float)STEPGEN_TICK_HZ + 0.5f);
+        t_k = (t1 - r->t_us > back) ? t1 - back : r->t_us + n;
+    }
+    if (n > 0xFFFFU) {
+        n = 0xFFFFU;
+    }
+
+    uint32_t period = (t_k - r->t_us + n / 2U) / n;
+    if (period < STEPGEN_TICK_HZ / STEPGEN_MAX_HZ) {
+        period = STEPGEN_TICK_HZ / STEPGEN_MAX_HZ;
+    } else if (period > 0xFFFFU) {
+        period = 0xFFFFU;
+    }
+
+    seg->steps = (uint16_t)n;
+    seg->period = (uint16_t)period;
+    r->planned = p + n;
+    r->t_us += n * period; // emitted time: rounding never accumulates against the profile
+    return true;
+}
+
+float stepgen_ramp_rate_at(const stepgen_ramp_t* r, float s) {
+    float v = r->v_cruise;
+    if (r->two_a > 0.0f) {
+        if (s < (float)r->accel_until) {
+            v = sqrtf(r->v_entry2 + r->two_a * s);
+        } else if (s > (float)r->decel_from) {
+            v = sqrtf(r->v_exit2 + r->two_a * ((float)r->total - s));
+        }
+        if (v > r->v_cruise) {
+            v = r->v_cruise;
+        }
+    }
+    return v < (float)STEPGEN_MIN_HZ ? (float)STEPGEN_MIN_HZ : v;
+}
+
+bool stepgen_ramp_next(stepgen_ramp_t* r, stepgen_seg_t* seg) {
+    const uint32_t p = r->planned;
+    if (p >= r->total) {
+        return false;
+    }
+    if (r->scurve) {
+        return scurve_next(r, seg);
+    }
+
+    // End of the phase we are in: segments never straddle an accel/cruise/decel boundary
+    uint32_t phase_end = r->total;
+    if (p < r->accel_until) {
+        phase_end = r->accel_until;
+    } else if (p < r->decel_from) {
+        phase_end = r->decel_from;
+    }
+
+    // About STEPGEN_SEG_US worth of steps at the local rate (at least one)
+    const float v_here = stepgen_ramp_rate_at(r, (float)p + 0.5f);
+    uint32_t n = (uint32_t)(v_here * ((float)STEPGEN_SEG_US / (float)STEPGEN_TICK_HZ));
+    if (n == 0) {
+        n = 1;
+    }
+    if (n > phase_end - p) {
+        n = phase_end - p;
+    }
+    if (n > 0xFFFFU) {
+        n = 0xFFFFU;
+    }
+
+    // One interval for the whole segment: the rate at its midpoint
+    const float v_mid = stepgen_ramp_rate_at(r, (float)p + 0.5f * (float)n);
+    uint32_t period = (uint32_t)((float)STEPGEN_TICK_HZ / v_mid + 0.5f);
+    if (period > 0xFFFFU) {
+        period = 0xFFFFU;
+    }
+
+    seg->steps = (uint16_t)n;
+    seg->period = (uint16_t)period;
+    r->planned = p + n;
+    return true;
+}
+
+void stepgen_lane_reset(stepgen_lane_t* l) {
+    l->head = 0;
+    l->tail = 0;
+    l->seg_left = 0;
+    l->period = 0xFFFFU; // slowest possible until the first segment lands
+    l->underruns = 0;
+}
+
+void stepgen_lane_fill(stepgen_lane_t* l) {
+    for (;;) {
+        const uint8_t h = l->head;
+        const uint8_t next = (uint8_t)((h + 1U) & (STEPGEN_SEGQ_LEN - 1U));
+        if (next == l->tail) {
+            return; // full (one slot kept free to tell full from empty)
+        }
+        stepgen_seg_t seg;
+        if (!stepgen_ramp_next(&l->ramp, &seg)) {
+            return;
+        }
+        l->q[h] = seg;
+        l->head = next; // publish after the slot is written
+    }
+}
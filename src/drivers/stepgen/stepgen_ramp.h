@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Acceleration ramps as a precomputed interval stream (hardware independent).
+ *
+ * The producer (move start + stepgen_prep() from SysTick at 1 kHz) turns a trapezoidal or a
+ * 7-segment jerk-limited (S-curve) velocity profile into short constant-rate segments
+ * {steps, period}. The step ISR only pops a segment and counts it down, so there is no
+ * division and no float math per step.
+ *
+ * Rates are in steps/s, accelerations in steps/s^2, jerk in steps/s^3, periods in timer
+ * ticks (1 us).
+ */
+
+#define STEPGEN_TICK_HZ 1000000UL // step timer clock (TIM1 @ 1 MHz)
+#define STEPGEN_SEG_US 2000U // target duration of one segment
+#define STEPGEN_SEGQ_LEN 8U // segments buffered per lane (power of two)
+#define STEPGEN_MIN_HZ 16U // slowest rate: period must fit the 16-bit compare
+#define STEPGEN_MAX_HZ 40000U // fastest rate we plan for (ISR budget, see bench)
+
+typedef struct {
+    uint16_t steps; // steps in this segment
+    uint16_t period; // timer ticks from one step to the next
+} stepgen_seg_t;
+
+typedef struct {
+    uint32_t total; // steps in the move
+    uint32_t planned; // steps already turned into segments
+    uint32_t accel_until; // steps [0, accel_until) accelerate
+    uint32_t decel_from; // steps [decel_from, total) decelerate
+    float v_entry2; // entry rate squared
+    float v_exit2; // exit rate squared
+    float v_cruise; // plateau rate (may be lowered to a triangle peak)
+    float two_a; // 2 * acceleration (0 = constant rate)
+
+    // S-curve only (rest to rest); the profile is walked in time rather than in steps
+    uint8_t scurve; // 1 = 7-segment jerk-limited profile
+    float jerk; // steps/s^3
+    float a_peak; // acceleration actually reached (<= the limit)
+    float t_j; // each jerk phase (s)
+    float t_c; // constant-acceleration phase (s)
+    float t_total; // whole move (s)
+    uint32_t t_us; // profile time at step `planned` (timer ticks)
+} stepgen_ramp_t;
+
+typedef struct {
+    stepgen_ramp_t ramp; // producer side (move start, stepgen_prep() in SysTick)
+    volatile stepgen_seg_t q[STEPGEN_SEGQ_LEN]; // volatile: slot is stored before head
+    volatile uint8_t head; // written by the producer only
+    volatile uint8_t tail; // written by the ISR only
+    volatile uint8_t active; // producer may fill while set
+    uint16_t period; // ISR: interval of the current segment
+    uint16_t seg_left; // ISR: steps left at that interval
+    uint32_t underruns; // ISR found the queue empty mid-move
+} stepgen_lane_t;
+
+/**
+ * Plan a trapezoid over `steps`: v_entry -> v_cruise at `accel`, cruise, -> v_exit.
+ * If the move is too short to reach v_cruise it becomes a triangle. accel <= 0 runs the
+ * whole move at v_cruise (the old constant-rate behaviour).
+ */
+void stepgen_ramp_plan(stepgen_ramp_t* r,
+                       uint32_t steps,
+                       float v_entry,
+                       float v_cruise,
+                       float v_exit,
+                       float accel);
+
+/**
+ * Plan a rest-to-rest 7-segment S-curve over `steps`: jerk up, constant accel, jerk down,
+ * cruise, and the mirror image. Acceleration is continuous (bounded by `jerk`); short moves
+ * lower the peak acceleration and/or rate. accel or jerk <= 0 falls back to
+ * stepgen_ramp_plan() with a trapezoid / constant rate.
+ */
+void stepgen_ramp_plan_scurve(stepgen_ramp_t* r,
+                              uint32_t steps,
+                              float v_max,
+                              float accel,
+                              float jerk);
+
+/* Position (steps), rate and acceleration of an S-curve plan at time t (s) from its start. */
+void stepgen_scurve_eval(const stepgen_ramp_t* r, float t, float* s, float* v, float* a);
+
+/* Rate the profile commands at (fractional) step position s (trapezoid plans). */
+float stepgen_ramp_rate_at(const stepgen_ramp_t* r, float s);
+
+/* Next constant-rate segment of the profile; false once every step is planned. */
+bool stepgen_ramp_next(stepgen_ramp_t* r, stepgen_seg_t* seg);
+
+/* Producer side: empty the queue (lane must be inactive) / top it up from the ramp. */
+void stepgen_lane_reset(stepgen_lane_t* l);
+void stepgen_lane_fill(stepgen_lane_t* l);
+
+/**
+ * ISR side: interval (timer ticks) from the step being issued now to the next one.
+ * If the producer fell behind, the last interval is held and `underruns` counts it.
+ */
+static inline uint16_t stepgen_lane_next_period(stepgen_lane_t* l) {
+    if (l->seg_left == 0) {
+        const uint8_t t = l->tail;
+        if (t == l->head) {
+            l->underruns++;
+            return l->period;
+        }
+        l->period = l->q[t].period;
+        l->seg_left = l->q[t].steps;
+        l->tail = (uint8_t)((t + 1U) & (STEPGEN_SEGQ_LEN - 1U));
+    }
+    l->seg_left--;
+    return l->period;
+}
@@ -0,0 +1,75 @@
+#include "byte_ring.h"
+
+void byte_ring_init(byte_ring_t* r, volatile uint8_t* buf, uint32_t size) {
+    r->buf = buf;
+    r->mask = size - 1U;
+    r->head = 0;
+    r->tail = 0;
+    r->lost = 0;
+    r->dropped = 0;
+}
+
+bool byte_ring_put(byte_ring_t* r, uint8_t c) {
+    const uint32_t h = r->head;
+    if (h - r->tail > r->mask) {
+        r->dropped++;
+        return false;
+    }
+    r->buf[h & r->mask] = c;
+    r->head = h + 1U; // publish after the byte is stored
+    return true;
+}
+
+void byte_ring_commit(byte_ring_t* r, uint32_t n) {
+    r->head += n;
+}
+
+uint32_t byte_ring_write(byte_ring_t* r, const uint8_t* src, uint32_t n,
+                         byte_ring_policy_t policy, uint32_t claimed) {
+    const uint32_t t = r->tail;
+    uint32_t h = r->head;
+    uint32_t room = r->mask + 1U - (h - t + claimed);
+    if (n > room && policy == BYTE_RING_OVERWRITE) {
+        // Give up the oldest unclaimed bytes: slide the rest down to the tail
+        const uint32_t queued = h - t;
+        const uint32_t d = (n - room < queued) ? n - room : queued;
+        for (uint32_t i = 0; i < queued - d; ++i) {
+            r->buf[(t + i) & r->mask] = r->buf[(t + d + i) & r->mask];
+        }
+        h -= d;
+        room += d;
+        r->dropped += d;
+    }
+    if (n > room) {
+        r->dropped += n - room;
+        if (policy == BYTE_RING_OVERWRITE) {
+            src += n - room; // the newest bytes win
+        }
+        n = room;
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+        r->buf[(h + i) & r->mask] = src[i];
+    }
+    r->head = h + n; // publish after the bytes are stored
+    return n;
+}
+
+int byte_ring_get(byte_ring_t* r) {
+    uint32_t t = r->tail;
+    const uint32_t h = r->head;
+    if (h == t) {
+        return -1;
+    }
+    if (h - t > r->mask + 1U) {
+        // Producer lapped us: everything older than one buffer is gone
+        r->lost += h - t - (r->mask + 1U);
+        t = h - (r->mask + 1U);
+    }
+    const int c = r->buf[t & r->mask];
+    r->tail = t + 1U;
+    return c;
+}
+
+void byte_ring_skip(byte_ring_t* r, uint32_t n) {
+    r->tail += n;
+}
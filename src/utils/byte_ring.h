@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Lock-free single-producer / single-consumer byte ring (hardware independent).
+ *
+ * head and tail are free-running byte counts (never masked), written by one side each, so
+ * head - tail is the fill level even when it exceeds the size. That is how a DMA producer,
+ * which overwrites without asking, is detected: byte_ring_get() skips the consumer ahead to
+ * the oldest byte still in the buffer and adds the gap to `lost`.
+ *
+ * Producers either byte_ring_put() (software, refuses when full and counts `dropped`) or
+ * write straight into buf and byte_ring_commit() (DMA). Size must be a power of two.
+ *
+ * A DMA consumer claims byte_ring_span() bytes from the tail for one transfer and
+ * byte_ring_skip()s them right away; the claimed bytes stay in buf until the transfer
+ * completes, so producers pass that count to byte_ring_write() to leave them alone.
+ */
+
+typedef enum {
+    BYTE_RING_DROP, // full: the new bytes are discarded
+    BYTE_RING_OVERWRITE, // full: the oldest bytes the consumer has not claimed are discarded
+} byte_ring_policy_t;
+
+typedef struct {
+    volatile uint8_t* buf;
+    uint32_t mask; // size - 1
+    volatile uint32_t head; // bytes ever written (producer only)
+    volatile uint32_t tail; // bytes ever read (consumer only)
+    uint32_t lost; // consumer: bytes overwritten before they were read
+    uint32_t dropped; // producer: bytes refused or overwritten on a full ring
+} byte_ring_t;
+
+void byte_ring_init(byte_ring_t* r, volatile uint8_t* buf, uint32_t size);
+
+/* Producer side */
+bool byte_ring_put(byte_ring_t* r, uint8_t c);
+void byte_ring_commit(byte_ring_t* r, uint32_t n); // n bytes already written at head
+/*
+Copy n bytes in, returns how many were stored. `claimed` bytes just behind the tail still
+belong to a running transfer and count as used. OVERWRITE makes room by sliding the queued
+bytes over the oldest ones, so with it (and whenever `claimed` may change) the consumer is
+held off around the call. Both policies count what they discard in `dropped`.
+*/
+uint32_t byte_ring_write(byte_ring_t* r, const uint8_t* src, uint32_t n,
+                         byte_ring_policy_t policy, uint32_t claimed);
+
+/* Consumer side */
+int byte_ring_get(byte_ring_t* r); // next byte, or -1 if empty
+void byte_ring_skip(byte_ring_t* r, uint32_t n); // n bytes consumed in place
+
+/* Readable bytes from the tail up to the end of buf (one contiguous DMA transfer) */
+static inline uint32_t byte_ring_span(const byte_ring_t* r) {
+    const uint32_t used = r->head - r->tail;
+    const uint32_t to_end = r->mask + 1U - (r->tail & r->mask);
+    return used < to_end ? used : to_end;
+}
+
+static inline uint32_t byte_ring_used(const byte_ring_t* r) {
+    return r->head - r->tail; // may exceed the size after a DMA overrun
+}
+
+static inline uint32_t byte_ring_free(const byte_ring_t* r) {
+    const uint32_t used = byte_ring_used(r);
+    return used > r->mask ? 0U : r->mask + 1U - used;
+}
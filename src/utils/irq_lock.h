@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "stm32f4xx.h"
+
+/*
+Short critical sections against the 1 kHz SysTick work (debounce, stepgen_prep, motion
+service) without touching the step timer: BASEPRI masks only interrupts at SysTick's
+priority (the lowest, set by SysTick_Config), so the step timer keeps stepping inside the lock.
+
+    uint32_t key = irq_lock_systick();
+    ... shared planner state ...
+    irq_unlock(key);
+*/
+static inline uint32_t irq_lock_systick(void) {
+    const uint32_t key = __get_BASEPRI();
+    __set_BASEPRI(((1UL << __NVIC_PRIO_BITS) - 1UL) << (8U - __NVIC_PRIO_BITS));
+    __DSB();
+    __ISB();
+    return key;
+}
+
+static inline void irq_unlock(uint32_t key) {
+    __set_BASEPRI(key);
+}
@@ -0,0 +1,52 @@
+#include "isr_prof.h"
+
+#include <string.h>
+
+static const char* const NAMES[ISR_PROF_COUNT] = {
+        "step", "systick", "usart2", "dma_rx", "dma_tx", "estop", "limits",
+};
+
+const char* isr_prof_name(isr_prof_id_t id) {
+    return (unsigned)id < ISR_PROF_COUNT ? NAMES[id] : "?";
+}
+
+#if ISR_PROF
+
+isr_prof_slot_t isr_prof_slots[ISR_PROF_COUNT];
+
+bool isr_prof_get(isr_prof_id_t id, isr_prof_stats_t* out) {
+    const isr_prof_slot_t* p = &isr_prof_slots[id];
+    const volatile isr_prof_stats_t* s = &p->s;
+    uint32_t seq;
+    do {
+        seq = p->seq;
+        if (p->reset) {
+            memset(out, 0, sizeof *out);
+        } else {
+            out->calls = s->calls;
+            out->min = s->min;
+            out->max = s->max;
+            out->total = s->total;
+        }
+    } while (seq != p->seq); // the handler ran in between: read again
+    return true;
+}
+
+void isr_prof_reset(void) {
+    for (int i = 0; i < ISR_PROF_COUNT; ++i) {
+        isr_prof_slots[i].reset = 1;
+    }
+}
+
+#else
+
+bool isr_prof_get(isr_prof_id_t id, isr_prof_stats_t* out) {
+    (void)id;
+    memset(out, 0, sizeof *out);
+    return false;
+}
+
+void isr_prof_reset(void) {
+}
+
+#endif
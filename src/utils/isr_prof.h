@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Interrupt handler profiling on the DWT cycle counter (CYCCNT, started by dwt_enable()).
+ *
+ * Each instrumented handler opens with ISR_PROF_ENTER() and closes with ISR_PROF_EXIT(id);
+ * its slot keeps the call count and the min / max / total cycles from entry to exit. Only
+ * that handler writes its slot, so nothing is locked: readers retry on a sequence count as
+ * stepgen_position() does. The 12-cycle exception entry is not in the figure; time spent in
+ * a higher-priority handler that preempts this one is.
+ *
+ * Built in with ISR_PROF=1 (CMake: -DISR_PROF=ON); otherwise both macros are empty, the
+ * handlers compile as before and isr_prof_get() returns false. "$I" in gcode_stream reports
+ * every slot.
+ */
+
+typedef enum {
+    ISR_PROF_STEP = 0, // TIM1_CC: step edges and the DDA tick
+    ISR_PROF_SYSTICK, // debounce, homing, motion service, stepgen_prep
+    ISR_PROF_USART2, // RX idle line
+    ISR_PROF_DMA_RX, // DMA1 stream 5, RX half / full
+    ISR_PROF_DMA_TX, // DMA1 stream 6, TX complete
+    ISR_PROF_ESTOP, // EXTI9_5
+    ISR_PROF_LIMITS, // EXTI0 / 1 / 4
+    ISR_PROF_COUNT
+} isr_prof_id_t;
+
+typedef struct {
+    uint32_t calls;
+    uint32_t min, max; // cycles, entry to exit
+    uint64_t total; // mean = total / calls
+} isr_prof_stats_t;
+
+// Snapshot of one slot (zeros if compiled out); false when profiling is compiled out
+bool isr_prof_get(isr_prof_id_t id, isr_prof_stats_t* out);
+// Every slot reads as empty and starts over with its handler's next call
+void isr_prof_reset(void);
+const char* isr_prof_name(isr_prof_id_t id); // "step", "systick", ...
+
+#if ISR_PROF
+
+#include "stm32f4xx.h"
+
+typedef struct {
+    isr_prof_stats_t s;
+    volatile uint32_t seq; // bumped by every update
+    volatile uint8_t reset; // set by isr_prof_reset(), cleared by the next update
+} isr_prof_slot_t;
+
+extern isr_prof_slot_t isr_prof_slots[ISR_PROF_COUNT];
+
+static inline void isr_prof_record(isr_prof_id_t id, uint32_t cycles) {
+    isr_prof_slot_t* p = &isr_prof_slots[id];
+    p->seq++;
+    if (p->reset) {
+        p->reset = 0;
+        p->s.calls = 0;
+        p->s.max = 0;
+        p->s.total = 0;
+    }
+    if (p->s.calls == 0U || cycles < p->s.min) {
+        p->s.min = cycles;
+    }
+    if (cycles > p->s.max) {
+        p->s.max = cycles;
+    }
+    p->s.calls++;
+    p->s.total += cycles;
+}
+
+#define ISR_PROF_ENTER() const uint32_t isr_prof_t0 = DWT->CYCCNT
+#define ISR_PROF_EXIT(id) isr_prof_record((id), DWT->CYCCNT - isr_prof_t0)
+
+#else
+
+#define ISR_PROF_ENTER() ((void)0)
+#define ISR_PROF_EXIT(id) ((void)0)
+
+#endif
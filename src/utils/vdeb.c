@@ -0,0 +1,68 @@
+#include "vdeb.h"
+
+void vdeb_init(vdeb_t* d, uint32_t sample, uint8_t ticks) {
+    d->tripped = 0;
+    d->rose = d->fell = 0;
+    vdeb_set(d, UINT32_MAX, sample, ticks);
+}
+
+void vdeb_set(vdeb_t* d, uint32_t m, uint32_t sample, uint8_t ticks) {
+    ticks = ticks < 1U ? 1U : ticks > 7U ? 7U : ticks;
+    const uint32_t keep = ~m;
+    d->stable = (d->stable & keep) | (sample & m);
+    d->c0 &= keep;
+    d->c1 &= keep;
+    d->c2 &= keep;
+    d->r0 &= keep;
+    d->r1 &= keep;
+    d->r2 &= keep;
+    d->n0 = (d->n0 & keep) | ((ticks & 1U) ? m : 0U);
+    d->n1 = (d->n1 & keep) | ((ticks & 2U) ? m : 0U);
+    d->n2 = (d->n2 & keep) | ((ticks & 4U) ? m : 0U);
+    d->tripped = (d->tripped & keep) | (sample & m);
+}
+
+uint32_t vdeb_trip(vdeb_t* d, uint32_t m) {
+    const uint32_t fresh = m & ~d->tripped;
+    d->tripped |= fresh; // edge IRQs run at one priority: no other writer in between
+    return fresh;
+}
+
+static inline uint32_t at_n(uint32_t c0, uint32_t c1, uint32_t c2, const vdeb_t* d) {
+    return ~((c0 ^ d->n0) | (c1 ^ d->n1) | (c2 ^ d->n2));
+}
+
+/* Count where `inc`, clear elsewhere; returns the bits that have just reached n */
+static inline uint32_t count(uint32_t* c0, uint32_t* c1, uint32_t* c2, uint32_t inc,
+                             const vdeb_t* d) {
+    *c2 = (*c2 ^ (*c1 & *c0)) & inc;
+    *c1 = (*c1 ^ *c0) & inc;
+    *c0 = ~*c0 & inc;
+    return inc & at_n(*c0, *c1, *c2, d);
+}
+
+uint32_t vdeb_tick(vdeb_t* d, uint32_t sample) {
+    // Debounce: flip the inputs whose differing run has reached n
+    const uint32_t flip = count(&d->c0, &d->c1, &d->c2, sample ^ d->stable, d);
+    d->c0 &= ~flip;
+    d->c1 &= ~flip;
+    d->c2 &= ~flip;
+    d->stable ^= flip;
+    d->rose = flip & d->stable;
+    d->fell = flip & ~d->stable;
+
+    // Trips end after n inactive samples in a row and once stable agrees; a run that has
+    // reached n holds there while stable is still active
+    const uint32_t rel = d->tripped & ~sample;
+    const uint32_t held = rel & at_n(d->r0, d->r1, d->r2, d);
+    const uint32_t full = count(&d->r0, &d->r1, &d->r2, rel & ~held, d) | held;
+    const uint32_t done = full & ~d->stable;
+    const uint32_t keep = full & ~done;
+    d->r0 = (d->r0 & ~done) | (keep & d->n0);
+    d->r1 = (d->r1 & ~done) | (keep & d->n1);
+    d->r2 = (d->r2 & ~done) | (keep & d->n2);
+    if (done != 0U) {
+        __atomic_fetch_and(&d->tripped, ~done, __ATOMIC_RELAXED); // an edge IRQ may set bits
+    }
+    return done;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Bit-parallel debouncer for up to 32 inputs (hardware independent).
+ *
+ * Bit i of every word is input i. Each input has a 3-bit "vertical" counter (bit i of c0,
+ * c1, c2) of consecutive samples that differ from `stable`; when it reaches `ticks` (1..7)
+ * the input flips. The whole word costs the same dozen or so AND/XOR operations whether
+ * one input moves or all 32, with no per-pin loop and no branches. `ticks` is per input.
+ *
+ * First edge: the edge interrupt calls vdeb_trip() on the very first active edge and the
+ * owner acts on `tripped` right away; the interrupt is then masked, so contact bounce costs
+ * nothing. Debouncing only decides when that is over: a tripped input clears once it has
+ * read inactive for `ticks` samples and `stable` agrees (after a real press, in the same
+ * tick in which `stable` drops), and vdeb_tick() reports it so the owner re-arms the edge
+ * interrupt. A spike the debouncer never confirms trips once and re-arms the same way.
+ */
+
+typedef struct {
+    uint32_t stable; // debounced state, 1 = active
+    uint32_t c0, c1, c2; // differing-sample counters, bit-sliced
+    uint32_t r0, r1, r2; // inactive-sample counters of tripped inputs, bit-sliced
+    uint32_t n0, n1, n2; // each input's `ticks`, bit-sliced
+    volatile uint32_t tripped; // first edge seen, not yet released (edge IRQ sets, tick clears)
+    uint32_t rose, fell; // debounced edges of the last tick
+} vdeb_t;
+
+// Seed from the current levels; inputs already active start tripped (edge IRQs masked)
+void vdeb_init(vdeb_t* d, uint32_t sample, uint8_t ticks);
+// (Re)seed the inputs in `m` only, with their own ticks (1..7)
+void vdeb_set(vdeb_t* d, uint32_t m, uint32_t sample, uint8_t ticks);
+
+// Edge IRQ: mark `m` tripped; returns the bits that were not tripped before
+uint32_t vdeb_trip(vdeb_t* d, uint32_t m);
+
+// One poll of all inputs (1 = active). Updates stable / rose / fell; returns the trips that
+// just ended (re-arm their edge interrupts).
+uint32_t vdeb_tick(vdeb_t* d, uint32_t sample);
+
+// Active now: tripped by an edge, or debounced active
+static inline uint32_t vdeb_active(const vdeb_t* d) {
+    return d->tripped | d->stable;
+}
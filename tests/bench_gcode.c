@@ -0,0 +1,73 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "gcode.h"
+
+/*
+ * Host throughput of the G-code front end: every byte goes through the line assembler,
+ * then parse + execute, like gcode_stream_service() does with USART2 bytes. On target the
+ * same path is timed with the DWT counter and reported by "$C".
+ */
+
+#define PASSES 20000U
+#define LINK_BAUD 115200U
+
+static const char* const PROGRAM[] = {
+        "G21 G90 G17\n",
+        "G0 X10.000 Y5.000 Z1.000\n",
+        "G1 Z-0.500 F300\n",
+        "G1 X12.345 Y-6.789 F1200 (pocket)\n",
+        "X13.1 Y-6.2\n",
+        "X13.9 Y-5.55 ; tiny segment\n",
+        "G2 X20.0 Y0.0 I3.5 J2.0\n",
+        "G3 X10.0 Y0.0 R5.0\n",
+        "G91 G1 X0.05 Y0.05\n",
+        "G90 G0 Z5\n",
+};
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+int main(void) {
+    const uint32_t n_prog = (uint32_t)(sizeof PROGRAM / sizeof PROGRAM[0]);
+    gcode_line_t l = {0};
+    gcode_state_t st;
+    gcode_init(&st);
+
+    uint32_t lines = 0, errors = 0, bytes = 0;
+    volatile float sink = 0.0f;
+    const double t0 = now_s();
+    for (uint32_t pass = 0; pass < PASSES; ++pass) {
+        for (uint32_t k = 0; k < n_prog; ++k) {
+            for (const char* p = PROGRAM[k]; *p; ++p) {
+                bytes++;
+                if (!gcode_line_feed(&l, *p)) {
+                    continue;
+                }
+                gcode_block_t b;
+                gc_cmd_t c[GCODE_MAX_CMDS];
+                uint8_t n;
+                gc_status_t e = gcode_parse(l.buf, l.len, &b);
+                if (e == GC_OK) {
+                    e = gcode_execute(&st, &b, c, &n);
+                }
+                errors += (e != GC_OK);
+                sink += st.pos[0];
+                lines++;
+            }
+        }
+    }
+    const double dt = now_s() - t0;
+
+    printf("gcode front end: %.0f lines/s on host (%u lines, %u errors, %.0f ns/line)\n",
+           (double)lines / dt, lines, errors, 1e9 * dt / (double)lines);
+    printf("link: %u baud carries ~%.0f lines/s of this program\n", LINK_BAUD,
+           (double)LINK_BAUD / 10.0 / ((double)bytes / (double)lines));
+    (void)sink;
+    return errors != 0;
+}
@@ -0,0 +1,205 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "vdeb.h"
+
+/*
+ * Host timing of the 1 kHz switch tick: the old per-pin debouncer (one IDR shift, polarity
+ * and counter per switch, as limits.c / estop.c did) against inputs_tick()'s single word
+ * (vdeb_tick). Both run the same bouncy input streams with random first-edge trips and
+ * must agree on every debounced level, trip and re-arm. The numbers are a relative guide
+ * only; the tick runs once per ms next to the step ISR, so what matters is that it stays
+ * flat as inputs are added.
+ */
+
+#define TICKS 5U
+#define SAMPLES 4096U // recorded IDR words, replayed
+#define ROUNDS 400U
+
+/* The per-pin debouncer with first-edge trip, as it was before vdeb */
+typedef struct {
+    uint8_t cnt, stable, last_sample, ticks;
+    uint8_t tripped, released;
+} pin_deb_t;
+
+typedef struct {
+    uint8_t pin; // IDR bit
+    uint8_t active_low;
+} pin_hw_t;
+
+static int pin_trip(pin_deb_t* d) {
+    if (d->tripped) {
+        return 0;
+    }
+    d->tripped = 1;
+    d->released = 0;
+    return 1;
+}
+
+static int pin_tick(pin_deb_t* d, uint8_t sample) {
+    if (sample == d->stable) {
+        d->cnt = 0;
+        d->last_sample = sample;
+    } else {
+        if (sample != d->last_sample) {
+            d->last_sample = sample;
+            d->cnt = 1;
+        } else if (d->cnt < 255) {
+            d->cnt++;
+        }
+        if (d->cnt >= d->ticks) {
+            d->stable = sample;
+            d->cnt = 0;
+        }
+    }
+    if (!d->tripped) {
+        return 0;
+    }
+    d->released = sample ? 0U : (uint8_t)(d->released + 1U);
+    if (d->released < d->ticks || d->stable) {
+        return 0;
+    }
+    d->released = 0;
+    d->tripped = 0;
+    return 1;
+}
+
+static uint32_t s_idr[SAMPLES]; // 32 pins' raw levels per tick (two 16-bit ports)
+static uint32_t s_trip[SAMPLES]; // EXTI edges between ticks (subset of the active pins)
+static pin_hw_t s_hw[32];
+static uint32_t s_invert;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+/* Switches that press and release now and then with a few ms of chatter */
+static void make_streams(void) {
+    srand(14);
+    uint32_t lvl = 0, bounce[32] = {0};
+    for (uint32_t k = 0; k < SAMPLES; ++k) {
+        for (uint32_t i = 0; i < 32U; ++i) {
+            if (bounce[i] == 0U && rand() % 200 == 0) {
+                bounce[i] = 1U + (uint32_t)(rand() % 8);
+                lvl ^= 1UL << i;
+            }
+            uint32_t raw = (lvl >> i) & 1U;
+            if (bounce[i] > 0U) {
+                raw ^= (uint32_t)(bounce[i]-- > 1U && rand() % 2);
+            }
+            s_idr[k] |= raw << i;
+        }
+        s_idr[k] ^= s_invert; // electrical level
+        s_trip[k] = (s_idr[k] ^ s_invert) & (uint32_t)rand(); // some of the active edges
+    }
+}
+
+static void init_hw(void) {
+    for (uint32_t i = 0; i < 32U; ++i) {
+        s_hw[i].pin = (uint8_t)i;
+        s_hw[i].active_low = (uint8_t)(i % 3U != 0U);
+        s_invert |= (uint32_t)s_hw[i].active_low << i;
+    }
+}
+
+/* Per-pin: returns a checksum of the re-arms */
+static uint32_t run_pins(pin_deb_t* d, uint32_t n, uint32_t rounds, uint32_t* trace) {
+    uint32_t sum = 0;
+    for (uint32_t r = 0; r < rounds; ++r) {
+        for (uint32_t k = 0; k < SAMPLES; ++k) {
+            const uint32_t idr = s_idr[k];
+            uint32_t rearm = 0;
+            for (uint32_t i = 0; i < n; ++i) {
+                if ((s_trip[k] >> i) & 1U) {
+                    pin_trip(&d[i]);
+                }
+                const uint8_t hi = (uint8_t)((idr >> s_hw[i].pin) & 1U);
+                const uint8_t raw = s_hw[i].active_low ? (uint8_t)!hi : hi;
+                rearm |= (uint32_t)pin_tick(&d[i], raw) << i;
+            }
+            sum += rearm;
+            if (trace) {
+                uint32_t st = 0, tr = 0;
+                for (uint32_t i = 0; i < n; ++i) {
+                    st |= (uint32_t)d[i].stable << i;
+                    tr |= (uint32_t)d[i].tripped << i;
+                }
+                trace[3 * k] = st;
+                trace[3 * k + 1] = tr;
+                trace[3 * k + 2] = rearm;
+            }
+        }
+    }
+    return sum;
+}
+
+static uint32_t run_vdeb(vdeb_t* d, uint32_t n, uint32_t rounds, uint32_t* trace) {
+    const uint32_t used = n == 32U ? UINT32_MAX : (1UL << n) - 1U;
+    uint32_t sum = 0;
+    for (uint32_t r = 0; r < rounds; ++r) {
+        for (uint32_t k = 0; k < SAMPLES; ++k) {
+            vdeb_trip(d, s_trip[k] & used);
+            const uint32_t rearm = vdeb_tick(d, (s_idr[k] ^ s_invert) & used);
+            sum += rearm;
+            if (trace) {
+                trace[3 * k] = d->stable;
+                trace[3 * k + 1] = d->tripped;
+                trace[3 * k + 2] = rearm;
+            }
+        }
+    }
+    return sum;
+}
+
+static uint32_t s_tr_pin[3 * SAMPLES], s_tr_vdeb[3 * SAMPLES];
+
+int main(void) {
+    init_hw();
+    make_streams();
+
+    // Same answers, every tick, every lane
+    {
+        pin_deb_t d[32] = {0};
+        vdeb_t v;
+        for (uint32_t i = 0; i < 32U; ++i) {
+            d[i].ticks = (uint8_t)TICKS;
+        }
+        vdeb_init(&v, 0, TICKS);
+        run_pins(d, 32U, 1U, s_tr_pin);
+        run_vdeb(&v, 32U, 1U, s_tr_vdeb);
+        uint32_t rearms = 0;
+        for (uint32_t k = 0; k < 3U * SAMPLES; ++k) {
+            assert(s_tr_pin[k] == s_tr_vdeb[k]);
+            rearms += k % 3U == 2U ? (uint32_t)__builtin_popcount(s_tr_pin[k]) : 0U;
+        }
+        assert(rearms > 100U); // the streams do exercise trips and re-arms
+    }
+
+    volatile uint32_t sink = 0;
+    const uint32_t sizes[] = {4U, 16U, 32U};
+    for (uint32_t s = 0; s < sizeof sizes / sizeof sizes[0]; ++s) {
+        const uint32_t n = sizes[s];
+        pin_deb_t d[32] = {0};
+        vdeb_t v;
+        for (uint32_t i = 0; i < 32U; ++i) {
+            d[i].ticks = (uint8_t)TICKS;
+        }
+        vdeb_init(&v, 0, TICKS);
+
+        double t0 = now_s();
+        sink += run_pins(d, n, ROUNDS, NULL);
+        const double pin_ns = 1e9 * (now_s() - t0) / (SAMPLES * ROUNDS);
+        t0 = now_s();
+        sink += run_vdeb(&v, n, ROUNDS, NULL);
+        const double vdeb_ns = 1e9 * (now_s() - t0) / (SAMPLES * ROUNDS);
+        printf("%2u inputs: per-pin %6.1f ns/tick, vertical %5.1f ns/tick (%.1fx)\n", n, pin_ns,
+               vdeb_ns, pin_ns / vdeb_ns);
+    }
+    printf("All input debounce benchmarks passed.\n");
+    return 0;
+}
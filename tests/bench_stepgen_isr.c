@@ -0,0 +1,63 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "stepgen_dda.h"
+#include "stepgen_oc.h"
+#include "stepgen_ramp.h"
+
+/*
+ * Host timing of the per-step ISR work (no hardware access): the DDA tick, one lane pop
+ * and both compare edges of every stepping axis. The number is only a relative guide; the
+ * target budget printed below is what a 180 MHz core has per step at STEPGEN_MAX_HZ.
+ */
+
+#define STEPS 2000000U
+#define CORE_HZ 180000000UL
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+int main(void) {
+    static stepgen_lane_t lane;
+    stepgen_dda_t dda;
+    stepgen_oc_t oc[3] = {0};
+    const uint32_t steps[3] = {STEPS, STEPS / 2U, STEPS / 3U};
+
+    stepgen_lane_reset(&lane);
+    stepgen_ramp_plan(&lane.ramp, STEPS, 0.0f, (float)STEPGEN_MAX_HZ, 0.0f, 200000.0f);
+    stepgen_dda_load(&dda, steps);
+
+    volatile uint32_t sink = 0;
+    uint16_t now = 0;
+    const double t0 = now_s();
+    for (uint32_t k = 0; k < STEPS; ++k) {
+        if ((k & 15U) == 0) {
+            stepgen_lane_fill(&lane); // stands in for stepgen_prep(); not part of the ISR
+        }
+        const uint8_t mask = stepgen_dda_tick(&dda);
+        const uint16_t p = stepgen_lane_next_period(&lane);
+        for (int i = 0; i < 3; ++i) {
+            if (mask & (1U << i)) {
+                stepgen_oc_set_period(&oc[i], p);
+                stepgen_oc_queue_step(&oc[i], (uint16_t)(now + STEPGEN_OC_LEAD_TICKS));
+                stepgen_oc_on_match(&oc[i]); // rise
+                stepgen_oc_on_match(&oc[i]); // fall
+                sink += oc[i].ccr;
+            }
+        }
+        now = (uint16_t)(now + p);
+    }
+    const double dt = now_s() - t0;
+
+    printf("stepgen ISR path: %.1f ns/step on host (%u steps, %lu underruns)\n",
+           1e9 * dt / (double)STEPS, STEPS, (unsigned long)lane.underruns);
+    printf("target budget: %lu cycles/step at %u Hz on a %lu MHz core\n",
+           (unsigned long)(CORE_HZ / STEPGEN_MAX_HZ), STEPGEN_MAX_HZ,
+           (unsigned long)(CORE_HZ / 1000000UL));
+    (void)sink;
+    return 0;
+}
@@ -0,0 +1,15 @@
+; Arcs: centre form, radius form, full circle, helix, other planes
+G21 G90 G17
+M17
+G0 X5 Y0
+G3 X0 Y5 I-5 J0 F1200
+G2 X-5 Y0 R5
+G3 X-5 Y0 I2.5 J0
+G2 X0 Y0 Z1 I2.5 J0 F900
+G18
+G2 X4 Z1 I2 K0
+G19
+G3 Y2 Z3 J1 K1
+G17
+G0 X0 Y0 Z0
+M2
@@ -0,0 +1,14 @@
+; Straight lines: single axis, diagonals, all three axes, rapids, G91
+G21 G90 G17
+M17
+G1 X10 F1200
+G1 Y8
+G1 X2 Y-4 F900
+G1 X6 Y3 Z1.5 F600
+G0 X-3 Y-2 Z0
+G91
+G1 X4.5 Y4.5 F1500
+G1 Z-0.8 F300
+G90
+G0 X0 Y0 Z0
+M2
@@ -0,0 +1,22 @@
+; Direction reversals: full stops, a zig-zag, single-axis flips while another axis runs
+G21 G90 G17
+M17
+G1 X5 F1500
+G1 X0
+G1 X5
+G1 X1 Y1
+G1 X4 Y2
+G1 X1 Y3
+G1 X4 Y4
+G1 X1 Y5
+G1 X3 Y0 Z0.5 F900
+G1 X3 Y2 Z0
+G1 X0 Y2 Z0.5
+G91
+G1 X0.5 F1500
+G1 X-0.5
+G1 X0.5
+G1 X-0.5
+G90
+G0 X0 Y0 Z0
+M2
@@ -0,0 +1,34 @@
+; Tiny segments: 0.05 mm (2 X/Y steps), below one step (the fraction carries), a fine polyline
+G21 G91 G17
+M17
+G1 X0.05 F1200
+G1 X0.05
+G1 X0.05 Y0.05
+G1 X0.05 Y0.05
+G1 X0.01
+G1 X0.01
+G1 X0.01
+G1 X0.01
+G1 X0.01
+G1 Y0.01
+G1 Y0.01
+G1 Y0.01
+G1 Z0.003
+G1 Z0.003
+G1 X0.12 Y0.03
+G1 X0.12 Y0.06
+G1 X0.11 Y0.09
+G1 X0.10 Y0.11
+G1 X0.09 Y0.12
+G1 X0.06 Y0.12
+G1 X0.03 Y0.12
+G1 X-0.03 Y0.12
+G1 X-0.06 Y0.12
+G1 X-0.09 Y0.12
+G1 X-0.11 Y0.10
+G1 X-0.12 Y0.08
+G1 X-0.12 Y0.05
+G1 X-0.12 Y0.02
+G90
+G0 X0 Y0 Z0
+M2
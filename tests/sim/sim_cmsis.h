@@ -0,0 +1,68 @@
+#pragma once
+
+/*
+ * Host stand-in for cmsis_gcc.h, force-included (-include) ahead of every source built for
+ * the emulator. Defining the guard keeps the Arm inline assembly out; the core intrinsics
+ * the drivers use are routed into the emulator instead:
+ *  - __NOP() spends one core cycle of simulated time (delay() loops really wait)
+ *  - BASEPRI / PRIMASK are the emulator's masks: lowering them dispatches whatever is
+ *    pending and now allowed, like the core does on the next instruction
+ *  - barriers are compiler barriers (register writes take effect in order anyway)
+ */
+
+#define __CMSIS_GCC_H
+
+#include <stdint.h>
+
+#define __ASM __asm
+#define __INLINE inline
+#define __STATIC_INLINE static inline
+#define __STATIC_FORCEINLINE __attribute__((always_inline)) static inline
+#define __NO_RETURN __attribute__((__noreturn__))
+#define __USED __attribute__((used))
+#define __WEAK __attribute__((weak))
+#define __PACKED __attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x) __attribute__((aligned(x)))
+#define __RESTRICT __restrict
+#define __COMPILER_BARRIER() __ASM volatile("" ::: "memory")
+
+void sim_cpu_nop(void);
+uint32_t sim_cpu_basepri(void);
+void sim_cpu_set_basepri(uint32_t v);
+uint32_t sim_cpu_primask(void);
+void sim_cpu_set_primask(uint32_t v);
+void sim_cpu_wfi(void);
+
+#define __NOP() sim_cpu_nop()
+#define __WFI() sim_cpu_wfi()
+#define __WFE() sim_cpu_wfi()
+#define __SEV() __COMPILER_BARRIER()
+#define __DSB() __COMPILER_BARRIER()
+#define __ISB() __COMPILER_BARRIER()
+#define __DMB() __COMPILER_BARRIER()
+
+static inline uint32_t __get_BASEPRI(void) {
+    return sim_cpu_basepri();
+}
+
+static inline void __set_BASEPRI(uint32_t v) {
+    sim_cpu_set_basepri(v);
+}
+
+static inline uint32_t __get_PRIMASK(void) {
+    return sim_cpu_primask();
+}
+
+static inline void __set_PRIMASK(uint32_t v) {
+    sim_cpu_set_primask(v);
+}
+
+static inline void __enable_irq(void) {
+    sim_cpu_set_primask(0);
+}
+
+static inline void __disable_irq(void) {
+    sim_cpu_set_primask(1);
+}
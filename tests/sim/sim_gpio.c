@@ -0,0 +1,282 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "sim_internal.h"
+
+/*
+GPIOA..H, EXTI and SYSCFG.
+
+A pin's level comes from, in order: the chip (an output's ODR bit, or the peripheral behind
+its alternate function), the external circuit (sim_pin_drive()), the pull resistor (floating
+reads 0). Open-drain outputs only pull low. Every change is seen once, at the cycle it
+happens: IDR follows, EXTI lines routed to it (SYSCFG_EXTICR) latch their edge in PR while
+unmasked, the watchers hear about it, and the break inputs are re-checked (which may change
+timer outputs and so other pins: re-evaluated until nothing moves).
+*/
+
+#define N_PORT 8U
+#define N_WATCH 4U
+
+enum { AF_TIM_CH = 0, AF_TIM_BKIN, AF_USART_TX };
+
+typedef struct {
+    uint8_t port;
+    uint8_t pin;
+    uint8_t af;
+    uint8_t kind;
+    uint8_t unit; // timer index (0 = TIM1, 1 = TIM2, ...)
+    uint8_t ch;
+} af_t;
+
+// Alternate functions with a modelled peripheral behind them (RM0390 / datasheet table 11)
+static const af_t AF[] = {
+        {0, 8, 1, AF_TIM_CH, 0, 0},   {0, 9, 1, AF_TIM_CH, 0, 1},   {0, 10, 1, AF_TIM_CH, 0, 2},
+        {0, 11, 1, AF_TIM_CH, 0, 3},  {0, 6, 1, AF_TIM_BKIN, 0, 0}, {1, 12, 1, AF_TIM_BKIN, 0, 0},
+        {4, 9, 1, AF_TIM_CH, 0, 0},   {4, 11, 1, AF_TIM_CH, 0, 1},  {4, 13, 1, AF_TIM_CH, 0, 2},
+        {4, 14, 1, AF_TIM_CH, 0, 3},  {0, 0, 1, AF_TIM_CH, 1, 0},   {0, 5, 1, AF_TIM_CH, 1, 0},
+        {0, 15, 1, AF_TIM_CH, 1, 0},  {0, 1, 1, AF_TIM_CH, 1, 1},   {1, 3, 1, AF_TIM_CH, 1, 1},
+        {0, 2, 1, AF_TIM_CH, 1, 2},   {1, 10, 1, AF_TIM_CH, 1, 2},  {0, 3, 1, AF_TIM_CH, 1, 3},
+        {1, 11, 1, AF_TIM_CH, 1, 3},  {0, 6, 2, AF_TIM_CH, 2, 0},   {1, 4, 2, AF_TIM_CH, 2, 0},
+        {2, 6, 2, AF_TIM_CH, 2, 0},   {0, 7, 2, AF_TIM_CH, 2, 1},   {1, 5, 2, AF_TIM_CH, 2, 1},
+        {2, 7, 2, AF_TIM_CH, 2, 1},   {1, 0, 2, AF_TIM_CH, 2, 2},   {2, 8, 2, AF_TIM_CH, 2, 2},
+        {1, 1, 2, AF_TIM_CH, 2, 3},   {2, 9, 2, AF_TIM_CH, 2, 3},   {1, 6, 2, AF_TIM_CH, 3, 0},
+        {1, 7, 2, AF_TIM_CH, 3, 1},   {1, 8, 2, AF_TIM_CH, 3, 2},   {1, 9, 2, AF_TIM_CH, 3, 3},
+        {0, 0, 2, AF_TIM_CH, 4, 0},   {0, 1, 2, AF_TIM_CH, 4, 1},   {0, 2, 2, AF_TIM_CH, 4, 2},
+        {0, 3, 2, AF_TIM_CH, 4, 3},   {0, 2, 7, AF_USART_TX, 0, 0}, {3, 5, 7, AF_USART_TX, 0, 0},
+};
+#define N_AF (sizeof AF / sizeof AF[0])
+
+static uint16_t s_ext_mask[N_PORT]; // pins the external circuit drives
+static uint16_t s_ext_level[N_PORT];
+static uint16_t s_level[N_PORT];
+static bool s_dirty;
+static bool s_updating;
+
+static struct {
+    sim_pin_fn fn;
+    void* ctx;
+} s_watch[N_WATCH];
+
+static inline GPIO_TypeDef* port_regs(uint32_t p) {
+    return (GPIO_TypeDef*)(GPIOA_BASE + p * (GPIOB_BASE - GPIOA_BASE));
+}
+
+static inline uint32_t pin_af(const GPIO_TypeDef* g, uint32_t n) {
+    return (g->AFR[n >> 3] >> ((n & 7U) * 4U)) & 0xFU;
+}
+
+static int8_t s_af_of[N_PORT][16][16]; // AF[] entry per port / pin / AF number, -1 = none
+
+static void af_index(void) {
+    memset(s_af_of, -1, sizeof s_af_of);
+    for (uint32_t i = 0; i < N_AF; ++i) {
+        s_af_of[AF[i].port][AF[i].pin][AF[i].af] = (int8_t)i;
+    }
+}
+
+static int af_drive(uint32_t p, uint32_t n, uint32_t af) {
+    const int i = s_af_of[p][n][af];
+    if (i < 0) {
+        return -1; // nothing modelled
+    }
+    if (AF[i].kind == AF_TIM_CH) {
+        return sim_tim_output(AF[i].unit, AF[i].ch);
+    }
+    if (AF[i].kind == AF_USART_TX) {
+        return sim_usart_tx_pin();
+    }
+    return -1; // an input function
+}
+
+/* Pins whose 2-bit field in a MODER / PUPDR style register equals v, as a 16-bit mask */
+static uint32_t field_mask(uint32_t reg, uint32_t v) {
+    uint32_t x = ~(reg ^ (v * 0x55555555U));
+    x &= x >> 1; // both bits of the field match
+    x &= 0x55555555U;
+    x = (x | (x >> 1)) & 0x33333333U;
+    x = (x | (x >> 2)) & 0x0F0F0F0FU;
+    x = (x | (x >> 4)) & 0x00FF00FFU;
+    return (x | (x >> 8)) & 0xFFFFU;
+}
+
+/* Levels on every pin of a port */
+static uint16_t port_level(uint32_t p) {
+    const GPIO_TypeDef* g = port_regs(p);
+    const uint32_t moder = g->MODER;
+    const uint32_t out = field_mask(moder, 1U);
+    const uint32_t af = field_mask(moder, 2U);
+    uint32_t level = g->ODR & out;
+    uint32_t driven = out;
+    for (uint32_t m = af; m != 0U; m &= m - 1U) {
+        const uint32_t n = (uint32_t)__builtin_ctz(m);
+        const int d = af_drive(p, n, pin_af(g, n));
+        if (d >= 0) {
+            driven |= 1UL << n;
+            level |= (uint32_t)d << n;
+        }
+    }
+    const uint32_t released = level & g->OTYPER; // open drain only pulls low
+    driven &= ~released;
+    level &= driven;
+    const uint32_t ext = s_ext_mask[p] & ~driven;
+    level |= s_ext_level[p] & ext;
+    level |= field_mask(g->PUPDR, 1U) & ~(driven | ext); // pull-down / floating: 0
+    return (uint16_t)level;
+}
+
+static void edge(uint32_t p, uint32_t n, bool level) {
+    const uint32_t m = 1UL << n;
+    const uint32_t src = (SYSCFG->EXTICR[n >> 2] >> ((n & 3U) * 4U)) & 0xFU;
+    if (src == p && (EXTI->IMR & m) && ((level ? EXTI->RTSR : EXTI->FTSR) & m)) {
+        EXTI->PR |= m;
+    }
+    for (uint32_t i = 0; i < N_WATCH; ++i) {
+        if (s_watch[i].fn != NULL) {
+            s_watch[i].fn(s_watch[i].ctx, (uint8_t)p, (uint8_t)n, level, sim_t);
+        }
+    }
+}
+
+static void evaluate(bool quiet) {
+    for (uint32_t pass = 0; s_dirty && pass < 16U; ++pass) {
+        s_dirty = false;
+        uint16_t changed[N_PORT];
+        for (uint32_t p = 0; p < N_PORT; ++p) {
+            const uint16_t level = port_level(p);
+            changed[p] = level ^ s_level[p];
+            s_level[p] = level;
+            // analog pins: the Schmitt trigger is off
+            port_regs(p)->IDR = level & ~field_mask(port_regs(p)->MODER, 3U);
+        }
+        if (!quiet) {
+            for (uint32_t p = 0; p < N_PORT; ++p) {
+                for (uint32_t m = changed[p]; m != 0U; m &= m - 1U) {
+                    const uint32_t n = (uint32_t)__builtin_ctz(m);
+                    edge(p, n, (s_level[p] >> n) & 1U);
+                }
+            }
+        }
+        sim_tim_break(); // may move timer outputs: another pass
+    }
+}
+
+void sim_gpio_changed(void) {
+    s_dirty = true;
+}
+
+void sim_gpio_update(void) {
+    if (s_updating || !s_dirty) {
+        return; // a watcher drove a pin: the running evaluation takes it
+    }
+    s_updating = true;
+    evaluate(false);
+    s_updating = false;
+}
+
+void sim_gpio_write(uintptr_t a, uint32_t old) {
+    const uint32_t w = *sim_reg(a);
+    if (a >= GPIOA_BASE && a < GPIOA_BASE + N_PORT * 0x400U) {
+        GPIO_TypeDef* g = (GPIO_TypeDef*)(a & ~(uintptr_t)0x3FFU);
+        const uintptr_t off = a & 0x3FFU;
+        if (off == offsetof(GPIO_TypeDef, BSRR)) {
+            g->ODR = ((g->ODR & ~(w >> 16)) | w) & 0xFFFFU; // set wins over reset
+            g->BSRR = 0;
+        } else if (off == offsetof(GPIO_TypeDef, IDR)) {
+            g->IDR = old; // read-only
+        } else if (off == offsetof(GPIO_TypeDef, ODR)) {
+            g->ODR = w & 0xFFFFU;
+        }
+        s_dirty = true;
+    } else if (a == (uintptr_t)&EXTI->PR) {
+        EXTI->PR = old & ~w; // rc_w1
+        EXTI->SWIER &= ~w;
+    } else if (a == (uintptr_t)&EXTI->SWIER) {
+        EXTI->PR |= w & ~old & EXTI->IMR;
+    }
+}
+
+bool sim_gpio_irq(int irqn) {
+    const uint32_t p = EXTI->PR & EXTI->IMR;
+    switch (irqn) {
+    case EXTI0_IRQn:
+    case EXTI1_IRQn:
+    case EXTI2_IRQn:
+    case EXTI3_IRQn:
+    case EXTI4_IRQn:
+        return (p >> (irqn - EXTI0_IRQn)) & 1U;
+    case EXTI9_5_IRQn:
+        return (p & 0x03E0U) != 0U;
+    case EXTI15_10_IRQn:
+        return (p & 0xFC00U) != 0U;
+    default:
+        return false;
+    }
+}
+
+int sim_gpio_bkin(uint8_t unit) {
+    for (uint32_t i = 0; i < N_AF; ++i) {
+        const af_t* e = &AF[i];
+        if (e->kind != AF_TIM_BKIN || e->unit != unit) {
+            continue;
+        }
+        const GPIO_TypeDef* g = port_regs(e->port);
+        if (((g->MODER >> (2U * e->pin)) & 3U) == 2U && pin_af(g, e->pin) == e->af) {
+            return (s_level[e->port] >> e->pin) & 1U;
+        }
+    }
+    return 0; // no pin routed: the input reads low
+}
+
+void sim_gpio_reset(void) {
+    af_index();
+    for (uint32_t p = 0; p < N_PORT; ++p) {
+        s_level[p] = 0;
+        s_ext_mask[p] = 0;
+        s_ext_level[p] = 0;
+    }
+    s_dirty = true;
+    evaluate(true); // reset levels, nobody told
+}
+
+/* ---- API ---- */
+
+uint8_t sim_port_index(const GPIO_TypeDef* port) {
+    return (uint8_t)(((uintptr_t)port - GPIOA_BASE) / (GPIOB_BASE - GPIOA_BASE));
+}
+
+void sim_pin_drive(GPIO_TypeDef* port, uint8_t pin, int level) {
+    const uint32_t p = sim_port_index(port);
+    const uint16_t m = (uint16_t)(1U << (pin & 15U));
+    s_ext_mask[p] = (uint16_t)(level < 0 ? s_ext_mask[p] & ~m : s_ext_mask[p] | m);
+    s_ext_level[p] = (uint16_t)(level > 0 ? s_ext_level[p] | m : s_ext_level[p] & ~m);
+    s_dirty = true;
+    if (!s_updating) {
+        sim_settle();
+    }
+}
+
+bool sim_pin(const GPIO_TypeDef* port, uint8_t pin) {
+    if (!s_updating) {
+        sim_settle();
+    }
+    return (s_level[sim_port_index(port)] >> (pin & 15U)) & 1U;
+}
+
+bool sim_pin_watch(sim_pin_fn fn, void* ctx) {
+    for (uint32_t i = 0; i < N_WATCH; ++i) {
+        if (s_watch[i].fn == NULL) {
+            s_watch[i].fn = fn;
+            s_watch[i].ctx = ctx;
+            return true;
+        }
+    }
+    return false;
+}
+
+void sim_pin_unwatch(sim_pin_fn fn, void* ctx) {
+    for (uint32_t i = 0; i < N_WATCH; ++i) {
+        if (s_watch[i].fn == fn && s_watch[i].ctx == ctx) {
+            s_watch[i].fn = NULL;
+        }
+    }
+}
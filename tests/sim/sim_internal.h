@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stm32_sim.h"
+
+/* Shared between the emulator's modules only (not for tests) */
+
+#define SIM_NEVER UINT64_MAX
+
+extern uint64_t sim_t; // now, in core cycles
+extern sim_stats_t sim_st;
+
+static inline volatile uint32_t* sim_reg(uintptr_t addr) {
+    return (volatile uint32_t*)addr;
+}
+
+/* Core (stm32_sim.c) */
+void sim_settle(void); // apply the pending store, re-evaluate pins, take interrupts
+uint32_t sim_tim_clk_div(bool apb2); // core cycles per timer clock on that bus
+uint32_t sim_pclk_div(bool apb2); // core cycles per peripheral clock
+
+/* Timers (sim_tim.c): TIM1..TIM5, index 0 = TIM1 */
+void sim_tim_reset(void);
+uint64_t sim_tim_next(void);
+void sim_tim_advance(uint64_t t);
+void sim_tim_write(uintptr_t addr, uint32_t old);
+bool sim_tim_irq(int irqn); // interrupt line level
+int sim_tim_output(uint8_t unit, uint8_t ch); // drive on TIMx_CHy: 0 / 1, -1 = not driven
+void sim_tim_break(void); // a break input may have changed level
+
+/* GPIO, EXTI, SYSCFG (sim_gpio.c) */
+void sim_gpio_reset(void);
+void sim_gpio_write(uintptr_t addr, uint32_t old);
+void sim_gpio_changed(void); // a pin driver changed: re-evaluate before the next access
+void sim_gpio_update(void); // re-evaluate pins now (edges, watchers, break)
+bool sim_gpio_irq(int irqn);
+int sim_gpio_bkin(uint8_t unit); // level on TIMx_BKIN (0 if no pin is routed to it)
+
+/* USART2 + DMA1 (sim_usart.c) */
+void sim_usart_reset(void);
+uint64_t sim_usart_next(void);
+void sim_usart_advance(uint64_t t);
+void sim_usart_write(uintptr_t addr, uint32_t old);
+void sim_usart_read(uintptr_t addr); // after a load (clear-on-read sequences)
+bool sim_usart_irq(int irqn);
+int sim_usart_tx_pin(void); // drive on USART2_TX: idle high while enabled, -1 = not driven
@@ -0,0 +1,397 @@
+#include <stddef.h>
+
+#include "sim_internal.h"
+
+/*
+TIM1..TIM5, up-counting only (DIR / CMS are not modelled).
+
+Each timer keeps the counter it last brought up to date (t_sync, prescaler phase) and works
+out when it next does something visible: a compare match (CCxIF, OCxREF) or the overflow
+(update event). Between those nothing is simulated; CNT is written back whenever time moves.
+PSC, ARR (with ARPE) and CCRx (with OCxPE) go through their shadow registers at the update
+event like on the chip.
+
+Outputs: OCxREF in frozen / active / inactive / toggle / forced / PWM1 / PWM2 mode, through
+CCxP and CCxE. On TIM1 the main output enable applies too: with MOE clear, OSSI drives
+CCxE outputs to OISx, otherwise they float. The break input (BKE, BKP) is level sensitive:
+while active it holds MOE clear and BIF set; AOE sets MOE again at the next update event.
+*/
+
+#define N_TIM 5U
+#define OCM_FROZEN 0U
+#define OCM_ACTIVE 1U
+#define OCM_INACTIVE 2U
+#define OCM_TOGGLE 3U
+#define OCM_FORCE_LOW 4U
+#define OCM_FORCE_HIGH 5U
+#define OCM_PWM1 6U
+#define OCM_PWM2 7U
+
+typedef struct {
+    uintptr_t base;
+    uint8_t apb2; // clocked from APB2 (else APB1)
+    uint8_t wide; // 32-bit counter
+    uint8_t advanced; // RCR, BDTR, separate interrupt lines
+    // State
+    uint64_t t_sync; // counted up to here
+    uint32_t pcnt; // prescaler phase (timer clocks into the current count)
+    uint32_t psc; // active (shadow) registers
+    uint32_t arr;
+    uint32_t rep;
+    uint32_t ccr[4];
+    uint8_t ref[4]; // OCxREF
+    int8_t out[4]; // what the channel drives onto its pin: 0 / 1, -1 = nothing
+} tim_t;
+
+static tim_t s_tim[N_TIM] = {
+        {.base = TIM1_BASE, .apb2 = 1, .advanced = 1},
+        {.base = TIM2_BASE, .wide = 1},
+        {.base = TIM3_BASE},
+        {.base = TIM4_BASE},
+        {.base = TIM5_BASE, .wide = 1},
+};
+
+static inline TIM_TypeDef* regs(const tim_t* t) {
+    return (TIM_TypeDef*)t->base;
+}
+
+static inline uint32_t top(const tim_t* t) {
+    return t->wide ? 0xFFFFFFFFU : 0xFFFFU;
+}
+
+static inline uint32_t ccmr_field(const tim_t* t, uint32_t ch) {
+    const TIM_TypeDef* r = regs(t);
+    const uint32_t ccmr = ch < 2U ? r->CCMR1 : r->CCMR2;
+    return (ccmr >> ((ch & 1U) * 8U)) & 0xFFU;
+}
+
+static inline bool is_output(const tim_t* t, uint32_t ch) {
+    return (ccmr_field(t, ch) & 3U) == 0U; // CCxS = 00
+}
+
+static inline uint32_t oc_mode(const tim_t* t, uint32_t ch) {
+    return (ccmr_field(t, ch) >> 4) & 7U;
+}
+
+static inline volatile uint32_t* ccr_reg(const tim_t* t, uint32_t ch) {
+    return &regs(t)->CCR1 + ch;
+}
+
+static inline uint32_t ccr_of(const tim_t* t, uint32_t ch) {
+    return (ccmr_field(t, ch) & 0x08U) ? t->ccr[ch] : *ccr_reg(t, ch); // OCxPE
+}
+
+static bool break_active(const tim_t* t) {
+    const uint32_t bdtr = regs(t)->BDTR;
+    if (!t->advanced || !(bdtr & TIM_BDTR_BKE)) {
+        return false;
+    }
+    const int lvl = sim_gpio_bkin((uint8_t)(t - s_tim));
+    return (lvl != 0) == ((bdtr & TIM_BDTR_BKP) != 0U);
+}
+
+static int8_t output_of(const tim_t* t, uint32_t ch) {
+    const TIM_TypeDef* r = regs(t);
+    if (!is_output(t, ch)) {
+        return -1;
+    }
+    const uint32_t ccer = r->CCER >> (4U * ch);
+    const bool en = (ccer & 1U) != 0U;
+    const int8_t level = (int8_t)(t->ref[ch] ^ ((ccer >> 1) & 1U));
+    if (!t->advanced || (r->BDTR & TIM_BDTR_MOE)) {
+        return en ? level : -1;
+    }
+    if ((r->BDTR & TIM_BDTR_OSSI) && en) {
+        return (int8_t)((r->CR2 >> (8U + 2U * ch)) & 1U); // OISx
+    }
+    return -1;
+}
+
+static void outputs(tim_t* t) {
+    for (uint32_t ch = 0; ch < 4U; ++ch) {
+        const int8_t o = output_of(t, ch);
+        if (o != t->out[ch]) {
+            t->out[ch] = o;
+            sim_gpio_changed();
+        }
+    }
+}
+
+static void pwm_refs(tim_t* t, uint32_t cnt) {
+    for (uint32_t ch = 0; ch < 4U; ++ch) {
+        const uint32_t m = oc_mode(t, ch);
+        if (m == OCM_PWM1 || m == OCM_PWM2) {
+            const uint8_t below = cnt < ccr_of(t, ch) ? 1U : 0U;
+            t->ref[ch] = m == OCM_PWM1 ? below : (uint8_t)!below;
+        }
+    }
+}
+
+static void shadows(tim_t* t) {
+    TIM_TypeDef* r = regs(t);
+    t->psc = r->PSC & 0xFFFFU;
+    t->arr = r->ARR & top(t);
+    for (uint32_t ch = 0; ch < 4U; ++ch) {
+        t->ccr[ch] = *ccr_reg(t, ch);
+    }
+    t->rep = t->advanced ? (r->RCR & 0xFFU) : 0U;
+}
+
+/* Counter overflow (or UG): the update event unless the repetition counter holds it back */
+static void update_event(tim_t* t, bool forced) {
+    TIM_TypeDef* r = regs(t);
+    if (r->CR1 & TIM_CR1_UDIS) {
+        return;
+    }
+    if (!forced && t->rep > 0U) {
+        t->rep--;
+        return;
+    }
+    shadows(t);
+    if (!forced || !(r->CR1 & TIM_CR1_URS)) {
+        r->SR |= TIM_SR_UIF;
+    }
+    if (!forced && (r->CR1 & TIM_CR1_OPM)) {
+        r->CR1 &= ~TIM_CR1_CEN;
+    }
+    if (t->advanced && (r->BDTR & TIM_BDTR_AOE) && !break_active(t)) {
+        r->BDTR |= TIM_BDTR_MOE;
+    }
+}
+
+static void compare_match(tim_t* t, uint32_t ch) {
+    regs(t)->SR |= TIM_SR_CC1IF << ch;
+    switch (oc_mode(t, ch)) {
+    case OCM_ACTIVE:
+        t->ref[ch] = 1;
+        break;
+    case OCM_INACTIVE:
+        t->ref[ch] = 0;
+        break;
+    case OCM_TOGGLE:
+        t->ref[ch] ^= 1U;
+        break;
+    default:
+        break; // frozen, forced; PWM follows the counter (pwm_refs)
+    }
+}
+
+/* Counts from cnt to the next match or overflow */
+static uint64_t counts_to_event(const tim_t* t, uint32_t cnt) {
+    const uint32_t limit = cnt <= t->arr ? t->arr : top(t);
+    uint64_t d = (uint64_t)limit - cnt + 1U;
+    for (uint32_t ch = 0; ch < 4U; ++ch) {
+        if (!is_output(t, ch)) {
+            continue;
+        }
+        const uint32_t c = ccr_of(t, ch);
+        if (c > cnt && c <= limit && c - cnt < d) {
+            d = c - cnt;
+        }
+    }
+    return d;
+}
+
+static void count(tim_t* t, uint64_t counts) {
+    TIM_TypeDef* r = regs(t);
+    uint32_t cnt = r->CNT & top(t);
+    while (counts > 0U && (r->CR1 & TIM_CR1_CEN)) {
+        const uint64_t d = counts_to_event(t, cnt);
+        if (d > counts) {
+            cnt += (uint32_t)counts;
+            break;
+        }
+        counts -= d;
+        const uint32_t limit = cnt <= t->arr ? t->arr : top(t);
+        if ((uint64_t)cnt + d > limit) {
+            cnt = 0;
+            update_event(t, false);
+        } else {
+            cnt += (uint32_t)d;
+        }
+        for (uint32_t ch = 0; ch < 4U; ++ch) {
+            if (is_output(t, ch) && ccr_of(t, ch) == cnt) {
+                compare_match(t, ch);
+            }
+        }
+        pwm_refs(t, cnt);
+        sim_st.events++;
+    }
+    r->CNT = cnt;
+    outputs(t);
+}
+
+uint64_t sim_tim_next(void) {
+    uint64_t next = SIM_NEVER;
+    for (uint32_t i = 0; i < N_TIM; ++i) {
+        const tim_t* t = &s_tim[i];
+        const TIM_TypeDef* r = regs(t);
+        if (!(r->CR1 & TIM_CR1_CEN)) {
+            continue;
+        }
+        const uint64_t per = (uint64_t)t->psc + 1U;
+        const uint64_t d = counts_to_event(t, r->CNT & top(t));
+        const uint64_t clocks = (per - t->pcnt) + (d - 1U) * per;
+        const uint64_t at = t->t_sync + clocks * sim_tim_clk_div(t->apb2);
+        next = at < next ? at : next;
+    }
+    return next;
+}
+
+void sim_tim_advance(uint64_t now) {
+    for (uint32_t i = 0; i < N_TIM; ++i) {
+        tim_t* t = &s_tim[i];
+        if (!(regs(t)->CR1 & TIM_CR1_CEN) || now <= t->t_sync) {
+            continue;
+        }
+        const uint32_t div = sim_tim_clk_div(t->apb2);
+        const uint64_t clocks = (now - t->t_sync) / div;
+        const uint64_t per = (uint64_t)t->psc + 1U;
+        t->t_sync += clocks * div;
+        const uint64_t total = t->pcnt + clocks;
+        t->pcnt = (uint32_t)(total % per);
+        count(t, total / per);
+    }
+}
+
+static void mode_written(tim_t* t, uint32_t ch, uint32_t old_field) {
+    const uint32_t m = oc_mode(t, ch);
+    if (m == ((old_field >> 4) & 7U)) {
+        return;
+    }
+    if (m == OCM_FORCE_LOW) {
+        t->ref[ch] = 0;
+    } else if (m == OCM_FORCE_HIGH) {
+        t->ref[ch] = 1;
+    } else if (m == OCM_PWM1 || m == OCM_PWM2) {
+        pwm_refs(t, regs(t)->CNT & top(t));
+    } // frozen / active / inactive / toggle keep the level they find
+}
+
+static void check_break(tim_t* t) {
+    TIM_TypeDef* r = regs(t);
+    if (break_active(t)) {
+        r->BDTR &= ~TIM_BDTR_MOE;
+        r->SR |= TIM_SR_BIF;
+    }
+}
+
+void sim_tim_write(uintptr_t a, uint32_t old) {
+    tim_t* t = NULL;
+    for (uint32_t i = 0; i < N_TIM; ++i) {
+        if ((a & ~(uintptr_t)0x3FFU) == s_tim[i].base) {
+            t = &s_tim[i];
+        }
+    }
+    if (t == NULL) {
+        return;
+    }
+    TIM_TypeDef* r = regs(t);
+    const uintptr_t off = a - t->base;
+    const uint32_t w = *sim_reg(a);
+
+    if (off == offsetof(TIM_TypeDef, CR1)) {
+        if (!(old & TIM_CR1_CEN) && (w & TIM_CR1_CEN)) {
+            t->t_sync = sim_t; // counting starts now, prescaler phase kept
+        }
+        if (!(w & TIM_CR1_ARPE)) {
+            t->arr = r->ARR & top(t);
+        }
+    } else if (off == offsetof(TIM_TypeDef, SR)) {
+        r->SR = old & w & 0x1FFFU; // rc_w0: writing 1 leaves a flag as it is
+        check_break(t);
+    } else if (off == offsetof(TIM_TypeDef, EGR)) {
+        r->EGR = 0;
+        if (w & TIM_EGR_UG) {
+            r->CNT = 0;
+            t->pcnt = 0;
+            t->t_sync = sim_t;
+            update_event(t, true);
+            pwm_refs(t, 0);
+        }
+        r->SR |= w & (TIM_EGR_CC1G | TIM_EGR_CC2G | TIM_EGR_CC3G | TIM_EGR_CC4G | TIM_EGR_TG);
+        if ((w & TIM_EGR_BG) && t->advanced) {
+            r->BDTR &= ~TIM_BDTR_MOE;
+            r->SR |= TIM_SR_BIF;
+        }
+    } else if (off == offsetof(TIM_TypeDef, CCMR1) || off == offsetof(TIM_TypeDef, CCMR2)) {
+        const uint32_t ch0 = off == offsetof(TIM_TypeDef, CCMR1) ? 0U : 2U;
+        mode_written(t, ch0, old & 0xFFU);
+        mode_written(t, ch0 + 1U, (old >> 8) & 0xFFU);
+    } else if (off == offsetof(TIM_TypeDef, CNT)) {
+        r->CNT = w & top(t);
+        pwm_refs(t, r->CNT);
+    } else if (off == offsetof(TIM_TypeDef, PSC)) {
+        r->PSC = w & 0xFFFFU; // takes effect at the next update event
+    } else if (off == offsetof(TIM_TypeDef, ARR)) {
+        r->ARR = w & top(t);
+        if (!(r->CR1 & TIM_CR1_ARPE)) {
+            t->arr = r->ARR;
+        }
+    } else if (off >= offsetof(TIM_TypeDef, CCR1) && off <= offsetof(TIM_TypeDef, CCR4)) {
+        *sim_reg(a) = w & top(t);
+        pwm_refs(t, r->CNT & top(t));
+    } else if (off == offsetof(TIM_TypeDef, BDTR)) {
+        check_break(t); // MOE cannot be set while the break input is active
+    }
+    outputs(t);
+}
+
+void sim_tim_break(void) {
+    for (uint32_t i = 0; i < N_TIM; ++i) {
+        if (s_tim[i].advanced) {
+            check_break(&s_tim[i]);
+            outputs(&s_tim[i]);
+        }
+    }
+}
+
+bool sim_tim_irq(int irqn) {
+    const TIM_TypeDef* r;
+    switch (irqn) {
+    case TIM1_CC_IRQn:
+        return (TIM1->SR & TIM1->DIER & 0x1EU) != 0U;
+    case TIM1_UP_TIM10_IRQn:
+        return (TIM1->SR & TIM1->DIER & TIM_SR_UIF) != 0U;
+    case TIM1_BRK_TIM9_IRQn:
+        return (TIM1->SR & TIM1->DIER & TIM_SR_BIF) != 0U;
+    case TIM1_TRG_COM_TIM11_IRQn:
+        return (TIM1->SR & TIM1->DIER & (TIM_SR_TIF | TIM_SR_COMIF)) != 0U;
+    case TIM2_IRQn:
+        r = TIM2;
+        break;
+    case TIM3_IRQn:
+        r = TIM3;
+        break;
+    case TIM4_IRQn:
+        r = TIM4;
+        break;
+    case TIM5_IRQn:
+        r = TIM5;
+        break;
+    default:
+        return false;
+    }
+    return (r->SR & r->DIER & 0x5FU) != 0U;
+}
+
+int sim_tim_output(uint8_t unit, uint8_t ch) {
+    return unit < N_TIM && ch < 4U ? s_tim[unit].out[ch] : -1;
+}
+
+void sim_tim_reset(void) {
+    for (uint32_t i = 0; i < N_TIM; ++i) {
+        tim_t* t = &s_tim[i];
+        regs(t)->ARR = top(t);
+        t->t_sync = sim_t;
+        t->pcnt = 0;
+        t->psc = 0;
+        t->arr = top(t);
+        t->rep = 0;
+        for (uint32_t ch = 0; ch < 4U; ++ch) {
+            t->ccr[ch] = 0;
+            t->ref[ch] = 0;
+            t->out[ch] = -1;
+        }
+    }
+}
@@ -0,0 +1,244 @@
+#include "sim_trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bsp_pins.h"
+
+/*
+Edges come from the emulator's pin watcher, so they carry the exact cycle the pin changed
+(a toggle on compare match, a BSRR store, the break input taking MOE away). The files are
+written after the run; nothing here touches the simulated chip.
+*/
+
+#define CYCLES_PER_US (SIM_HCLK_HZ / 1000000ULL)
+
+static const char AXIS_NAME[3] = {'x', 'y', 'z'};
+
+static void on_pin(void* ctx, uint8_t port, uint8_t pin, bool level, uint64_t t) {
+    sim_trace_t* tr = ctx;
+    for (uint8_t c = 0; c < tr->n_ch; ++c) {
+        if (sim_port_index(tr->ch[c].port) != port || tr->ch[c].pin != pin) {
+            continue;
+        }
+        if (tr->n == tr->cap) {
+            tr->dropped++;
+            return;
+        }
+        tr->edges[tr->n++] = (sim_trace_edge_t){t, c, level};
+    }
+}
+
+void sim_trace_init(sim_trace_t* tr, sim_trace_edge_t* buf, size_t cap) {
+    memset(tr, 0, sizeof *tr);
+    tr->edges = buf;
+    tr->cap = cap;
+}
+
+int sim_trace_add(sim_trace_t* tr, GPIO_TypeDef* port, uint8_t pin, const char* name) {
+    if (tr->n_ch == SIM_TRACE_MAX_CH) {
+        return -1;
+    }
+    const uint8_t c = tr->n_ch++;
+    tr->ch[c].port = port;
+    tr->ch[c].pin = pin;
+    snprintf(tr->ch[c].name, sizeof tr->ch[c].name, "%s", name);
+    return c;
+}
+
+void sim_trace_add_axes(sim_trace_t* tr) {
+    // Same pins as the stepgen's AXIS_HW table
+    static const struct {
+        GPIO_TypeDef* port;
+        uint8_t pin;
+    } PINS[9] = {
+            {X_STEP_PORT, X_STEP_PIN}, {X_DIR_PORT, X_DIR_PIN}, {X_EN_PORT, X_EN_PIN},
+            {Y_STEP_PORT, Y_STEP_PIN}, {Y_DIR_PORT, Y_DIR_PIN}, {Y_EN_PORT, Y_EN_PIN},
+            {Z_STEP_PORT, Z_STEP_PIN}, {Z_DIR_PORT, Z_DIR_PIN}, {Z_EN_PORT, Z_EN_PIN},
+    };
+    static const char* const KIND[3] = {"step", "dir", "en"};
+    if (tr->n_ch != 0U) {
+        return; // the fixed layout needs channels 0..8
+    }
+    for (int i = 0; i < 9; ++i) {
+        char name[16];
+        snprintf(name, sizeof name, "%c_%s", AXIS_NAME[i / 3], KIND[i % 3]);
+        sim_trace_add(tr, PINS[i].port, PINS[i].pin, name);
+    }
+    tr->axes = true;
+}
+
+static void snapshot(sim_trace_t* tr) {
+    // Levels first: reading a pin settles the stores still pending, and the edges those
+    // produce belong to the window being discarded
+    for (uint8_t c = 0; c < tr->n_ch; ++c) {
+        tr->ch[c].level0 = sim_pin(tr->ch[c].port, tr->ch[c].pin);
+    }
+    tr->n = 0;
+    tr->dropped = 0;
+    tr->t0 = sim_now();
+    tr->t_end = tr->t0;
+}
+
+bool sim_trace_start(sim_trace_t* tr) {
+    snapshot(tr);
+    tr->on = sim_pin_watch(on_pin, tr);
+    return tr->on;
+}
+
+void sim_trace_stop(sim_trace_t* tr) {
+    if (tr->on) {
+        sim_pin_unwatch(on_pin, tr);
+        tr->on = false;
+    }
+    tr->t_end = sim_now();
+}
+
+void sim_trace_clear(sim_trace_t* tr) {
+    snapshot(tr);
+}
+
+void sim_trace_stats(const sim_trace_t* tr, int step_ch, int dir_ch, sim_trace_stats_t* out) {
+    memset(out, 0, sizeof *out);
+    out->interval_min = UINT64_MAX;
+    out->high_min = UINT64_MAX;
+    out->dir_setup_min = UINT64_MAX;
+    uint64_t last_rise = 0, sum = 0, prev_iv = 0, dir_at = 0;
+    bool have_iv = false, dir_moved = false;
+    for (size_t i = 0; i < tr->n; ++i) {
+        const sim_trace_edge_t* e = &tr->edges[i];
+        if ((int)e->ch == dir_ch) {
+            dir_at = e->t;
+            dir_moved = true;
+            continue;
+        }
+        if ((int)e->ch != step_ch) {
+            continue;
+        }
+        if (!e->level) {
+            if (out->rises != 0U && e->t - last_rise < out->high_min) {
+                out->high_min = e->t - last_rise;
+            }
+            continue;
+        }
+        if (dir_moved) {
+            const uint64_t setup = e->t - dir_at;
+            out->dir_setup_min = setup < out->dir_setup_min ? setup : out->dir_setup_min;
+            dir_moved = false;
+        }
+        if (out->rises != 0U) {
+            const uint64_t iv = e->t - last_rise;
+            out->interval_min = iv < out->interval_min ? iv : out->interval_min;
+            out->interval_max = iv > out->interval_max ? iv : out->interval_max;
+            sum += iv;
+            if (have_iv) {
+                const int64_t j = (int64_t)iv - (int64_t)prev_iv;
+                out->jitter_min = j < out->jitter_min ? j : out->jitter_min;
+                out->jitter_max = j > out->jitter_max ? j : out->jitter_max;
+            }
+            prev_iv = iv;
+            have_iv = true;
+        }
+        last_rise = e->t;
+        out->rises++;
+    }
+    if (out->rises > 1U) {
+        out->interval_mean = (double)sum / (double)(out->rises - 1U);
+    } else {
+        out->interval_min = 0;
+    }
+    if (out->high_min == UINT64_MAX) {
+        out->high_min = 0;
+    }
+}
+
+/* ---- Files ---- */
+
+static uint64_t to_ns(uint64_t cycles) {
+    return (cycles * 1000U + CYCLES_PER_US / 2U) / CYCLES_PER_US;
+}
+
+static double to_us(double cycles) {
+    return cycles / (double)CYCLES_PER_US;
+}
+
+bool sim_trace_write_vcd(const sim_trace_t* tr, const char* path) {
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        return false;
+    }
+    fprintf(f, "$date simulated $end\n$version stm32_sim trace $end\n$timescale 1ns $end\n");
+    fprintf(f, "$scope module stm32f446 $end\n");
+    for (uint8_t c = 0; c < tr->n_ch; ++c) {
+        fprintf(f, "$var wire 1 %c %s $end\n", '!' + c, tr->ch[c].name);
+    }
+    fprintf(f, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n");
+    for (uint8_t c = 0; c < tr->n_ch; ++c) {
+        fprintf(f, "%d%c\n", tr->ch[c].level0 ? 1 : 0, '!' + c);
+    }
+    fprintf(f, "$end\n");
+    uint64_t last = UINT64_MAX;
+    for (size_t i = 0; i < tr->n; ++i) {
+        const sim_trace_edge_t* e = &tr->edges[i];
+        const uint64_t ns = to_ns(e->t - tr->t0);
+        if (ns != last) {
+            fprintf(f, "#%llu\n", (unsigned long long)ns);
+            last = ns;
+        }
+        fprintf(f, "%d%c\n", e->level, '!' + e->ch);
+    }
+    const uint64_t end = to_ns((tr->on ? sim_now() : tr->t_end) - tr->t0);
+    if (last == UINT64_MAX || end > last) {
+        fprintf(f, "#%llu\n", (unsigned long long)end); // the window's end, for the viewer
+    }
+    return fclose(f) == 0;
+}
+
+bool sim_trace_write_summary_csv(const sim_trace_t* tr, const char* path) {
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        return false;
+    }
+    fprintf(f, "axis,rises,interval_min_us,interval_max_us,interval_mean_us,"
+               "jitter_min_us,jitter_max_us,high_min_us,dir_setup_min_us\n");
+    for (int a = 0; tr->axes && a < 3; ++a) {
+        sim_trace_stats_t s;
+        sim_trace_stats(tr, SIM_TRACE_CH(a, SIM_TRACE_STEP), SIM_TRACE_CH(a, SIM_TRACE_DIR), &s);
+        fprintf(f, "%c,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,", AXIS_NAME[a], s.rises,
+                to_us((double)s.interval_min), to_us((double)s.interval_max),
+                to_us(s.interval_mean), to_us((double)s.jitter_min),
+                to_us((double)s.jitter_max), to_us((double)s.high_min));
+        if (s.dir_setup_min == UINT64_MAX) {
+            fprintf(f, "\n"); // DIR never moved
+        } else {
+            fprintf(f, "%.3f\n", to_us((double)s.dir_setup_min));
+        }
+    }
+    return fclose(f) == 0;
+}
+
+bool sim_trace_write_intervals_csv(const sim_trace_t* tr, const char* path) {
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        return false;
+    }
+    fprintf(f, "axis,t_us,interval_us\n");
+    uint64_t last[3] = {0, 0, 0};
+    bool seen[3] = {false, false, false};
+    for (size_t i = 0; tr->axes && i < tr->n; ++i) {
+        const sim_trace_edge_t* e = &tr->edges[i];
+        const int a = e->ch / 3;
+        if (a >= 3 || e->ch % 3 != SIM_TRACE_STEP || !e->level) {
+            continue;
+        }
+        fprintf(f, "%c,%.3f,", AXIS_NAME[a], to_us((double)(e->t - tr->t0)));
+        if (seen[a]) {
+            fprintf(f, "%.3f\n", to_us((double)(e->t - last[a])));
+        } else {
+            fprintf(f, "\n"); // first rise of the axis
+        }
+        last[a] = e->t;
+        seen[a] = true;
+    }
+    return fclose(f) == 0;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stm32_sim.h"
+
+/**
+ * Pin trace recorder on top of the emulator: every level change of the registered pins with
+ * its cycle stamp, into a buffer the caller owns. Export as a Value Change Dump (GTKWave)
+ * and as CSV (per-axis pulse summary, every interval), or query the summary directly to
+ * catch step-timing regressions in a test.
+ *
+ *     static sim_trace_edge_t buf[65536];
+ *     sim_trace_t tr;
+ *     sim_trace_init(&tr, buf, 65536);
+ *     sim_trace_add_axes(&tr); // STEP / DIR / EN of X, Y, Z (the stepgen's AXIS_HW pins)
+ *     sim_trace_start(&tr);
+ *     ... sim_run() ...
+ *     sim_trace_stop(&tr);
+ *     sim_trace_write_vcd(&tr, "move.vcd");
+ *
+ * Record one move per trace (or sim_trace_clear() between them): the interval statistics
+ * run across every rise recorded, idle gaps included.
+ */
+
+#define SIM_TRACE_MAX_CH 16U
+
+typedef struct {
+    uint64_t t; // core cycles (sim_now())
+    uint8_t ch;
+    uint8_t level;
+} sim_trace_edge_t;
+
+typedef struct {
+    struct {
+        GPIO_TypeDef* port;
+        uint8_t pin;
+        bool level0; // level when recording started
+        char name[16];
+    } ch[SIM_TRACE_MAX_CH];
+    uint8_t n_ch;
+    bool axes; // channels 0..8 are sim_trace_add_axes()'s
+    sim_trace_edge_t* edges;
+    size_t n, cap;
+    uint32_t dropped; // edges lost to a full buffer
+    uint64_t t0, t_end; // recording window
+    bool on;
+} sim_trace_t;
+
+void sim_trace_init(sim_trace_t* tr, sim_trace_edge_t* buf, size_t cap);
+// Channel index, -1 if the table is full. Names become VCD signal names (no spaces).
+int sim_trace_add(sim_trace_t* tr, GPIO_TypeDef* port, uint8_t pin, const char* name);
+
+// STEP, DIR, EN of X, Y, Z from bsp_pins.h, as channel SIM_TRACE_CH(axis, kind)
+enum { SIM_TRACE_STEP = 0, SIM_TRACE_DIR, SIM_TRACE_EN };
+#define SIM_TRACE_CH(axis, kind) ((int)(axis) * 3 + (kind))
+void sim_trace_add_axes(sim_trace_t* tr);
+
+bool sim_trace_start(sim_trace_t* tr); // false if every emulator watcher slot is taken
+void sim_trace_stop(sim_trace_t* tr);
+void sim_trace_clear(sim_trace_t* tr); // forget the edges, keep recording from now
+
+/* Pulse train on a STEP channel (all times in core cycles) */
+typedef struct {
+    uint32_t rises;
+    uint64_t interval_min, interval_max; // rise to rise
+    double interval_mean;
+    int64_t jitter_min, jitter_max; // interval minus the one before it (0 / 0 at a constant rate)
+    uint64_t high_min; // shortest pulse (rise to fall)
+    uint64_t dir_setup_min; // DIR change to the next rise; UINT64_MAX if DIR never moved
+} sim_trace_stats_t;
+
+// dir_ch < 0: no DIR channel (dir_setup_min stays UINT64_MAX)
+void sim_trace_stats(const sim_trace_t* tr, int step_ch, int dir_ch, sim_trace_stats_t* out);
+
+// Files: true on success. Times in the files are in microseconds (VCD: 1 ns resolution).
+bool sim_trace_write_vcd(const sim_trace_t* tr, const char* path);
+// One row per axis added by sim_trace_add_axes(): the pulse summary above
+bool sim_trace_write_summary_csv(const sim_trace_t* tr, const char* path);
+// One row per STEP rise: axis, time, interval since the previous rise on that axis
+bool sim_trace_write_intervals_csv(const sim_trace_t* tr, const char* path);
@@ -0,0 +1,315 @@
+#include <stddef.h>
+
+#include "sim_internal.h"
+
+/*
+USART2 and the two DMA1 streams wired to it (stream 5 / channel 4 RX, stream 6 / channel 4
+TX), byte level: a frame takes (start + 8 or 9 data + stop) bit times at the programmed BRR.
+
+TX: DR -> TDR -> shift register, TXE / TC as on the chip. RX: bytes queued by the test
+arrive back to back; RXNE, ORE when the previous one was not read, IDLE one frame after a
+burst. SR-then-DR reads clear IDLE / ORE. With CR3.DMAR / DMAT the streams move bytes between
+DR and memory (byte wide, MINC, CIRC, HT / TC flags). M0AR holds a 32-bit address, so the
+test binary is linked without PIE: its static buffers then sit below 4 GiB.
+*/
+
+#define RXQ_LEN 65536U // power of two
+#define TXQ_LEN 65536U
+#define RX_STREAM 5U
+#define TX_STREAM 6U
+#define USART2_DMA_CH 4U
+
+static uint8_t s_rxq[RXQ_LEN];
+static uint32_t s_rxq_head, s_rxq_tail;
+static uint8_t s_txq[TXQ_LEN];
+static uint32_t s_txq_head, s_txq_tail;
+
+static uint64_t s_tx_end; // shift register busy until
+static uint16_t s_shift; // frame on the line
+static uint16_t s_tdr;
+static bool s_tdr_full;
+static uint64_t s_rx_at; // next byte on the line
+static uint64_t s_idle_at;
+static uint16_t s_rdr;
+static bool s_sr_read; // first half of the SR-then-DR clear sequence
+static uint32_t s_dma_idx[8]; // memory offset of each stream
+static uint32_t s_dma_len[8]; // NDTR at enable (circular reload)
+
+static uint64_t frame(void) {
+    const uint32_t brr = USART2->BRR & 0xFFFFU;
+    uint32_t div = (USART2->CR1 & USART_CR1_OVER8) ? (((brr >> 1) & ~7U) | (brr & 7U)) : brr;
+    div = div == 0U ? 1U : div;
+    const uint32_t bits = (USART2->CR1 & USART_CR1_M) ? 11U : 10U;
+    return (uint64_t)bits * div * sim_pclk_div(false);
+}
+
+static inline bool tx_on(void) {
+    return (USART2->CR1 & (USART_CR1_UE | USART_CR1_TE)) == (USART_CR1_UE | USART_CR1_TE);
+}
+
+static inline bool rx_on(void) {
+    return (USART2->CR1 & (USART_CR1_UE | USART_CR1_RE)) == (USART_CR1_UE | USART_CR1_RE);
+}
+
+/* ---- DMA1 ---- */
+
+static inline DMA_Stream_TypeDef* stream(uint32_t s) {
+    return (DMA_Stream_TypeDef*)(DMA1_BASE + 0x10U + 0x18U * s);
+}
+
+static inline volatile uint32_t* isr_of(uint32_t s) {
+    return s < 4U ? &DMA1->LISR : &DMA1->HISR;
+}
+
+static inline uint32_t flag_shift(uint32_t s) {
+    static const uint8_t SHIFT[4] = {0, 6, 16, 22};
+    return SHIFT[s & 3U];
+}
+
+static bool stream_ready(uint32_t s, uint32_t dir) {
+    const uint32_t cr = stream(s)->CR;
+    return (cr & DMA_SxCR_EN) && ((cr & DMA_SxCR_CHSEL) >> DMA_SxCR_CHSEL_Pos) == USART2_DMA_CH
+           && (cr & DMA_SxCR_DIR) == dir && stream(s)->NDTR != 0U;
+}
+
+static uint8_t* stream_mem(uint32_t s) {
+    DMA_Stream_TypeDef* st = stream(s);
+    const uint32_t off = (st->CR & DMA_SxCR_MINC) ? s_dma_idx[s] : 0U;
+    return (uint8_t*)(uintptr_t)(st->M0AR + off);
+}
+
+/* One item moved: count it down, flag half / full, reload or finish */
+static void stream_step(uint32_t s) {
+    DMA_Stream_TypeDef* st = stream(s);
+    const uint32_t left = st->NDTR - 1U;
+    s_dma_idx[s]++;
+    if (left == s_dma_len[s] / 2U) {
+        *isr_of(s) |= DMA_LISR_HTIF0 << flag_shift(s);
+    }
+    if (left == 0U) {
+        *isr_of(s) |= DMA_LISR_TCIF0 << flag_shift(s);
+        if (st->CR & DMA_SxCR_CIRC) {
+            st->NDTR = s_dma_len[s];
+            s_dma_idx[s] = 0;
+            return;
+        }
+        st->CR &= ~DMA_SxCR_EN;
+    }
+    st->NDTR = left;
+}
+
+static void tx_write(uint16_t v);
+
+static void dma_service(void) {
+    if ((USART2->CR3 & USART_CR3_DMAR) && (USART2->SR & USART_SR_RXNE)
+        && stream_ready(RX_STREAM, 0U)) {
+        *stream_mem(RX_STREAM) = (uint8_t)s_rdr;
+        USART2->SR &= ~USART_SR_RXNE; // the DMA's read of DR
+        stream_step(RX_STREAM);
+    }
+    while ((USART2->CR3 & USART_CR3_DMAT) && (USART2->SR & USART_SR_TXE)
+           && stream_ready(TX_STREAM, DMA_SxCR_DIR_0)) {
+        const uint8_t b = *stream_mem(TX_STREAM);
+        stream_step(TX_STREAM);
+        tx_write(b);
+    }
+}
+
+static void dma_write(uintptr_t a, uint32_t old) {
+    const uintptr_t off = a - DMA1_BASE;
+    const uint32_t w = *sim_reg(a);
+    if (off == offsetof(DMA_TypeDef, LISR) || off == offsetof(DMA_TypeDef, HISR)) {
+        *sim_reg(a) = old; // read-only
+    } else if (off == offsetof(DMA_TypeDef, LIFCR)) {
+        DMA1->LISR &= ~w;
+        DMA1->LIFCR = 0;
+    } else if (off == offsetof(DMA_TypeDef, HIFCR)) {
+        DMA1->HISR &= ~w;
+        DMA1->HIFCR = 0;
+    } else if (off >= 0x10U && ((off - 0x10U) % 0x18U) == 0U) { // SxCR
+        const uint32_t s = (uint32_t)(off - 0x10U) / 0x18U;
+        if (!(old & DMA_SxCR_EN) && (w & DMA_SxCR_EN)) {
+            s_dma_len[s] = stream(s)->NDTR & 0xFFFFU;
+            s_dma_idx[s] = 0;
+        }
+    }
+    dma_service();
+}
+
+/* ---- USART2 ---- */
+
+static void rx_kick(void) {
+    if (s_rx_at == SIM_NEVER && s_rxq_head != s_rxq_tail && rx_on()) {
+        s_rx_at = sim_t + frame();
+    }
+}
+
+static void tx_write(uint16_t v) {
+    if (!tx_on()) {
+        return;
+    }
+    USART2->SR &= ~USART_SR_TC;
+    if (s_tx_end == SIM_NEVER) {
+        s_shift = v;
+        s_tx_end = sim_t + frame(); // straight into the shift register, TXE stays set
+        return;
+    }
+    s_tdr = v; // waits in TDR behind the frame on the line
+    s_tdr_full = true;
+    USART2->SR &= ~USART_SR_TXE;
+}
+
+/* The frame in the shift register has left the pin */
+static void tx_done(void) {
+    if (s_txq_head - s_txq_tail < TXQ_LEN) {
+        s_txq[s_txq_head++ & (TXQ_LEN - 1U)] = (uint8_t)s_shift;
+    }
+    if (s_tdr_full) {
+        s_shift = s_tdr;
+        s_tdr_full = false;
+        s_tx_end += frame();
+        USART2->SR |= USART_SR_TXE;
+    } else {
+        s_tx_end = SIM_NEVER;
+        USART2->SR |= USART_SR_TC;
+    }
+}
+
+/* A byte has arrived: RDR, or an overrun if the last one is still unread */
+static void rx_done(void) {
+    const uint8_t b = s_rxq[s_rxq_tail++ & (RXQ_LEN - 1U)];
+    if (USART2->SR & USART_SR_RXNE) {
+        USART2->SR |= USART_SR_ORE;
+    } else {
+        s_rdr = b;
+        USART2->DR = b;
+        USART2->SR |= USART_SR_RXNE;
+    }
+    s_idle_at = s_rx_at + frame();
+    s_rx_at = s_rxq_head != s_rxq_tail && rx_on() ? s_rx_at + frame() : SIM_NEVER;
+}
+
+uint64_t sim_usart_next(void) {
+    uint64_t t = s_tx_end;
+    t = s_rx_at < t ? s_rx_at : t;
+    return s_idle_at < t ? s_idle_at : t;
+}
+
+void sim_usart_advance(uint64_t t) {
+    bool moved = false;
+    if (s_tx_end <= t) {
+        tx_done();
+        moved = true;
+    }
+    if (s_rx_at <= t) {
+        rx_done();
+        moved = true;
+    }
+    if (s_idle_at <= t) {
+        s_idle_at = SIM_NEVER;
+        if (s_rx_at == SIM_NEVER) {
+            USART2->SR |= USART_SR_IDLE;
+        }
+        moved = true;
+    }
+    if (moved) {
+        sim_st.events++;
+        dma_service();
+    }
+}
+
+void sim_usart_write(uintptr_t a, uint32_t old) {
+    if (a >= DMA1_BASE && a < DMA1_BASE + 0x400U) {
+        dma_write(a, old);
+        return;
+    }
+    const uintptr_t off = a - USART2_BASE;
+    const uint32_t w = *sim_reg(a);
+    if (off == offsetof(USART_TypeDef, SR)) {
+        const uint32_t rc_w0 = USART_SR_CTS | USART_SR_LBD | USART_SR_TC | USART_SR_RXNE;
+        USART2->SR = old & (w | ~rc_w0);
+    } else if (off == offsetof(USART_TypeDef, DR)) {
+        USART2->DR = s_rdr; // DR reads RDR; the write went to TDR
+        tx_write((uint16_t)(w & 0x1FFU));
+    } else if (off == offsetof(USART_TypeDef, CR1)) {
+        rx_kick();
+    }
+    dma_service();
+}
+
+void sim_usart_read(uintptr_t a) {
+    if (a == (uintptr_t)&USART2->SR) {
+        s_sr_read = true;
+    } else if (a == (uintptr_t)&USART2->DR) {
+        USART2->SR &= ~USART_SR_RXNE;
+        if (s_sr_read) {
+            USART2->SR &= ~(USART_SR_IDLE | USART_SR_ORE);
+        }
+        s_sr_read = false;
+    }
+}
+
+bool sim_usart_irq(int irqn) {
+    if (irqn == USART2_IRQn) {
+        const uint32_t sr = USART2->SR;
+        const uint32_t cr1 = USART2->CR1;
+        return ((cr1 & USART_CR1_TXEIE) && (sr & USART_SR_TXE))
+               || ((cr1 & USART_CR1_TCIE) && (sr & USART_SR_TC))
+               || ((cr1 & USART_CR1_RXNEIE) && (sr & (USART_SR_RXNE | USART_SR_ORE)))
+               || ((cr1 & USART_CR1_IDLEIE) && (sr & USART_SR_IDLE));
+    }
+    uint32_t s;
+    if (irqn == DMA1_Stream5_IRQn) {
+        s = RX_STREAM;
+    } else if (irqn == DMA1_Stream6_IRQn) {
+        s = TX_STREAM;
+    } else {
+        return false;
+    }
+    const uint32_t flags = (*isr_of(s) >> flag_shift(s)) & 0x3DU;
+    const uint32_t cr = stream(s)->CR;
+    const uint32_t en = ((cr & DMA_SxCR_TCIE) ? DMA_LISR_TCIF0 : 0U)
+                        | ((cr & DMA_SxCR_HTIE) ? DMA_LISR_HTIF0 : 0U)
+                        | ((cr & DMA_SxCR_TEIE) ? DMA_LISR_TEIF0 : 0U)
+                        | ((cr & DMA_SxCR_DMEIE) ? DMA_LISR_DMEIF0 : 0U);
+    return (flags & en) != 0U;
+}
+
+int sim_usart_tx_pin(void) {
+    return tx_on() ? 1 : -1; // frames are not drawn on the pin: it idles high
+}
+
+void sim_usart_reset(void) {
+    USART2->SR = USART_SR_TXE | USART_SR_TC;
+    s_rxq_head = s_rxq_tail = 0;
+    s_txq_head = s_txq_tail = 0;
+    s_tx_end = SIM_NEVER;
+    s_tdr_full = false;
+    s_rx_at = SIM_NEVER;
+    s_idle_at = SIM_NEVER;
+    s_rdr = 0;
+    s_sr_read = false;
+    for (uint32_t s = 0; s < 8U; ++s) {
+        s_dma_idx[s] = 0;
+        s_dma_len[s] = 0;
+    }
+}
+
+/* ---- API ---- */
+
+void sim_uart_rx(const void* data, size_t n) {
+    const uint8_t* p = data;
+    for (size_t i = 0; i < n && s_rxq_head - s_rxq_tail < RXQ_LEN; ++i) {
+        s_rxq[s_rxq_head++ & (RXQ_LEN - 1U)] = p[i];
+    }
+    rx_kick();
+}
+
+size_t sim_uart_tx(void* out, size_t max) {
+    uint8_t* p = out;
+    size_t n = 0;
+    while (n < max && s_txq_tail != s_txq_head) {
+        p[n++] = s_txq[s_txq_tail++ & (TXQ_LEN - 1U)];
+    }
+    return n;
+}
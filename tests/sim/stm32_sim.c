@@ -0,0 +1,863 @@
+#define _GNU_SOURCE
+
+#include "stm32_sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "sim_internal.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+/*
+Core of the emulator: the register map, time, the NVIC / SysTick / DWT / RCC models and the
+bus. The drivers are built with -fsanitize=thread (without its runtime), so every load and
+store calls one of the __tsan_* hooks at the bottom of this file first. A store to a register
+is only recorded there (address + old value); the next access, or the end of a handler,
+applies it: the peripheral model sees the old and new value and fixes the register up
+(BSRR -> ODR, rc_w0 / rc_w1 flags, ...), then pending interrupts are dispatched.
+*/
+
+#define PERIPH_LO 0x40000000UL
+#define PERIPH_LEN 0x80000UL // APB1, APB2, AHB1 (GPIO, RCC, DMA)
+#define CORE_LO 0xE0000000UL
+#define CORE_LEN 0x100000UL // DWT, SysTick, NVIC, SCB, CoreDebug
+
+#define EXC_SYSTICK (-1)
+#define PRIO_THREAD 0x100U
+#define SPIN_REPEATS 32U // re-reads of the same volatiles with no write in between: a poll
+#define STORM_LIMIT 10000000U // handlers run without time moving: an interrupt never cleared
+
+uint64_t sim_t;
+sim_stats_t sim_st;
+uint32_t SystemCoreClock = 16000000U; // the firmware sets it in system_clock_init()
+
+static bool s_mapped;
+
+/* ---------------- Vectors ---------------- */
+
+#define WEAK_HANDLER(name) extern void name(void) __attribute__((weak));
+WEAK_HANDLER(SysTick_Handler)
+WEAK_HANDLER(EXTI0_IRQHandler)
+WEAK_HANDLER(EXTI1_IRQHandler)
+WEAK_HANDLER(EXTI2_IRQHandler)
+WEAK_HANDLER(EXTI3_IRQHandler)
+WEAK_HANDLER(EXTI4_IRQHandler)
+WEAK_HANDLER(DMA1_Stream5_IRQHandler)
+WEAK_HANDLER(DMA1_Stream6_IRQHandler)
+WEAK_HANDLER(EXTI9_5_IRQHandler)
+WEAK_HANDLER(TIM1_BRK_TIM9_IRQHandler)
+WEAK_HANDLER(TIM1_UP_TIM10_IRQHandler)
+WEAK_HANDLER(TIM1_TRG_COM_TIM11_IRQHandler)
+WEAK_HANDLER(TIM1_CC_IRQHandler)
+WEAK_HANDLER(TIM2_IRQHandler)
+WEAK_HANDLER(TIM3_IRQHandler)
+WEAK_HANDLER(TIM4_IRQHandler)
+WEAK_HANDLER(USART2_IRQHandler)
+WEAK_HANDLER(EXTI15_10_IRQHandler)
+WEAK_HANDLER(TIM5_IRQHandler)
+
+enum { SRC_CORE = 0, SRC_TIM, SRC_GPIO, SRC_USART }; // the model behind an interrupt line
+
+typedef struct {
+    int8_t irqn;
+    uint8_t src;
+    void (*fn)(void);
+} vec_t;
+
+// Every interrupt a modelled peripheral can raise, in vector order (lower number wins a tie)
+static const vec_t VEC[] = {
+        {EXC_SYSTICK, SRC_CORE, SysTick_Handler},
+        {EXTI0_IRQn, SRC_GPIO, EXTI0_IRQHandler},
+        {EXTI1_IRQn, SRC_GPIO, EXTI1_IRQHandler},
+        {EXTI2_IRQn, SRC_GPIO, EXTI2_IRQHandler},
+        {EXTI3_IRQn, SRC_GPIO, EXTI3_IRQHandler},
+        {EXTI4_IRQn, SRC_GPIO, EXTI4_IRQHandler},
+        {DMA1_Stream5_IRQn, SRC_USART, DMA1_Stream5_IRQHandler},
+        {DMA1_Stream6_IRQn, SRC_USART, DMA1_Stream6_IRQHandler},
+        {EXTI9_5_IRQn, SRC_GPIO, EXTI9_5_IRQHandler},
+        {TIM1_BRK_TIM9_IRQn, SRC_TIM, TIM1_BRK_TIM9_IRQHandler},
+        {TIM1_UP_TIM10_IRQn, SRC_TIM, TIM1_UP_TIM10_IRQHandler},
+        {TIM1_TRG_COM_TIM11_IRQn, SRC_TIM, TIM1_TRG_COM_TIM11_IRQHandler},
+        {TIM1_CC_IRQn, SRC_TIM, TIM1_CC_IRQHandler},
+        {TIM2_IRQn, SRC_TIM, TIM2_IRQHandler},
+        {TIM3_IRQn, SRC_TIM, TIM3_IRQHandler},
+        {TIM4_IRQn, SRC_TIM, TIM4_IRQHandler},
+        {USART2_IRQn, SRC_USART, USART2_IRQHandler},
+        {EXTI15_10_IRQn, SRC_GPIO, EXTI15_10_IRQHandler},
+        {TIM5_IRQn, SRC_TIM, TIM5_IRQHandler},
+};
+#define N_VEC (sizeof VEC / sizeof VEC[0])
+
+/* ---------------- CPU: masks, priorities, dispatch ---------------- */
+
+static uint32_t s_exec = PRIO_THREAD; // priority of what is running (thread: lowest)
+static uint32_t s_basepri;
+static uint32_t s_primask;
+static bool s_systick_pend;
+static uint32_t s_storm;
+
+static inline uint32_t nvic_bit(int irqn) {
+    return 1UL << ((uint32_t)irqn & 31U);
+}
+
+static bool irq_enabled(int irqn) {
+    return (NVIC->ISER[(uint32_t)irqn >> 5] & nvic_bit(irqn)) != 0U;
+}
+
+static bool irq_latched(int irqn) {
+    return (NVIC->ISPR[(uint32_t)irqn >> 5] & nvic_bit(irqn)) != 0U;
+}
+
+static void irq_unlatch(int irqn) {
+    const uint32_t i = (uint32_t)irqn >> 5;
+    const uint32_t v = NVIC->ISPR[i] & ~nvic_bit(irqn);
+    NVIC->ISPR[i] = v;
+    NVIC->ICPR[i] = v;
+}
+
+static void irq_active(int irqn, bool on) {
+    const uint32_t i = (uint32_t)irqn >> 5;
+    NVIC->IABR[i] = on ? (NVIC->IABR[i] | nvic_bit(irqn)) : (NVIC->IABR[i] & ~nvic_bit(irqn));
+}
+
+static uint32_t prio_of(int irqn) {
+    const uint8_t raw = irqn == EXC_SYSTICK ? SCB->SHP[11] : NVIC->IP[irqn];
+    return (uint32_t)raw & (0xFFUL << (8U - __NVIC_PRIO_BITS)) & 0xFFU;
+}
+
+static uint32_t s_vec_on; // VEC entries enabled in the NVIC (bit i = VEC[i]), SysTick always
+
+static void vec_refresh(void) {
+    s_vec_on = 0;
+    for (uint32_t i = 0; i < N_VEC; ++i) {
+        if (VEC[i].irqn == EXC_SYSTICK || irq_enabled(VEC[i].irqn)) {
+            s_vec_on |= 1UL << i;
+        }
+    }
+}
+
+static bool pending(const vec_t* v) {
+    if (v->irqn == EXC_SYSTICK) {
+        return s_systick_pend;
+    }
+    if (irq_latched(v->irqn)) {
+        return true;
+    }
+    switch (v->src) {
+    case SRC_TIM:
+        return sim_tim_irq(v->irqn);
+    case SRC_GPIO:
+        return sim_gpio_irq(v->irqn);
+    case SRC_USART:
+        return sim_usart_irq(v->irqn);
+    default:
+        return false;
+    }
+}
+
+static bool may_preempt(uint32_t prio) {
+    return prio < s_exec && !s_primask && (s_basepri == 0U || prio < s_basepri);
+}
+
+// Polling detection: distinct volatiles read since the last volatile store, and re-reads.
+// Each handler gets its own; the code it interrupted carries on with its own afterwards.
+typedef struct {
+    uintptr_t seen[8];
+    uint32_t n;
+    uint32_t repeats;
+    bool reg; // one of them is a register
+} poll_t;
+
+static poll_t s_poll;
+
+void sim_bus_flush(void);
+
+static void run_handler(const vec_t* v, uint32_t prio) {
+    const uint32_t saved = s_exec;
+    if (v->irqn == EXC_SYSTICK) {
+        s_systick_pend = false;
+    } else {
+        irq_unlatch(v->irqn);
+        irq_active(v->irqn, true);
+    }
+    s_exec = prio;
+    sim_st.irqs++;
+    if (++s_storm > STORM_LIMIT) {
+        fprintf(stderr, "sim: IRQ %d keeps firing without time moving\n", v->irqn);
+        abort();
+    }
+    const poll_t outer = s_poll;
+    memset(&s_poll, 0, sizeof s_poll);
+    v->fn();
+    sim_bus_flush(); // the handler's last store lands before the exception return
+    s_poll = outer;
+    s_exec = saved;
+    if (v->irqn != EXC_SYSTICK) {
+        irq_active(v->irqn, false);
+    }
+}
+
+/* Take every pending exception allowed to preempt what runs now, highest priority first */
+static void dispatch(void) {
+    for (;;) {
+        const vec_t* best = NULL;
+        uint32_t best_prio = PRIO_THREAD;
+        for (uint32_t m = s_vec_on; m != 0U; m &= m - 1U) {
+            const vec_t* v = &VEC[__builtin_ctz(m)];
+            if (!pending(v)) {
+                continue;
+            }
+            const uint32_t p = prio_of(v->irqn);
+            if (p < best_prio) {
+                best = v;
+                best_prio = p;
+            }
+        }
+        if (best == NULL || !may_preempt(best_prio)) {
+            return;
+        }
+        if (best->fn == NULL) { // nothing linked in: count it and switch the source off
+            sim_st.unhandled_irqs++;
+            if (best->irqn == EXC_SYSTICK) {
+                s_systick_pend = false;
+            } else {
+                const uint32_t i = (uint32_t)best->irqn >> 5;
+                NVIC->ISER[i] &= ~nvic_bit(best->irqn);
+                NVIC->ICER[i] = NVIC->ISER[i];
+                irq_unlatch(best->irqn);
+                vec_refresh();
+            }
+            continue;
+        }
+        run_handler(best, best_prio);
+    }
+}
+
+/* ---------------- SysTick / DWT ---------------- */
+
+static uint64_t s_st_sync; // SysTick counted up to here
+static uint32_t s_cyc_base; // CYCCNT at s_cyc_t
+static uint64_t s_cyc_t;
+static bool s_cyc_on;
+
+static uint32_t systick_div(void) {
+    return (SysTick->CTRL & SysTick_CTRL_CLKSOURCE_Msk) ? 1U : 8U;
+}
+
+static bool systick_on(void) {
+    return (SysTick->CTRL & SysTick_CTRL_ENABLE_Msk) && (SysTick->LOAD & 0xFFFFFFU) != 0U;
+}
+
+static uint64_t systick_next(void) {
+    if (!systick_on()) {
+        return SIM_NEVER;
+    }
+    const uint32_t val = SysTick->VAL & 0xFFFFFFU;
+    const uint64_t clocks = val == 0U ? 1ULL + (SysTick->LOAD & 0xFFFFFFU) : val;
+    return s_st_sync + clocks * systick_div();
+}
+
+static void systick_advance(uint64_t t) {
+    if (!systick_on()) {
+        s_st_sync = t;
+        return;
+    }
+    const uint32_t div = systick_div();
+    uint64_t n = (t - s_st_sync) / div;
+    s_st_sync += n * div;
+    uint32_t val = SysTick->VAL & 0xFFFFFFU;
+    const uint32_t load = SysTick->LOAD & 0xFFFFFFU;
+    while (n > 0U) {
+        if (val == 0U) {
+            val = load; // reload on the clock after reaching zero
+            n--;
+            continue;
+        }
+        const uint64_t step = n < val ? n : val;
+        val -= (uint32_t)step;
+        n -= step;
+        if (val == 0U) {
+            SysTick->CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+            if (SysTick->CTRL & SysTick_CTRL_TICKINT_Msk) {
+                s_systick_pend = true;
+            }
+            sim_st.events++;
+        }
+    }
+    SysTick->VAL = val;
+}
+
+static bool dwt_counting(void) {
+    return (CoreDebug->DEMCR & CoreDebug_DEMCR_TRCENA_Msk) && (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk);
+}
+
+static void dwt_sync(uint64_t t) {
+    if (s_cyc_on) {
+        DWT->CYCCNT = s_cyc_base + (uint32_t)(t - s_cyc_t);
+    }
+}
+
+/* Counting switched on or off: restart from the register as it reads now */
+static void dwt_rebase(void) {
+    s_cyc_on = dwt_counting();
+    s_cyc_base = DWT->CYCCNT;
+    s_cyc_t = sim_t;
+}
+
+/* ---------------- RCC: clocks and gating ---------------- */
+
+static uint32_t apb_div(uint32_t ppre) {
+    return ppre < 4U ? 1U : 1U << (ppre - 3U);
+}
+
+uint32_t sim_pclk_div(bool apb2) {
+    const uint32_t cfgr = RCC->CFGR;
+    return apb_div(apb2 ? (cfgr >> RCC_CFGR_PPRE2_Pos) & 7U : (cfgr >> RCC_CFGR_PPRE1_Pos) & 7U);
+}
+
+uint32_t sim_tim_clk_div(bool apb2) {
+    const uint32_t d = sim_pclk_div(apb2);
+    return d == 1U ? 1U : d / 2U; // timers run at twice a divided APB clock
+}
+
+typedef struct {
+    uint32_t base;
+    uint32_t enr; // offset of the RCC enable register
+    uint8_t bit;
+} gate_t;
+
+static const gate_t GATES[] = {
+        {GPIOA_BASE, 0x30, 0},  {GPIOB_BASE, 0x30, 1},   {GPIOC_BASE, 0x30, 2},
+        {GPIOD_BASE, 0x30, 3},  {GPIOE_BASE, 0x30, 4},   {GPIOF_BASE, 0x30, 5},
+        {GPIOG_BASE, 0x30, 6},  {GPIOH_BASE, 0x30, 7},   {DMA1_BASE, 0x30, 21},
+        {DMA2_BASE, 0x30, 22},  {TIM2_BASE, 0x40, 0},    {TIM3_BASE, 0x40, 1},
+        {TIM4_BASE, 0x40, 2},   {TIM5_BASE, 0x40, 3},    {USART2_BASE, 0x40, 17},
+        {USART3_BASE, 0x40, 18}, {PWR_BASE, 0x40, 28},   {TIM1_BASE, 0x44, 0},
+        {USART1_BASE, 0x44, 4}, {SYSCFG_BASE, 0x44, 14},
+};
+
+static bool clocked(uintptr_t a) {
+    for (uint32_t i = 0; i < sizeof GATES / sizeof GATES[0]; ++i) {
+        if (a >= GATES[i].base && a < GATES[i].base + 0x400U) {
+            return (*sim_reg(RCC_BASE + GATES[i].enr) >> GATES[i].bit) & 1U;
+        }
+    }
+    return true;
+}
+
+static void rcc_write(uintptr_t a) {
+    if (a == (uintptr_t)&RCC->CR) {
+        // Oscillators and PLLs are ready as soon as they are on (lock time not modelled)
+        uint32_t cr = RCC->CR & ~(RCC_CR_HSIRDY | RCC_CR_HSERDY | RCC_CR_PLLRDY
+                                  | RCC_CR_PLLI2SRDY | RCC_CR_PLLSAIRDY);
+        cr |= (cr & RCC_CR_HSION) ? RCC_CR_HSIRDY : 0U;
+        cr |= (cr & RCC_CR_HSEON) ? RCC_CR_HSERDY : 0U;
+        cr |= (cr & RCC_CR_PLLON) ? RCC_CR_PLLRDY : 0U;
+        cr |= (cr & RCC_CR_PLLI2SON) ? RCC_CR_PLLI2SRDY : 0U;
+        cr |= (cr & RCC_CR_PLLSAION) ? RCC_CR_PLLSAIRDY : 0U;
+        RCC->CR = cr;
+    } else if (a == (uintptr_t)&RCC->CFGR) {
+        const uint32_t cfgr = RCC->CFGR;
+        RCC->CFGR = (cfgr & ~RCC_CFGR_SWS) | ((cfgr & RCC_CFGR_SW) << RCC_CFGR_SWS_Pos);
+    }
+}
+
+/* ---------------- Core register writes ---------------- */
+
+static void nvic_write(uintptr_t a, uint32_t old) {
+    const uint32_t off = (uint32_t)(a - NVIC_BASE);
+    const uint32_t i = (off & 0x7FU) >> 2;
+    const uint32_t w = *sim_reg(a);
+    if (off < 0x80U) { // ISER
+        NVIC->ISER[i] = old | w;
+        NVIC->ICER[i] = NVIC->ISER[i];
+        vec_refresh();
+    } else if (off < 0x100U) { // ICER
+        NVIC->ICER[i] = old & ~w;
+        NVIC->ISER[i] = NVIC->ICER[i];
+        vec_refresh();
+    } else if (off < 0x180U) { // ISPR
+        NVIC->ISPR[i] = old | w;
+        NVIC->ICPR[i] = NVIC->ISPR[i];
+    } else if (off < 0x200U) { // ICPR
+        NVIC->ICPR[i] = old & ~w;
+        NVIC->ISPR[i] = NVIC->ICPR[i];
+    } else if (off < 0x280U) { // IABR: read-only
+        *sim_reg(a) = old;
+    } else if (a == (uintptr_t)&NVIC->STIR) {
+        const uint32_t n = w & 0x1FFU;
+        NVIC->ISPR[n >> 5] |= 1UL << (n & 31U);
+        NVIC->ICPR[n >> 5] = NVIC->ISPR[n >> 5];
+        NVIC->STIR = 0;
+    }
+}
+
+static void systick_write(uintptr_t a, uint32_t old) {
+    if (a == (uintptr_t)&SysTick->CTRL) {
+        const uint32_t w = SysTick->CTRL;
+        SysTick->CTRL = (w & ~SysTick_CTRL_COUNTFLAG_Msk) | (old & SysTick_CTRL_COUNTFLAG_Msk);
+        if (!(old & SysTick_CTRL_ENABLE_Msk) && (w & SysTick_CTRL_ENABLE_Msk)) {
+            s_st_sync = sim_t;
+        }
+    } else if (a == (uintptr_t)&SysTick->VAL) {
+        SysTick->VAL = 0; // any write clears the counter and COUNTFLAG
+        SysTick->CTRL &= ~SysTick_CTRL_COUNTFLAG_Msk;
+    } else if (a == (uintptr_t)&SysTick->LOAD) {
+        SysTick->LOAD &= 0xFFFFFFU;
+    } else if (a == (uintptr_t)&SysTick->CALIB) {
+        *sim_reg(a) = old;
+    }
+}
+
+static void scb_write(uintptr_t a) {
+    if (a == (uintptr_t)&SCB->ICSR) {
+        const uint32_t w = SCB->ICSR;
+        if (w & SCB_ICSR_PENDSTSET_Msk) {
+            s_systick_pend = true;
+        }
+        if (w & SCB_ICSR_PENDSTCLR_Msk) {
+            s_systick_pend = false;
+        }
+        SCB->ICSR = 0;
+    }
+}
+
+static void core_write(uintptr_t a, uint32_t old) {
+    if (a >= NVIC_BASE && a < NVIC_BASE + 0xE00U) {
+        nvic_write(a, old);
+    } else if (a >= SysTick_BASE && a < SysTick_BASE + 0x10U) {
+        systick_write(a, old);
+    } else if (a == (uintptr_t)&DWT->CYCCNT) {
+        s_cyc_base = DWT->CYCCNT;
+        s_cyc_t = sim_t;
+    } else if (a == (uintptr_t)&DWT->CTRL || a == (uintptr_t)&CoreDebug->DEMCR) {
+        dwt_rebase();
+    } else if (a >= SCB_BASE && a < SCB_BASE + 0x90U) {
+        scb_write(a);
+    }
+}
+
+/* ---------------- Bus ---------------- */
+
+enum { PEND_NONE = 0, PEND_WRITE, PEND_READ, PEND_DROP };
+
+static struct {
+    uintptr_t addr;
+    uint32_t old;
+    uint8_t kind;
+} s_pend;
+
+
+static inline bool is_reg(uintptr_t a) {
+    return (a - PERIPH_LO) < PERIPH_LEN || (a - CORE_LO) < CORE_LEN;
+}
+
+static void apply_write(uintptr_t a, uint32_t old) {
+    if (a >= TIM2_BASE && a < TIM5_BASE + 0x400U) {
+        sim_tim_write(a, old);
+    } else if (a >= TIM1_BASE && a < TIM1_BASE + 0x400U) {
+        sim_tim_write(a, old);
+    } else if (a >= GPIOA_BASE && a < GPIOH_BASE + 0x400U) {
+        sim_gpio_write(a, old);
+    } else if ((a >= EXTI_BASE && a < EXTI_BASE + 0x400U)
+               || (a >= SYSCFG_BASE && a < SYSCFG_BASE + 0x400U)) {
+        sim_gpio_write(a, old);
+    } else if ((a >= USART2_BASE && a < USART2_BASE + 0x400U)
+               || (a >= DMA1_BASE && a < DMA1_BASE + 0x400U)) {
+        sim_usart_write(a, old);
+    } else if (a >= RCC_BASE && a < RCC_BASE + 0x400U) {
+        rcc_write(a);
+    } else if (a >= CORE_LO) {
+        core_write(a, old);
+    }
+}
+
+static void apply_read(uintptr_t a) {
+    if (a == (uintptr_t)&SysTick->CTRL) {
+        SysTick->CTRL &= ~SysTick_CTRL_COUNTFLAG_Msk; // cleared by the read
+    } else if ((a >= USART2_BASE && a < USART2_BASE + 0x400U)) {
+        sim_usart_read(a);
+    }
+}
+
+void sim_bus_flush(void) {
+    if (s_pend.kind == PEND_NONE) {
+        return;
+    }
+    const uintptr_t a = s_pend.addr;
+    const uint32_t old = s_pend.old;
+    const uint8_t kind = s_pend.kind;
+    s_pend.kind = PEND_NONE;
+    if (kind == PEND_WRITE) {
+        apply_write(a, old);
+    } else if (kind == PEND_READ) {
+        apply_read(a);
+    } else {
+        *sim_reg(a) = old; // unclocked peripheral: the write never happened
+    }
+    sim_gpio_update();
+    dispatch();
+}
+
+void sim_settle(void) {
+    sim_bus_flush();
+    sim_gpio_update();
+    dispatch();
+}
+
+static void advance_to(uint64_t t);
+
+/* A loop keeps re-reading the same volatiles without storing anything: let time run */
+static void poll_fast_forward(void) {
+    // Only an event can change RAM; a register (a counter, a flag) may move on by itself
+    const uint64_t cap = s_poll.reg ? sim_t + SIM_US(1) : SIM_NEVER;
+    memset(&s_poll, 0, sizeof s_poll);
+    sim_st.spins++;
+    uint64_t t = sim_tim_next();
+    const uint64_t st = systick_next();
+    const uint64_t ut = sim_usart_next();
+    t = st < t ? st : t;
+    t = ut < t ? ut : t;
+    if (t == SIM_NEVER && cap == SIM_NEVER) {
+        fprintf(stderr, "sim: polling memory with nothing left to happen\n");
+        abort();
+    }
+    advance_to(t < cap && t > sim_t ? t : (cap == SIM_NEVER ? sim_t + 1U : cap));
+}
+
+static inline void poll_note(uintptr_t a) {
+    for (uint32_t i = 0; i < s_poll.n; ++i) {
+        if (s_poll.seen[i] == a) {
+            if (++s_poll.repeats >= SPIN_REPEATS) {
+                poll_fast_forward();
+            }
+            return;
+        }
+    }
+    if (s_poll.n < 8U) {
+        s_poll.seen[s_poll.n++] = a;
+        s_poll.reg |= is_reg(a);
+    }
+}
+
+static inline void bus_access(void* p, bool write, bool vol) {
+    if (s_pend.kind != PEND_NONE) {
+        sim_bus_flush();
+    }
+    const uintptr_t a = (uintptr_t)p;
+    if (vol) {
+        if (write) {
+            memset(&s_poll, 0, sizeof s_poll);
+        } else {
+            poll_note(a);
+        }
+    }
+    if (!is_reg(a)) {
+        return;
+    }
+    const uintptr_t w = a & ~(uintptr_t)3U;
+    if (!write) {
+        s_pend.addr = w;
+        s_pend.kind = PEND_READ;
+        return;
+    }
+    s_pend.addr = w;
+    s_pend.old = *sim_reg(w);
+    s_pend.kind = PEND_WRITE;
+    if (!clocked(w)) {
+        s_pend.kind = PEND_DROP;
+        if (sim_st.unclocked_writes++ == 0U) {
+            sim_st.first_unclocked = (uint32_t)w;
+        }
+    }
+}
+
+/* ThreadSanitizer's instrumentation entry points (the runtime is not linked) */
+#define TSAN_PLAIN(n)                                                                        \
+    void __tsan_read##n(void* p) {                                                           \
+        bus_access(p, false, false);                                                         \
+    }                                                                                        \
+    void __tsan_write##n(void* p) {                                                          \
+        bus_access(p, true, false);                                                          \
+    }                                                                                        \
+    void __tsan_unaligned_read##n(void* p) {                                                 \
+        bus_access(p, false, false);                                                         \
+    }                                                                                        \
+    void __tsan_unaligned_write##n(void* p) {                                                \
+        bus_access(p, true, false);                                                          \
+    }                                                                                        \
+    void __tsan_volatile_read##n(void* p) {                                                  \
+        bus_access(p, false, true);                                                          \
+    }                                                                                        \
+    void __tsan_volatile_write##n(void* p) {                                                 \
+        bus_access(p, true, true);                                                           \
+    }                                                                                        \
+    void __tsan_unaligned_volatile_read##n(void* p) {                                        \
+        bus_access(p, false, true);                                                          \
+    }                                                                                        \
+    void __tsan_unaligned_volatile_write##n(void* p) {                                       \
+        bus_access(p, true, true);                                                           \
+    }
+
+TSAN_PLAIN(1)
+TSAN_PLAIN(2)
+TSAN_PLAIN(4)
+TSAN_PLAIN(8)
+TSAN_PLAIN(16)
+
+void __tsan_read_range(void* p, unsigned long n) {
+    (void)n;
+    bus_access(p, false, false);
+}
+
+void __tsan_write_range(void* p, unsigned long n) {
+    (void)n;
+    bus_access(p, true, false);
+}
+
+/* Atomics (LDREX / STREX on the chip): one access, no handler can run inside it */
+#define TSAN_RMW(n, t, op, name)                                                             \
+    t __tsan_atomic##n##_##name(volatile t* p, t v, int mo) {                                \
+        (void)mo;                                                                            \
+        bus_access((void*)p, true, true);                                                    \
+        const t old = *p;                                                                    \
+        *p = (t)(op);                                                                        \
+        return old;                                                                          \
+    }
+
+#define TSAN_ATOMIC(n, t)                                                                    \
+    t __tsan_atomic##n##_load(const volatile t* p, int mo) {                                 \
+        (void)mo;                                                                            \
+        bus_access((void*)p, false, true);                                                   \
+        return *p;                                                                           \
+    }                                                                                        \
+    void __tsan_atomic##n##_store(volatile t* p, t v, int mo) {                              \
+        (void)mo;                                                                            \
+        bus_access((void*)p, true, true);                                                    \
+        *p = v;                                                                              \
+    }                                                                                        \
+    TSAN_RMW(n, t, v, exchange)                                                              \
+    TSAN_RMW(n, t, old + v, fetch_add)                                                       \
+    TSAN_RMW(n, t, old - v, fetch_sub)                                                       \
+    TSAN_RMW(n, t, old & v, fetch_and)                                                       \
+    TSAN_RMW(n, t, old | v, fetch_or)                                                        \
+    TSAN_RMW(n, t, old ^ v, fetch_xor)                                                       \
+    TSAN_RMW(n, t, ~(old & v), fetch_nand)                                                   \
+    int __tsan_atomic##n##_compare_exchange_strong(volatile t* p, t* expected, t v, int mo,  \
+                                                   int fmo) {                                \
+        (void)mo;                                                                            \
+        (void)fmo;                                                                           \
+        bus_access((void*)p, true, true);                                                    \
+        if (*p == *expected) {                                                               \
+            *p = v;                                                                          \
+            return 1;                                                                        \
+        }                                                                                    \
+        *expected = *p;                                                                      \
+        return 0;                                                                            \
+    }                                                                                        \
+    int __tsan_atomic##n##_compare_exchange_weak(volatile t* p, t* expected, t v, int mo,    \
+                                                 int fmo) {                                  \
+        return __tsan_atomic##n##_compare_exchange_strong(p, expected, v, mo, fmo);          \
+    }                                                                                        \
+    t __tsan_atomic##n##_compare_exchange_val(volatile t* p, t expected, t v, int mo,        \
+                                              int fmo) {                                     \
+        __tsan_atomic##n##_compare_exchange_strong(p, &expected, v, mo, fmo);                \
+        return expected;                                                                     \
+    }
+
+TSAN_ATOMIC(8, uint8_t)
+TSAN_ATOMIC(16, uint16_t)
+TSAN_ATOMIC(32, uint32_t)
+TSAN_ATOMIC(64, uint64_t)
+
+void __tsan_atomic_thread_fence(int mo) {
+    (void)mo;
+}
+
+void __tsan_atomic_signal_fence(int mo) {
+    (void)mo;
+}
+
+void __tsan_init(void) {
+}
+
+void __tsan_func_entry(void* pc) {
+    (void)pc;
+}
+
+void __tsan_func_exit(void) {
+}
+
+/* ---------------- Intrinsics (sim_cmsis.h) ---------------- */
+
+void sim_cpu_nop(void) {
+    advance_to(sim_t + 1U);
+}
+
+uint32_t sim_cpu_basepri(void) {
+    return s_basepri;
+}
+
+void sim_cpu_set_basepri(uint32_t v) {
+    sim_bus_flush();
+    s_basepri = v & 0xF0U; // 4 priority bits implemented
+    dispatch();
+}
+
+uint32_t sim_cpu_primask(void) {
+    return s_primask;
+}
+
+void sim_cpu_set_primask(uint32_t v) {
+    sim_bus_flush();
+    s_primask = v & 1U;
+    dispatch();
+}
+
+void sim_cpu_wfi(void) {
+    const uint64_t irqs = sim_st.irqs;
+    const uint64_t end = sim_t + SIM_MS(1000);
+    while (sim_st.irqs == irqs && sim_t < end) {
+        poll_fast_forward();
+    }
+}
+
+/* ---------------- Time ---------------- */
+
+static uint64_t next_event(void) {
+    uint64_t t = sim_tim_next();
+    const uint64_t st = systick_next();
+    const uint64_t ut = sim_usart_next();
+    t = st < t ? st : t;
+    return ut < t ? ut : t;
+}
+
+static void advance_all(uint64_t t) {
+    sim_tim_advance(t);
+    systick_advance(t);
+    sim_usart_advance(t);
+    dwt_sync(t);
+}
+
+/* Process every event up to t in order, dispatching after each */
+static void advance_to(uint64_t t) {
+    sim_bus_flush();
+    for (;;) {
+        const uint64_t te = next_event();
+        if (te > t) {
+            break;
+        }
+        if (te > sim_t) {
+            sim_t = te;
+            s_storm = 0;
+        }
+        advance_all(sim_t);
+        sim_gpio_update();
+        dispatch();
+    }
+    if (sim_t < t) {
+        sim_t = t;
+        s_storm = 0;
+        advance_all(t);
+        sim_gpio_update();
+        dispatch();
+    }
+}
+
+/* ---------------- API ---------------- */
+
+static bool map_block(uintptr_t base, size_t len) {
+    void* p = mmap((void*)base, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    if (p != (void*)base) { // a kernel without MAP_FIXED_NOREPLACE took it as a hint
+        munmap(p, len);
+        return false;
+    }
+    return true;
+}
+
+static void reset_values(void) {
+    memset((void*)PERIPH_LO, 0, PERIPH_LEN);
+    memset((void*)CORE_LO, 0, CORE_LEN);
+
+    RCC->CR = 0x00000083U; // HSI on and ready
+    RCC->PLLCFGR = 0x24003010U;
+    RCC->AHB1ENR = 0x00100000U;
+    RCC->CSR = 0x0E000000U;
+    PWR->CR = 0x0000C000U;
+    GPIOA->MODER = 0xA8000000U; // PA13..15: debug port
+    GPIOA->OSPEEDR = 0x0C000000U;
+    GPIOA->PUPDR = 0x64000000U;
+    GPIOB->MODER = 0x00000280U; // PB3 / PB4: debug port
+    GPIOB->OSPEEDR = 0x000000C0U;
+    GPIOB->PUPDR = 0x00000100U;
+    *sim_reg((uintptr_t)&SysTick->CALIB) = 0xC0000000U | (SIM_HCLK_HZ / 8000U);
+    DWT->CTRL = 0x40000000U; // NUMCOMP = 4
+    *sim_reg((uintptr_t)&SCB->CPUID) = 0x410FC241U;
+}
+
+bool sim_init(void) {
+    if (!s_mapped) {
+        if (!map_block(PERIPH_LO, PERIPH_LEN)) {
+            return false;
+        }
+        if (!map_block(CORE_LO, CORE_LEN)) {
+            munmap((void*)PERIPH_LO, PERIPH_LEN);
+            return false;
+        }
+        s_mapped = true;
+    }
+    s_pend.kind = PEND_NONE;
+    reset_values();
+    memset(&sim_st, 0, sizeof sim_st);
+    s_exec = PRIO_THREAD;
+    s_basepri = 0;
+    s_primask = 0;
+    s_systick_pend = false;
+    vec_refresh();
+    s_st_sync = sim_t;
+    s_cyc_on = false;
+    s_cyc_base = 0;
+    s_cyc_t = sim_t;
+    memset(&s_poll, 0, sizeof s_poll);
+    sim_tim_reset();
+    sim_usart_reset();
+    sim_gpio_reset();
+    return true;
+}
+
+uint64_t sim_now(void) {
+    return sim_t;
+}
+
+void sim_run(uint64_t cycles) {
+    advance_to(sim_t + cycles);
+}
+
+bool sim_run_until(bool (*done)(void), uint64_t max_cycles) {
+    const uint64_t end = sim_t + max_cycles;
+    for (;;) {
+        sim_bus_flush();
+        if (done()) {
+            return true;
+        }
+        if (sim_t >= end) {
+            return false;
+        }
+        const uint64_t te = next_event();
+        advance_to(te > end ? end : (te > sim_t ? te : sim_t + 1U));
+    }
+}
+
+const sim_stats_t* sim_stats(void) {
+    sim_bus_flush();
+    return &sim_st;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stm32f4xx.h"
+
+/**
+ * Register-level STM32F446 emulator for host tests (Linux, GCC).
+ *
+ * The driver sources compile unchanged against the real device header: the peripheral and
+ * core register blocks are mapped at their real addresses, and every load/store the drivers
+ * make goes through the compiler's ThreadSanitizer hooks, which the emulator implements
+ * instead of the sanitizer runtime (see README.md). A write takes effect like on the chip
+ * (BSRR, rc_w0 / rc_w1 flags, NVIC set/clear registers, EGR, ...) before the next access,
+ * and an interrupt the write makes pending preempts right there if its priority allows.
+ *
+ * Time is counted in core cycles at SIM_HCLK_HZ and only moves in sim_run*() or __NOP()
+ * (one cycle each); handlers and the code between run in zero time. Between events the
+ * emulator jumps straight to the next one, so idle stretches cost nothing.
+ *
+ * Modelled: TIM1..TIM5 (up-counting, preload, OPM, RCR, output compare and PWM modes, the
+ * TIM1 break input and MOE / OSSI), GPIOA..H (MODER / AF / pulls, IDR, ODR, BSRR), EXTI and
+ * SYSCFG routing, NVIC priorities, BASEPRI / PRIMASK and nesting, SysTick, DWT CYCCNT, RCC
+ * ready bits and clock gating, USART2 with DMA1 streams 5 / 6.
+ */
+
+#define SIM_HCLK_HZ 180000000ULL
+#define SIM_US(us) ((uint64_t)(us) * (SIM_HCLK_HZ / 1000000ULL))
+#define SIM_MS(ms) ((uint64_t)(ms) * (SIM_HCLK_HZ / 1000ULL))
+
+// Map the register blocks (first call) and bring every peripheral to its reset state.
+// false: the address ranges are taken or cannot be mapped on this host.
+bool sim_init(void);
+
+uint64_t sim_now(void); // core cycles since the first sim_init()
+void sim_run(uint64_t cycles);
+// Run until done() (checked after every event) or for at most max_cycles; returns done()
+bool sim_run_until(bool (*done)(void), uint64_t max_cycles);
+
+/* ---- Pins ---- */
+
+#define SIM_RELEASED (-1)
+
+// External circuit on a pin: 0 / 1, or SIM_RELEASED (the pull resistor decides).
+// The chip's own output wins while the pin is an output.
+void sim_pin_drive(GPIO_TypeDef* port, uint8_t pin, int level);
+bool sim_pin(const GPIO_TypeDef* port, uint8_t pin); // level on the pin right now
+uint8_t sim_port_index(const GPIO_TypeDef* port); // GPIOA = 0, GPIOB = 1, ...
+
+// Called for every pin that changes level, at the cycle it changes (also from
+// sim_pin_drive()). The callback may drive pins itself.
+typedef void (*sim_pin_fn)(void* ctx, uint8_t port, uint8_t pin, bool level, uint64_t t);
+bool sim_pin_watch(sim_pin_fn fn, void* ctx); // false when every watcher slot is taken
+void sim_pin_unwatch(sim_pin_fn fn, void* ctx);
+
+/* ---- USART2 (the host link) ---- */
+
+// Bytes from the host: they arrive back to back at the programmed baud rate
+void sim_uart_rx(const void* data, size_t n);
+// Bytes that have left the TX pin since the last call (up to max)
+size_t sim_uart_tx(void* out, size_t max);
+
+/* ---- Counters ---- */
+
+typedef struct {
+    uint64_t events; // timer / SysTick / UART events processed
+    uint64_t irqs; // handlers run
+    uint32_t unclocked_writes; // writes to a peripheral whose RCC enable bit is clear (dropped)
+    uint32_t first_unclocked; // address of the first one
+    uint32_t unhandled_irqs; // pended with no handler linked in
+    uint32_t spins; // polling loops fast-forwarded to the next event
+} sim_stats_t;
+
+const sim_stats_t* sim_stats(void);
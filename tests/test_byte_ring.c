@@ -0,0 +1,269 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "byte_ring.h"
+
+/*
+ * byte_ring as the USART2 RX path uses it: a simulated DMA stream writes bytes into a
+ * circular buffer and counts NDTR down; "interrupts" at half/full transfer and at line idle
+ * run the same position arithmetic as rx_dma_update() and commit the distance.
+ *
+ * And as the TX path uses it: writers go through byte_ring_write(), a simulated DMA stream
+ * sends one contiguous span per transfer, and its completion starts the next (tx_kick()).
+ */
+
+#define BUF_LEN 64U
+
+static volatile uint8_t buf[BUF_LEN];
+static byte_ring_t ring;
+
+typedef struct {
+    uint32_t ndtr; // counts down, reloads at 0 (circular)
+    uint32_t last_pos; // driver: write index at the last update
+    uint8_t next; // byte value the "sender" puts on the line next
+} sim_dma_t;
+
+static sim_dma_t dma;
+
+static void sim_reset(uint32_t start_count) {
+    memset((void*)buf, 0, sizeof buf);
+    byte_ring_init(&ring, buf, BUF_LEN);
+    ring.head = start_count; // exercise the 32-bit wrap of the free-running counts
+    ring.tail = start_count;
+    dma.last_pos = start_count & (BUF_LEN - 1U);
+    dma.ndtr = BUF_LEN - dma.last_pos;
+    dma.next = 0;
+}
+
+static void rx_update(void) {
+    const uint32_t pos = (BUF_LEN - dma.ndtr) & (BUF_LEN - 1U);
+    byte_ring_commit(&ring, (pos - dma.last_pos) & (BUF_LEN - 1U));
+    dma.last_pos = pos;
+}
+
+/* One byte arrives; the DMA stores it and raises HT/TC like the hardware */
+static void sim_rx_byte(void) {
+    buf[BUF_LEN - dma.ndtr] = dma.next++;
+    if (--dma.ndtr == 0) {
+        dma.ndtr = BUF_LEN;
+        rx_update(); // TC
+    } else if (dma.ndtr == BUF_LEN / 2U) {
+        rx_update(); // HT
+    }
+}
+
+static void sim_burst(uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        sim_rx_byte();
+    }
+    rx_update(); // IDLE after the burst
+}
+
+/* Drain everything, checking the byte sequence continues from `expect` */
+static uint32_t drain(uint8_t* expect) {
+    uint32_t n = 0;
+    int c;
+    while ((c = byte_ring_get(&ring)) >= 0) {
+        assert((uint8_t)c == *expect);
+        (*expect)++;
+        n++;
+    }
+    return n;
+}
+
+static void test_bursts_and_wraparound(void) {
+    const uint32_t starts[] = {0U, 37U, 0xFFFFFFF0U}; // last one wraps the uint32 counts
+    for (uint32_t s = 0; s < 3; ++s) {
+        sim_reset(starts[s]);
+        uint8_t expect = 0;
+        uint32_t got = 0, sent = 0;
+        for (uint32_t burst = 1; burst <= BUF_LEN; ++burst) {
+            sim_burst(burst); // 1..BUF_LEN bytes, always read before the buffer laps
+            sent += burst;
+            assert(byte_ring_used(&ring) == burst);
+            assert(byte_ring_free(&ring) == BUF_LEN - burst);
+            got += drain(&expect);
+        }
+        assert(got == sent && ring.lost == 0 && byte_ring_get(&ring) == -1);
+    }
+}
+
+static void test_partial_reads(void) {
+    sim_reset(0);
+    uint8_t expect = 0;
+    // Reader keeps up in small bites while bytes stream in, no idle in between
+    for (uint32_t i = 0; i < 10000; ++i) {
+        sim_rx_byte();
+        if ((i % 7) == 6) {
+            rx_update(); // an idle gap now and then
+        }
+        if ((i % 40) == 39) {
+            drain(&expect);
+        }
+    }
+    rx_update();
+    drain(&expect);
+    assert(expect == (uint8_t)10000U && ring.lost == 0);
+}
+
+static void test_overrun_accounting(void) {
+    sim_reset(0xFFFFFFE0U);
+    uint8_t expect = 0;
+    // Nobody reads while 3.5 buffers come in: all but the newest BUF_LEN bytes are gone
+    const uint32_t sent = BUF_LEN * 3U + BUF_LEN / 2U;
+    sim_burst(sent);
+    assert(byte_ring_used(&ring) == sent && byte_ring_free(&ring) == 0);
+
+    expect = (uint8_t)(sent - BUF_LEN);
+    assert(drain(&expect) == BUF_LEN);
+    assert(ring.lost == sent - BUF_LEN);
+
+    // The ring carries on normally afterwards
+    sim_burst(10);
+    assert(drain(&expect) == 10 && ring.lost == sent - BUF_LEN);
+}
+
+static void test_software_producer(void) {
+    uint8_t mem[16];
+    byte_ring_t r;
+    byte_ring_init(&r, mem, sizeof mem);
+    for (uint32_t i = 0; i < 20; ++i) {
+        assert(byte_ring_put(&r, (uint8_t)i) == (i < 16));
+    }
+    assert(r.dropped == 4 && byte_ring_free(&r) == 0);
+    for (int i = 0; i < 16; ++i) {
+        assert(byte_ring_get(&r) == i);
+    }
+    assert(byte_ring_get(&r) == -1 && r.lost == 0 && byte_ring_free(&r) == 16);
+}
+
+/* TX model: same claim / release steps as tx_kick() and the Stream6 IRQ */
+#define TX_LEN 32U
+
+static volatile uint8_t tx_mem[TX_LEN];
+static byte_ring_t tx;
+static uint32_t tx_busy; // bytes of the running transfer
+static uint32_t tx_src; // buffer index the transfer reads from
+static uint8_t wire[1U << 16]; // everything that went out, in order
+static uint32_t wire_len;
+
+static void tx_reset(byte_ring_policy_t* policy, byte_ring_policy_t p) {
+    byte_ring_init(&tx, tx_mem, TX_LEN);
+    tx.head = tx.tail = 0xFFFFFFE0U; // buffer index 0, but the counts wrap soon
+    tx_busy = 0;
+    wire_len = 0;
+    *policy = p;
+}
+
+static void tx_kick(void) {
+    if (tx_busy != 0U) {
+        return;
+    }
+    const uint32_t n = byte_ring_span(&tx);
+    if (n == 0U) {
+        return;
+    }
+    assert((tx.tail & tx.mask) + n <= TX_LEN); // one transfer never crosses the end
+    tx_src = tx.tail & tx.mask;
+    byte_ring_skip(&tx, n);
+    tx_busy = n;
+}
+
+/* The DMA finishes: the bytes are read only now, so an overwrite of them would show */
+static void tx_complete(void) {
+    if (tx_busy == 0U) {
+        return;
+    }
+    for (uint32_t i = 0; i < tx_busy; ++i) {
+        wire[wire_len++] = tx_mem[tx_src + i];
+    }
+    tx_busy = 0;
+    tx_kick();
+}
+
+static uint32_t tx_write(byte_ring_policy_t policy, const uint8_t* p, uint32_t n) {
+    const uint32_t stored = byte_ring_write(&tx, p, n, policy, tx_busy);
+    tx_kick();
+    return stored;
+}
+
+static void test_tx_ordering(void) {
+    byte_ring_policy_t policy;
+    tx_reset(&policy, BYTE_RING_DROP);
+    uint8_t msg[TX_LEN];
+    uint8_t next = 0;
+    uint32_t sent = 0;
+    srand(5);
+    // Writes of random length never outrun the DMA: every byte arrives, in order
+    for (int k = 0; k < 2000; ++k) {
+        const uint32_t n = (uint32_t)(rand() % 12);
+        for (uint32_t i = 0; i < n; ++i) {
+            msg[i] = next++;
+        }
+        assert(tx_write(policy, msg, n) == n);
+        sent += n;
+        while (byte_ring_used(&tx) + tx_busy > TX_LEN / 2U) {
+            tx_complete();
+        }
+    }
+    while (tx_busy != 0U) {
+        tx_complete();
+    }
+    assert(wire_len == sent && tx.dropped == 0);
+    for (uint32_t i = 0; i < wire_len; ++i) {
+        assert(wire[i] == (uint8_t)i);
+    }
+}
+
+static void test_tx_policies(void) {
+    byte_ring_policy_t policy;
+    uint8_t msg[100];
+    for (uint32_t i = 0; i < sizeof msg; ++i) {
+        msg[i] = (uint8_t)i;
+    }
+
+    // DROP: the first TX_LEN bytes go (the first span is claimed at once), the rest is refused
+    tx_reset(&policy, BYTE_RING_DROP);
+    assert(tx_write(policy, msg, 10) == 10 && tx_busy == 10);
+    assert(tx_write(policy, msg + 10, 90) == TX_LEN - 10);
+    assert(tx.dropped == 90 - (TX_LEN - 10) && byte_ring_free(&tx) == 10);
+    while (tx_busy != 0U) {
+        tx_complete();
+    }
+    assert(wire_len == TX_LEN && memcmp(wire, msg, TX_LEN) == 0);
+
+    // OVERWRITE: the claimed 10 bytes survive, then only the newest unclaimed ones
+    tx_reset(&policy, BYTE_RING_OVERWRITE);
+    assert(tx_write(policy, msg, 10) == 10 && tx_busy == 10);
+    assert(tx_write(policy, msg + 10, 90) == TX_LEN - 10);
+    assert(tx.dropped == 90 - (TX_LEN - 10));
+    assert(tx_write(policy, msg + 95, 5) == 5); // full: slides out the 5 oldest queued
+    assert(tx.dropped == 95 - (TX_LEN - 10));
+    while (tx_busy != 0U) {
+        tx_complete();
+    }
+    assert(wire_len == TX_LEN && memcmp(wire, msg, 10) == 0);
+    assert(memcmp(wire + 10, msg + 100 - (TX_LEN - 10) + 5, TX_LEN - 15) == 0);
+    assert(memcmp(wire + TX_LEN - 5, msg + 95, 5) == 0);
+
+    // OVERWRITE with the whole ring claimed has nothing to give up: it drops instead
+    tx_reset(&policy, BYTE_RING_OVERWRITE);
+    assert(tx_write(policy, msg, TX_LEN) == TX_LEN && tx_busy == TX_LEN);
+    assert(tx_write(policy, msg, 5) == 0 && tx.dropped == 5);
+    tx_complete();
+    assert(wire_len == TX_LEN && memcmp(wire, msg, TX_LEN) == 0);
+}
+
+int main(void) {
+    test_bursts_and_wraparound();
+    test_partial_reads();
+    test_overrun_accounting();
+    test_software_producer();
+    test_tx_ordering();
+    test_tx_policies();
+    printf("All byte_ring tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "stepgen_break.h"
+#include "stepgen_oc.h"
+
+/*
+ * E-stop on the step timer's break input, modelled at 1 us.
+ *
+ * One STEP channel runs in toggle mode from the real stepgen_oc scheduler (OCxREF). The
+ * output stage follows RM0390's advanced-timer rules for the BDTR value stepgen_init_all()
+ * writes: BKIN at its active level clears MOE at once; with OSSI the pin is then driven to
+ * OISx (low); MOE only comes back when software sets it (no AOE) and not while BKIN is
+ * still active. Compared, for a press at a random time in a slow move:
+ *   polled - the old path: the latch after the debounce, the ISR halts at the next fall
+ *   EXTI   - the first edge stops the scheduling; a pulse in flight still completes
+ *   break  - BKIN takes the pin low in hardware (EXTI still stops the scheduling behind it)
+ * Also checks the latch / estop_clear() semantics of the hardware half.
+ */
+
+#define STEP_HZ 250U // slow: 4 ms period, 2 ms high
+#define TICKS 5U // debounce samples at 1 kHz
+#define EXTI_US 1U // edge -> trip hook (~90 cycles at 180 MHz)
+#define BDTR STEPGEN_BDTR_BREAK(0) // e-stop active low (bsp_pins.h)
+
+typedef enum { POLLED = 0, EXTI_STOP, BREAK } scheme_t;
+
+typedef struct {
+    stepgen_oc_t oc;
+    int ref; // OC1REF
+    int running;
+    uint32_t moe, bif;
+} tim_t;
+
+static int bkin_active(uint32_t bdtr, int level) {
+    return (bdtr & TIM_BDTR_BKE) && (level != 0) == ((bdtr & TIM_BDTR_BKP) != 0U);
+}
+
+/* Break logic: asynchronous, level sensitive */
+static void tim_break(tim_t* t, int bkin_level) {
+    if (bkin_active(BDTR, bkin_level)) {
+        t->moe = 0;
+        t->bif = 1;
+    }
+}
+
+/* The pin: OCxREF with MOE, else the idle level (OSSI) or released (Hi-Z, read as -1) */
+static int tim_pin(const tim_t* t) {
+    if (t->moe) {
+        return t->ref;
+    }
+    return (BDTR & TIM_BDTR_OSSI) ? 0 : -1;
+}
+
+/* Software: MOE write, ignored by the hardware while the break input is active */
+static void tim_set_moe(tim_t* t, int bkin_level) {
+    t->moe = 1;
+    tim_break(t, bkin_level);
+}
+
+typedef struct {
+    uint32_t low_us; // edge -> STEP low for good
+    uint32_t rises; // rising edges on the pin after the edge
+    int runt; // a pulse cut short
+} result_t;
+
+static result_t run(scheme_t sc, uint32_t t_edge) {
+    tim_t t = {0};
+    stepgen_oc_set_period(&t.oc, 1000000U / STEP_HZ);
+    stepgen_oc_start(&t.oc, 0, 1000U);
+    t.running = 1;
+    tim_set_moe(&t, 1);
+
+    // Polled latch: TICKS-th SysTick after the edge (the switch reads closed from the edge)
+    const uint32_t latch_t = (t_edge / 1000U + TICKS) * 1000U;
+    result_t r = {0, 0, 0};
+    int prev_pin = 0, stop_req = 0;
+    uint32_t last_high = t_edge, rise_t = 0;
+    for (uint32_t us = 0; us < t_edge + 20000U; ++us) {
+        const int bkin = us >= t_edge ? 0 : 1; // active low: pressed = 0
+        if (sc == BREAK) {
+            tim_break(&t, bkin);
+        }
+        if (sc != POLLED && us == t_edge + EXTI_US && t.running) {
+            stop_req = 1;
+            if (stepgen_oc_stop(&t.oc)) {
+                t.running = 0; // low already: halt now
+            }
+        }
+        if (t.running && (uint16_t)us == t.oc.ccr) {
+            t.ref ^= 1;
+            const stepgen_oc_event_t ev = stepgen_oc_on_match(&t.oc);
+            const int latched = (sc == POLLED && us >= latch_t) || stop_req;
+            if (ev == STEPGEN_OC_DONE || (ev == STEPGEN_OC_FALL && latched)) {
+                t.running = 0; // axis_halt(): force low
+                t.ref = 0;
+            }
+        }
+        const int pin = tim_pin(&t);
+        assert(pin != -1); // OSSI: never floating
+        if (pin && !prev_pin) {
+            rise_t = us;
+            r.rises += us >= t_edge;
+        }
+        if (!pin && prev_pin && us - rise_t < 500000U / STEP_HZ) {
+            r.runt = 1;
+        }
+        if (pin && us >= t_edge) {
+            last_high = us + 1U;
+        }
+        prev_pin = pin;
+    }
+    r.low_us = last_high - t_edge;
+    return r;
+}
+
+static void test_latency(void) {
+    const char* name[] = {"polled", "EXTI", "break"};
+    for (int sc = POLLED; sc <= BREAK; ++sc) {
+        uint32_t worst = 0, rises = 0, runts = 0;
+        double sum = 0.0;
+        srand(15);
+        const int trials = 400;
+        for (int k = 0; k < trials; ++k) {
+            const uint32_t t_edge = 20000U + (uint32_t)(rand() % 8000);
+            const result_t r = run((scheme_t)sc, t_edge);
+            worst = r.low_us > worst ? r.low_us : worst;
+            rises = r.rises > rises ? r.rises : rises;
+            runts += (uint32_t)r.runt;
+            sum += r.low_us;
+        }
+        printf("e-stop at %u Hz, %-6s: STEP low %7.1f us avg, %5u us max, up to %u rises, "
+               "%u/%d pulses cut\n",
+               STEP_HZ, name[sc], sum / trials, worst, rises, runts, trials);
+        if (sc == POLLED) {
+            assert(worst > (TICKS - 1U) * 1000U && rises >= 1U); // a step period and more
+        } else if (sc == EXTI_STOP) {
+            assert(worst <= 500000U / STEP_HZ + EXTI_US + 1U && rises == 0U && runts == 0U);
+        } else {
+            assert(worst == 0U && rises == 0U); // hardware: the same microsecond
+            assert(runts > 0U); // the price: a pulse in flight is cut (position is lost anyway)
+        }
+    }
+}
+
+static void test_latch(void) {
+    tim_t t = {0};
+    assert((BDTR & TIM_BDTR_AOE) == 0U && (BDTR & TIM_BDTR_MOE) == 0U);
+    tim_set_moe(&t, 1);
+    assert(t.moe == 1 && !t.bif);
+
+    // Press: MOE cleared, the switch released again does not bring it back
+    tim_break(&t, 0);
+    assert(t.moe == 0 && t.bif == 1 && tim_pin(&t) == 0);
+    tim_break(&t, 1);
+    assert(t.moe == 0);
+
+    // stepgen's re-arm: refused while latched, refused while BKIN is held
+    int latched = 1;
+    assert(!stepgen_break_may_rearm(latched, false));
+    latched = 0; // estop_clear()
+    assert(!stepgen_break_may_rearm(latched, bkin_active(BDTR, 0)));
+    tim_set_moe(&t, 0); // even if software tried: the break input wins
+    assert(t.moe == 0);
+
+    // Released and cleared: the next move sets MOE, the halted channel is low (no glitch)
+    assert(stepgen_break_may_rearm(latched, bkin_active(BDTR, 1)));
+    t.bif = 0;
+    tim_set_moe(&t, 1);
+    assert(t.moe == 1 && tim_pin(&t) == 0);
+}
+
+int main(void) {
+    test_latency();
+    test_latch();
+    printf("All e-stop break tests passed.\n");
+    return 0;
+}
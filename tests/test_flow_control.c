@@ -0,0 +1,221 @@
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "byte_ring.h"
+#include "gcode.h"
+#include "hostlink.h"
+
+/*
+ * Streaming a program of short segments over the serial link, simulated at 1 us steps:
+ *
+ *  sender --(baud)--> RX ring (256 B) -> line assembler -> parse/execute -> planner (15)
+ *         <--(latency + baud)-- "ok Bf:<blocks>,<bytes>"
+ *
+ * The receive side is gcode_stream_service() in miniature (same assembler, parser, ring and
+ * ack format); the planner is a FIFO whose head block runs for length / feed. Two senders:
+ * send-and-wait (one line in flight) and character counting (unacknowledged bytes <= RX
+ * size). Reports blocks/s and checks the counting sender never overruns the RX ring.
+ */
+
+#define RX_SIZE 256U
+#define PLANNER_SLOTS 15U
+#define N_LINES 2000U
+#define SERVICE_US 100U // superloop period (generous: the real loop is faster)
+#define USB_LATENCY_US 1000U // host serial stack, each direction of a reply
+#define SEG_MM 0.05f
+#define FEED_MM_MIN 3000.0f
+
+static char prog[N_LINES][32];
+
+typedef struct {
+    uint32_t due_us; // reaches the sender
+    uint32_t planner_free, rx_free;
+} ack_t;
+
+typedef struct {
+    // link + receiver
+    volatile uint8_t rx_mem[RX_SIZE];
+    byte_ring_t rx;
+    gcode_line_t line;
+    gcode_state_t gc;
+    gc_cmd_t cmd; // one queued command per line in this program
+    int pending; // line parsed, waiting for planner room
+    float planner_us[PLANNER_SLOTS]; // remaining run time per block
+    uint32_t pl_head, pl_count;
+    float last_pos[3];
+    ack_t acks[64];
+    uint32_t ack_head, ack_count;
+    uint32_t reply_busy_until; // reply link is busy sending earlier acks
+    // sender
+    uint32_t next_line, next_byte, acked;
+    uint32_t unacked[64]; // byte counts of lines not yet acknowledged (FIFO)
+    uint32_t ua_head, ua_count, ua_bytes;
+    uint32_t min_rx_free, min_planner_free;
+    uint64_t starved_us; // planner empty while the program was not done
+    uint32_t max_rx_used;
+} sim_t;
+
+static void make_program(void) {
+    float x = 0.0f, y = 0.0f;
+    srand(21);
+    for (uint32_t k = 0; k < N_LINES; ++k) {
+        const float a = (float)(rand() % 3600) * 0.1f * 3.14159265f / 180.0f;
+        x += SEG_MM * cosf(a);
+        y += SEG_MM * sinf(a);
+        snprintf(prog[k], sizeof prog[k], "G1X%.3fY%.3fF%.0f\n", x, y, FEED_MM_MIN);
+    }
+}
+
+static void receiver_ack(sim_t* s, uint32_t now, double byte_us) {
+    char buf[HL_ACK_MAX];
+    const uint32_t rx_free = RX_SIZE - byte_ring_used(&s->rx);
+    const uint32_t n = hl_format_ack(buf, PLANNER_SLOTS - s->pl_count, rx_free);
+    ack_t* a = &s->acks[(s->ack_head + s->ack_count++) & 63U];
+    assert(s->ack_count <= 64);
+    const uint32_t start = now > s->reply_busy_until ? now : s->reply_busy_until;
+    s->reply_busy_until = start + (uint32_t)(n * byte_us);
+    a->due_us = s->reply_busy_until + USB_LATENCY_US;
+    assert(hl_parse_ack(buf, &a->planner_free, &a->rx_free));
+}
+
+static void receiver_service(sim_t* s, uint32_t now, double byte_us) {
+    if (s->pending) {
+        if (s->pl_count == PLANNER_SLOTS) {
+            return; // planner full: stop reading, the sender's bytes wait in the ring
+        }
+        float len2 = 0.0f;
+        for (int i = 0; i < 3; ++i) {
+            const float d = s->cmd.target[i] - s->last_pos[i];
+            len2 += d * d;
+            s->last_pos[i] = s->cmd.target[i];
+        }
+        s->planner_us[(s->pl_head + s->pl_count++) % PLANNER_SLOTS] =
+                sqrtf(len2) / (s->cmd.feed_mm_min / 60.0f) * 1e6f;
+        s->pending = 0;
+        receiver_ack(s, now, byte_us);
+    }
+    int c;
+    while ((c = byte_ring_get(&s->rx)) >= 0) {
+        if (!gcode_line_feed(&s->line, (char)c)) {
+            continue;
+        }
+        gcode_block_t b;
+        gc_cmd_t cmds[GCODE_MAX_CMDS];
+        uint8_t n = 0;
+        gc_status_t st = gcode_parse(s->line.buf, s->line.len, &b);
+        if (st == GC_OK) {
+            st = gcode_execute(&s->gc, &b, cmds, &n);
+        }
+        assert(st == GC_OK && n == 1);
+        s->cmd = cmds[0];
+        s->pending = 1;
+        return;
+    }
+}
+
+/* Returns the run time in us */
+static uint32_t run(sim_t* s, uint32_t baud, int counting) {
+    memset(s, 0, sizeof *s);
+    byte_ring_init(&s->rx, s->rx_mem, RX_SIZE);
+    gcode_init(&s->gc);
+    s->min_rx_free = RX_SIZE;
+    s->min_planner_free = PLANNER_SLOTS;
+    const double byte_us = 10.0 * 1e6 / (double)baud; // 8N1
+    double wire_free_at = 0.0; // sender's UART is idle from here
+    uint32_t executed = 0, done_at = 0;
+
+    for (uint32_t now = 0;; ++now) {
+        if (executed == N_LINES && s->ua_count == 0) {
+            return done_at; // last block run and every ack home
+        }
+        // Sender: next byte onto the wire when allowed
+        if ((double)now >= wire_free_at && s->next_line < N_LINES) {
+            const char* l = prog[s->next_line];
+            const uint32_t len = (uint32_t)strlen(l);
+            const int may = counting ? (s->ua_bytes + len <= RX_SIZE || s->next_byte > 0)
+                                     : (s->ua_count == 0 || s->next_byte > 0);
+            if (may) {
+                if (s->next_byte == 0) {
+                    s->unacked[(s->ua_head + s->ua_count++) & 63U] = len;
+                    s->ua_bytes += len;
+                }
+                // The byte lands in the receiver's ring one byte time later; the ring must
+                // have room (the real DMA would overwrite unread bytes)
+                assert(byte_ring_free(&s->rx) > 0);
+                byte_ring_put(&s->rx, (uint8_t)l[s->next_byte++]);
+                wire_free_at = (double)now + byte_us;
+                if (s->next_byte == len) {
+                    s->next_byte = 0;
+                    s->next_line++;
+                }
+            }
+        }
+        if (byte_ring_used(&s->rx) > s->max_rx_used) {
+            s->max_rx_used = byte_ring_used(&s->rx);
+        }
+
+        // Receiver superloop
+        if (now % SERVICE_US == 0) {
+            receiver_service(s, now, byte_us);
+        }
+
+        // Machine: the head block runs
+        if (s->pl_count > 0) {
+            s->planner_us[s->pl_head] -= 1.0f;
+            if (s->planner_us[s->pl_head] <= 0.0f) {
+                s->pl_head = (s->pl_head + 1U) % PLANNER_SLOTS;
+                s->pl_count--;
+                if (++executed == N_LINES) {
+                    done_at = now;
+                }
+            }
+        } else if (executed > 0 && executed < N_LINES) {
+            s->starved_us++;
+        }
+
+        // Acks reaching the sender
+        while (s->ack_count > 0 && s->acks[s->ack_head & 63U].due_us <= now) {
+            const ack_t* a = &s->acks[s->ack_head++ & 63U];
+            s->ack_count--;
+            s->min_rx_free = a->rx_free < s->min_rx_free ? a->rx_free : s->min_rx_free;
+            s->min_planner_free =
+                    a->planner_free < s->min_planner_free ? a->planner_free : s->min_planner_free;
+            assert(s->ua_count > 0);
+            s->ua_bytes -= s->unacked[s->ua_head++ & 63U];
+            s->ua_count--;
+            s->acked++;
+        }
+    }
+}
+
+int main(void) {
+    static sim_t sim;
+    make_program();
+    const float machine_bps = FEED_MM_MIN / 60.0f / SEG_MM; // what the machine could do
+    const uint32_t bauds[] = {115200U, 1000000U};
+    printf("flow control: %u segments of %.2f mm at F%.0f (machine limit %.0f blocks/s)\n",
+           N_LINES, SEG_MM, FEED_MM_MIN, machine_bps);
+
+    for (int b = 0; b < 2; ++b) {
+        double bps[2];
+        for (int counting = 0; counting < 2; ++counting) {
+            const uint32_t t = run(&sim, bauds[b], counting);
+            bps[counting] = N_LINES * 1e6 / (double)t;
+            printf("  %7u baud %-17s %6.0f blocks/s  starved %5.1f%%  RX peak %3u B  "
+                   "min Bf %u,%u\n",
+                   bauds[b], counting ? "char-counting:" : "send-and-wait:", bps[counting],
+                   100.0 * (double)sim.starved_us / (double)t, sim.max_rx_used,
+                   sim.min_planner_free, sim.min_rx_free);
+            assert(sim.acked == N_LINES && sim.rx.dropped == 0 && sim.max_rx_used <= RX_SIZE);
+        }
+        assert(bps[1] > 1.3 * bps[0]); // the pipeline hides the round trip
+    }
+    // At 1 Mbaud the counting sender keeps the planner fed: close to the machine limit
+    assert(N_LINES * 1e6 / (double)run(&sim, 1000000U, 1) > 0.9 * machine_bps);
+    printf("All flow control tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,379 @@
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gcode.h"
+#include "gcode_arc.h"
+
+/*
+ * G-code front end: line assembly, word parsing, modal interpretation, and a fuzz pass that
+ * throws random and mutated lines at all three and checks nothing escapes its bounds. Arcs are
+ * walked chord by chord against the exact circle.
+ */
+
+static int near(float a, float b) {
+    return fabsf(a - b) <= 1e-4f * fmaxf(1.0f, fabsf(b));
+}
+
+/* Feed a whole string; return the number of completed lines (last one left in l) */
+static int feed(gcode_line_t* l, const char* s) {
+    int lines = 0;
+    while (*s) {
+        lines += gcode_line_feed(l, *s++) ? 1 : 0;
+    }
+    return lines;
+}
+
+static gc_status_t run(gcode_state_t* st, const char* text, gc_cmd_t* cmds, uint8_t* n) {
+    static gcode_line_t l;
+    gcode_block_t b;
+    char buf[128];
+    snprintf(buf, sizeof buf, "%s\n", text);
+    assert(feed(&l, buf) == 1);
+    gc_status_t e = gcode_parse(l.buf, l.len, &b);
+    if (e != GC_OK) {
+        return e;
+    }
+    return gcode_execute(st, &b, cmds, n);
+}
+
+static void test_line_assembler(void) {
+    gcode_line_t l = {0};
+    assert(feed(&l, "g1 x1.5 (move) y-2 ; trailing\r\n") == 1);
+    assert(strcmp(l.buf, "G1X1.5Y-2") == 0 && l.len == 9 && !l.overflow);
+    assert(feed(&l, "\n\n") == 0); // blank lines and the LF of CR LF are ignored
+    assert(feed(&l, "(only a comment)\n") == 1 && l.len == 0); // still answered
+
+    char longline[300];
+    memset(longline, 'X', sizeof longline - 2);
+    longline[sizeof longline - 2] = '\n';
+    longline[sizeof longline - 1] = '\0';
+    assert(feed(&l, longline) == 1 && l.overflow && l.len == GCODE_LINE_MAX);
+    assert(feed(&l, "G0X1\n") == 1 && !l.overflow);
+}
+
+static void test_parse_words(void) {
+    gcode_block_t b;
+    const char* s = "N10G1X-12.345Y.5Z+3F1200";
+    assert(gcode_parse(s, (uint16_t)strlen(s), &b) == GC_OK);
+    assert(b.motion == 1 && b.words == (GC_WORD_AXES | GC_WORD_F));
+    assert(near(b.xyz[0], -12.345f) && near(b.xyz[1], 0.5f) && near(b.xyz[2], 3.0f));
+    assert(near(b.f, 1200.0f));
+
+    s = "G0G1X1";
+    assert(gcode_parse(s, (uint16_t)strlen(s), &b) == GC_ERR_MODAL_CONFLICT);
+    s = "X1X2";
+    assert(gcode_parse(s, (uint16_t)strlen(s), &b) == GC_ERR_REPEATED_WORD);
+    s = "G38.2Z-5";
+    assert(gcode_parse(s, (uint16_t)strlen(s), &b) == GC_ERR_UNSUPPORTED_G);
+    s = "M7";
+    assert(gcode_parse(s, (uint16_t)strlen(s), &b) == GC_ERR_UNSUPPORTED_M);
+    s = "G1X";
+    assert(gcode_parse(s, (uint16_t)strlen(s), &b) == GC_ERR_BAD_NUMBER);
+    s = "Q1";
+    assert(gcode_parse(s, (uint16_t)strlen(s), &b) == GC_ERR_BAD_WORD);
+    assert(gcode_parse("", 0, &b) == GC_ERR_EMPTY);
+
+    // Number reader against strtod
+    srand(3);
+    for (int k = 0; k < 20000; ++k) {
+        char num[32];
+        const int ip = rand() % 100000;
+        const int fp = rand() % 10000;
+        snprintf(num, sizeof num, "X%s%d.%04d", (rand() & 1) ? "-" : "", ip, fp);
+        assert(gcode_parse(num, (uint16_t)strlen(num), &b) == GC_OK);
+        const double ref = strtod(num + 1, NULL);
+        assert(fabs((double)b.xyz[0] - ref) <= 1e-6 * fmax(1.0, fabs(ref)));
+    }
+}
+
+static void test_modal_state(void) {
+    gcode_state_t st;
+    gc_cmd_t c[GCODE_MAX_CMDS];
+    uint8_t n;
+    gcode_init(&st);
+
+    assert(run(&st, "G1X10", c, &n) == GC_ERR_NO_FEED);
+    assert(st.pos[0] == 0.0f); // refused lines leave the state alone
+    assert(run(&st, "G1X10Y5F600", c, &n) == GC_OK && n == 1);
+    assert(c[0].type == GC_CMD_LINE && near(c[0].target[0], 10.0f) && c[0].feed_mm_min == 600.0f);
+    assert(run(&st, "Y7", c, &n) == GC_OK && c[0].type == GC_CMD_LINE); // modal G1
+    assert(near(c[0].target[0], 10.0f) && near(c[0].target[1], 7.0f));
+
+    assert(run(&st, "G91G0X1Z-2", c, &n) == GC_OK && c[0].type == GC_CMD_RAPID);
+    assert(near(c[0].target[0], 11.0f) && near(c[0].target[2], -2.0f));
+
+    assert(run(&st, "G90G20X1", c, &n) == GC_OK);
+    assert(near(c[0].target[0], 25.4f) && near(c[0].target[1], 7.0f));
+    assert(run(&st, "G21", c, &n) == GC_OK && n == 0);
+
+    // G92: the current point becomes X0, later absolute moves are shifted
+    assert(run(&st, "G92X0", c, &n) == GC_OK && n == 0);
+    assert(run(&st, "G0X5", c, &n) == GC_OK && near(c[0].target[0], 30.4f));
+
+    // G28 via an intermediate point, then machine zero on that axis only
+    assert(run(&st, "G28Z3", c, &n) == GC_OK && n == 2);
+    assert(near(c[0].target[2], 3.0f) && c[1].target[2] == 0.0f && near(c[1].target[0], 30.4f));
+    assert(run(&st, "G28", c, &n) == GC_OK && n == 1);
+    assert(c[0].target[0] == 0.0f && c[0].target[1] == 0.0f && c[0].target[2] == 0.0f);
+
+    assert(run(&st, "G4", c, &n) == GC_ERR_MISSING_WORDS);
+    assert(run(&st, "G4P0.25", c, &n) == GC_OK && c[0].type == GC_CMD_DWELL);
+    assert(near(c[0].seconds, 0.25f));
+    assert(run(&st, "G1X1F100M5", c, &n) == GC_OK && n == 2);
+    assert(c[0].type == GC_CMD_LINE && c[1].type == GC_CMD_MCODE && c[1].mcode == 5);
+}
+
+/* G54..G59 origins from G10, with G92 layered on the active one */
+static void test_work_offsets(void) {
+    gcode_state_t st;
+    gc_cmd_t c[GCODE_MAX_CMDS];
+    uint8_t n;
+    gcode_init(&st);
+
+    assert(run(&st, "G10L2P2X100Y50", c, &n) == GC_OK && n == 0);
+    assert(run(&st, "G0X1Y1", c, &n) == GC_OK && near(c[0].target[0], 1.0f)); // still G54
+    assert(run(&st, "G55X1Y1", c, &n) == GC_OK);
+    assert(near(c[0].target[0], 101.0f) && near(c[0].target[1], 51.0f) && st.coord == 1);
+
+    // L20: the current point (machine 101, 51) becomes G56 X0 Y-2
+    assert(run(&st, "G10L20P3X0Y-2", c, &n) == GC_OK && n == 0);
+    assert(near(st.wcs[2][0], 101.0f) && near(st.wcs[2][1], 53.0f));
+    assert(run(&st, "G56G0X5Y-2", c, &n) == GC_OK);
+    assert(near(c[0].target[0], 106.0f) && near(c[0].target[1], 51.0f));
+
+    // G92 shifts the active system further; switching systems keeps it
+    assert(run(&st, "G92X0", c, &n) == GC_OK && n == 0);
+    assert(run(&st, "X1", c, &n) == GC_OK && near(c[0].target[0], 107.0f));
+    assert(run(&st, "G54X1", c, &n) == GC_OK && near(c[0].target[0], 6.0f));
+    assert(run(&st, "G10L2P0X-10", c, &n) == GC_OK); // P0: the active system (G54)
+    assert(run(&st, "X1", c, &n) == GC_OK && near(c[0].target[0], -4.0f));
+
+    // Inches scale the offsets given on the line
+    assert(run(&st, "G20G10L2P6Z1", c, &n) == GC_OK && near(st.wcs[5][2], 25.4f));
+    assert(run(&st, "G21G59Z0", c, &n) == GC_OK && near(c[0].target[2], 25.4f));
+
+    // G28 and machine zero ignore every offset
+    assert(run(&st, "G28", c, &n) == GC_OK && c[0].target[0] == 0.0f && c[0].target[2] == 0.0f);
+
+    assert(run(&st, "G10L2X1", c, &n) == GC_ERR_MISSING_WORDS);
+    assert(run(&st, "G10P1X1", c, &n) == GC_ERR_MISSING_WORDS);
+    assert(run(&st, "G10L1P1X1", c, &n) == GC_ERR_UNSUPPORTED);
+    assert(run(&st, "G10L2P7X1", c, &n) == GC_ERR_BAD_VALUE);
+    assert(run(&st, "G10L2P1.5X1", c, &n) == GC_ERR_BAD_VALUE);
+    assert(run(&st, "G54G55", c, &n) == GC_ERR_MODAL_CONFLICT);
+    assert(run(&st, "G59.1", c, &n) == GC_ERR_UNSUPPORTED_G);
+}
+
+static void test_arcs(void) {
+    gcode_state_t st;
+    gc_cmd_t c[GCODE_MAX_CMDS];
+    uint8_t n;
+    gcode_init(&st);
+
+    assert(run(&st, "G2X10Y0I5F300", c, &n) == GC_OK && c[0].type == GC_CMD_ARC);
+    assert(!c[0].ccw && c[0].plane == 17 && near(c[0].center[0], 5.0f) && c[0].center[1] == 0.0f);
+
+    // R form: G2 from (10,0) to (20,0), R10 short arc -> center below the chord
+    assert(run(&st, "X20R10", c, &n) == GC_OK);
+    assert(near(c[0].center[0], 15.0f) && near(c[0].center[1], -8.660254f));
+    assert(run(&st, "G3X30R10", c, &n) == GC_OK);
+    assert(c[0].ccw && near(c[0].center[1], 8.660254f));
+    assert(run(&st, "G2X40R-10", c, &n) == GC_OK); // long way round
+    assert(near(c[0].center[1], 8.660254f));
+    assert(run(&st, "G2X100R1", c, &n) == GC_ERR_MISSING_WORDS); // radius too small
+
+    assert(run(&st, "G18G2X40Z10K5", c, &n) == GC_OK && c[0].plane == 18);
+    assert(near(c[0].center[2], 5.0f) && near(c[0].center[0], 40.0f));
+    assert(run(&st, "G17G2X0", c, &n) == GC_ERR_MISSING_WORDS); // no I/J/R
+    assert(run(&st, "G2", c, &n) == GC_ERR_MISSING_WORDS);
+}
+
+static double s_arc_radial; // worst distance of a point from the circle in the last walk_arc()
+
+/*
+ * Walk the chords of `c` from `start`: every point within 2 float ulp of the circle and of tol,
+ * at its exact angle up to the float resolution of that angle, every chord within `tol` of the
+ * arc, the helix axis linear, and the last point the target itself. Returns the number of
+ * segments.
+ */
+static uint32_t walk_arc(const float start[3], const gc_cmd_t* c, float tol, double angle) {
+    gc_arc_t a;
+    gc_arc_init(&a, start, c, tol);
+    int a0, a1;
+    gcode_plane_axes(c->plane, &a0, &a1);
+    const int a2 = 3 - a0 - a1;
+    const double x0 = start[a0] - c->center[a0], y0 = start[a1] - c->center[a1];
+    const double r = sqrt(x0 * x0 + y0 * y0);
+    // One float ulp of the coordinates (bounded by r plus the centre's offset)
+    const double ulp = FLT_EPSILON * (r + fabs(c->center[a0]) + fabs(c->center[a1]));
+
+    float prev[3] = {start[0], start[1], start[2]};
+    float p[3];
+    uint32_t k = 0;
+    double worst = 0.0;
+    s_arc_radial = 0.0;
+    while (gc_arc_next(&a, p)) {
+        k++;
+        // Off the circle: what adds to the chord error
+        const double radial = fabs(hypot(p[a0] - c->center[a0], p[a1] - c->center[a1]) - r);
+        s_arc_radial = radial > s_arc_radial ? radial : s_arc_radial;
+        assert(radial <= 2.0 * ulp && radial <= tol);
+
+        // Along the circle: a float angle resolves |t| only to ~|t| ulp, times r
+        const double t = angle * (double)k / (double)a.segments;
+        const double ex = c->center[a0] + x0 * cos(t) - y0 * sin(t);
+        const double ey = c->center[a1] + x0 * sin(t) + y0 * cos(t);
+        const double err = hypot(p[a0] - ex, p[a1] - ey);
+        worst = err > worst ? err : worst;
+        assert(err <= 2.0 * ulp + 2.0 * FLT_EPSILON * fabs(t) * r);
+
+        const double mx = 0.5 * (p[a0] + prev[a0]) - c->center[a0];
+        const double my = 0.5 * (p[a1] + prev[a1]) - c->center[a1];
+        assert(r - sqrt(mx * mx + my * my) <= tol + 2.0 * ulp); // sagitta
+        const double lin = start[a2] + (c->target[a2] - start[a2]) * (double)k / a.segments;
+        assert(fabs(p[a2] - lin) <= 1e-5 * fmax(1.0, fabs(lin)));
+        memcpy(prev, p, sizeof prev);
+    }
+    assert(k == a.segments && !gc_arc_next(&a, p));
+    assert(memcmp(p, c->target, sizeof p) == 0);
+
+    const uint32_t want = (uint32_t)ceil(fabs(angle) * r / (2.0 * sqrt(tol * (2.0 * r - tol))));
+    assert(k == (want ? want : 1U) || k == want + 1U); // float rounding at the ceiling
+    printf("gcode arc: r %.1f, %.0f deg, tol %.4f: %u chords, %.2e mm off the circle, "
+           "%.2e mm from the exact point\n",
+           r, angle * 180.0 / 3.14159265358979, tol, k, s_arc_radial, worst);
+    return k;
+}
+
+static void test_arc_segments(void) {
+    const double pi = 3.14159265358979;
+    gcode_state_t st;
+    gc_cmd_t c[GCODE_MAX_CMDS];
+    uint8_t n;
+    gcode_init(&st);
+
+    // Quarter and half circles both ways, from (10, 0) around the origin
+    float start[3] = {10.0f, 0.0f, 0.0f};
+    st.pos[0] = 10.0f;
+    assert(run(&st, "G3X0Y10I-10F600", c, &n) == GC_OK);
+    const uint32_t quarter = walk_arc(start, &c[0], 0.002f, pi / 2.0);
+    st.pos[0] = 10.0f;
+    st.pos[1] = 0.0f;
+    assert(run(&st, "G2X-10Y0I-10", c, &n) == GC_OK);
+    const uint32_t half = walk_arc(start, &c[0], 0.002f, -pi);
+    assert(half == 2U * quarter || half == 2U * quarter - 1U); // one ceil fewer
+
+    // Looser tolerance, fewer chords; a circle smaller than the tolerance is one line
+    assert(walk_arc(start, &c[0], 0.05f, -pi) < quarter);
+    st.pos[0] = 0.001f;
+    st.pos[1] = 0.0f;
+    float tiny[3] = {0.001f, 0.0f, 0.0f};
+    assert(run(&st, "G2X-0.001Y0I-0.001", c, &n) == GC_OK);
+    assert(walk_arc(tiny, &c[0], 0.01f, -pi) == 1U);
+
+    // Same end point: a full circle, here as a helix that climbs 5 mm
+    st.pos[0] = 10.0f;
+    st.pos[1] = 0.0f;
+    st.pos[2] = 0.0f;
+    assert(run(&st, "G3X10Y0Z5I-10", c, &n) == GC_OK);
+    walk_arc(start, &c[0], 0.002f, 2.0 * pi);
+
+    // The other planes: G18 (ZX) and G19 (YZ), counter-clockwise as seen down Y / X
+    st.pos[0] = 10.0f;
+    st.pos[2] = 0.0f;
+    assert(run(&st, "G18G3X0Z-10I-10", c, &n) == GC_OK && c[0].plane == 18);
+    walk_arc(start, &c[0], 0.002f, pi / 2.0);
+    float on_y[3] = {0.0f, 10.0f, 0.0f};
+    st.pos[0] = 0.0f;
+    st.pos[1] = 10.0f;
+    st.pos[2] = 0.0f;
+    assert(run(&st, "G19G3Y0Z10J-10", c, &n) == GC_OK && c[0].plane == 19);
+    walk_arc(on_y, &c[0], 0.002f, pi / 2.0);
+
+    // Thousands of chords: the periodic exact correction keeps the rotation on the circle
+    float big[3] = {500.0f, 0.0f, 0.0f};
+    st.pos[0] = 500.0f;
+    st.pos[1] = 0.0f;
+    st.pos[2] = 0.0f;
+    assert(run(&st, "G17G2X500Y0I-500", c, &n) == GC_OK);
+    assert(walk_arc(big, &c[0], 0.0001f, -2.0 * pi) > 4000U);
+    assert(s_arc_radial <= 0.0001); // within the 0.1 um tolerance of the circle at r = 500
+}
+
+/* Random bytes and mutated real lines: every result is a known status, no NaN leaks out */
+static void test_fuzz(void) {
+    static const char* seeds[] = {"G1X10.5Y-3F1200", "G2X5Y5I2.5J0", "G92X0Y0Z0", "G4P1",
+                                  "G28X1", "G91G0Z-1.25", "M30", "G20G1X.1F10", "G3X1R-5",
+                                  "G10L20P2X3", "G56G0Y-4"};
+    const char alphabet[] = "GMXYZIJKRFPSLN0123456789.-+ ()%;\t\r\nabcxyzQ";
+    gcode_state_t st;
+    gcode_line_t l = {0};
+    gcode_init(&st);
+    srand(11);
+
+    uint32_t lines = 0, ok = 0;
+    for (int k = 0; k < 200000; ++k) {
+        char buf[160];
+        int len;
+        if (k & 1) {
+            len = rand() % (int)(sizeof buf);
+            for (int i = 0; i < len; ++i) {
+                buf[i] = (rand() % 4) ? alphabet[rand() % (int)(sizeof alphabet - 1)]
+                                      : (char)(rand() & 0xFF);
+            }
+        } else {
+            const int seed = rand() % (int)(sizeof seeds / sizeof seeds[0]);
+            len = snprintf(buf, sizeof buf, "%s", seeds[seed]);
+            for (int m = rand() % 4; m > 0; --m) {
+                buf[rand() % len] = alphabet[rand() % (int)(sizeof alphabet - 1)];
+            }
+        }
+        buf[len++] = '\n';
+
+        for (int i = 0; i < len; ++i) {
+            if (!gcode_line_feed(&l, buf[i])) {
+                continue;
+            }
+            lines++;
+            assert(l.len <= GCODE_LINE_MAX && l.buf[l.len] == '\0');
+            gcode_block_t b;
+            gc_cmd_t c[GCODE_MAX_CMDS];
+            uint8_t n = 0;
+            gc_status_t e = gcode_parse(l.buf, l.len, &b);
+            if (e == GC_OK) {
+                e = gcode_execute(&st, &b, c, &n);
+            }
+            assert(e <= GC_ERR_BAD_VALUE && n <= GCODE_MAX_CMDS);
+            if (e == GC_OK) {
+                ok++;
+                for (int j = 0; j < 3; ++j) {
+                    assert(isfinite(st.pos[j]) && isfinite(st.offset[j]));
+                    assert(isfinite(st.wcs[st.coord][j]) && st.coord < GCODE_WCS_COUNT);
+                }
+                if (fabsf(st.pos[0]) > 1e6f || fabsf(st.offset[0]) > 1e6f ||
+                    fabsf(st.wcs[st.coord][0]) > 1e6f) {
+                    gcode_init(&st); // keep float magnitudes sane for the next round
+                }
+            }
+        }
+    }
+    printf("gcode fuzz: %u lines, %u accepted\n", lines, ok);
+    assert(ok > 1000);
+}
+
+int main(void) {
+    test_line_assembler();
+    test_parse_words();
+    test_modal_state();
+    test_work_offsets();
+    test_arcs();
+    test_arc_segments();
+    test_fuzz();
+    printf("All gcode tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,376 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app_init.h"
+#include "gcode_stream.h"
+#include "motion.h"
+#include "sim_trace.h"
+#include "stepgen_pwm_tim3.h"
+#include "stm32_sim.h"
+
+/*
+ * Golden trajectories: a G-code program (tests/golden/<name>.nc) is sent line by line over
+ * the emulated USART2, waiting for each reply like a send-and-wait sender, and runs through
+ * gcode_stream (parser, arcs), the planner and the step engine unchanged. The STEP / DIR pins
+ * are traced and reduced to <name>.golden:
+ *  - exact, per axis: STEP rises, DIR reversals, the final step counter, and a hash of the
+ *    DIR level at every rise (the whole step / direction sequence, timing left out)
+ *  - with a tolerance: the time of the first, n/4, n/2, 3n/4 and last rise of each axis and
+ *    of the last rise overall, from the first rise on any axis
+ *
+ *     test_golden <name>.nc            compare (timing within 20 us + 0.5 %)
+ *     test_golden <name>.nc --counts   exact part only, for step engine work that moves time
+ *     test_golden <name>.nc --tol-us 50 --tol-pct 2
+ *     test_golden <name>.nc --update   rewrite <name>.golden from this run
+ */
+
+#define SKIP 77
+#define EDGES (1U << 18)
+#define MARKS 5 // rise 1, n/4, n/2, 3n/4, n
+
+typedef struct {
+    uint32_t rises;
+    uint32_t reversals;
+    int32_t final;
+    uint64_t hash;
+    double t_us[MARKS];
+} axis_run_t;
+
+typedef struct {
+    axis_run_t axis[3];
+    double end_us;
+} golden_t;
+
+static const char AXIS_NAME[3] = {'x', 'y', 'z'};
+
+static sim_trace_edge_t s_buf[EDGES];
+
+/* ---- Sender: one line out, wait for its "ok" / "error:" ---- */
+
+static char s_reply[128];
+static size_t s_reply_len;
+static uint32_t s_replies, s_want;
+static uint32_t s_errors;
+
+static void on_reply(void) {
+    s_reply[s_reply_len] = '\0';
+    if (strncmp(s_reply, "ok", 2) == 0) {
+        s_replies++;
+    } else if (strncmp(s_reply, "error:", 6) == 0) {
+        s_replies++;
+        s_errors++;
+        fprintf(stderr, "golden: %s\n", s_reply);
+    }
+    s_reply_len = 0;
+}
+
+/* The superloop, run after every emulator event */
+static bool pump(void) {
+    gcode_stream_service();
+    char buf[64];
+    size_t n;
+    while ((n = sim_uart_tx(buf, sizeof buf)) != 0U) {
+        for (size_t i = 0; i < n; ++i) {
+            if (buf[i] == '\n') {
+                on_reply();
+            } else if (buf[i] != '\r' && s_reply_len < sizeof s_reply - 1U) {
+                s_reply[s_reply_len++] = buf[i];
+            }
+        }
+    }
+    return s_replies == s_want;
+}
+
+static bool pump_idle(void) {
+    return pump() && !motion_busy();
+}
+
+static bool send_program(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "golden: cannot open %s\n", path);
+        return false;
+    }
+    char line[128];
+    while (fgets(line, sizeof line, f) != NULL) {
+        size_t n = strcspn(line, "\r\n");
+        line[n] = '\0';
+        if (strspn(line, " \t") == n) {
+            continue; // a blank line gets no reply
+        }
+        line[n++] = '\n';
+        s_want++;
+        sim_uart_rx(line, n);
+        if (!sim_run_until(pump, SIM_MS(60000))) {
+            fprintf(stderr, "golden: no reply to \"%.*s\"\n", (int)(n - 1U), line);
+            fclose(f);
+            return false;
+        }
+    }
+    fclose(f);
+    const bool idle = sim_run_until(pump_idle, SIM_MS(60000));
+    sim_run(SIM_MS(1)); // the last pulses fall
+    return idle;
+}
+
+/* ---- Reduce the trace ---- */
+
+static uint64_t fnv1a(uint64_t h, uint8_t byte) {
+    return (h ^ byte) * 0x100000001b3ULL;
+}
+
+static double us_since(uint64_t t, uint64_t t0) {
+    return (double)(t - t0) / (double)(SIM_HCLK_HZ / 1000000ULL);
+}
+
+static void reduce(const sim_trace_t* tr, golden_t* g) {
+    memset(g, 0, sizeof *g);
+    bool dir[3], last_dir[3];
+    uint64_t t_first = 0;
+    bool any = false;
+    for (int a = 0; a < 3; ++a) {
+        dir[a] = tr->ch[SIM_TRACE_CH(a, SIM_TRACE_DIR)].level0;
+        last_dir[a] = dir[a];
+        g->axis[a].hash = 0xcbf29ce484222325ULL;
+    }
+    // Pass 1: sequence and counts
+    for (size_t i = 0; i < tr->n; ++i) {
+        const sim_trace_edge_t* e = &tr->edges[i];
+        const int a = e->ch / 3;
+        if (e->ch % 3 == SIM_TRACE_DIR) {
+            dir[a] = e->level;
+        } else if (e->ch % 3 == SIM_TRACE_STEP && e->level) {
+            axis_run_t* r = &g->axis[a];
+            if (r->rises != 0U && dir[a] != last_dir[a]) {
+                r->reversals++;
+            }
+            last_dir[a] = dir[a];
+            r->hash = fnv1a(r->hash, dir[a] ? '1' : '0');
+            r->rises++;
+            if (!any) {
+                t_first = e->t;
+                any = true;
+            }
+        }
+    }
+    // Pass 2: the time marks, now that each axis' rise count is known
+    uint32_t k[3] = {0, 0, 0};
+    for (size_t i = 0; i < tr->n; ++i) {
+        const sim_trace_edge_t* e = &tr->edges[i];
+        if (e->ch % 3 != SIM_TRACE_STEP || !e->level) {
+            continue;
+        }
+        axis_run_t* r = &g->axis[e->ch / 3];
+        const uint32_t at = k[e->ch / 3]++;
+        for (int m = 0; m < MARKS; ++m) {
+            const uint32_t want = m == MARKS - 1 ? r->rises - 1U : r->rises * (uint32_t)m / 4U;
+            if (at == want) {
+                r->t_us[m] = us_since(e->t, t_first);
+            }
+        }
+        g->end_us = us_since(e->t, t_first);
+    }
+    int32_t pos[3];
+    stepgen_position(pos);
+    for (int a = 0; a < 3; ++a) {
+        g->axis[a].final = pos[a];
+    }
+}
+
+/* ---- Golden file ---- */
+
+static bool write_golden(const char* path, const char* program, const golden_t* g) {
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        return false;
+    }
+    const char* base = strrchr(program, '/');
+    base = base != NULL ? base + 1 : program;
+    fprintf(f, "# %s (rewrite with: test_golden %s --update)\n", base, base);
+    fprintf(f, "# axis <name> rises <n> reversals <n> final <steps> hash <FNV-1a of DIR at each "
+               "rise>\n");
+    for (int a = 0; a < 3; ++a) {
+        const axis_run_t* r = &g->axis[a];
+        fprintf(f, "axis %c rises %" PRIu32 " reversals %" PRIu32 " final %" PRId32
+                   " hash %016" PRIx64 "\n",
+                AXIS_NAME[a], r->rises, r->reversals, r->final, r->hash);
+    }
+    fprintf(f, "# time <name> <us at rise 1, n/4, n/2, 3n/4, n> from the first rise on any axis\n");
+    for (int a = 0; a < 3; ++a) {
+        fprintf(f, "time %c", AXIS_NAME[a]);
+        for (int m = 0; m < MARKS; ++m) {
+            fprintf(f, " %.3f", g->axis[a].t_us[m]);
+        }
+        fprintf(f, "\n");
+    }
+    fprintf(f, "end %.3f\n", g->end_us);
+    return fclose(f) == 0;
+}
+
+static bool read_golden(const char* path, golden_t* g) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        return false;
+    }
+    memset(g, 0, sizeof *g);
+    unsigned seen = 0; // bit per line kind and axis
+    char line[256];
+    while (fgets(line, sizeof line, f) != NULL) {
+        char name;
+        int used = 0;
+        axis_run_t r;
+        if (sscanf(line, "axis %c rises %" SCNu32 " reversals %" SCNu32 " final %" SCNd32
+                         " hash %" SCNx64,
+                   &name, &r.rises, &r.reversals, &r.final, &r.hash) == 5) {
+            const char* p = memchr(AXIS_NAME, name, 3);
+            if (p != NULL) {
+                axis_run_t* dst = &g->axis[p - AXIS_NAME];
+                dst->rises = r.rises;
+                dst->reversals = r.reversals;
+                dst->final = r.final;
+                dst->hash = r.hash;
+                seen |= 1U << (p - AXIS_NAME);
+            }
+        } else if (sscanf(line, "time %c%n", &name, &used) == 1) {
+            const char* p = memchr(AXIS_NAME, name, 3);
+            int m = 0;
+            for (const char* s = line + used; p != NULL && m < MARKS; ++m) {
+                char* end;
+                g->axis[p - AXIS_NAME].t_us[m] = strtod(s, &end);
+                if (end == s) {
+                    break;
+                }
+                s = end;
+            }
+            if (m == MARKS) {
+                seen |= 8U << (p - AXIS_NAME);
+            }
+        } else if (sscanf(line, "end %lf", &g->end_us) == 1) {
+            seen |= 64U;
+        }
+    }
+    fclose(f);
+    return seen == 127U;
+}
+
+/* ---- Compare ---- */
+
+typedef struct {
+    bool timing;
+    double tol_us, tol_pct;
+} compare_opts_t;
+
+static bool near(double got, double want, const compare_opts_t* o) {
+    return fabs(got - want) <= o->tol_us + fabs(want) * o->tol_pct / 100.0;
+}
+
+static int compare(const golden_t* got, const golden_t* want, const compare_opts_t* o) {
+    int bad = 0;
+    for (int a = 0; a < 3; ++a) {
+        const axis_run_t* g = &got->axis[a];
+        const axis_run_t* w = &want->axis[a];
+        if (g->rises != w->rises || g->reversals != w->reversals || g->final != w->final ||
+            g->hash != w->hash) {
+            fprintf(stderr,
+                    "golden: %c rises %" PRIu32 " reversals %" PRIu32 " final %" PRId32
+                    " hash %016" PRIx64 ", want %" PRIu32 " %" PRIu32 " %" PRId32
+                    " %016" PRIx64 "\n",
+                    AXIS_NAME[a], g->rises, g->reversals, g->final, g->hash, w->rises,
+                    w->reversals, w->final, w->hash);
+            bad++;
+        }
+        for (int m = 0; o->timing && m < MARKS; ++m) {
+            if (!near(g->t_us[m], w->t_us[m], o)) {
+                fprintf(stderr, "golden: %c mark %d at %.3f us, want %.3f\n", AXIS_NAME[a], m,
+                        g->t_us[m], w->t_us[m]);
+                bad++;
+            }
+        }
+    }
+    if (o->timing && !near(got->end_us, want->end_us, o)) {
+        fprintf(stderr, "golden: last rise at %.3f us, want %.3f\n", got->end_us, want->end_us);
+        bad++;
+    }
+    return bad;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <program.nc> [--update] [--counts] [--tol-us N] "
+                        "[--tol-pct P]\n", argv[0]);
+        return 2;
+    }
+    const char* program = argv[1];
+    bool update = false;
+    compare_opts_t o = {.timing = true, .tol_us = 20.0, .tol_pct = 0.5};
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else if (strcmp(argv[i], "--counts") == 0) {
+            o.timing = false;
+        } else if (strcmp(argv[i], "--tol-us") == 0 && i + 1 < argc) {
+            o.tol_us = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--tol-pct") == 0 && i + 1 < argc) {
+            o.tol_pct = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "golden: unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+    char golden_path[512];
+    const size_t len = strlen(program);
+    if (len < 3 || strcmp(program + len - 3, ".nc") != 0 || len + 5 >= sizeof golden_path) {
+        fprintf(stderr, "golden: %s is not a .nc program\n", program);
+        return 2;
+    }
+    snprintf(golden_path, sizeof golden_path, "%.*s.golden", (int)(len - 3), program);
+
+    if (!sim_init()) {
+        printf("sim: cannot map the register blocks here, skipped\n");
+        return SKIP;
+    }
+    app_init();
+    gcode_stream_init();
+    sim_run(SIM_MS(5));
+
+    sim_trace_t tr;
+    sim_trace_init(&tr, s_buf, EDGES);
+    sim_trace_add_axes(&tr);
+    assert(sim_trace_start(&tr));
+    const bool ran = send_program(program);
+    sim_trace_stop(&tr);
+    if (!ran || s_errors != 0U || tr.dropped != 0U) {
+        fprintf(stderr, "golden: %s did not run cleanly (%" PRIu32 " errors, %" PRIu32
+                        " edges dropped)\n", program, s_errors, tr.dropped);
+        return 1;
+    }
+
+    golden_t got;
+    reduce(&tr, &got);
+    for (int a = 0; a < 3; ++a) {
+        printf("%c: %" PRIu32 " rises, %" PRIu32 " reversals, final %" PRId32 ", last at %.1f us\n",
+               AXIS_NAME[a], got.axis[a].rises, got.axis[a].reversals, got.axis[a].final,
+               got.axis[a].t_us[MARKS - 1]);
+    }
+    if (update) {
+        if (!write_golden(golden_path, program, &got)) {
+            fprintf(stderr, "golden: cannot write %s\n", golden_path);
+            return 1;
+        }
+        printf("wrote %s\n", golden_path);
+        return 0;
+    }
+    golden_t want;
+    if (!read_golden(golden_path, &want)) {
+        fprintf(stderr, "golden: no usable %s (run with --update)\n", golden_path);
+        return 1;
+    }
+    const int bad = compare(&got, &want, &o);
+    printf("%s: %s\n", golden_path, bad == 0 ? "match" : "MISMATCH");
+    return bad == 0 ? 0 : 1;
+}
@@ -0,0 +1,364 @@
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "home_sm.h"
+#include "vdeb.h"
+
+/*
+ * Homing state machines against simulated axes at 1 ms ticks, the way home_tick() drives
+ * them from SysTick. Each axis steps at its feed (whole steps, 200 steps/mm); its MIN
+ * switch closes at pos <= 0 and is lane i of the inputs word (vdeb_t: first edge trips, 5-sample
+ * debounce). A move toward MIN stops on the first closed step like the EXTI trip does, or,
+ * with edge_stop = 0 (the old polled scheme), once the debouncer agrees. An armed capture
+ * records the step count at the first closed step, like the EXTI sampling
+ * stepgen_steps_issued(). Checks phase order and timing, Z-before-XY grouping, the failure
+ * paths, how much sooner concurrent homing finishes than one axis at a time, and the
+ * overshoot / home error of the two-pass latch against the single pass.
+ */
+
+#define DEBOUNCE_TICKS 5
+#define SPM 200.0f // steps per mm (1600 steps/rev on an 8 mm lead)
+
+typedef struct {
+    int32_t pos; // steps, switch closes at pos <= 0
+    uint32_t left; // steps left in the current move
+    int dir; // +1 away from MIN, -1 toward
+    float rate; // steps per ms
+    float acc; // step fraction carried to the next ms
+    float phase0; // acc at the start of a move (where in the ms the first step falls)
+    uint32_t issued; // steps since the move started (stepgen_steps_issued)
+    int armed, hit, no_exti; // capture
+    uint32_t cap; // issued at the first closed step
+    uint32_t seek_overrun; // steps past the edge when the fast seek stopped
+    int broken; // 1: switch never closes, 2: always closed, 3: sticks once closed
+    uint32_t phase_at[HOME_FAILED + 1]; // sim time each phase was entered
+} sim_axis_t;
+
+static sim_axis_t ax[HOME_AXES];
+static vdeb_t deb; // the inputs word, lane i = axis i's MIN
+static home_seq_t seq;
+static uint32_t now_ms;
+static int edge_stop = 1;
+
+static const home_params_t P = {.fast_feed_mm_min = 1800.0f,
+                                .slow_feed_mm_min = 300.0f,
+                                .backoff_mm = 3.5f,
+                                .seek_span_mm = 220.0f,
+                                .home_offset_mm = 1.0f};
+
+static float mm(const sim_axis_t* a) {
+    return (float)a->pos / SPM;
+}
+
+static int raw_switch(sim_axis_t* a) {
+    if (a->broken == 3 && a->pos <= 0) {
+        a->broken = 2;
+    }
+    return a->broken == 2 || (a->broken != 1 && a->pos <= 0);
+}
+
+static int pressed_db(int i) {
+    return (deb.stable & HOME_BIT(i)) != 0U;
+}
+
+static void sim_seed(int i) {
+    const uint32_t m = HOME_BIT(i);
+    vdeb_set(&deb, m, raw_switch(&ax[i]) ? m : 0U, DEBOUNCE_TICKS); // limits_init_min()
+}
+
+static void sim_reset(float x0, float y0, float z0) {
+    memset(ax, 0, sizeof ax);
+    ax[0].pos = (int32_t)lroundf(x0 * SPM);
+    ax[1].pos = (int32_t)lroundf(y0 * SPM);
+    ax[2].pos = (int32_t)lroundf(z0 * SPM);
+    vdeb_init(&deb, 0, DEBOUNCE_TICKS);
+    for (int i = 0; i < 3; ++i) {
+        sim_seed(i);
+    }
+    now_ms = 0;
+}
+
+static void sim_tick_axes(void) {
+    for (int i = 0; i < 3; ++i) {
+        sim_axis_t* a = &ax[i];
+        if (a->left > 0) {
+            a->acc += a->rate;
+            uint32_t n = (uint32_t)a->acc;
+            a->acc -= (float)n;
+            n = n < a->left ? n : a->left;
+            for (uint32_t k = 0; k < n && a->left > 0; ++k) {
+                a->pos += a->dir;
+                a->issued++;
+                a->left--;
+                if (!raw_switch(a) || a->no_exti || !vdeb_trip(&deb, HOME_BIT(i))) {
+                    continue;
+                }
+                // EXTI on the first closed step: capture, then stepgen_trip_min()
+                if (a->armed && !a->hit) {
+                    a->hit = 1;
+                    a->cap = a->issued;
+                }
+                if (edge_stop && a->dir < 0) {
+                    a->left = 0;
+                }
+            }
+        }
+    }
+    uint32_t raw = 0;
+    for (int i = 0; i < 3; ++i) {
+        raw |= raw_switch(&ax[i]) ? HOME_BIT(i) : 0U;
+    }
+    vdeb_tick(&deb, raw); // inputs_tick()
+    for (int i = 0; i < 3; ++i) {
+        sim_axis_t* a = &ax[i];
+        // Step ISR: a move toward MIN stops once limits_block_neg() says so
+        const uint32_t block = (edge_stop ? vdeb_active(&deb) : deb.stable) & HOME_BIT(i);
+        if (a->left > 0 && a->dir < 0 && block) {
+            a->left = 0;
+        }
+    }
+}
+
+/* Run to completion; returns the total time in ms */
+static uint32_t run_p(const home_params_t p[3], const uint8_t* groups, uint8_t n) {
+    home_seq_start(&seq, p, groups, n);
+    home_phase_t last[3] = {HOME_IDLE, HOME_IDLE, HOME_IDLE};
+    while (home_seq_active(&seq)) {
+        now_ms++;
+        sim_tick_axes();
+        uint8_t pressed = 0, busy = 0;
+        for (int i = 0; i < 3; ++i) {
+            sim_axis_t* a = &ax[i];
+            pressed |= pressed_db(i) ? (uint8_t)HOME_BIT(i) : 0U;
+            busy |= a->left > 0 ? (uint8_t)HOME_BIT(i) : 0U;
+            if (a->armed && a->left == 0) {
+                if (a->hit) { // home_tick(): collect_capture()
+                    a->seek_overrun = a->issued - a->cap;
+                    home_seq_trigger(&seq, (uint8_t)i, (float)a->seek_overrun / SPM);
+                }
+                a->armed = 0;
+            }
+        }
+        home_move_t mv[HOME_AXES];
+        const uint8_t start = home_seq_tick(&seq, pressed, busy, mv);
+        for (int i = 0; i < 3; ++i) {
+            sim_axis_t* a = &ax[i];
+            if (start & HOME_BIT(i)) {
+                assert(!(busy & HOME_BIT(i))); // never restarted while moving
+                a->rate = mv[i].feed_mm_min / 60000.0f * SPM;
+                a->acc = a->phase0;
+                a->dir = mv[i].toward_negative ? -1 : 1;
+                a->issued = 0;
+                a->armed = mv[i].capture;
+                a->hit = 0;
+                // stepgen_move_n() refuses a move toward a pressed MIN
+                const int refused = mv[i].toward_negative && (vdeb_active(&deb) & HOME_BIT(i));
+                a->left = refused ? 0U : (uint32_t)lroundf(mv[i].mm * SPM);
+            }
+            if (seq.axis[i].phase != last[i]) {
+                last[i] = seq.axis[i].phase;
+                a->phase_at[last[i]] = now_ms;
+            }
+        }
+        if (seq.failed) {
+            for (int i = 0; i < 3; ++i) {
+                ax[i].left = 0; // home_tick() aborts the rest of the group
+            }
+        }
+        assert(now_ms < 10U * 60U * 1000U);
+    }
+    return now_ms;
+}
+
+static uint32_t run(const uint8_t* groups, uint8_t n) {
+    const home_params_t p[3] = {P, P, P};
+    return run_p(p, groups, n);
+}
+
+static void check_homed(int i) {
+    const sim_axis_t* a = &ax[i];
+    assert(seq.axis[i].phase == HOME_DONE && seq.axis[i].err == HOME_ERR_NONE);
+    assert(a->phase_at[HOME_SEEK] < a->phase_at[HOME_BACKOFF]);
+    assert(a->phase_at[HOME_BACKOFF] < a->phase_at[HOME_LATCH]);
+    assert(a->phase_at[HOME_LATCH] < a->phase_at[HOME_CLEAR]);
+    assert(a->phase_at[HOME_CLEAR] < a->phase_at[HOME_DONE]);
+    // Latch pass stops within the debounce delay at slow feed, then the 1 mm clearance
+    const float overshoot = (DEBOUNCE_TICKS + 1) * P.slow_feed_mm_min / 60000.0f;
+    assert(mm(a) > P.home_offset_mm - overshoot && mm(a) <= P.home_offset_mm);
+    assert(!pressed_db(i));
+}
+
+static void test_concurrent_vs_serial(void) {
+    const uint8_t serial[] = {HOME_BIT(0), HOME_BIT(1), HOME_BIT(2)};
+    const uint8_t z_then_xy[] = {HOME_BIT(2), HOME_BIT(0) | HOME_BIT(1)};
+    const uint8_t all[] = {HOME_BIT(0) | HOME_BIT(1) | HOME_BIT(2)};
+
+    sim_reset(150.0f, 120.0f, 60.0f);
+    const uint32_t t_serial = run(serial, 3);
+    for (int i = 0; i < 3; ++i) {
+        check_homed(i);
+    }
+    assert(ax[1].phase_at[HOME_SEEK] > ax[0].phase_at[HOME_DONE]); // strictly one by one
+
+    sim_reset(150.0f, 120.0f, 60.0f);
+    const uint32_t t_zxy = run(z_then_xy, 2);
+    for (int i = 0; i < 3; ++i) {
+        check_homed(i);
+    }
+    // Z parks before X or Y moves; X and Y start in the same tick
+    assert(ax[0].phase_at[HOME_SEEK] > ax[2].phase_at[HOME_DONE]);
+    assert(ax[0].phase_at[HOME_SEEK] == ax[1].phase_at[HOME_SEEK]);
+
+    sim_reset(150.0f, 120.0f, 60.0f);
+    const uint32_t t_all = run(all, 1);
+
+    printf("homing: serial X,Y,Z %.2f s | Z then X+Y %.2f s | all together %.2f s\n",
+           t_serial / 1000.0, t_zxy / 1000.0, t_all / 1000.0);
+    assert(t_zxy < 0.75 * t_serial && t_all < t_zxy);
+}
+
+static void test_start_on_switch(void) {
+    const uint8_t g[] = {HOME_BIT(0)};
+    sim_reset(-0.5f, 10.0f, 10.0f); // X sits on its switch
+    run(g, 1);
+    check_homed(0);
+    assert(ax[0].phase_at[HOME_PULLOFF] != 0);
+    assert(ax[0].phase_at[HOME_PULLOFF] < ax[0].phase_at[HOME_SEEK]);
+    assert(seq.axis[1].phase == HOME_IDLE); // not in any group
+}
+
+static void test_failures(void) {
+    const uint8_t z_then_xy[] = {HOME_BIT(2), HOME_BIT(0) | HOME_BIT(1)};
+
+    // X switch dead: X runs out of span, Y (further out) is stopped mid-cycle
+    sim_reset(150.0f, 200.0f, 60.0f);
+    ax[0].broken = 1;
+    const uint32_t t = run(z_then_xy, 2);
+    assert(seq.failed && seq.axis[0].err == HOME_ERR_NOT_FOUND);
+    assert(seq.axis[1].phase == HOME_FAILED && seq.axis[1].err == HOME_ERR_ABORTED);
+    assert(seq.axis[2].phase == HOME_DONE);
+    const float travelled = 150.0f - mm(&ax[0]);
+    assert(fabsf(travelled - P.seek_span_mm) < 0.05f);
+    assert(t > ax[2].phase_at[HOME_DONE]);
+
+    // Z switch stuck closed: the pull-off cannot release it, X and Y never move
+    sim_reset(150.0f, 120.0f, 60.0f);
+    ax[2].broken = 2;
+    sim_seed(2);
+    run(z_then_xy, 2);
+    assert(seq.axis[2].err == HOME_ERR_STUCK);
+    assert(seq.axis[0].phase == HOME_IDLE && ax[0].pos == 150 * 200 && ax[1].pos == 120 * 200);
+
+    // Switch closes during the seek and then sticks: no release after the back-off
+    sim_reset(5.0f, 10.0f, 10.0f);
+    ax[0].broken = 3;
+    const uint8_t gx[] = {HOME_BIT(0)};
+    run(gx, 1);
+    assert(seq.axis[0].err == HOME_ERR_NO_RELEASE);
+    assert(ax[0].phase_at[HOME_FAILED] - ax[0].phase_at[HOME_BACKOFF] >= HOME_SETTLE_MS);
+}
+
+/* Single pass: seek, then straight to the clearance measured from the captured edge */
+static void test_single_pass(void) {
+    home_params_t p[3] = {P, P, P};
+    p[0].single_pass = true;
+    const uint8_t g[] = {HOME_BIT(0)};
+    const int32_t park = (int32_t)lroundf(P.home_offset_mm * SPM);
+
+    for (edge_stop = 0; edge_stop < 2; ++edge_stop) {
+        sim_reset(37.3f, 10.0f, 10.0f);
+        run_p(p, g, 1);
+        assert(seq.axis[0].phase == HOME_DONE && seq.axis[0].err == HOME_ERR_NONE);
+        assert(ax[0].phase_at[HOME_BACKOFF] == 0 && ax[0].phase_at[HOME_LATCH] == 0);
+        assert(ax[0].phase_at[HOME_SEEK] < ax[0].phase_at[HOME_CLEAR]);
+        // Polled stop: the run-on is made up; edge stop: none. Parked to the step either way.
+        assert((ax[0].seek_overrun > 0) == (edge_stop == 0) && ax[0].pos == park);
+        assert(!pressed_db(0));
+    }
+    edge_stop = 1;
+
+    // Capture missing (EXTI never fired): falls back to the two-pass latch
+    sim_reset(37.3f, 10.0f, 10.0f);
+    ax[0].no_exti = 1;
+    run_p(p, g, 1);
+    check_homed(0);
+}
+
+typedef struct {
+    uint32_t over_max, over_sum, t_sum;
+    int32_t err_lo, err_hi; // final position - park, steps
+} scheme_t;
+
+static void run_trial(scheme_t* r, const home_params_t p[3], float x0, float ph) {
+    const uint8_t g[] = {HOME_BIT(0)};
+    const int32_t park = (int32_t)lroundf(P.home_offset_mm * SPM);
+    sim_reset(x0, 10.0f, 10.0f);
+    ax[0].phase0 = ph;
+    r->t_sum += run_p(p, g, 1);
+    assert(seq.axis[0].phase == HOME_DONE);
+    const int32_t err = ax[0].pos - park;
+    r->err_lo = err < r->err_lo ? err : r->err_lo;
+    r->err_hi = err > r->err_hi ? err : r->err_hi;
+    r->over_sum += ax[0].seek_overrun; // from the captured edge (single pass only)
+    r->over_max = ax[0].seek_overrun > r->over_max ? ax[0].seek_overrun : r->over_max;
+}
+
+/*
+ * Overshoot and home error over random start positions and ms phases: the old scheme
+ * (polled stop, two-pass latch) against the new one (stop on the first edge, single pass
+ * from the captured edge). Polled, the seek overruns the edge by the debounce delay (4-5 ms
+ * of travel) and the latch stops 4-5 ms of slow feed past it, a bias that moves with the
+ * feed and the debounce setting. On the edge the overrun is gone, and the captured count
+ * puts the park position on the step without the back-off and slow pass.
+ */
+static void test_overshoot(void) {
+    const float feeds[] = {600.0f, 1800.0f, 6000.0f};
+    srand(12);
+    for (int f = 0; f < 3; ++f) {
+        home_params_t two[3] = {P, P, P}, one[3];
+        two[0].fast_feed_mm_min = feeds[f];
+        memcpy(one, two, sizeof one);
+        one[0].single_pass = true;
+
+        scheme_t old = {0, 0, 0, INT32_MAX, INT32_MIN}, cap = old, now = old;
+        const int trials = 100;
+        for (int k = 0; k < trials; ++k) {
+            const float x0 = 20.0f + (float)(rand() % 10000) * 0.01f;
+            const float ph = (float)(rand() % 1000) * 0.001f;
+            edge_stop = 0;
+            two[0].single_pass = false;
+            run_trial(&old, two, x0, ph); // polled stop, two-pass latch
+            run_trial(&cap, one, x0, ph); // polled stop, captured edge (single pass)
+            edge_stop = 1;
+            run_trial(&now, one, x0, ph); // EXTI stop, captured edge
+        }
+        const float steps_ms = feeds[f] / 60000.0f * SPM;
+        printf("homing F%-4.0f: seek overrun polled %5.1f avg %3u max, edge %u max steps | "
+               "home error two-pass %d..%d, captured %d..%d | %.2f s -> %.2f s -> %.2f s\n",
+               feeds[f], (double)cap.over_sum / trials, cap.over_max, now.over_max, old.err_lo,
+               old.err_hi, now.err_lo, now.err_hi, old.t_sum / 1000.0 / trials,
+               cap.t_sum / 1000.0 / trials, now.t_sum / 1000.0 / trials);
+        assert(cap.over_max >= (uint32_t)((DEBOUNCE_TICKS - 1) * steps_ms));
+        assert(cap.over_max <= (uint32_t)(DEBOUNCE_TICKS * steps_ms) + 1U);
+        assert(now.over_max <= 1U);
+        assert(old.err_lo <= old.err_hi && old.err_hi < 0); // the latch stops past the edge
+        assert(cap.err_lo == 0 && cap.err_hi == 0 && now.err_lo == 0 && now.err_hi == 0);
+        assert(now.t_sum <= cap.t_sum && cap.t_sum < old.t_sum);
+    }
+    edge_stop = 1;
+}
+
+int main(void) {
+    test_concurrent_vs_serial();
+    test_start_on_switch();
+    test_failures();
+    test_single_pass();
+    test_overshoot();
+    printf("All homing tests passed.\n");
+    return 0;
+}
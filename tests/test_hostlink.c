@@ -0,0 +1,305 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hostlink.h"
+
+/*
+ * Binary host link: the sender side (hl_encode_move) and the receiver side (byte decoder +
+ * hl_frame_to_move) must agree exactly on every move, recover from corrupted bytes, and be
+ * much smaller on the wire than the same moves as G-code text. Realtime bytes are found in
+ * the raw stream exactly where the stream reader would skip them.
+ */
+
+/* Receiver: decode a byte stream, collect the moves and the error codes */
+typedef struct {
+    hl_decoder_t dec;
+    hl_modal_t modal;
+    hl_move_t moves[4096];
+    uint32_t n_moves;
+    uint32_t n_errors;
+    hl_status_t last_error;
+} rx_t;
+
+static void rx_init(rx_t* r) {
+    memset(r, 0, sizeof *r);
+    hl_decoder_init(&r->dec);
+}
+
+static void rx_feed(rx_t* r, const uint8_t* p, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        hl_status_t st = hl_decode_byte(&r->dec, p[i]);
+        if (st == HL_NONE) {
+            continue;
+        }
+        if (st == HL_FRAME) {
+            st = hl_frame_to_move(&r->modal, &r->dec.frame, &r->moves[r->n_moves]);
+        }
+        if (st == HL_FRAME) {
+            r->n_moves++;
+        } else {
+            r->n_errors++;
+            r->last_error = st;
+        }
+    }
+}
+
+static int same_move(const hl_move_t* a, const hl_move_t* b) {
+    return memcmp(a->target_um, b->target_um, sizeof a->target_um) == 0
+           && (a->rapid != 0U) == (b->rapid != 0U)
+           && (a->rapid || a->feed_um_min == b->feed_um_min);
+}
+
+static void test_crc(void) {
+    const uint8_t check[] = "123456789";
+    assert(hl_crc16(0xFFFFU, check, 9) == 0x29B1U); // CRC-16/CCITT-FALSE check value
+}
+
+static void test_round_trip(void) {
+    static rx_t rx;
+    static hl_move_t sent[4096];
+    rx_init(&rx);
+    hl_modal_t tx = {0};
+    uint8_t frame[HL_MAX_FRAME];
+    int32_t pos[3] = {0, 0, 0};
+    uint32_t deltas = 0;
+    srand(7);
+
+    for (uint32_t k = 0; k < 4096; ++k) {
+        hl_move_t* mv = &sent[k];
+        const int big = (rand() % 20) == 0; // mostly short segments, some long jumps
+        for (int i = 0; i < 3; ++i) {
+            pos[i] += big ? (rand() % 400001) - 200000 : (rand() % 2001) - 1000;
+            mv->target_um[i] = pos[i];
+        }
+        mv->rapid = (rand() % 50) == 0;
+        mv->feed_um_min = 1200000U;
+        if ((rand() % 10) == 0) {
+            mv->feed_um_min = 600000U + 1000U * (uint32_t)(rand() % 100); // feed change
+        }
+        const uint32_t n = hl_encode_move(&tx, frame, mv);
+        assert(n <= HL_MAX_FRAME && frame[0] == HL_SYNC);
+        deltas += frame[2] == HL_T_DELTA;
+        // Split the frame at a random point, like DMA bursts would
+        const uint32_t cut = (uint32_t)rand() % (n + 1U);
+        rx_feed(&rx, frame, cut);
+        rx_feed(&rx, frame + cut, n - cut);
+    }
+    assert(rx.n_errors == 0 && rx.n_moves == 4096);
+    for (uint32_t k = 0; k < 4096; ++k) {
+        assert(same_move(&rx.moves[k], &sent[k]));
+    }
+    assert(deltas > 3000); // short segments ride in the 11-byte frame
+}
+
+static void test_extremes(void) {
+    static rx_t rx;
+    rx_init(&rx);
+    hl_modal_t tx = {0};
+    uint8_t frame[HL_MAX_FRAME];
+    const hl_move_t moves[] = {
+            {{INT32_MAX, INT32_MIN, 0}, UINT32_MAX, 0},
+            {{INT32_MAX - INT16_MAX, INT32_MIN + 32767, -32768}, UINT32_MAX, 0}, // delta edges
+            {{-1, 1, 32767}, 1U, 0}, // feed change: full line
+            {{-1, 1, 32767}, 0U, 1}, // rapid flag change: full line
+    };
+    for (uint32_t k = 0; k < 4; ++k) {
+        const uint32_t n = hl_encode_move(&tx, frame, &moves[k]);
+        assert(frame[2] == (k == 1 ? HL_T_DELTA : HL_T_LINE));
+        rx_feed(&rx, frame, n);
+        assert(rx.n_moves == k + 1 && same_move(&rx.moves[k], &moves[k]));
+    }
+}
+
+static void test_errors_and_resync(void) {
+    static rx_t rx;
+    rx_init(&rx);
+    uint8_t frame[HL_MAX_FRAME];
+    const uint8_t d[HL_DELTA_LEN] = {1, 0, 2, 0, 3, 0};
+
+    // A delta with no line before it has no origin
+    uint32_t n = hl_encode(frame, HL_T_DELTA, d, HL_DELTA_LEN);
+    rx_feed(&rx, frame, n);
+    assert(rx.n_errors == 1 && rx.last_error == HL_ERR_NO_ORIGIN);
+
+    // Unknown type, wrong length for the type, oversized LEN
+    n = hl_encode(frame, 0x7F, d, 2);
+    rx_feed(&rx, frame, n);
+    assert(rx.last_error == HL_ERR_TYPE);
+    n = hl_encode(frame, HL_T_DELTA, d, 4);
+    rx_feed(&rx, frame, n);
+    assert(rx.last_error == HL_ERR_LEN);
+    const uint8_t too_long[] = {HL_SYNC, HL_MAX_PAYLOAD + 1U};
+    rx_feed(&rx, too_long, 2);
+    assert(rx.last_error == HL_ERR_LEN && hl_decoder_idle(&rx.dec) && rx.n_errors == 4);
+
+    // Every single-bit flip in a frame is caught (or lands in the sync / length bytes)
+    hl_modal_t tx = {0};
+    const hl_move_t mv = {{1000, -2000, 3000}, 900000U, 0};
+    n = hl_encode_move(&tx, frame, &mv);
+    uint32_t caught = 0;
+    for (uint32_t bit = 8; bit < n * 8U; ++bit) {
+        uint8_t bad[HL_MAX_FRAME + 64];
+        memcpy(bad, frame, n);
+        bad[bit / 8U] ^= (uint8_t)(1U << (bit % 8U));
+        memset(bad + n, 0, 64); // idle filler so a grown LEN still completes
+        rx_init(&rx);
+        rx_feed(&rx, bad, n + 64U);
+        assert(rx.n_moves == 0);
+        caught += rx.n_errors != 0;
+        // The next good frame goes through
+        rx_feed(&rx, frame, n);
+        assert(rx.n_moves == 1 && same_move(&rx.moves[0], &mv));
+    }
+    assert(caught == (n - 1U) * 8U);
+
+    // Garbage and text in front of a frame are skipped
+    rx_init(&rx);
+    const char junk[] = "G1X1\r\n\x01\x02 ok";
+    rx_feed(&rx, (const uint8_t*)junk, sizeof junk - 1U);
+    rx_feed(&rx, frame, n);
+    assert(rx.n_moves == 1 && rx.n_errors == 0);
+}
+
+/* The stream reader's view (gcode_stream.c): a frame where a line could start, else text */
+typedef struct {
+    hl_decoder_t dec;
+    bool line_start;
+} reader_t;
+
+static bool reader_sees_realtime(reader_t* r, uint8_t c) {
+    if (!hl_decoder_idle(&r->dec) || (c == HL_SYNC && r->line_start)) {
+        (void)hl_decode_byte(&r->dec, c);
+        return false;
+    }
+    if (hl_rt_is_cmd(c)) {
+        return true;
+    }
+    r->line_start = c == '\r' || c == '\n';
+    return false;
+}
+
+/*
+ * Realtime bytes: the RX-interrupt scanner must pick out exactly the bytes the stream reader
+ * later skips, with frames (whose payload and CRC may hold any byte value) stepped over.
+ */
+static void test_realtime_scan(void) {
+    hl_rt_t rt;
+    hl_rt_init(&rt);
+    const char text[] = "G1 X1 !F100\r\n~";
+    uint8_t got[8];
+    uint32_t n = 0;
+    for (uint32_t i = 0; i + 1U < sizeof text; ++i) {
+        const uint8_t c = hl_rt_scan(&rt, (uint8_t)text[i]);
+        if (c) {
+            got[n++] = c;
+        }
+    }
+    assert(n == 2 && got[0] == HL_RT_FEED_HOLD && got[1] == HL_RT_CYCLE_START);
+
+    // A frame right after the line: payload bytes that look like commands are not commands
+    const uint8_t payload[6] = {'!', '~', HL_RT_FEED_PLUS_10, HL_RT_RAPID_100, HL_SYNC, '\n'};
+    uint8_t frame[HL_MAX_FRAME];
+    const uint32_t fl = hl_encode(frame, HL_T_DELTA, payload, sizeof payload);
+    for (uint32_t i = 0; i < fl; ++i) {
+        assert(hl_rt_scan(&rt, frame[i]) == 0);
+    }
+    assert(hl_rt_scan(&rt, HL_RT_FEED_MINUS_1) == HL_RT_FEED_MINUS_1);
+    // ... but a SYNC inside a G-code line is just a byte of that line
+    assert(hl_rt_scan(&rt, 'G') == 0 && hl_rt_scan(&rt, HL_SYNC) == 0);
+    assert(hl_rt_scan(&rt, HL_RT_FEED_HOLD) == HL_RT_FEED_HOLD);
+
+    // Random mixes of text, frames (some with a bad LEN) and realtime bytes: both sides agree
+    static const uint8_t rt_bytes[] = {'!', '~', 0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97};
+    srand(5);
+    for (int round = 0; round < 2000; ++round) {
+        reader_t r = {.line_start = true};
+        hl_decoder_init(&r.dec);
+        hl_rt_init(&rt);
+        for (int part = 0; part < 40; ++part) {
+            uint8_t buf[HL_MAX_FRAME + 8];
+            uint32_t len = 0;
+            switch (rand() % 4) {
+            case 0: { // frame with a random payload
+                uint8_t p[HL_MAX_PAYLOAD];
+                const uint8_t pl = (uint8_t)(rand() % (HL_MAX_PAYLOAD + 1));
+                for (uint8_t i = 0; i < pl; ++i) {
+                    p[i] = (rand() % 2) ? rt_bytes[rand() % 10] : (uint8_t)rand();
+                }
+                len = hl_encode(buf, (uint8_t)rand(), p, pl);
+                if (rand() % 8 == 0) {
+                    buf[1] = (uint8_t)(HL_MAX_PAYLOAD + 1 + rand() % 200); // dropped at LEN
+                    len = 2;
+                }
+                break;
+            }
+            case 1: // a realtime byte
+                buf[len++] = rt_bytes[rand() % 10];
+                break;
+            default: // a bit of text, maybe ending the line, maybe holding a stray SYNC
+                for (int i = rand() % 6; i >= 0; --i) {
+                    const int k = rand() % 10;
+                    buf[len++] = k == 0 ? '\n' : (k == 1 ? HL_SYNC : (uint8_t)('A' + k));
+                }
+                break;
+            }
+            for (uint32_t i = 0; i < len; ++i) {
+                const uint8_t c = hl_rt_scan(&rt, buf[i]);
+                assert((c != 0) == reader_sees_realtime(&r, buf[i]));
+                assert(c == 0 || c == buf[i]);
+            }
+        }
+    }
+
+    // Overrides step and clamp to 10..200 %
+    hl_rt_init(&rt);
+    for (int i = 0; i < 30; ++i) {
+        (void)hl_rt_override(&rt, HL_RT_FEED_PLUS_10);
+    }
+    assert(rt.pct[0] == HL_RT_PCT_MAX && rt.pct[1] == 100U);
+    assert(!hl_rt_override(&rt, HL_RT_FEED_PLUS_1) && hl_rt_override(&rt, HL_RT_FEED_MINUS_1));
+    assert(rt.pct[0] == 199U);
+    for (int i = 0; i < 30; ++i) {
+        (void)hl_rt_override(&rt, HL_RT_RAPID_MINUS_10);
+    }
+    assert(rt.pct[1] == HL_RT_PCT_MIN);
+    assert(hl_rt_override(&rt, HL_RT_RAPID_100) && rt.pct[1] == 100U);
+    assert(hl_rt_override(&rt, HL_RT_FEED_100) && rt.pct[0] == 100U);
+    assert(!hl_rt_override(&rt, HL_RT_FEED_HOLD));
+}
+
+/* Bytes per move: binary frames vs the equivalent G-code text a sender would stream */
+static void test_wire_size(void) {
+    hl_modal_t tx = {0};
+    uint8_t frame[HL_MAX_FRAME];
+    uint32_t bin = 0, text = 0;
+    int32_t pos[3] = {10000, 10000, -500};
+    srand(9);
+    for (int k = 0; k < 10000; ++k) {
+        hl_move_t mv = {{0, 0, 0}, 1500000U, 0};
+        for (int i = 0; i < 3; ++i) {
+            pos[i] += (rand() % 301) - 150; // 3D-surfacing sized steps, <= 0.15 mm
+            mv.target_um[i] = pos[i];
+        }
+        bin += hl_encode_move(&tx, frame, &mv);
+        char line[64];
+        text += (uint32_t)snprintf(line, sizeof line, "G1X%.3fY%.3fZ%.3f\n", pos[0] * 0.001,
+                                   pos[1] * 0.001, pos[2] * 0.001);
+    }
+    printf("hostlink: %.1f bytes/move binary vs %.1f text (%.1fx)\n", bin / 10000.0,
+           text / 10000.0, (double)text / (double)bin);
+    assert(text > 2U * bin);
+}
+
+int main(void) {
+    test_crc();
+    test_round_trip();
+    test_extremes();
+    test_errors_and_resync();
+    test_realtime_scan();
+    test_wire_size();
+    printf("All hostlink tests passed.\n");
+    return 0;
+}
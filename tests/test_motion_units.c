@@ -1,6 +1,8 @@
 #include <assert.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "motion_units.h"
 
@@ -13,40 +15,113 @@ static void test_defaults_steps_per_mm(void) {
     float z_spmm = steps_per_mm(AXIS_Z);
 
     // Allow tiny float tolerance
-    assert(fabsf(x_spmm - 200.0f) < 0.001f);
-    assert(fabsf(y_spmm - 200.0f) < 0.001f);
+    // X/Y: 200*8 / 40 mm belt = 40 steps/mm; Z: 200*8 / 8 mm screw = 200 steps/mm
+    assert(fabsf(x_spmm - 40.0f) < 0.001f);
+    assert(fabsf(y_spmm - 40.0f) < 0.001f);
     assert(fabsf(z_spmm - 200.0f) < 0.001f);
 }
 
 static void test_mm_to_steps_rounding(void) {
     motion_init_defaults();
 
-    // Exact multiple
-    assert(mm_to_steps(AXIS_X, 10.0f) == 2000u);
+    // Exact multiple (Z = 200 steps/mm)
+    assert(mm_to_steps(AXIS_Z, 10.0f) == 2000u);
 
     // Check rounding behavior
     // 0.01 mm * 200 steps/mm = 2 steps ⇒ expect 2
-    assert(mm_to_steps(AXIS_X, 0.01f) == 2u);
+    assert(mm_to_steps(AXIS_Z, 0.01f) == 2u);
 
     // 0.002 mm * 200 = 0.4 steps ⇒ with +0.5f expect 0 or 1 depending on your policy
     // Right now: (0.4 + 0.5) = 0.9 → cast to uint32_t = 0
-    assert(mm_to_steps(AXIS_X, 0.002f) == 0u);
+    assert(mm_to_steps(AXIS_Z, 0.002f) == 0u);
 }
 
 static void test_feed_to_hz_basic(void) {
     motion_init_defaults();
 
-    // 600 mm/min = 10 mm/s; 10 mm/s * 200 steps/mm = 2000 Hz
-    assert(feed_to_hz(AXIS_X, 600.0f) == 2000u);
+    // 600 mm/min = 10 mm/s; 10 mm/s * 200 steps/mm = 2000 Hz (Z)
+    assert(feed_to_hz(AXIS_Z, 600.0f) == 2000u);
+    // 10 mm/s * 40 steps/mm = 400 Hz (X)
+    assert(feed_to_hz(AXIS_X, 600.0f) == 400u);
 
     // 0 feed should give 0 Hz
     assert(feed_to_hz(AXIS_X, 0.0f) == 0u);
 }
 
+static void test_accel_to_hz_s(void) {
+    motion_init_defaults();
+
+    // 500 mm/s^2 * 40 steps/mm = 20000 steps/s^2 (X); 200 mm/s^2 * 200 = 40000 (Z)
+    assert(accel_to_hz_s(AXIS_X, accel_mm_s2(AXIS_X)) == 20000u);
+    assert(accel_to_hz_s(AXIS_Z, accel_mm_s2(AXIS_Z)) == 40000u);
+}
+
+static void test_set_axis_factors(void) {
+    // 0.2" lead screw at 1/16: 3200 / 5.08 = 629.92 steps/mm, factors recomputed on the change
+    motion_set_axis(AXIS_X, &(axis_cfg_t){200, 16, 5.08f, 300.0f, 100.0f});
+    assert(fabsf(steps_per_mm(AXIS_X) - 629.92126f) < 1e-3f);
+    assert(fabsf(steps_per_mm(AXIS_X) * mm_per_step(AXIS_X) - 1.0f) < 1e-6f);
+    assert(feed_to_hz(AXIS_X, 600.0f) == 6299u);
+    assert(mm_to_steps(AXIS_X, 1.0f) == 630u);
+    assert(fabsf(steps_to_mm(AXIS_X, 3200) - 5.08f) < 1e-5f);
+    assert(fabsf(steps_to_mm(AXIS_X, -3200) + 5.08f) < 1e-5f);
+    assert(travel_mm(AXIS_X) == 100.0f && accel_mm_s2(AXIS_X) == 300.0f);
+    assert(steps_per_mm(AXIS_Y) == 40.0f); // the other axes keep theirs
+
+    float frac;
+    assert(mm_to_steps_frac(AXIS_Z, 0.0125f, &frac) == 3 && fabsf(frac + 0.5f) < 1e-5f);
+    assert(mm_to_steps_frac(AXIS_Z, -0.0125f, &frac) == -3 && fabsf(frac - 0.5f) < 1e-5f);
+    assert(mm_to_steps_frac(AXIS_Z, 0.0123f, &frac) == 2 && fabsf(frac - 0.46f) < 1e-4f);
+    motion_init_defaults();
+}
+
+#define DRIFT_SEGMENTS 1000000U
+
+/*
+ * A million relative segments through the carry: the running step count never strays more
+ * than a step from the exact (double) sum of the lengths, whatever the lengths. Per-segment
+ * rounding is shown for comparison.
+ */
+static void drift(axis_t a, float d_min, float d_max, double spmm_exact, const char* what) {
+    srand(20260);
+    float carry = 0.0f;
+    int64_t steps = 0;
+    int64_t naive = 0;
+    double exact = 0.0;
+    double worst = 0.0;
+    for (uint32_t k = 0; k < DRIFT_SEGMENTS; ++k) {
+        const float d = d_min + (d_max - d_min) * ((float)rand() / (float)RAND_MAX);
+        steps += mm_to_steps_carry(a, d, &carry);
+        naive += d < 0.0f ? -(int64_t)mm_to_steps(a, -d) : (int64_t)mm_to_steps(a, d);
+        exact += (double)d * spmm_exact;
+        assert(fabsf(carry) <= 0.5f);
+        const double off = fabs((double)steps + (double)carry - exact);
+        worst = off > worst ? off : worst;
+    }
+    printf("motion_units: %u %s segments: %lld steps (exact %.1f), worst %.3f off; "
+           "rounded per segment: %lld\n",
+           DRIFT_SEGMENTS, what, (long long)steps, exact, worst, (long long)naive);
+    assert(llabs(steps - llround(exact)) <= 1);
+    assert(worst < 0.5 + 1e-7 * fabs(exact) + 0.01);
+}
+
+static void test_carry_drift(void) {
+    motion_init_defaults();
+    drift(AXIS_X, 0.0123f, 0.0123f, 40.0, "0.0123 mm X"); // 0.49 steps each
+    drift(AXIS_Z, 0.0005f, 0.002f, 200.0, "sub-step Z");
+    drift(AXIS_Y, -0.05f, 0.05f, 40.0, "signed Y");
+    motion_set_axis(AXIS_X, &(axis_cfg_t){200, 16, 5.08f, 300.0f, 100.0f});
+    drift(AXIS_X, 0.001f, 0.08f, 3200.0 / 5.08, "lead-screw X");
+    motion_init_defaults();
+}
+
 int main(void) {
     test_defaults_steps_per_mm();
     test_mm_to_steps_rounding();
     test_feed_to_hz_basic();
+    test_accel_to_hz_s();
+    test_set_axis_factors();
+    test_carry_drift();
 
     printf("All motion_units tests passed.\n");
     return 0;
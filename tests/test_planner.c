@@ -0,0 +1,308 @@
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "planner.h"
+
+/*
+ * Look-ahead planner: junction limits, the plan against a full re-plan from scratch, and
+ * that every popped block can actually be executed (reachable entry/exit under its accel).
+ * The throughput run streams tiny segments through a full ring and reports blocks/s.
+ */
+
+#define STEPS_PER_MM 40.0f
+
+static const planner_cfg_t CFG = {
+        .accel_mm_s2 = {500.0f, 500.0f, 200.0f},
+        .junction_dev_mm = 0.02f,
+        .min_junction_mm_s = 0.0f,
+};
+
+static bool add_move(float dx, float dy, float dz, float feed_mm_s, bool rapid) {
+    const float d[3] = {dx, dy, dz};
+    int32_t s[3];
+    for (int i = 0; i < 3; ++i) {
+        s[i] = (int32_t)lroundf(d[i] * STEPS_PER_MM);
+    }
+    return planner_add(s, d, feed_mm_s, rapid) == PLANNER_OK;
+}
+
+static bool add_mm(float dx, float dy, float dz, float feed_mm_s) {
+    return add_move(dx, dy, dz, feed_mm_s, false);
+}
+
+static int close_rel(float a, float b) {
+    return fabsf(a - b) <= 1e-3f * fmaxf(1.0f, fmaxf(fabsf(a), fabsf(b)));
+}
+
+/* Pop everything, checking each block against the exit promised by the one before it */
+static uint32_t drain_checked(planner_block_t* out, float* exits, uint32_t cap) {
+    planner_block_t b;
+    float exit2;
+    float promised = -1.0f;
+    uint32_t n = 0;
+    while (planner_pop(&b, &exit2)) {
+        if (promised >= 0.0f) {
+            assert(b.entry_speed2 == promised); // frozen when the block before left
+        }
+        assert(b.entry_speed2 <= b.max_entry_speed2 * (1.0f + 1e-5f));
+        assert(b.max_entry_speed2 <= b.nominal_speed2 * (1.0f + 1e-5f));
+        const float reach = 2.0f * b.accel * b.millimeters * (1.0f + 1e-4f) + 1e-3f;
+        assert(fabsf(exit2 - b.entry_speed2) <= reach);
+        promised = exit2;
+        if (out && n < cap) {
+            out[n] = b;
+            exits[n] = exit2;
+        }
+        n++;
+    }
+    assert(promised == 0.0f || n == 0); // the last block stops
+    return n;
+}
+
+static void test_straight_line_cruises(void) {
+    planner_init(&CFG);
+    for (int k = 0; k < 10; ++k) {
+        assert(add_mm(10.0f, 0.0f, 0.0f, 50.0f));
+    }
+    planner_block_t b[10];
+    float ex[10];
+    assert(drain_checked(b, ex, 10) == 10);
+    assert(b[0].entry_speed2 == 0.0f);
+    // 10 mm at 500 mm/s^2 reaches 50 mm/s (needs 2.5 mm): every inner junction at full feed
+    for (int k = 1; k < 10; ++k) {
+        assert(close_rel(b[k].entry_speed2, 2500.0f));
+    }
+    assert(ex[9] == 0.0f);
+}
+
+static void test_corner_and_reversal(void) {
+    planner_init(&CFG);
+    assert(add_mm(10.0f, 0.0f, 0.0f, 100.0f));
+    assert(add_mm(0.0f, 10.0f, 0.0f, 100.0f)); // 90 degrees
+    assert(add_mm(0.0f, -10.0f, 0.0f, 100.0f)); // reversal
+
+    planner_block_t b[3];
+    float ex[3];
+    assert(drain_checked(b, ex, 3) == 3);
+
+    // v^2 = a d sin(t/2) / (1 - sin(t/2)) with t = 90 degrees, a = 500 (pure Y)
+    const float sh = sqrtf(0.5f);
+    const float v2 = 500.0f * 0.02f * sh / (1.0f - sh);
+    assert(close_rel(b[1].max_entry_speed2, v2));
+    assert(close_rel(b[1].entry_speed2, v2));
+    assert(b[2].max_entry_speed2 == 0.0f && b[2].entry_speed2 == 0.0f);
+}
+
+static void test_diagonal_accel_and_short_blocks(void) {
+    planner_init(&CFG);
+    // X/Z diagonal: Z (200) limits the path accel to 200 / (1/sqrt2)
+    assert(add_mm(1.0f, 0.0f, 1.0f, 20.0f));
+    planner_block_t b;
+    float ex;
+    assert(planner_pop(&b, &ex));
+    assert(close_rel(b.accel, 200.0f * sqrtf(2.0f)));
+    assert(close_rel(b.millimeters, sqrtf(2.0f)));
+
+    // Empty moves and non-positive feeds are refused
+    planner_init(&CFG);
+    assert(!add_mm(0.0f, 0.0f, 0.0f, 10.0f));
+    assert(!add_mm(1.0f, 0.0f, 0.0f, 0.0f));
+    assert(planner_count() == 0);
+
+    // Tiny collinear blocks: the speed is accel-limited from rest, not by the junctions
+    planner_init(&CFG);
+    for (int k = 0; k < 8; ++k) {
+        assert(add_mm(0.1f, 0.0f, 0.0f, 200.0f));
+    }
+    planner_block_t t[8];
+    float te[8];
+    assert(drain_checked(t, te, 8) == 8);
+    for (int k = 1; k < 4; ++k) {
+        assert(close_rel(t[k].entry_speed2, 2.0f * 500.0f * 0.1f * (float)k)); // forward limit
+    }
+}
+
+/* Reference: both passes over the whole sequence from scratch */
+static void full_replan(const planner_block_t* b, uint32_t n, float* entry2) {
+    entry2[n] = 0.0f;
+    for (uint32_t k = n; k-- > 0;) {
+        const float v2 = entry2[k + 1] + 2.0f * b[k].accel * b[k].millimeters;
+        entry2[k] = fminf(b[k].max_entry_speed2, v2);
+    }
+    entry2[0] = 0.0f;
+    for (uint32_t k = 0; k + 1 < n; ++k) {
+        entry2[k + 1] = fminf(entry2[k + 1], entry2[k] + 2.0f * b[k].accel * b[k].millimeters);
+    }
+}
+
+static void test_incremental_matches_full_replan(void) {
+    srand(7);
+    for (int round = 0; round < 200; ++round) {
+        planner_init(&CFG);
+        const uint32_t n = PLANNER_BUF_LEN - 1U;
+        for (uint32_t k = 0; k < n; ++k) {
+            const float dx = (float)(rand() % 2001 - 1000) / 500.0f;
+            const float dy = (float)(rand() % 2001 - 1000) / 500.0f;
+            const float dz = (rand() % 4 == 0) ? (float)(rand() % 201 - 100) / 500.0f : 0.0f;
+            const float feed = 5.0f + (float)(rand() % 200);
+            if (!add_mm(dx, dy, dz, feed)) {
+                assert(add_mm(1.0f, 0.0f, 0.0f, feed)); // rounded to nothing: pick a real move
+            }
+        }
+        assert(planner_free() == 0 && !add_mm(1.0f, 0.0f, 0.0f, 10.0f));
+
+        planner_block_t b[PLANNER_BUF_LEN];
+        float ex[PLANNER_BUF_LEN];
+        float ref[PLANNER_BUF_LEN + 1];
+        assert(drain_checked(b, ex, n) == n);
+        full_replan(b, n, ref);
+        for (uint32_t k = 0; k < n; ++k) {
+            assert(close_rel(b[k].entry_speed2, ref[k]));
+        }
+    }
+}
+
+/* Overrides: nominal speeds rescale per kind and the queue matches a full re-plan of them */
+static void test_override_replans(void) {
+    srand(11);
+    for (int round = 0; round < 100; ++round) {
+        planner_init(&CFG);
+        const uint32_t n = PLANNER_BUF_LEN - 1U;
+        for (uint32_t k = 0; k < n; ++k) {
+            const float dx = (float)(rand() % 2001 - 1000) / 500.0f;
+            const float dy = (float)(rand() % 2001 - 1000) / 500.0f;
+            const bool rapid = rand() % 3 == 0;
+            const float feed = rapid ? 150.0f : 5.0f + (float)(rand() % 100);
+            if (!add_move(dx, dy, 0.0f, feed, rapid)) {
+                assert(add_move(1.0f, 0.0f, 0.0f, feed, rapid));
+            }
+        }
+        const uint8_t feed_pct = (uint8_t)(10 + rand() % 191);
+        const uint8_t rapid_pct = (uint8_t)(10 + rand() % 191);
+        planner_set_override(feed_pct, rapid_pct);
+
+        planner_block_t b[PLANNER_BUF_LEN];
+        float ex[PLANNER_BUF_LEN];
+        float ref[PLANNER_BUF_LEN + 1];
+        assert(drain_checked(b, ex, n) == n);
+        full_replan(b, n, ref);
+        for (uint32_t k = 0; k < n; ++k) {
+            const uint8_t pct = b[k].rapid ? rapid_pct : feed_pct;
+            const float f = (float)pct / 100.0f;
+            assert(b[k].pct == pct);
+            assert(close_rel(b[k].nominal_speed2, b[k].feed2 * f * f));
+            assert(close_rel(b[k].entry_speed2, ref[k]));
+        }
+    }
+
+    // Mid-program: the block already handed on keeps its promised exit, later ones slow down
+    planner_init(&CFG);
+    for (int k = 0; k < 4; ++k) {
+        assert(add_mm(10.0f, 0.0f, 0.0f, 50.0f));
+    }
+    planner_block_t b;
+    float exit2;
+    assert(planner_pop(&b, &exit2) && close_rel(exit2, 2500.0f));
+    planner_set_override(30, 100);
+    assert(planner_pop(&b, &exit2));
+    assert(b.entry_speed2 == 2500.0f && close_rel(b.nominal_speed2, 2500.0f * 0.09f));
+    assert(close_rel(exit2, 2500.0f * 0.09f));
+    assert(add_mm(10.0f, 0.0f, 0.0f, 50.0f) && planner_count() == 3);
+    while (planner_pop(&b, &exit2)) {
+        assert(close_rel(b.nominal_speed2, 2500.0f * 0.09f));
+        assert(b.entry_speed2 <= b.nominal_speed2 * (1.0f + 1e-5f));
+    }
+    assert(exit2 == 0.0f);
+}
+
+/* Stream tiny chords of a circle through a full ring, popping one per add once it fills */
+static void bench_throughput(void) {
+    const uint32_t N = 400000;
+    const float r = 5.0f;
+    const float dt = 6.2831853f / 360.0f; // 1 degree chords, ~0.087 mm
+    planner_init(&CFG);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    float px = r, py = 0.0f, promised = -1.0f;
+    planner_block_t b;
+    float ex;
+    for (uint32_t k = 1; k <= N; ++k) {
+        const float x = r * cosf(dt * (float)k), y = r * sinf(dt * (float)k);
+        if (planner_free() == 0) {
+            assert(planner_pop(&b, &ex));
+            assert(promised < 0.0f || b.entry_speed2 == promised);
+            promised = ex;
+        }
+        assert(add_mm(x - px, y - py, 0.0f, 100.0f));
+        px = x;
+        py = y;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    assert(promised > 0.0f); // the look-ahead keeps the tool moving around the circle
+    const double s = (double)(t1.tv_sec - t0.tv_sec) + 1e-9 * (double)(t1.tv_nsec - t0.tv_nsec);
+    printf("planner: %.0f blocks/s on host (%u tiny segments, ring of %u)\n", (double)N / s, N,
+           PLANNER_BUF_LEN);
+}
+
+/* Envelope 0..100 mm on X and Y (Z unchecked): the end point decides, both ends inclusive */
+static void test_soft_limits(void) {
+    planner_cfg_t cfg = CFG;
+    for (int i = 0; i < 2; ++i) {
+        cfg.soft_min[i] = 0;
+        cfg.soft_max[i] = (int32_t)(100.0f * STEPS_PER_MM);
+    }
+    cfg.soft_axes = 0x3U;
+    planner_init(&cfg);
+
+    const int32_t one[3] = {1, 0, 0};
+    const float one_mm[3] = {1.0f / STEPS_PER_MM, 0.0f, 0.0f};
+    const int32_t back[3] = {-1, 0, 0};
+    const float back_mm[3] = {-1.0f / STEPS_PER_MM, 0.0f, 0.0f};
+
+    assert(planner_add(back, back_mm, 10.0f, false) == PLANNER_SOFT_LIMIT); // one step below MIN
+    assert(planner_count() == 0);
+    assert(add_mm(100.0f, 50.0f, 0.0f, 50.0f)); // exactly onto the X end
+    assert(planner_add(one, one_mm, 10.0f, false) == PLANNER_SOFT_LIMIT); // one step past it
+    assert(add_mm(0.0f, 50.0f, 0.0f, 50.0f)); // Y to its end: X sits at 100, not moving
+    assert(!add_mm(0.0f, 0.1f, 0.0f, 50.0f));
+    assert(add_mm(0.0f, 0.0f, -500.0f, 50.0f)); // Z is not checked
+    assert(planner_count() == 3); // refused blocks left no trace
+
+    // A diagonal is refused as a whole when only one axis leaves the envelope
+    assert(!add_mm(-50.0f, 1.0f, 0.0f, 50.0f));
+    assert(add_mm(-100.0f, -100.0f, 0.0f, 50.0f)); // back to 0, 0: still from the queue's end
+    assert(planner_count() == 4);
+
+    // A full ring reports FULL before looking at the envelope
+    planner_reset();
+    for (uint32_t k = 0; k < PLANNER_BUF_LEN - 1U; ++k) {
+        assert(add_mm(1.0f, 0.0f, 0.0f, 50.0f));
+    }
+    assert(planner_add(back, back_mm, 10.0f, false) == PLANNER_FULL);
+    drain_checked(NULL, NULL, 0);
+
+    // After a re-sync (e.g. homing) the envelope applies from the new position
+    const int32_t at[3] = {(int32_t)(99.0f * STEPS_PER_MM), 0, 0};
+    planner_set_position(at);
+    assert(add_mm(1.0f, 0.0f, 0.0f, 50.0f) && !add_mm(0.025f, 0.0f, 0.0f, 50.0f));
+    planner_set_soft_axes(0); // not homed: anything goes
+    assert(add_mm(-1000.0f, 0.0f, 0.0f, 50.0f));
+    drain_checked(NULL, NULL, 0);
+}
+
+int main(void) {
+    test_straight_line_cruises();
+    test_corner_and_reversal();
+    test_diagonal_accel_and_short_blocks();
+    test_incremental_matches_full_replan();
+    test_soft_limits();
+    test_override_replans();
+    bench_throughput();
+    printf("All planner tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,404 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "app_init.h"
+#include "bsp_pins.h"
+#include "bsp_usart2_debug.h"
+#include "estop.h"
+#include "gcode_stream.h"
+#include "home.h"
+#include "isr_prof.h"
+#include "limits.h"
+#include "motion.h"
+#include "motion_units.h"
+#include "stepgen_pwm_tim3.h"
+#include "stm32_sim.h"
+
+/*
+ * The drivers on the register-level emulator (tests/sim): stepgen_pwm_tim3.c, limits.c,
+ * estop.c, home.c, the USART2 link and app_init() run unchanged; only the pins are watched.
+ *
+ * Checked: clock and SysTick bring-up, the rate of a single-axis move on its STEP pin, a
+ * 10 Hz edge gap longer than half the counter range, a coordinated line (edge counts, DIR
+ * levels and setup before the first edge, the step counters), a MIN switch stopping a move
+ * toward it, the e-stop on TIM1_BKIN (MOE, STEP held low, latch, clear and re-arm), homing
+ * after main()'s boot sequence against a switch modelled from the STEP / DIR pins, USART2
+ * RX / TX through DMA, the handler counts behind "$I" (ISR_PROF) and the jitter histograms
+ * behind "$J" (STEP_JITTER). Prints simulated vs wall-clock time.
+ */
+
+#define SKIP 77 // ctest SKIP_RETURN_CODE: the register ranges cannot be mapped here
+
+typedef struct {
+    GPIO_TypeDef* step_port;
+    uint8_t step_pin;
+    GPIO_TypeDef* dir_port;
+    uint8_t dir_pin;
+    GPIO_TypeDef* min_port;
+    uint8_t min_pin;
+} axis_pins_t;
+
+static const axis_pins_t PINS[3] = {
+        {X_STEP_PORT, X_STEP_PIN, X_DIR_PORT, X_DIR_PIN, X_MIN_PORT, X_MIN_PIN},
+        {Y_STEP_PORT, Y_STEP_PIN, Y_DIR_PORT, Y_DIR_PIN, Y_MIN_PORT, Y_MIN_PIN},
+        {Z_STEP_PORT, Z_STEP_PIN, Z_DIR_PORT, Z_DIR_PIN, Z_MIN_PORT, Z_MIN_PIN},
+};
+
+/* What the motors see: edges on STEP, DIR level at each rise, a physical position */
+typedef struct {
+    uint32_t rises;
+    uint64_t last_rise;
+    uint64_t min_period, max_period; // between consecutive rises (cycles)
+    uint64_t dir_at; // last DIR change
+    uint64_t min_setup; // DIR change -> next rise
+    bool dir_dirty;
+    int32_t pos; // + = away from MIN
+    int32_t switch_at; // MIN switch closes at pos <= switch_at (INT32_MIN = no switch)
+} motor_t;
+
+static motor_t s_motor[3];
+
+static void motors_reset(void) {
+    for (int i = 0; i < 3; ++i) {
+        const int32_t pos = s_motor[i].pos;
+        memset(&s_motor[i], 0, sizeof s_motor[i]);
+        s_motor[i].min_period = UINT64_MAX;
+        s_motor[i].min_setup = UINT64_MAX;
+        s_motor[i].pos = pos;
+        s_motor[i].switch_at = INT32_MIN;
+    }
+}
+
+static bool switch_closed(int a) {
+    return s_motor[a].switch_at != INT32_MIN && s_motor[a].pos <= s_motor[a].switch_at;
+}
+
+static void on_pin(void* ctx, uint8_t port, uint8_t pin, bool level, uint64_t t) {
+    (void)ctx;
+    for (int a = 0; a < 3; ++a) {
+        motor_t* m = &s_motor[a];
+        const axis_pins_t* p = &PINS[a];
+        if (port == sim_port_index(p->dir_port) && pin == p->dir_pin) {
+            m->dir_at = t;
+            m->dir_dirty = true;
+        }
+        if (port != sim_port_index(p->step_port) || pin != p->step_pin || !level) {
+            continue;
+        }
+        if (m->rises != 0U) {
+            const uint64_t d = t - m->last_rise;
+            m->min_period = d < m->min_period ? d : m->min_period;
+            m->max_period = d > m->max_period ? d : m->max_period;
+        }
+        if (m->dir_dirty) {
+            const uint64_t s = t - m->dir_at;
+            m->min_setup = s < m->min_setup ? s : m->min_setup;
+            m->dir_dirty = false;
+        }
+        m->rises++;
+        m->last_rise = t;
+        // DIR high = CW on every axis; CW is toward MIN on X / Y
+        const bool cw = sim_pin(p->dir_port, p->dir_pin);
+        m->pos += (cw == axis_cw_is_negative((axis_t)a)) ? -1 : 1;
+        if (m->switch_at != INT32_MIN) {
+            sim_pin_drive(p->min_port, p->min_pin, switch_closed(a) ? 0 : 1); // active low
+        }
+    }
+}
+
+static bool all_idle(void) {
+    return !stepgen_busy(AXIS_X) && !stepgen_busy(AXIS_Y) && !stepgen_busy(AXIS_Z)
+           && !motion_busy();
+}
+
+static void test_bring_up(void) {
+    app_init();
+    const sim_stats_t* st = sim_stats();
+    assert(st->unclocked_writes == 0U);
+    assert(SystemCoreClock == 180000000U);
+    assert((RCC->CFGR & RCC_CFGR_SWS) == RCC_CFGR_SWS_PLL);
+
+    const uint32_t ms0 = app_millis();
+    sim_run(SIM_MS(100));
+    const uint32_t ms = app_millis() - ms0;
+    assert(ms == 100U);
+    assert(sim_stats()->unhandled_irqs == 0U);
+    printf("bring-up: PLL on, SysTick %u ticks in 100 ms, no unclocked writes\n", ms);
+}
+
+static void test_single_axis_rate(void) {
+    motors_reset();
+    stepgen_set_accel(AXIS_X, 0); // constant rate: every period the same
+    stepgen_dir(AXIS_X, false); // away from MIN
+    const int32_t pos0 = s_motor[AXIS_X].pos;
+    int32_t p0[3], p1[3];
+    stepgen_position(p0);
+
+    stepgen_move_n(AXIS_X, 400, 4000);
+    assert(stepgen_busy(AXIS_X));
+    assert(sim_run_until(all_idle, SIM_MS(200)));
+    stepgen_position(p1);
+
+    const motor_t* m = &s_motor[AXIS_X];
+    assert(m->rises == 400U);
+    assert(m->min_period == SIM_US(250) && m->max_period == SIM_US(250));
+    assert(m->pos - pos0 == 400);
+    assert(p1[AXIS_X] - p0[AXIS_X] == 400);
+    assert(s_motor[AXIS_Y].rises == 0U && s_motor[AXIS_Z].rises == 0U);
+    assert(!sim_pin(X_STEP_PORT, X_STEP_PIN));
+    stepgen_set_accel(AXIS_X, accel_to_hz_s(AXIS_X, accel_mm_s2(AXIS_X)));
+    printf("move_n: 400 rises on PA8, period %.1f us\n", (double)m->min_period / 180.0);
+}
+
+static bool x_rose(void) {
+    return s_motor[AXIS_X].rises != 0U;
+}
+
+/* A 10 Hz low half (50 ms, over half the counter range) must not be taken for a late edge */
+static void test_slow_edge(void) {
+    motors_reset();
+    stepgen_set_accel(AXIS_X, 0);
+    stepgen_dir(AXIS_X, false); // away from MIN
+    stepgen_move_n(AXIS_X, 2, 1000);
+    assert(sim_run_until(x_rose, SIM_MS(10)));
+    sim_run(SIM_US(100)); // the rise ISR has taken its 1 kHz period from the lane
+    stepgen_set_hz(AXIS_X, 10); // from the fall on: the low half lasts 50 ms
+    assert(sim_run_until(all_idle, SIM_MS(200)));
+
+    const motor_t* m = &s_motor[AXIS_X];
+    assert(m->rises == 2U);
+    assert(m->min_period == SIM_US(500 + 50000));
+    stepgen_set_accel(AXIS_X, accel_to_hz_s(AXIS_X, accel_mm_s2(AXIS_X)));
+    printf("slow edge: 10 Hz low half, rises %.1f ms apart\n",
+           (double)m->min_period / 180000.0);
+}
+
+static void test_coordinated_line(void) {
+    motors_reset();
+    int32_t p0[3], p1[3];
+    stepgen_position(p0);
+    assert(motion_line(10.0f, -5.0f, 1.0f, 600.0f) == MOTION_OK);
+    assert(sim_run_until(all_idle, SIM_MS(5000)));
+    stepgen_position(p1);
+
+    const int32_t want[3] = {(int32_t)mm_to_steps(AXIS_X, 10.0f),
+                             -(int32_t)mm_to_steps(AXIS_Y, 5.0f),
+                             (int32_t)mm_to_steps(AXIS_Z, 1.0f)};
+    for (int a = 0; a < 3; ++a) {
+        assert(s_motor[a].rises == (uint32_t)abs(want[a]));
+        assert(p1[a] - p0[a] == want[a]);
+        assert(s_motor[a].min_setup > 0U); // DIR settled before the first edge it governs
+    }
+    // Y toward MIN: CW, DIR high; X / Z away: X CCW (low), Z CW (high)
+    assert(!sim_pin(X_DIR_PORT, X_DIR_PIN));
+    assert(sim_pin(Y_DIR_PORT, Y_DIR_PIN));
+    assert(sim_pin(Z_DIR_PORT, Z_DIR_PIN));
+    printf("line: %u / %u / %u rises, DIR setup >= %.1f us\n", s_motor[0].rises,
+           s_motor[1].rises, s_motor[2].rises, (double)s_motor[1].min_setup / 180.0);
+}
+
+static uint64_t s_stop_at;
+
+static bool halfway(void) {
+    return sim_now() >= s_stop_at;
+}
+
+static void test_limit_trip(void) {
+    motors_reset();
+    stepgen_dir(AXIS_Y, axis_cw_is_negative(AXIS_Y)); // toward MIN
+    stepgen_move_n(AXIS_Y, 4000, 8000);
+    assert(!sim_run_until(all_idle, SIM_MS(100)));
+    const uint32_t before = s_motor[AXIS_Y].rises;
+    assert(before > 0U && before < 4000U);
+
+    sim_pin_drive(Y_MIN_PORT, Y_MIN_PIN, 0); // pressed: the EXTI stops the axis
+    assert(sim_run_until(all_idle, SIM_MS(1)));
+    assert(s_motor[AXIS_Y].rises - before <= 1U); // at most the pulse in flight
+    assert(!sim_pin(Y_STEP_PORT, Y_STEP_PIN));
+    sim_run(SIM_MS(20));
+    assert(limits_min_pressed(AXIS_Y));
+
+    stepgen_move_n(AXIS_Y, 10, 1000); // refused while pressed
+    assert(!stepgen_busy(AXIS_Y));
+    sim_pin_drive(Y_MIN_PORT, Y_MIN_PIN, SIM_RELEASED); // pull-up: released
+    sim_run(SIM_MS(20));
+    assert(!limits_min_pressed(AXIS_Y));
+    printf("limit: Y stopped %u steps into the move, within a pulse of the edge\n", before);
+}
+
+static void test_estop_break(void) {
+    motors_reset();
+    stepgen_dir(AXIS_Z, true);
+    stepgen_move_n(AXIS_Z, 100000, 20000);
+    s_stop_at = sim_now() + SIM_MS(50);
+    assert(sim_run_until(halfway, SIM_MS(60)));
+    assert(stepgen_busy(AXIS_Z));
+
+    sim_pin_drive(ESTOP_PORT, ESTOP_PIN, 0); // pressed: BKIN active low
+    assert((TIM1->BDTR & TIM_BDTR_MOE) == 0U); // the timer let go of the outputs at the edge
+    assert(!sim_pin(Z_STEP_PORT, Z_STEP_PIN));
+    assert(estop_latched());
+    const uint32_t rises = s_motor[AXIS_Z].rises;
+    sim_run(SIM_MS(20));
+    assert(s_motor[AXIS_Z].rises == rises);
+    assert(!stepgen_busy(AXIS_Z));
+
+    estop_clear(); // still pressed: stays latched, no move starts
+    stepgen_move_n(AXIS_Z, 10, 1000);
+    assert(!stepgen_busy(AXIS_Z));
+    sim_pin_drive(ESTOP_PORT, ESTOP_PIN, SIM_RELEASED);
+    sim_run(SIM_MS(20));
+    estop_clear();
+    assert(!estop_latched());
+    stepgen_move_n(AXIS_Z, 10, 1000); // the move sets MOE again
+    assert((TIM1->BDTR & TIM_BDTR_MOE) != 0U);
+    assert(sim_run_until(all_idle, SIM_MS(100)));
+    assert(s_motor[AXIS_Z].rises - rises == 10U);
+    printf("e-stop: MOE cleared at the edge, %u rises before it, re-armed after clear\n", rises);
+}
+
+/* From main()'s boot sequence: app_init() sets up the switches, home_init() lets them settle */
+static void test_homing(void) {
+    assert(sim_init()); // reset: a fresh boot
+    app_init();
+    motion_init_defaults();
+    home_init();
+    motors_reset();
+    const int32_t sw = s_motor[AXIS_X].pos - (int32_t)mm_to_steps(AXIS_X, 12.0f);
+    s_motor[AXIS_X].switch_at = sw; // the switch sits 12 mm toward MIN from here
+    const home_params_t p = {
+            .fast_feed_mm_min = 1200.0f,
+            .slow_feed_mm_min = 100.0f,
+            .backoff_mm = 2.0f,
+            .seek_span_mm = 50.0f,
+            .home_offset_mm = 1.0f,
+            .single_pass = false,
+    };
+    assert(home_axis_blocking(AXIS_X, &p)); // spins on home_busy(): the emulator runs on
+    assert(home_phase(AXIS_X) == HOME_DONE);
+
+    int32_t pos[3];
+    stepgen_position(pos);
+    assert(pos[AXIS_X] == 0);
+    const int32_t off = s_motor[AXIS_X].pos - sw;
+    const int32_t want = (int32_t)mm_to_steps(AXIS_X, 1.0f);
+    assert(!switch_closed(AXIS_X));
+    assert(abs(off - want) <= 1);
+    printf("home: X parked %d steps off the switch (asked %d), %u rises\n", off, want,
+           s_motor[AXIS_X].rises);
+}
+
+static void test_uart(void) {
+    static const char msg[] = "G1 X1 F100\n";
+    sim_uart_rx(msg, sizeof msg - 1U);
+    sim_run(SIM_MS(5)); // 11 bytes at 115200 baud: ~1 ms, then the line goes idle
+    char got[32] = {0};
+    size_t n = 0;
+    int c;
+    while ((c = dbg_getc_nonblock()) >= 0 && n < sizeof got - 1U) {
+        got[n++] = (char)c;
+    }
+    assert(strcmp(got, msg) == 0);
+
+    char out[64];
+    while (sim_uart_tx(out, sizeof out) != 0U) {
+    }
+    dbg_write("ok\r\n");
+    dbg_flush(); // spins on the DMA and TC: the emulator runs on
+    const size_t m = sim_uart_tx(out, sizeof out);
+    assert(m == 4U && memcmp(out, "ok\r\n", 4) == 0);
+    printf("uart: %zu bytes in through DMA, \"ok\" out\n", n);
+}
+
+/* A "$" command through gcode_stream: its reply lines up to and including "ok" */
+static void command(const char* cmd, char* out, size_t max) {
+    while (sim_uart_tx(out, max) != 0U) {
+    }
+    memset(out, 0, max);
+    sim_uart_rx(cmd, strlen(cmd));
+    size_t n = 0;
+    for (int i = 0; i < 200 && strstr(out, "ok") == NULL; ++i) {
+        sim_run(SIM_MS(1));
+        gcode_stream_service();
+        n += sim_uart_tx(out + n, max - 1U - n);
+    }
+    assert(strstr(out, "ok") != NULL);
+}
+
+/* Every handler counted once per call; the emulator runs handlers in zero cycles, so only
+   the counts are checked here (the cycle figures need the chip) */
+static void test_isr_prof(void) {
+    isr_prof_reset();
+    isr_prof_stats_t s;
+    assert(isr_prof_get(ISR_PROF_STEP, &s) && s.calls == 0U);
+
+    motors_reset();
+    stepgen_set_accel(AXIS_Y, 0);
+    stepgen_dir(AXIS_Y, false);
+    stepgen_move_n(AXIS_Y, 200, 10000);
+    assert(sim_run_until(all_idle, SIM_MS(100)));
+    sim_run(SIM_MS(50) - sim_now() % SIM_MS(1)); // to a SysTick boundary
+    assert(s_motor[AXIS_Y].rises == 200U);
+    isr_prof_get(ISR_PROF_STEP, &s);
+    assert(s.calls == 400U); // a toggle compare per edge
+    assert(s.min <= s.max && s.total <= (uint64_t)s.max * s.calls);
+
+    isr_prof_reset();
+    sim_run(SIM_MS(20));
+    isr_prof_get(ISR_PROF_SYSTICK, &s);
+    assert(s.calls == 20U);
+
+    gcode_stream_init();
+    char out[512];
+    command("$I\n", out, sizeof out);
+    assert(strstr(out, "[ISR:systick,") != NULL && strstr(out, "[ISR:step,0,") != NULL);
+    assert(strstr(out, "[ISR:dma_rx,") != NULL);
+    printf("isr_prof: 400 step interrupts for 200 steps, 20 SysTicks in 20 ms, $I answered\n");
+}
+
+/* Jitter capture (STEP_JITTER) over the link: the emulator services each compare at its
+   match, so every interval is on time; "$J0" empties the histograms */
+static void test_jitter_report(void) {
+    char out[512];
+    command("$J0\n", out, sizeof out);
+    stepgen_set_accel(AXIS_Y, 0);
+    stepgen_dir(AXIS_Y, true);
+    stepgen_move_n(AXIS_Y, 100, 5000);
+    assert(sim_run_until(all_idle, SIM_MS(100)));
+    command("$J\n", out, sizeof out);
+    assert(strstr(out, "[JIT:x,0,0,0,36]") != NULL); // X has not stepped since the clear
+    assert(strstr(out, "[JIT:y,99,0,0,36,0:99]") != NULL);
+    command("$J0\n", out, sizeof out);
+    command("$J\n", out, sizeof out);
+    assert(strstr(out, "[JIT:y,0,0,0,36]") != NULL);
+    printf("jitter: $J reports 99 Y intervals on time, $J0 clears\n");
+}
+
+int main(void) {
+    if (!sim_init()) {
+        printf("sim: cannot map the register blocks here, skipped\n");
+        return SKIP;
+    }
+    const clock_t c0 = clock();
+    sim_pin_watch(on_pin, NULL);
+    test_bring_up();
+    test_single_axis_rate();
+    test_slow_edge();
+    test_coordinated_line();
+    test_limit_trip();
+    test_estop_break();
+    test_homing();
+    test_uart();
+    test_isr_prof();
+    test_jitter_report();
+
+    const double wall = (double)(clock() - c0) / CLOCKS_PER_SEC;
+    const double simulated = (double)sim_now() / (double)SIM_HCLK_HZ;
+    printf("%.2f s simulated in %.2f s (%.0fx), %llu irqs\n", simulated, wall,
+           simulated / (wall > 0.0 ? wall : 1e-9), (unsigned long long)sim_stats()->irqs);
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app_init.h"
+#include "sim_trace.h"
+#include "stepgen_pwm_tim3.h"
+#include "stm32_sim.h"
+
+/*
+ * STEP / DIR / EN traces of the step engine on the emulator, with the timing budget the
+ * engine has to keep (1 us timer ticks, so everything is checked to the tick):
+ *  - a constant-rate single-axis move: every interval equal (no jitter), 50 % duty
+ *  - a constant-rate coordinated line: the dominant axis on the tick grid (+-1 tick), the
+ *    others whole DDA ticks apart, DIR set before the first pulse it governs, EN low
+ * The firmware's own jitter histograms (STEP_JITTER) must agree: the emulator services every
+ * compare at its match, so every interval lands in the on-time bin.
+ * Writes sim_trace_*.vcd (GTKWave), the CSV summaries and sim_jitter_line.csv (the
+ * histograms) next to the test binary.
+ */
+
+#define SKIP 77
+#define TICK SIM_US(1) // TIM1 counter tick
+#define EDGES 65536U
+
+static sim_trace_edge_t s_buf[EDGES];
+
+static bool idle(void) {
+    return !stepgen_busy(AXIS_X) && !stepgen_busy(AXIS_Y) && !stepgen_busy(AXIS_Z);
+}
+
+static void save(const sim_trace_t* tr, const char* name) {
+    char path[64];
+    snprintf(path, sizeof path, "sim_trace_%s.vcd", name);
+    assert(sim_trace_write_vcd(tr, path));
+    snprintf(path, sizeof path, "sim_trace_%s.csv", name);
+    assert(sim_trace_write_summary_csv(tr, path));
+    snprintf(path, sizeof path, "sim_trace_%s_intervals.csv", name);
+    assert(sim_trace_write_intervals_csv(tr, path));
+}
+
+/* The firmware's histograms: axis, bin (signed, on-time = 0), deviation from / to, count */
+static void save_jitter(const char* path) {
+    FILE* f = fopen(path, "w");
+    assert(f != NULL);
+    fprintf(f, "axis,bin,from_cycles,to_cycles,count\n");
+    for (int a = 0; a < 3; ++a) {
+        stepgen_jitter_t j;
+        assert(stepgen_jitter_get((axis_t)a, &j));
+        for (uint32_t b = 0; b < STEPGEN_JITTER_BINS; ++b) {
+            const int k = (int)b - (int)STEPGEN_JITTER_MID;
+            fprintf(f, "%c,%d,%d,%d,%u\n", "xyz"[a], k, k * STEPGEN_JITTER_BIN_CYCLES
+                    - STEPGEN_JITTER_BIN_CYCLES / 2, k * STEPGEN_JITTER_BIN_CYCLES
+                    + STEPGEN_JITTER_BIN_CYCLES / 2, j.bins[b]);
+        }
+    }
+    assert(fclose(f) == 0);
+}
+
+/* Every interval of the line binned on time: count = rises - 1 per axis */
+static void check_jitter(const sim_trace_stats_t s[3]) {
+    for (int a = 0; a < 3; ++a) {
+        stepgen_jitter_t j;
+        assert(stepgen_jitter_get((axis_t)a, &j));
+        assert(j.count == s[a].rises - 1U);
+        assert(j.bins[STEPGEN_JITTER_MID] == j.count);
+        assert(j.min == 0 && j.max == 0);
+    }
+}
+
+static void test_constant_rate(sim_trace_t* tr) {
+    stepgen_set_accel(AXIS_X, 0);
+    stepgen_enable(AXIS_X, true);
+    sim_trace_clear(tr);
+    stepgen_dir(AXIS_X, true);
+    stepgen_move_n(AXIS_X, 500, 5000);
+    assert(sim_run_until(idle, SIM_MS(200)));
+    sim_run(SIM_MS(1));
+
+    sim_trace_stats_t s;
+    sim_trace_stats(tr, SIM_TRACE_CH(AXIS_X, SIM_TRACE_STEP), SIM_TRACE_CH(AXIS_X, SIM_TRACE_DIR),
+                    &s);
+    assert(s.rises == 500U);
+    assert(s.interval_min == SIM_US(200) && s.interval_max == SIM_US(200));
+    assert(s.jitter_min == 0 && s.jitter_max == 0);
+    assert(s.high_min == SIM_US(100));
+    assert(s.dir_setup_min >= TICK); // DIR moved before the first rise
+    assert(tr->dropped == 0U);
+    save(tr, "move");
+    printf("move: 500 rises every %.1f us, jitter 0, DIR setup %.1f us\n",
+           (double)s.interval_min / 180.0, (double)s.dir_setup_min / 180.0);
+}
+
+/* EN of every axis low (enabled), and nothing on them while the line ran */
+static void check_enabled(const sim_trace_t* tr) {
+    for (int a = 0; a < 3; ++a) {
+        const int ch = SIM_TRACE_CH(a, SIM_TRACE_EN);
+        assert(!tr->ch[ch].level0);
+        for (size_t i = 0; i < tr->n; ++i) {
+            assert(tr->edges[i].ch != ch);
+        }
+    }
+}
+
+static void test_line(sim_trace_t* tr) {
+    for (int a = 0; a < 3; ++a) {
+        stepgen_enable((axis_t)a, true);
+    }
+    sim_trace_clear(tr);
+    stepgen_jitter_clear();
+    const stepgen_block_t b = {.steps = {600, -400, 150}, .rate_hz = 6000U};
+    assert(stepgen_line(&b));
+    assert(sim_run_until(idle, SIM_MS(500)));
+    sim_run(SIM_MS(1));
+
+    sim_trace_stats_t s[3];
+    for (int a = 0; a < 3; ++a) {
+        sim_trace_stats(tr, SIM_TRACE_CH(a, SIM_TRACE_STEP), SIM_TRACE_CH(a, SIM_TRACE_DIR),
+                        &s[a]);
+    }
+    assert(s[0].rises == 600U && s[1].rises == 400U && s[2].rises == 150U);
+    // Dominant axis: 166.7 us on a 1 us grid
+    assert(s[0].interval_min >= SIM_US(166) && s[0].interval_max <= SIM_US(167));
+    assert(s[0].jitter_max - s[0].jitter_min <= (int64_t)(2U * TICK));
+    // Minor axes: whole ticks apart (1 or 2 for Y at 2/3, 4 for Z at 1/4)
+    assert(s[1].interval_min >= s[0].interval_min);
+    assert(s[1].interval_max <= 2U * s[0].interval_max);
+    assert(s[2].interval_min >= 4U * s[0].interval_min);
+    assert(s[2].interval_max <= 4U * s[0].interval_max);
+    // Y reversed from the previous moves: DIR was changed ahead of its first pulse
+    assert(s[1].dir_setup_min != UINT64_MAX && s[1].dir_setup_min >= TICK);
+    check_enabled(tr);
+    check_jitter(s);
+    save(tr, "line");
+    save_jitter("sim_jitter_line.csv");
+    printf("line: X %.1f..%.1f us, Y %.1f..%.1f us, Z %.1f..%.1f us\n",
+           (double)s[0].interval_min / 180.0, (double)s[0].interval_max / 180.0,
+           (double)s[1].interval_min / 180.0, (double)s[1].interval_max / 180.0,
+           (double)s[2].interval_min / 180.0, (double)s[2].interval_max / 180.0);
+}
+
+/* The VCD holds every edge, in order, after a header GTKWave accepts */
+static void test_vcd_file(void) {
+    FILE* f = fopen("sim_trace_line.vcd", "r");
+    assert(f != NULL);
+    char line[128];
+    int vars = 0, changes = 0;
+    bool defs = false;
+    unsigned long long t = 0, last = 0;
+    while (fgets(line, sizeof line, f) != NULL) {
+        if (strncmp(line, "$var wire 1 ", 12) == 0) {
+            vars++;
+        } else if (strncmp(line, "$enddefinitions", 15) == 0) {
+            defs = true;
+        } else if (line[0] == '#') {
+            t = strtoull(line + 1, NULL, 10);
+            assert(t >= last);
+            last = t;
+        } else if (defs && (line[0] == '0' || line[0] == '1')) {
+            changes++;
+        }
+    }
+    fclose(f);
+    assert(vars == 9 && defs);
+    assert(changes > 2 * (600 + 400 + 150)); // initial values + both edges of every pulse
+    printf("vcd: %d signals, %d value changes over %.1f ms\n", vars, changes, (double)t / 1e6);
+}
+
+int main(void) {
+    if (!sim_init()) {
+        printf("sim: cannot map the register blocks here, skipped\n");
+        return SKIP;
+    }
+    app_init();
+    sim_run(SIM_MS(10));
+
+    sim_trace_t tr;
+    sim_trace_init(&tr, s_buf, EDGES);
+    sim_trace_add_axes(&tr);
+    assert(sim_trace_start(&tr));
+    test_constant_rate(&tr);
+    test_line(&tr);
+    sim_trace_stop(&tr);
+    test_vcd_file();
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stepgen_dda.h"
+#include "stepgen_oc.h"
+
+/* Record the step mask of every tick for one block */
+static uint32_t record(const uint32_t n[3], uint8_t* masks, uint32_t cap) {
+    stepgen_dda_t d;
+    stepgen_dda_load(&d, n);
+    uint32_t ticks = 0;
+    while (!stepgen_dda_done(&d)) {
+        assert(ticks < cap);
+        masks[ticks++] = stepgen_dda_tick(&d);
+    }
+    return ticks;
+}
+
+static void check_line(uint32_t nx, uint32_t ny, uint32_t nz) {
+    static uint8_t masks[100000];
+    const uint32_t n[3] = {nx, ny, nz};
+    uint32_t total = nx;
+    if (ny > total)
+        total = ny;
+    if (nz > total)
+        total = nz;
+
+    const uint32_t ticks = record(n, masks, sizeof masks);
+    assert(ticks == total);
+
+    uint32_t cum[3] = {0, 0, 0};
+    for (uint32_t k = 0; k < ticks; ++k) {
+        for (int i = 0; i < 3; ++i) {
+            if (masks[k] & (1U << i)) {
+                cum[i]++;
+            }
+            // Never more than half a step off the ideal line: |cum*N - (k+1)*n| <= N/2
+            const int64_t dev = (int64_t)cum[i] * total - (int64_t)(k + 1) * n[i];
+            assert(llabs(dev) * 2 <= (int64_t)total);
+        }
+        if (total) {
+            // The dominant axis steps on every tick
+            for (int i = 0; i < 3; ++i) {
+                if (n[i] == total) {
+                    assert(masks[k] & (1U << i));
+                }
+            }
+        }
+    }
+    assert(cum[0] == nx && cum[1] == ny && cum[2] == nz);
+}
+
+static void test_step_sequences(void) {
+    check_line(100, 37, 13);
+    check_line(37, 100, 0);
+    check_line(0, 0, 4000);
+    check_line(64000, 64000, 64000); // pure diagonal: all step together
+    check_line(99991, 1, 50000);
+    check_line(0, 0, 0);
+
+    // Known pattern for a 2:1 line
+    uint8_t masks[8];
+    const uint32_t n[3] = {4, 2, 0};
+    assert(record(n, masks, 8) == 4);
+    assert(masks[0] == 0x3 && masks[1] == 0x1 && masks[2] == 0x3 && masks[3] == 0x1);
+}
+
+/*
+ * Pulse level: the DDA tick fires every `tick_us` on CH4 and queues pulses on the axis
+ * compare channels (exactly like TIM1_CC_IRQHandler). Record every rising edge and check
+ * they all sit on the tick grid and that coincident steps are simultaneous.
+ */
+#define MAX_RISES 8192
+static uint32_t rises[3][MAX_RISES];
+static uint32_t n_rises[3];
+
+static void test_synchronized_edges(void) {
+    const uint32_t tick_us = 250; // 4 kHz dominant rate
+    const uint32_t n[3] = {1200, 700, 300};
+
+    stepgen_oc_t oc[3];
+    bool armed[3] = {false, false, false};
+    uint8_t pin[3] = {0, 0, 0};
+    memset(n_rises, 0, sizeof n_rises);
+    for (int i = 0; i < 3; ++i) {
+        stepgen_oc_set_period(&oc[i], tick_us);
+        oc[i].steps_left = 0;
+        oc[i].level = 0;
+    }
+
+    stepgen_dda_t d;
+    stepgen_dda_load(&d, n);
+
+    uint32_t now = 0;
+    const uint32_t t0 = STEPGEN_OC_LEAD_TICKS; // first tick
+    uint16_t ccr4 = (uint16_t)t0;
+    bool ticking = true;
+
+    while (ticking || armed[0] || armed[1] || armed[2]) {
+        ++now;
+        const uint16_t cnt = (uint16_t)now;
+        for (int i = 0; i < 3; ++i) {
+            if (armed[i] && cnt == oc[i].ccr) {
+                pin[i] ^= 1U;
+                if (pin[i]) {
+                    assert(n_rises[i] < MAX_RISES);
+                    rises[i][n_rises[i]++] = now;
+                }
+                if (stepgen_oc_on_match(&oc[i]) == STEPGEN_OC_DONE) {
+                    armed[i] = false;
+                }
+            }
+        }
+        if (ticking && cnt == ccr4) {
+            const uint8_t mask = stepgen_dda_tick(&d);
+            for (int i = 0; i < 3; ++i) {
+                if ((mask & (1U << i))
+                        && stepgen_oc_queue_step(&oc[i], (uint16_t)(ccr4 + STEPGEN_OC_LEAD_TICKS))) {
+                    armed[i] = true;
+                }
+            }
+            if (stepgen_dda_done(&d)) {
+                ticking = false;
+            }
+            ccr4 = (uint16_t)(ccr4 + tick_us);
+        }
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        assert(n_rises[i] == n[i]);
+        assert(pin[i] == 0);
+        for (uint32_t k = 0; k < n_rises[i]; ++k) {
+            // Every edge is tick time + lead, i.e. on the shared grid
+            assert((rises[i][k] - t0 - STEPGEN_OC_LEAD_TICKS) % tick_us == 0);
+        }
+    }
+    // Dominant axis: one step per tick, back to back
+    for (uint32_t k = 1; k < n_rises[0]; ++k) {
+        assert(rises[0][k] - rises[0][k - 1] == tick_us);
+    }
+    // Whole line lasts N ticks; every axis finishes on the last tick or before it
+    const uint32_t last = t0 + STEPGEN_OC_LEAD_TICKS + (n[0] - 1) * tick_us;
+    assert(rises[0][n_rises[0] - 1] == last);
+    assert(rises[1][n_rises[1] - 1] <= last && rises[2][n_rises[2] - 1] <= last);
+}
+
+int main(void) {
+    test_step_sequences();
+    test_synchronized_edges();
+
+    printf("All stepgen_dda tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,276 @@
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stepgen_feed.h"
+
+/*
+ * Feed hold, cycle start and overrides on the line lane. The lane is drained like the DDA tick
+ * drains it (one interval per tick, pausing once a hold has run dry) while a 1 kHz "SysTick"
+ * runs the producer, like stepgen_prep(). Stop distances are measured from the step the
+ * producer had reached when it took the hold; the lane already queued ahead of it is the
+ * reaction time.
+ */
+
+#define MAX_TICKS 200000U
+#define MAX_BLOCKS 16U
+#define ACCEL 50000.0f // steps/s^2
+
+typedef struct {
+    stepgen_feed_t f;
+    stepgen_lane_t l;
+    stepgen_feed_blk_t q[MAX_BLOCKS];
+    uint32_t n; // blocks queued
+    uint32_t next; // next block offered to the producer
+    uint32_t total; // ticks in all blocks
+    uint32_t ticks; // ticks issued
+    uint64_t t_us;
+    uint64_t next_prep;
+    bool paused;
+    float rate[MAX_TICKS]; // steps/s at each tick
+} sim_t;
+
+static sim_t s_sim;
+
+static void prep(sim_t* s) {
+    while (stepgen_feed_fill(&s->f, &s->l, s->next < s->n ? &s->q[s->next] : NULL)) {
+        s->next++;
+    }
+}
+
+static stepgen_feed_blk_t blk(uint32_t steps, float entry, float nominal, float exit) {
+    const stepgen_feed_blk_t b = {steps, entry, nominal, exit, ACCEL, 100U, 0U};
+    return b;
+}
+
+static void sim_start(sim_t* s, const stepgen_feed_blk_t* blocks, uint32_t n) {
+    const uint8_t pct_req[2] = {s->f.pct_req[0], s->f.pct_req[1]};
+    memset(s, 0, sizeof *s);
+    stepgen_feed_init(&s->f);
+    stepgen_feed_override(&s->f, pct_req[0] ? pct_req[0] : 100U, pct_req[1] ? pct_req[1] : 100U);
+    for (uint32_t i = 0; i < n; ++i) {
+        s->q[i] = blocks[i];
+        s->total += blocks[i].steps;
+    }
+    s->n = n;
+    stepgen_lane_reset(&s->l);
+    stepgen_feed_start(&s->f, &s->l.ramp, &s->q[0]);
+    s->next = 1;
+    prep(s);
+    s->next_prep = 1000;
+}
+
+/* Tick until `until` ticks have gone out, the program ends, or a hold has paused it */
+static void sim_run(sim_t* s, uint32_t until) {
+    while (s->ticks < until && s->ticks < s->total) {
+        while (s->t_us >= s->next_prep) {
+            prep(s);
+            s->next_prep += 1000;
+        }
+        if (s->paused) {
+            if (s->f.state != STEPGEN_FEED_RUN || s->l.tail == s->l.head) {
+                return; // still held: the caller decides what happens next
+            }
+            s->paused = false; // cycle start: the tick is re-armed (stepgen_prep())
+        }
+        if (stepgen_feed_should_pause(&s->f, &s->l)) {
+            s->paused = true;
+            s->t_us = s->next_prep;
+            continue;
+        }
+        const uint16_t p = stepgen_lane_next_period(&s->l);
+        s->rate[s->ticks++] = 1e6f / (float)p;
+        s->t_us += p;
+    }
+}
+
+
+/* Ticks the producer had segmented when it took the hold (absolute, across blocks) */
+static uint32_t producer_pos(const sim_t* s) {
+    uint32_t done = 0;
+    for (uint32_t i = 0; i + 1U < s->next; ++i) {
+        done += s->q[i].steps;
+    }
+    return done + s->q[s->next - 1U].steps - s->f.rest - (s->l.ramp.total - s->l.ramp.planned);
+}
+
+/*
+ * Largest rate change between neighbouring ticks beyond what the segments allow: one segment
+ * holds ~2 ms (about 100 steps/s apart at 50000 steps/s^2), and whole-microsecond periods are
+ * v^2 / 1e6 apart. Anything left over is a jump in the profile.
+ */
+static float max_jump(const sim_t* s, uint32_t from, uint32_t to) {
+    const float seg = 2.0f * ACCEL * (float)STEPGEN_SEG_US * 1e-6f;
+    float m = 0.0f;
+    for (uint32_t k = from + 1U; k < to; ++k) {
+        const float v = fmaxf(s->rate[k], s->rate[k - 1U]);
+        const float d = fabsf(s->rate[k] - s->rate[k - 1U]) - seg - v * v * 1e-6f;
+        m = d > m ? d : m;
+    }
+    return m;
+}
+
+static void test_hold_in_one_block(void) {
+    sim_t* s = &s_sim;
+    const stepgen_feed_blk_t b = blk(20000, 0.0f, 10000.0f, 0.0f);
+    sim_start(s, &b, 1);
+    sim_run(s, 6000); // cruising by now (accel takes 1000 steps)
+    assert(fabsf(s->rate[s->ticks - 1U] - 10000.0f) < 1.0f);
+
+    const uint32_t requested = s->ticks;
+    stepgen_feed_hold(&s->f);
+    prep(s);
+    const uint32_t from = producer_pos(s);
+    assert(s->f.state == STEPGEN_FEED_DECEL);
+    sim_run(s, s->total);
+    assert(s->paused && s->ticks < s->total);
+
+    const float ideal = 10000.0f * 10000.0f / (2.0f * ACCEL); // 1000 steps
+    const uint32_t stop = s->ticks;
+    printf("stepgen_feed: hold at %.0f steps/s: %u steps to rest (ideal %.0f), %u queued ahead\n",
+           10000.0, stop - from, ideal, from - requested);
+    assert(fabsf((float)(stop - from) - ideal) <= 2.0f);
+    assert(from - requested <= STEPGEN_SEGQ_LEN * 20U); // reaction: what the lane held
+    assert(s->rate[stop - 1U] < 500.0f); // crawling at the end, not cut off
+    assert(max_jump(s, requested, stop) == 0.0f);
+
+    // Still held: nothing moves however long it waits
+    for (int i = 0; i < 50; ++i) {
+        prep(s);
+        sim_run(s, s->total);
+    }
+    assert(s->ticks == stop && s->paused);
+
+    // Cycle start: the remaining steps from rest, every one of them, ending at rest again
+    stepgen_feed_resume(&s->f);
+    prep(s);
+    sim_run(s, s->total);
+    assert(s->ticks == s->total && !s->paused);
+    assert(s->rate[stop] < 500.0f && s->rate[s->total - 1U] < 500.0f);
+    assert(max_jump(s, stop, s->total) == 0.0f);
+    assert(s->l.underruns == 0);
+}
+
+static void test_hold_across_blocks(void) {
+    // Collinear 300-step blocks at full speed: a 1000-step stop spans four of them. Junction
+    // rates as the planner leaves them: each entry can still stop by the end of the queue.
+    sim_t* s = &s_sim;
+    stepgen_feed_blk_t b[12];
+    float entry[13];
+    for (int i = 0; i <= 12; ++i) {
+        entry[i] = fminf(10000.0f, sqrtf(2.0f * ACCEL * 300.0f * (float)(12 - i)));
+    }
+    entry[0] = 0.0f;
+    for (int i = 0; i < 12; ++i) {
+        b[i] = blk(300, entry[i], 10000.0f, entry[i + 1]);
+    }
+    sim_start(s, b, 12);
+    sim_run(s, 1700);
+    stepgen_feed_hold(&s->f);
+    prep(s);
+    const uint32_t from = producer_pos(s);
+    const uint32_t blk_at_hold = s->next;
+    sim_run(s, s->total);
+    assert(s->paused);
+    const uint32_t stop = s->ticks;
+    assert(fabsf((float)(stop - from) - 1000.0f) <= 2.0f * 4.0f); // a ceil per block at most
+    assert(s->next >= blk_at_hold + 3U); // the stop reached into later blocks
+    assert(max_jump(s, 1700, stop) == 0.0f);
+
+    stepgen_feed_resume(&s->f);
+    prep(s);
+    sim_run(s, s->total);
+    assert(s->ticks == s->total); // block boundaries kept: not a step lost or added
+    assert(s->rate[s->total - 1U] < 500.0f);
+    assert(max_jump(s, stop, s->total) == 0.0f);
+}
+
+static void test_hold_then_resume_while_stopping(void) {
+    sim_t* s = &s_sim;
+    const stepgen_feed_blk_t b = blk(20000, 0.0f, 10000.0f, 0.0f);
+    sim_start(s, &b, 1);
+    sim_run(s, 6000);
+    stepgen_feed_hold(&s->f);
+    prep(s);
+    sim_run(s, 6500); // part way down
+    assert(s->rate[s->ticks - 1U] < 9500.0f);
+    stepgen_feed_resume(&s->f);
+    prep(s);
+    sim_run(s, s->total);
+    assert(s->ticks == s->total && !s->paused);
+    assert(max_jump(s, 6000, s->total) == 0.0f);
+    // Back up to full speed in between
+    float peak = 0.0f;
+    for (uint32_t k = 6500; k < s->total; ++k) {
+        peak = s->rate[k] > peak ? s->rate[k] : peak;
+    }
+    assert(peak > 9990.0f);
+}
+
+/* Ticks from `from` until the rate first comes within `tol` of `v` */
+static uint32_t settle(const sim_t* s, uint32_t from, float v, float tol) {
+    uint32_t k = from;
+    while (k < s->ticks && fabsf(s->rate[k] - v) > tol) {
+        k++;
+    }
+    return k - from;
+}
+
+static void test_overrides(void) {
+    sim_t* s = &s_sim;
+    const stepgen_feed_blk_t b = blk(60000, 0.0f, 10000.0f, 0.0f);
+    sim_start(s, &b, 1);
+    sim_run(s, 6000);
+
+    // 50 %: down to 5000 along the acceleration limit (750 steps) after the queued lane
+    stepgen_feed_override(&s->f, 50, 100);
+    prep(s);
+    uint32_t from = producer_pos(s);
+    sim_run(s, 20000);
+    const uint32_t down = settle(s, from, 5000.0f, 2.0f);
+    assert(fabsf((float)down - 750.0f) <= 15.0f);
+    assert(fabsf(s->rate[s->ticks - 1U] - 5000.0f) < 2.0f);
+
+    // 200 %: up to 20000 (3750 steps), then still stopping at the block end
+    stepgen_feed_override(&s->f, 200, 100);
+    prep(s);
+    from = producer_pos(s);
+    sim_run(s, s->total);
+    const uint32_t up = settle(s, from, 20000.0f, 2.0f); // 50 us: whole periods get coarse
+    assert(fabsf((float)up - 3750.0f) <= 3750.0f * 0.03f);
+    assert(s->ticks == s->total && s->rate[s->total - 1U] < 1000.0f);
+    assert(max_jump(s, 6000, s->total) == 0.0f);
+    printf("stepgen_feed: override 100->50 %% in %u steps, 50->200 %% in %u (ideal 750, 3750)\n",
+           down, up);
+
+    // A rapid follows the rapid override only; a block planned at 50 % scales from there
+    stepgen_feed_blk_t r = blk(20000, 0.0f, 10000.0f, 0.0f);
+    r.rapid = 1;
+    sim_start(s, &r, 1); // the feed override (200 %) carries over
+    sim_run(s, 10000);
+    assert(fabsf(s->rate[s->ticks - 1U] - 10000.0f) < 2.0f);
+    stepgen_feed_blk_t h = blk(20000, 0.0f, 5000.0f, 0.0f);
+    h.pct = 50;
+    stepgen_feed_override(&s->f, 100, 100);
+    sim_start(s, &h, 1);
+    sim_run(s, 10000);
+    assert(fabsf(s->rate[s->ticks - 1U] - 10000.0f) < 2.0f);
+
+    // Above STEPGEN_MAX_HZ the rate is capped, not wrapped
+    stepgen_feed_blk_t fast = blk(80000, 0.0f, 30000.0f, 0.0f);
+    stepgen_feed_override(&s->f, 200, 100);
+    sim_start(s, &fast, 1);
+    sim_run(s, 60000);
+    assert(fabsf(s->rate[s->ticks - 1U] - (float)STEPGEN_MAX_HZ) < 50.0f);
+}
+
+int main(void) {
+    test_hold_in_one_block();
+    test_hold_across_blocks();
+    test_hold_then_resume_while_stopping();
+    test_overrides();
+    printf("All stepgen_feed tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "stepgen_jitter.h"
+
+/*
+ * Jitter histogram bookkeeping: binning (nearest bin, open ends), the first rise of a chain
+ * only starting it, 16-bit compare wrap in the commanded interval, 32-bit cycle-stamp wrap
+ * in the measured one, and a gap of a timer period or more starting a new chain.
+ */
+
+#define CPT 180U // core cycles per timer tick (1 MHz timer at 180 MHz)
+#define W STEPGEN_JITTER_BIN_CYCLES
+#define MID STEPGEN_JITTER_MID
+
+static void test_bins(void) {
+    assert(stepgen_jitter_bin(0) == MID);
+    assert(stepgen_jitter_bin(W / 2 - 1) == MID);
+    assert(stepgen_jitter_bin(W / 2) == MID + 1U);
+    assert(stepgen_jitter_bin(-W / 2) == MID);
+    assert(stepgen_jitter_bin(-W / 2 - 1) == MID - 1U);
+    assert(stepgen_jitter_bin(3 * W) == MID + 3U);
+    assert(stepgen_jitter_bin(-3 * W) == MID - 3U);
+    assert(stepgen_jitter_bin(1000000) == STEPGEN_JITTER_BINS - 1U);
+    assert(stepgen_jitter_bin(-1000000) == 0U);
+    printf("bins: %u x %d cycles, ends open\n", STEPGEN_JITTER_BINS, W);
+}
+
+static void test_chain(void) {
+    stepgen_jitter_t j;
+    stepgen_jitter_reset(&j);
+
+    // Rises every 100 ticks, serviced 50 cycles late except one that is 2 bins later still
+    uint32_t stamp = 0xFFFFF000U; // wraps during the run
+    uint16_t ccr = 0xFF00U; // wraps during the run
+    for (int i = 0; i < 10; ++i) {
+        const uint32_t late = i == 5 ? 50U + 2U * W : 50U;
+        stepgen_jitter_rise(&j, stamp + late, ccr, CPT);
+        stamp += 100U * CPT;
+        ccr = (uint16_t)(ccr + 100U);
+    }
+    assert(j.count == 9U); // the first rise only starts the chain
+    assert(j.bins[MID] == 7U);
+    assert(j.bins[MID + 2U] == 1U && j.bins[MID - 2U] == 1U); // late, then back on time
+    assert(j.min == -2 * W && j.max == 2 * W);
+
+    // A pause shorter than the timer period is still an interval (e.g. between DDA pulses)
+    stamp += 20000U * CPT;
+    ccr = (uint16_t)(ccr + 20000U);
+    stepgen_jitter_rise(&j, stamp + 50U, ccr, CPT);
+    assert(j.count == 10U && j.bins[MID] == 8U);
+
+    // 70 ms: the compare values wrapped in between, so this rise only starts a new chain
+    stamp += 70000U * CPT;
+    ccr = (uint16_t)(ccr + 70000U);
+    stepgen_jitter_rise(&j, stamp + 50U, ccr, CPT);
+    assert(j.count == 10U);
+    stepgen_jitter_rise(&j, stamp + 40U * CPT + 50U, (uint16_t)(ccr + 40U), CPT);
+    assert(j.count == 11U && j.bins[MID] == 9U);
+    printf("chain: one late rise seen as +%d / -%d cycles, 70 ms gap restarts\n", 2 * W,
+           2 * W);
+}
+
+int main(void) {
+    test_bins();
+    test_chain();
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stepgen_oc.h"
+
+/*
+ * Simulated step timer: a 16-bit up-counter at 1 MHz (1 tick = 1 us) with three compare
+ * channels in toggle mode. Each tick we compare CNT against every armed CCR exactly like
+ * the hardware does, toggle the pin and run the same per-channel logic the ISR runs.
+ */
+
+#define SIM_AXES 3
+#define MAX_EDGES 4096
+
+typedef struct {
+    stepgen_oc_t oc;
+    bool armed; // toggle mode (false = forced inactive)
+    uint8_t pin;
+    uint32_t rises[MAX_EDGES]; // absolute time (us) of every rising edge
+    uint32_t n_rises;
+    uint32_t high_time_total;
+    uint32_t last_rise;
+} sim_ch_t;
+
+static sim_ch_t ch[SIM_AXES];
+static uint32_t now_us; // absolute simulated time; CNT = now_us & 0xFFFF
+
+static void sim_reset(void) {
+    memset(ch, 0, sizeof ch);
+    now_us = 0;
+}
+
+static void sim_start(int i, uint32_t steps, uint32_t hz) {
+    stepgen_oc_set_period(&ch[i].oc, 1000000UL / hz);
+    stepgen_oc_start(&ch[i].oc, (uint16_t)now_us, steps);
+    ch[i].armed = true;
+}
+
+static void sim_run(uint32_t ticks) {
+    for (uint32_t t = 0; t < ticks; ++t) {
+        ++now_us;
+        const uint16_t cnt = (uint16_t)now_us;
+        for (int i = 0; i < SIM_AXES; ++i) {
+            sim_ch_t* c = &ch[i];
+            if (!c->armed || cnt != c->oc.ccr) {
+                continue;
+            }
+            c->pin ^= 1U; // hardware toggle on match
+            if (c->pin) {
+                assert(c->n_rises < MAX_EDGES);
+                c->rises[c->n_rises++] = now_us;
+                c->last_rise = now_us;
+            } else {
+                c->high_time_total += now_us - c->last_rise;
+            }
+            if (stepgen_oc_on_match(&c->oc) == STEPGEN_OC_DONE) {
+                c->armed = false; // ISR parks the channel (force inactive)
+            }
+        }
+    }
+}
+
+static void assert_intervals(int i, uint32_t expect_us) {
+    for (uint32_t k = 1; k < ch[i].n_rises; ++k) {
+        assert(ch[i].rises[k] - ch[i].rises[k - 1] == expect_us);
+    }
+}
+
+static void test_independent_periods(void) {
+    sim_reset();
+
+    // Three axes, three rates, all running at the same time on one timer
+    sim_start(0, 200, 1000); // X: 1000 us period
+    sim_run(123);
+    sim_start(1, 60, 333); // Y: 3003 us period, started later
+    sim_start(2, 500, 2500); // Z: 400 us period
+
+    sim_run(400000); // 400 ms: crosses the 16-bit wrap several times
+
+    assert(ch[0].n_rises == 200 && !ch[0].armed && ch[0].pin == 0);
+    assert(ch[1].n_rises == 60 && !ch[1].armed && ch[1].pin == 0);
+    assert(ch[2].n_rises == 500 && !ch[2].armed && ch[2].pin == 0);
+
+    assert_intervals(0, 1000);
+    assert_intervals(1, 3003);
+    assert_intervals(2, 400);
+
+    // 50% duty (odd periods put the spare tick in the low half)
+    assert(ch[0].high_time_total == 200u * 500u);
+    assert(ch[1].high_time_total == 60u * 1501u);
+    assert(ch[2].high_time_total == 500u * 200u);
+
+    // First edge arrives after the fixed lead
+    assert(ch[0].rises[0] == STEPGEN_OC_LEAD_TICKS);
+    assert(ch[1].rises[0] == 123u + STEPGEN_OC_LEAD_TICKS);
+}
+
+static void test_rate_change_mid_move(void) {
+    sim_reset();
+    sim_start(0, 20, 1000);
+    sim_run(5000 + STEPGEN_OC_LEAD_TICKS - 1); // 5 pulses out, 6th rise pending
+    assert(ch[0].n_rises == 5);
+
+    stepgen_oc_set_period(&ch[0].oc, 500); // double the rate from the next edge
+    sim_run(100000);
+
+    assert(ch[0].n_rises == 20);
+    // The low half already scheduled keeps the old timing, then the new period applies
+    for (uint32_t k = 6; k < ch[0].n_rises; ++k) {
+        assert(ch[0].rises[k] - ch[0].rises[k - 1] == 500);
+    }
+}
+
+static void test_stop_finishes_pulse(void) {
+    sim_reset();
+    sim_start(0, 100, 1000);
+    sim_run(STEPGEN_OC_LEAD_TICKS + 100); // inside the first high half
+    assert(ch[0].pin == 1);
+
+    bool freeze_now = stepgen_oc_stop(&ch[0].oc);
+    assert(!freeze_now); // the fall is still owed
+    sim_run(10000);
+    assert(ch[0].n_rises == 1 && ch[0].pin == 0 && !ch[0].armed);
+    assert(!stepgen_oc_active(&ch[0].oc));
+}
+
+/* The machine position follows DIR across moves, and a stop mid-pulse counts that pulse once */
+static void test_position_counter(void) {
+    sim_reset();
+    ch[0].oc.dir = 1;
+    sim_start(0, 40, 2000);
+    sim_run(40 * 500 + 1000);
+    assert(ch[0].oc.pos == 40);
+
+    ch[0].oc.dir = -1; // DIR is only changed between moves
+    sim_start(0, 15, 2000);
+    sim_run(15 * 500 + 1000);
+    assert(ch[0].oc.pos == 25 && ch[0].oc.issued == 15);
+
+    sim_start(0, 100, 1000);
+    sim_run(STEPGEN_OC_LEAD_TICKS + 3 * 1000 + 100); // high half of the fourth pulse
+    assert(ch[0].pin == 1);
+    stepgen_oc_stop(&ch[0].oc);
+    sim_run(10000);
+    assert(ch[0].oc.pos == 25 - 4 && ch[0].oc.pos == 25 - (int32_t)ch[0].oc.issued);
+
+    // Single steps from the DDA tick count the same way
+    ch[0].oc.dir = 1;
+    stepgen_oc_set_period(&ch[0].oc, 50);
+    for (int k = 0; k < 7; ++k) {
+        ch[0].armed = stepgen_oc_queue_step(&ch[0].oc, (uint16_t)(now_us + 10)) || ch[0].armed;
+        sim_run(100);
+    }
+    assert(ch[0].oc.pos == 21 + 7);
+}
+
+static void test_period_clamps(void) {
+    stepgen_oc_t oc;
+    stepgen_oc_set_period(&oc, 1); // faster than the ISR can follow
+    assert(oc.high_ticks == STEPGEN_OC_MIN_EDGE_TICKS);
+    assert(oc.low_ticks == STEPGEN_OC_MIN_EDGE_TICKS);
+
+    stepgen_oc_set_period(&oc, 1000000UL); // 1 Hz: longer than one counter wrap
+    assert(oc.high_ticks == STEPGEN_OC_MAX_EDGE_TICKS);
+    assert(oc.low_ticks == STEPGEN_OC_MAX_EDGE_TICKS);
+}
+
+static void test_late_edge(void) {
+    // 10 Hz: 50000-tick halves, longer than half the counter range
+    stepgen_oc_t oc;
+    stepgen_oc_set_period(&oc, 1000000UL / 10U);
+    assert(oc.high_ticks == 50000U && oc.low_ticks == 50000U);
+    const uint16_t from = 0xF000U; // the edge just serviced, near the wrap
+    const uint16_t at = (uint16_t)(from + oc.low_ticks);
+    assert(!stepgen_oc_late(from, at, from));
+    assert(!stepgen_oc_late(from, at, (uint16_t)(from + 3U))); // ISR latency
+    assert(!stepgen_oc_late(from, at, (uint16_t)(at - 1U)));
+    assert(stepgen_oc_late(from, at, at));
+    assert(stepgen_oc_late(from, at, (uint16_t)(at + 2U)));
+
+    // The longest gap still waits; a zero gap is always due
+    const uint16_t far = (uint16_t)(from + STEPGEN_OC_MAX_EDGE_TICKS);
+    assert(!stepgen_oc_late(from, far, (uint16_t)(from + 0x8001U)));
+    assert(stepgen_oc_late(from, from, from));
+}
+
+int main(void) {
+    test_independent_periods();
+    test_rate_change_mid_move();
+    test_stop_finishes_pulse();
+    test_position_counter();
+    test_period_clamps();
+    test_late_edge();
+
+    printf("All stepgen_oc tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "stepgen_ramp.h"
+
+/*
+ * Ramp planning and the lane interval stream. The lane is drained the way the step ISR
+ * drains it (one stepgen_lane_next_period() per step) while a 1 kHz "SysTick" refills it.
+ */
+
+#define MAX_STEPS 200000
+
+static uint16_t periods[MAX_STEPS];
+
+// Drain a planned lane like the ISR; refill every 1000 simulated us like stepgen_prep().
+static uint32_t run_lane(stepgen_lane_t* l, uint32_t steps, uint64_t* total_us) {
+    stepgen_lane_fill(l);
+    uint64_t t = 0;
+    uint64_t next_prep = 1000;
+    for (uint32_t k = 0; k < steps; ++k) {
+        while (t >= next_prep) {
+            stepgen_lane_fill(l);
+            next_prep += 1000;
+        }
+        periods[k] = stepgen_lane_next_period(l);
+        t += periods[k];
+    }
+    *total_us = t;
+    return l->underruns;
+}
+
+static void test_trapezoid_shape(void) {
+    stepgen_ramp_t r;
+    // 10000 steps, 0 -> 5000 -> 0 at 50000 steps/s^2: 250 steps each way, cruise between
+    stepgen_ramp_plan(&r, 10000, 0.0f, 5000.0f, 0.0f, 50000.0f);
+    assert(r.accel_until == 250);
+    assert(r.decel_from == 10000 - 250);
+    assert(fabsf(r.v_cruise - 5000.0f) < 0.01f);
+
+    assert(fabsf(stepgen_ramp_rate_at(&r, 5000.0f) - 5000.0f) < 0.01f);
+    // v^2 = 2as at the half-way point of the ramp
+    assert(fabsf(stepgen_ramp_rate_at(&r, 125.0f) - sqrtf(2.0f * 50000.0f * 125.0f)) < 0.5f);
+    // Never below the 16-bit-compare floor, even at s = 0
+    assert(stepgen_ramp_rate_at(&r, 0.0f) >= (float)STEPGEN_MIN_HZ);
+}
+
+static void test_triangle(void) {
+    stepgen_ramp_t r;
+    // 100 steps cannot reach 5000 Hz at 50000 steps/s^2 (needs 500): peak in the middle
+    stepgen_ramp_plan(&r, 100, 0.0f, 5000.0f, 0.0f, 50000.0f);
+    assert(r.accel_until == 50 && r.decel_from == 50);
+    assert(fabsf(r.v_cruise - sqrtf(2.0f * 50000.0f * 50.0f)) < 0.5f);
+}
+
+static void test_entry_exit(void) {
+    stepgen_ramp_t r;
+    // Entering at cruise: no accel phase; leaving at 2000 Hz
+    stepgen_ramp_plan(&r, 10000, 5000.0f, 5000.0f, 2000.0f, 50000.0f);
+    assert(r.accel_until == 0);
+    assert(r.decel_from == 10000 - 210); // (5000^2 - 2000^2) / 1e5 = 210 steps
+    assert(fabsf(stepgen_ramp_rate_at(&r, 10000.0f) - 2000.0f) < 0.5f);
+}
+
+static void test_segments_conserve_steps(void) {
+    stepgen_ramp_t r;
+    stepgen_ramp_plan(&r, 12345, 0.0f, 8000.0f, 0.0f, 20000.0f);
+
+    uint32_t sum = 0;
+    uint32_t segs = 0;
+    stepgen_seg_t s;
+    while (stepgen_ramp_next(&r, &s)) {
+        assert(s.steps > 0 && s.period > 0);
+        // Segments never straddle a phase boundary
+        assert(!(sum < r.accel_until && sum + s.steps > r.accel_until));
+        assert(!(sum < r.decel_from && sum + s.steps > r.decel_from));
+        sum += s.steps;
+        ++segs;
+    }
+    assert(sum == 12345);
+    assert(segs < 12345 / 4); // many steps per segment -> little work per step
+}
+
+static void test_lane_profile(void) {
+    static stepgen_lane_t l;
+    stepgen_lane_reset(&l);
+    stepgen_ramp_plan(&l.ramp, 20000, 0.0f, 10000.0f, 0.0f, 40000.0f);
+
+    uint64_t total_us = 0;
+    assert(run_lane(&l, 20000, &total_us) == 0); // 1 kHz refills keep up
+    assert(l.head == l.tail && l.seg_left == 0); // every planned step consumed
+
+    // Periods fall monotonically to cruise, hold, then rise monotonically
+    const uint32_t acc = l.ramp.accel_until;
+    const uint32_t dec = l.ramp.decel_from;
+    for (uint32_t k = 1; k < acc; ++k) {
+        assert(periods[k] <= periods[k - 1]);
+    }
+    for (uint32_t k = acc; k < dec; ++k) {
+        assert(periods[k] == 100); // 10 kHz
+    }
+    for (uint32_t k = dec + 1; k < 20000; ++k) {
+        assert(periods[k] >= periods[k - 1]);
+    }
+
+    // Move time close to the analytic trapezoid: 2 * v/a + cruise distance / v
+    const double v = 10000.0, a = 40000.0;
+    const double t_ideal = 2.0 * v / a + (20000.0 - v * v / a) / v;
+    assert(fabs((double)total_us * 1e-6 - t_ideal) < 0.01 * t_ideal);
+}
+
+static void test_constant_rate_without_accel(void) {
+    static stepgen_lane_t l;
+    stepgen_lane_reset(&l);
+    stepgen_ramp_plan(&l.ramp, 3000, 0.0f, 333.0f, 0.0f, 0.0f);
+
+    uint64_t total_us = 0;
+    assert(run_lane(&l, 3000, &total_us) == 0);
+    for (uint32_t k = 0; k < 3000; ++k) {
+        assert(periods[k] == 3003);
+    }
+}
+
+static void test_underrun_holds_period(void) {
+    static stepgen_lane_t l;
+    stepgen_lane_reset(&l);
+    stepgen_ramp_plan(&l.ramp, 100000, 0.0f, 20000.0f, 0.0f, 0.0f);
+    stepgen_lane_fill(&l); // one fill, no refills
+
+    uint16_t p = 0;
+    for (uint32_t k = 0; k < 2000; ++k) {
+        p = stepgen_lane_next_period(&l);
+    }
+    assert(p == 50); // still 20 kHz: the last interval is held
+    assert(l.underruns > 0);
+}
+
+// Sample the S-curve finely: position/rate/accel stay continuous and within their limits.
+static void check_scurve_continuity(const stepgen_ramp_t* r, float v_max, float a_max, float j) {
+    const float dt = 1e-5f;
+    float s0, v0, a0;
+    stepgen_scurve_eval(r, 0.0f, &s0, &v0, &a0);
+    assert(s0 == 0.0f && v0 == 0.0f && a0 == 0.0f);
+
+    for (float t = dt; t < r->t_total + dt; t += dt) {
+        float s, v, a;
+        stepgen_scurve_eval(r, t, &s, &v, &a);
+        assert(s >= s0 - 1e-3f); // never runs backwards
+        assert(v <= v_max * 1.0001f && v >= -1e-3f);
+        assert(fabsf(a) <= a_max * 1.0001f);
+        assert(fabsf(v - v0) <= a_max * dt * 1.01f + 1e-2f); // velocity continuous
+        assert(fabsf(a - a0) <= j * dt * 1.01f + 1e-1f); // acceleration continuous
+        s0 = s;
+        v0 = v;
+        a0 = a;
+    }
+    assert(fabsf(s0 - (float)r->total) < 0.01f);
+    assert(fabsf(v0) < 0.5f && fabsf(a0) < 1.0f);
+}
+
+// Every emitted step lands within ~one step of where the profile says it should.
+static void check_scurve_stream(stepgen_lane_t* l, uint32_t steps) {
+    const stepgen_ramp_t r = l->ramp; // planning state before the lane consumes it
+    uint64_t total_us = 0;
+    assert(run_lane(l, steps, &total_us) == 0);
+    assert(l->head == l->tail && l->seg_left == 0);
+
+    uint64_t t = 0;
+    for (uint32_t m = 0; m < steps; ++m) {
+        float s, v, a;
+        stepgen_scurve_eval(&r, (float)t * 1e-6f, &s, &v, &a);
+        assert(fabsf(s - (float)m) <= 1.5f);
+        t += periods[m];
+    }
+    // Last interval ends the move: total time matches the profile
+    assert(fabs((double)total_us * 1e-6 - (double)r.t_total) < 0.002 + 0.001 * r.t_total);
+}
+
+static void test_scurve_profile(void) {
+    static stepgen_lane_t l;
+    const float v = 10000.0f, a = 50000.0f, j = 1000000.0f;
+
+    stepgen_lane_reset(&l);
+    stepgen_ramp_plan_scurve(&l.ramp, 20000, v, a, j);
+    assert(l.ramp.scurve);
+
+    // Analytic: t_j = a/j = 50 ms, t_c = v/a - t_j = 150 ms, ramps cover 1250 steps each,
+    // cruise (20000 - 2500) / v = 1.75 s -> 2 * 0.25 + 1.75 = 2.25 s
+    assert(fabsf(l.ramp.t_j - 0.05f) < 1e-6f);
+    assert(fabsf(l.ramp.t_c - 0.15f) < 1e-6f);
+    assert(fabsf(l.ramp.t_total - 2.25f) < 1e-4f);
+
+    check_scurve_continuity(&l.ramp, v, a, j);
+    check_scurve_stream(&l, 20000);
+}
+
+static void test_scurve_short_move(void) {
+    static stepgen_lane_t l;
+    const float v = 10000.0f, a = 50000.0f, j = 1000000.0f;
+
+    // 200 steps: neither the rate nor the acceleration limit is reached
+    stepgen_lane_reset(&l);
+    stepgen_ramp_plan_scurve(&l.ramp, 200, v, a, j);
+    assert(l.ramp.v_cruise < v && l.ramp.a_peak < a && l.ramp.t_c == 0.0f);
+
+    // Pure jerk phases: 200 = 2 * j * t_j^3 (each half covers j * t_j^3), T = 4 * t_j
+    const float tj = cbrtf(100.0f / j);
+    assert(fabsf(l.ramp.t_total - 4.0f * tj) < 1e-3f * 4.0f * tj);
+
+    check_scurve_continuity(&l.ramp, v, a, j);
+    check_scurve_stream(&l, 200);
+}
+
+static void test_scurve_fallbacks(void) {
+    stepgen_ramp_t r;
+    stepgen_ramp_plan_scurve(&r, 1000, 5000.0f, 50000.0f, 0.0f); // no jerk: trapezoid
+    assert(!r.scurve && r.accel_until == 250);
+    stepgen_ramp_plan_scurve(&r, 1000, 5000.0f, 0.0f, 1e6f); // no accel: constant rate
+    assert(!r.scurve && r.two_a == 0.0f);
+}
+
+int main(void) {
+    test_trapezoid_shape();
+    test_triangle();
+    test_entry_exit();
+    test_segments_conserve_steps();
+    test_lane_profile();
+    test_constant_rate_without_accel();
+    test_underrun_holds_period();
+    test_scurve_profile();
+    test_scurve_short_move();
+    test_scurve_fallbacks();
+
+    printf("All stepgen_ramp tests passed.\n");
+    return 0;
+}
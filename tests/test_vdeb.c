@@ -0,0 +1,217 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "vdeb.h"
+
+/*
+ * Limit / e-stop inputs: first-edge trip vs the polled debouncer, simulated at 1 us.
+ *
+ * The switch closes with contact bounce; SysTick samples it every 1000 us (vdeb_tick).
+ * Polled (the old path) the step ISR stops once `stable` is set; with the EXTI the first
+ * edge trips the input (vdeb_trip) and the hook stops the steps after the interrupt
+ * latency. Counts the steps a 20 kHz axis still issues after the contact either way, and
+ * checks that bounce trips once, that release and spikes re-arm the edge interrupt, and
+ * that a real press stays active until the debounced release. Each scenario runs in a lane
+ * of its own; the last test checks that lanes sharing one word do not disturb each other.
+ */
+
+#define TICKS 5
+#define STEP_HZ 20000U // Z at 6000 mm/min, 200 steps/mm
+#define CORE_MHZ 180U
+// EXTI entry (12 cycles) + handler up to stepgen_trip_all() returning; the target's $L
+// reports the measured value, this is the budget the estimate assumes
+#define EXTI_TO_HALT_CYCLES 90U
+
+/* Raw switch level over time: closes at t_on with bounce for bounce_us, opens at t_off */
+typedef struct {
+    uint32_t t_on, t_off, bounce_us;
+    uint32_t seed;
+} contact_t;
+
+static int contact_level(const contact_t* c, uint32_t t) {
+    if (t < c->t_on || t >= c->t_off) {
+        return 0;
+    }
+    const uint32_t dt = t - c->t_on;
+    if (dt >= c->bounce_us) {
+        return 1;
+    }
+    // Bounce: 1 at the first contact, then chatter in ~20-100 us slices
+    const uint32_t slice = dt / 37U;
+    return dt < 20U || (((slice * 2654435761U) ^ c->seed) >> 29) != 0;
+}
+
+typedef struct {
+    vdeb_t d;
+    uint32_t m; // this input's lane
+    int masked; // EXTI line masked
+    int edges; // edges that tripped
+    int rearms;
+    int prev;
+} input_t;
+
+static void input_init(input_t* in, uint32_t lane) {
+    *in = (input_t){0};
+    in->m = 1UL << lane;
+    vdeb_init(&in->d, 0, TICKS);
+}
+
+static int input_active(const input_t* in) {
+    return (vdeb_active(&in->d) & in->m) != 0U;
+}
+
+/* One microsecond: EXTI on rising edges, SysTick poll on ms boundaries */
+static void input_step(input_t* in, const contact_t* c, uint32_t t, uint32_t* trip_t,
+                       uint32_t* stable_t) {
+    const int lvl = contact_level(c, t);
+    if (lvl && !in->prev && !in->masked && vdeb_trip(&in->d, in->m)) {
+        in->masked = 1;
+        in->edges++;
+        if (*trip_t == 0) {
+            *trip_t = t;
+        }
+    }
+    in->prev = lvl;
+    if (t % 1000U == 0U) {
+        if (vdeb_tick(&in->d, lvl ? in->m : 0U) & in->m) {
+            in->masked = 0;
+            in->rearms++;
+        }
+        if ((in->d.stable & in->m) && *stable_t == 0) {
+            *stable_t = t;
+        }
+    }
+}
+
+/* Rising edges of a free-running step train in (from, to] */
+static uint32_t steps_between(uint32_t from, uint32_t to, uint32_t phase_us) {
+    const uint32_t period = 1000000U / STEP_HZ;
+    const uint32_t a = (from + period - phase_us % period) / period;
+    const uint32_t b = (to + period - phase_us % period) / period;
+    return b - a;
+}
+
+static void test_latency(void) {
+    const double exti_us = (double)EXTI_TO_HALT_CYCLES / CORE_MHZ;
+    double polled_sum = 0.0, polled_min = 1e9, polled_max = 0.0;
+    uint32_t polled_steps_max = 0, exti_steps_max = 0;
+    const int trials = 1000;
+    srand(13);
+    for (int k = 0; k < trials; ++k) {
+        contact_t c = {20000U + (uint32_t)(rand() % 1000), 40000U, 200U + (uint32_t)(rand() % 1500),
+                       (uint32_t)rand()};
+        input_t in;
+        input_init(&in, (uint32_t)k % 32U);
+        uint32_t trip_t = 0, stable_t = 0;
+        for (uint32_t t = 0; t < 30000U; ++t) {
+            input_step(&in, &c, t, &trip_t, &stable_t);
+        }
+        assert(trip_t == c.t_on && in.edges == 1 && stable_t > c.t_on); // bounce trips once
+        assert(input_active(&in) && in.rearms == 0);
+
+        const uint32_t phase = (uint32_t)rand();
+        // Polled: the step ISR sees `stable` at its next step and stops there
+        const uint32_t polled_steps = steps_between(c.t_on, stable_t, phase);
+        // EXTI: the hook runs exti_us after the edge; a pulse already high just completes
+        const uint32_t exti_steps = steps_between(c.t_on, c.t_on + (uint32_t)exti_us, phase);
+        const double ms = (stable_t - c.t_on) / 1000.0;
+        polled_sum += ms;
+        polled_min = ms < polled_min ? ms : polled_min;
+        polled_max = ms > polled_max ? ms : polled_max;
+        polled_steps_max = polled_steps > polled_steps_max ? polled_steps : polled_steps_max;
+        exti_steps_max = exti_steps > exti_steps_max ? exti_steps : exti_steps_max;
+    }
+    printf("edge -> stop: polled %.2f..%.2f ms (avg %.2f), up to %u steps at %u Hz | "
+           "EXTI %.2f us, %u steps\n",
+           polled_min, polled_max, polled_sum / trials, polled_steps_max, STEP_HZ, exti_us,
+           exti_steps_max);
+    assert(polled_min >= TICKS - 1 && polled_max <= TICKS + 2);
+    assert(polled_steps_max >= (TICKS - 1) * STEP_HZ / 1000U);
+    assert(exti_us < 1.0 && exti_steps_max <= 1U);
+}
+
+static void test_release_and_spikes(void) {
+    input_t in;
+    input_init(&in, 31);
+    uint32_t trip_t = 0, stable_t = 0;
+
+    // Press with bounce, release with bounce: one trip, one re-arm after the release
+    contact_t c = {2500U, 30000U, 1200U, 77U};
+    for (uint32_t t = 0; t < 30000U; ++t) {
+        input_step(&in, &c, t, &trip_t, &stable_t);
+        if (t > c.t_on && t < c.t_off) {
+            assert(input_active(&in)); // blocked from the first edge to the release
+        }
+    }
+    assert(in.edges == 1 && in.rearms == 0 && in.d.stable == in.m);
+    for (uint32_t t = 30000U; t < 40000U; ++t) {
+        input_step(&in, &c, t, &trip_t, &stable_t);
+    }
+    assert(in.rearms == 1 && !input_active(&in) && !in.masked);
+
+    // A 30 us spike trips once (the steps stop: the safe side), is never confirmed, and
+    // the line re-arms TICKS polls later; the next real press trips again
+    input_t sp;
+    input_init(&sp, 0);
+    trip_t = stable_t = 0;
+    contact_t spike = {5100U, 5130U, 0U, 0U};
+    for (uint32_t t = 0; t < 20000U; ++t) {
+        input_step(&sp, &spike, t, &trip_t, &stable_t);
+    }
+    assert(sp.edges == 1 && sp.rearms == 1 && stable_t == 0 && !input_active(&sp));
+    contact_t press = {21000U, 50000U, 300U, 5U};
+    for (uint32_t t = 20000U; t < 30000U; ++t) {
+        input_step(&sp, &press, t, &trip_t, &stable_t);
+    }
+    assert(sp.edges == 2 && sp.d.stable == sp.m);
+
+    // Seeded pressed (switch held at power-up): starts tripped, edge IRQ stays masked
+    vdeb_t d;
+    vdeb_init(&d, 1U << 7, TICKS);
+    assert(vdeb_active(&d) == (1U << 7) && vdeb_trip(&d, 1U << 7) == 0U);
+    int rearms = 0;
+    for (int t = 0; t < 2 * TICKS; ++t) {
+        rearms += (vdeb_tick(&d, 0) & (1U << 7)) != 0U;
+    }
+    assert(rearms == 1 && vdeb_active(&d) == 0U);
+}
+
+/* Lanes of one word: their own ticks, simultaneous edges, no cross-talk */
+static void test_lanes(void) {
+    vdeb_t d;
+    vdeb_init(&d, 0, TICKS);
+    const uint32_t fast = 0x0000000FU, slow = 0x00F00000U, idle = ~(fast | slow);
+    vdeb_set(&d, fast, 0, 2);
+    vdeb_set(&d, slow, 0, 7);
+
+    // Both groups press in the same tick: each flips after its own count
+    assert(vdeb_trip(&d, fast | slow) == (fast | slow));
+    assert(vdeb_trip(&d, fast) == 0U); // bounce: already tripped
+    for (int t = 1; t <= 7; ++t) {
+        assert(vdeb_tick(&d, fast | slow) == 0U);
+        assert(d.rose == (t == 2 ? fast : t == 7 ? slow : 0U));
+        assert(d.stable == (t < 2 ? 0U : t < 7 ? fast : (fast | slow)));
+        assert(vdeb_active(&d) == (fast | slow));
+    }
+
+    // One lane of each group releases; a chattering sample resets only its own lane
+    const uint32_t rel = 0x00100001U;
+    uint32_t rearmed = 0;
+    for (int t = 1; t <= 9; ++t) {
+        const uint32_t chatter = t == 3 ? 0x00200000U : 0U; // a held slow lane blips open
+        rearmed |= vdeb_tick(&d, ((fast | slow) & ~rel & ~chatter));
+        assert(d.fell == (t == 2 ? (rel & fast) : t == 7 ? (rel & slow) : 0U));
+        assert((d.stable & idle) == 0U && (vdeb_active(&d) & idle) == 0U);
+    }
+    assert(rearmed == rel && vdeb_active(&d) == ((fast | slow) & ~rel));
+}
+
+int main(void) {
+    test_latency();
+    test_release_and_spikes();
+    test_lanes();
+    printf("All switch debounce tests passed.\n");
+    return 0;
+}